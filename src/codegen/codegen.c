@@ -2,9 +2,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 
 #include "parser.h"
 #include "symbols.h"
+#include "optimizer.h"
+#include "cfg.h"
+#include "regalloc.h"
 #include "ctype.h"
 
 #define MAX_BUFFER 1024
@@ -18,6 +23,26 @@ int next_label_number = 0;
 static TablaSimbolos *global_symbol_table_ref;
 static TablaSimbolos *ambito_actual = NULL;
 
+static NameTable *ir_type_names = NULL;
+static enum TipoDato *ir_types = NULL;
+static int ir_types_capacity = 0;
+
+static NameTable *ir_frame_names = NULL;
+static int *ir_frame_slots = NULL;
+static int ir_frame_capacity = 0;
+
+// Variables de bloque cuya declaración ya se tradujo (por su nombre en el IR)
+static NameTable *declared_scoped_names = NULL;
+
+typedef struct
+{
+    int renglon;
+    int columna;
+} SourcePosition;
+
+// Posición que reciben los cuádruplos emitidos; la fija el nodo que se está traduciendo
+static SourcePosition source_position = {0, 0};
+
 #define MAX_LOOP_NESTING 100
 
 static char *break_labels_stack[MAX_LOOP_NESTING];
@@ -70,23 +95,142 @@ static char *get_current_continue_label()
 
 static void generate_code_for_node(ASTNode *node);
 static char *generate_code_for_expression(ASTNode *expr_node);
+static void generate_code_for_condition(ASTNode *cond_node, int jump_when, const char *target_label);
 static void generate_code_for_statement(ASTNode *stmt_node);
 static void generate_code_for_declaration(ASTNode *decl_node);
 static void generate_code_for_if_statement(ASTNode *if_node);
 static void generate_code_for_while_statement(ASTNode *while_node);
 static void generate_code_for_for_statement(ASTNode *for_node);
 
+/*
+ * Los cuádruplos toman la posición del nodo más interno que se está
+ * traduciendo; al volver de un hijo se recupera la del padre.
+ */
+static SourcePosition enter_source_position(const ASTNode *node)
+{
+    SourcePosition saved = source_position;
+    if (node->renglon > 0)
+    {
+        source_position.renglon = node->renglon;
+        source_position.columna = node->columna;
+    }
+    return saved;
+}
+
+static void leave_source_position(SourcePosition saved)
+{
+    source_position = saved;
+}
+
+/*
+ * Nombre en el IR de una variable declarada en un ámbito de bloque: el del
+ * fuente precedido por el número del ámbito. Los identificadores del fuente
+ * empiezan con letra, así que nunca chocan con él.
+ */
+static char *scoped_name(const TablaSimbolos *ambito, const char *nombre)
+{
+    char buffer[MAX_BUFFER];
+    snprintf(buffer, sizeof(buffer), "_%d_%s", ambito->id_ambito, nombre);
+    return strdup(buffer);
+}
+
+/*
+ * Busca un identificador como lo hizo el análisis semántico: del ámbito actual
+ * hacia afuera, contando en los ámbitos de bloque solo las declaraciones que ya
+ * se tradujeron. Devuelve la entrada y deja en *ir_name su nombre en el IR.
+ */
+static EntradaSimbolo *resolve_identifier(const char *nombre, char **ir_name)
+{
+    for (TablaSimbolos *ambito = ambito_actual; ambito != NULL; ambito = ambito->padre)
+    {
+        EntradaSimbolo *symbol = buscar_simbolo_en_ambito_actual(ambito, nombre);
+        if (symbol == NULL)
+            continue;
+        if (ambito->padre == NULL)
+        {
+            *ir_name = strdup(nombre);
+            return symbol;
+        }
+        char *name = scoped_name(ambito, nombre);
+        if (lookup_name(declared_scoped_names, name) != -1)
+        {
+            *ir_name = name;
+            return symbol;
+        }
+        free(name);
+    }
+    *ir_name = strdup(nombre);
+    return NULL;
+}
+
+/* Nombre en el IR de una variable que se asigna o se lee de la entrada. */
+static char *variable_ir_name(const char *nombre)
+{
+    char *ir_name;
+    resolve_identifier(nombre, &ir_name);
+    return ir_name;
+}
+
 void generar_codigo_intermedio(ASTNode *root_ast_node, TablaSimbolos *global_sym_table)
 {
     if (!root_ast_node)
     {
         return;
     }
+    traducir_ast_a_ir(root_ast_node, global_sym_table);
+    finalizar_codigo_intermedio();
+}
+
+/*
+ * Las variables de bloque enteras viven en el marco de main. Dos ámbitos
+ * hermanos nunca están activos a la vez, así que empiezan en el mismo
+ * desplazamiento y comparten lugares; los hijos van debajo de las variables
+ * de su padre. Devuelve el desplazamiento más profundo del subárbol.
+ */
+static int assign_frame_slots(const TablaSimbolos *ambito, int base)
+{
+    int top = base;
+    for (int c = 0; c < CUBETAS_TABLA_SIMBOLOS; c++)
+    {
+        for (EntradaSimbolo *e = ambito->cubetas[c]; e != NULL; e = e->siguiente_en_cubeta)
+        {
+            if (e->tipo != INT && e->tipo != BOOL && e->tipo != CHAR)
+                continue;
+            top += 8;
+            char *name = scoped_name(ambito, e->nombre);
+            set_ir_frame_slot(name, top);
+            free(name);
+        }
+    }
+
+    int deepest = top;
+    for (int h = 0; h < ambito->num_hijos; h++)
+    {
+        int child = assign_frame_slots(ambito->hijos[h], top);
+        if (child > deepest)
+            deepest = child;
+    }
+    return deepest;
+}
+
+void traducir_ast_a_ir(ASTNode *root_ast_node, TablaSimbolos *global_sym_table)
+{
     init_ir_generator();
     global_symbol_table_ref = global_sym_table;
     ambito_actual = global_sym_table;
 
-    generate_code_for_node(root_ast_node);
+    if (global_sym_table)
+    {
+        for (int h = 0; h < global_sym_table->num_hijos; h++)
+            assign_frame_slots(global_sym_table->hijos[h], 0);
+    }
+
+    if (root_ast_node)
+        generate_code_for_node(root_ast_node);
+}
+
+void finalizar_codigo_intermedio()
+{
     optimize_ir_code();
 
     emit_quad(IR_HALT, NULL, NULL, NULL);
@@ -106,6 +250,74 @@ void init_ir_generator()
     ir_current_size = 0;
     next_temp_number = 0;
     next_label_number = 0;
+    source_position.renglon = 0;
+    source_position.columna = 0;
+
+    destroy_name_table(ir_type_names);
+    ir_type_names = create_name_table(INITIAL_IR_CAPACITY);
+    destroy_name_table(ir_frame_names);
+    ir_frame_names = create_name_table(16);
+    destroy_name_table(declared_scoped_names);
+    declared_scoped_names = create_name_table(16);
+}
+
+void set_ir_type(const char *name, enum TipoDato tipo)
+{
+    if (!is_valid_varname(name))
+        return;
+
+    int id = intern_name(ir_type_names, name);
+
+    if (id >= ir_types_capacity)
+    {
+        ir_types_capacity = ir_types_capacity == 0 ? INITIAL_IR_CAPACITY : ir_types_capacity * 2;
+        ir_types = realloc(ir_types, ir_types_capacity * sizeof(enum TipoDato));
+        if (ir_types == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo redimensionar la tabla de tipos del código intermedio.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    ir_types[id] = tipo;
+}
+
+enum TipoDato get_ir_type(const char *name)
+{
+    if (name == NULL)
+        return OTRO;
+    if (name[0] == '"')
+        return STRING;
+    if (es_literal(name))
+        return strchr(name, '.') ? FLOAT : INT;
+
+    int id = ir_type_names ? lookup_name(ir_type_names, name) : -1;
+    return id == -1 ? OTRO : ir_types[id];
+}
+
+void set_ir_frame_slot(const char *name, int offset)
+{
+    if (!is_valid_varname(name))
+        return;
+
+    int id = intern_name(ir_frame_names, name);
+
+    if (id >= ir_frame_capacity)
+    {
+        ir_frame_capacity = ir_frame_capacity == 0 ? 16 : ir_frame_capacity * 2;
+        ir_frame_slots = realloc(ir_frame_slots, ir_frame_capacity * sizeof(int));
+        if (ir_frame_slots == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo redimensionar la tabla del marco de pila.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    ir_frame_slots[id] = offset;
+}
+
+int get_ir_frame_slot(const char *name)
+{
+    int id = name && ir_frame_names ? lookup_name(ir_frame_names, name) : -1;
+    return id == -1 ? 0 : ir_frame_slots[id];
 }
 
 void emit_quad(IROperation op, const char *arg1, const char *arg2, const char *result)
@@ -126,10 +338,18 @@ void emit_quad(IROperation op, const char *arg1, const char *arg2, const char *r
     q->arg1 = (arg1 != NULL) ? strdup(arg1) : NULL;
     q->arg2 = (arg2 != NULL) ? strdup(arg2) : NULL;
     q->result = (result != NULL) ? strdup(result) : NULL;
+    q->renglon = source_position.renglon;
+    q->columna = source_position.columna;
 
     ir_current_size++;
 }
 
+void set_ir_source_position(int renglon, int columna)
+{
+    source_position.renglon = renglon;
+    source_position.columna = columna;
+}
+
 void free_ir_code()
 {
     if (ir_code == NULL)
@@ -165,6 +385,46 @@ char *new_label()
     return strdup(label_name_buffer);
 }
 
+void reserve_ir_name(const char *name)
+{
+    if (name == NULL || (name[0] != 't' && name[0] != 'L') || !isdigit((unsigned char)name[1]))
+        return;
+
+    char *end;
+    long number = strtol(name + 1, &end, 10);
+    if (*end != '\0' || number >= INT_MAX)
+        return;
+
+    if (name[0] == 't' && number >= next_temp_number)
+        next_temp_number = (int)number + 1;
+    else if (name[0] == 'L' && number >= next_label_number)
+        next_label_number = (int)number + 1;
+}
+
+void *xcalloc(size_t size)
+{
+    void *p = calloc(1, size > 0 ? size : 1);
+    if (p == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+char *xstrdup(const char *s)
+{
+    if (s == NULL)
+        return NULL;
+    char *copy = strdup(s);
+    if (copy == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria.\n");
+        exit(EXIT_FAILURE);
+    }
+    return copy;
+}
+
 static void generate_code_for_node(ASTNode *node)
 {
     if (!node)
@@ -172,6 +432,7 @@ static void generate_code_for_node(ASTNode *node)
         return;
     }
 
+    SourcePosition saved_position = enter_source_position(node);
     switch (node->type)
     {
     case AST_PROGRAMA:
@@ -179,12 +440,9 @@ static void generate_code_for_node(ASTNode *node)
     case AST_BLOQUE:
         TablaSimbolos *ambito_anterior = ambito_actual;
 
-        if (ambito_actual->num_hijos > 0)
-        {
-            ambito_actual = ambito_actual->hijos[0];
-        }
-        else
+        if (node->ambito != NULL)
         {
+            ambito_actual = node->ambito;
         }
 
         ASTNode *child = node->hijo_izq;
@@ -266,6 +524,50 @@ static void generate_code_for_node(ASTNode *node)
         fprintf(stderr, "Error at %d:%d: Error interno del compilador: Tipo de nodo AST no reconocido en generación de CI.\n", node->renglon, node->columna);
         break;
     }
+    leave_source_position(saved_position);
+}
+
+/*
+ * Número de Sethi–Ullman de una expresión: cuántos temporales deben estar
+ * vivos a la vez para evaluarla. Una hoja no necesita ninguno (se usa por su
+ * nombre); un operador necesita uno más si sus dos operandos requieren lo
+ * mismo, y si no, lo que requiere el más costoso.
+ */
+static int expression_need(ASTNode *expr_node)
+{
+    if (!expr_node)
+        return 0;
+    if (expr_node->ir_need >= 0)
+        return expr_node->ir_need;
+
+    int need;
+    switch (expr_node->type)
+    {
+    case AST_LITERAL_ENTERO:
+    case AST_LITERAL_FLOTANTE:
+    case AST_LITERAL_CADENA:
+    case AST_LITERAL_BOOLEANO:
+    case AST_IDENTIFICADOR:
+        need = 0;
+        break;
+    case AST_NEGACION_UNARIA_EXPR:
+    case AST_NOT_EXPR:
+    {
+        int operand_need = expression_need(expr_node->hijo_izq);
+        need = operand_need > 1 ? operand_need : 1;
+        break;
+    }
+    default:
+    {
+        int left_need = expression_need(expr_node->hijo_izq);
+        int right_need = expression_need(expr_node->hijo_der);
+        need = left_need == right_need ? left_need + 1 : (left_need > right_need ? left_need : right_need);
+        break;
+    }
+    }
+
+    expr_node->ir_need = need;
+    return need;
 }
 
 static char *generate_code_for_expression(ASTNode *expr_node)
@@ -280,13 +582,15 @@ static char *generate_code_for_expression(ASTNode *expr_node)
         return expr_node->ir_result_name;
     }
 
+    SourcePosition saved_position = enter_source_position(expr_node);
+
     char *result_name = NULL;
     char buffer[256];
 
     switch (expr_node->type)
     {
     case AST_LITERAL_ENTERO:
-        sprintf(buffer, "%d", (int)expr_node->valor.valor_numero);
+        sprintf(buffer, "%lld", (long long)expr_node->valor.valor_numero);
         result_name = strdup(buffer);
         break;
     case AST_LITERAL_FLOTANTE:
@@ -304,7 +608,10 @@ static char *generate_code_for_expression(ASTNode *expr_node)
     case AST_IDENTIFICADOR:
     {
 
-        EntradaSimbolo *symbol = buscar_simbolo_ambitos(ambito_actual, expr_node->valor.nombre_id);
+        char *ir_name;
+        EntradaSimbolo *symbol = resolve_identifier(expr_node->valor.nombre_id, &ir_name);
+        if (!symbol || symbol->es_constante)
+            free(ir_name);
         if (!symbol)
         {
 
@@ -323,6 +630,7 @@ static char *generate_code_for_expression(ASTNode *expr_node)
                 sprintf(buffer, "%f", symbol->valor_constante.valor_float);
                 break;
             case STRING:
+                leave_source_position(saved_position);
                 return strdup(symbol->valor_constante.valor_cadena);
             case BOOL:
                 sprintf(buffer, "%d", symbol->valor_constante.valor_bool ? 1 : 0);
@@ -337,7 +645,7 @@ static char *generate_code_for_expression(ASTNode *expr_node)
         else
         {
 
-            result_name = strdup(expr_node->valor.nombre_id);
+            result_name = ir_name;
         }
         break;
     }
@@ -373,8 +681,19 @@ static char *generate_code_for_expression(ASTNode *expr_node)
     case AST_MENOR_IGUAL_EXPR:
     case AST_MAYOR_IGUAL_EXPR:
     {
-        char *left_operand = generate_code_for_expression(expr_node->hijo_izq);
-        char *right_operand = generate_code_for_expression(expr_node->hijo_der);
+        // Primero el operando más costoso, para que el otro no retenga su temporal
+        char *left_operand;
+        char *right_operand;
+        if (expression_need(expr_node->hijo_der) > expression_need(expr_node->hijo_izq))
+        {
+            right_operand = generate_code_for_expression(expr_node->hijo_der);
+            left_operand = generate_code_for_expression(expr_node->hijo_izq);
+        }
+        else
+        {
+            left_operand = generate_code_for_expression(expr_node->hijo_izq);
+            right_operand = generate_code_for_expression(expr_node->hijo_der);
+        }
         char *temp = new_temp();
 
         IROperation op_code;
@@ -435,10 +754,64 @@ static char *generate_code_for_expression(ASTNode *expr_node)
         break;
     }
 
+    set_ir_type(result_name, expr_node->resolved_type);
     expr_node->ir_result_name = result_name;
+    leave_source_position(saved_position);
     return result_name;
 }
 
+/*
+ * Código de saltos para una condición: salta a target_label cuando la
+ * condición vale jump_when (0 o 1) y continúa en la siguiente instrucción en
+ * otro caso. '&&', '||' y '!' se traducen a saltos, así que cada operando se
+ * evalúa solo si hace falta (corto circuito) y sus resultados parciales nunca
+ * se guardan en temporales.
+ */
+static void generate_code_for_condition(ASTNode *cond_node, int jump_when, const char *target_label)
+{
+    SourcePosition saved_position = enter_source_position(cond_node);
+    switch (cond_node->type)
+    {
+    case AST_NOT_EXPR:
+        generate_code_for_condition(cond_node->hijo_izq, !jump_when, target_label);
+        break;
+
+    case AST_AND_EXPR:
+    case AST_OR_EXPR:
+    {
+        // a && b es falso en cuanto a es falso; a || b es verdadero en cuanto a es verdadero
+        int short_value = cond_node->type == AST_OR_EXPR;
+        if (jump_when == short_value)
+        {
+            generate_code_for_condition(cond_node->hijo_izq, jump_when, target_label);
+            generate_code_for_condition(cond_node->hijo_der, jump_when, target_label);
+        }
+        else
+        {
+            char *skip_label = new_label();
+            generate_code_for_condition(cond_node->hijo_izq, short_value, skip_label);
+            generate_code_for_condition(cond_node->hijo_der, jump_when, target_label);
+            emit_quad(IR_LABEL, NULL, NULL, skip_label);
+            free(skip_label);
+        }
+        break;
+    }
+
+    case AST_LITERAL_BOOLEANO:
+        if ((cond_node->valor.valor_booleano ? 1 : 0) == jump_when)
+            emit_quad(IR_GOTO, NULL, NULL, target_label);
+        break;
+
+    default:
+    {
+        char *condition_result = generate_code_for_expression(cond_node);
+        emit_quad(jump_when ? IR_IF_TRUE_GOTO : IR_IF_FALSE_GOTO, condition_result, NULL, target_label);
+        break;
+    }
+    }
+    leave_source_position(saved_position);
+}
+
 static void generate_code_for_statement(ASTNode *stmt_node)
 {
     if (!stmt_node)
@@ -451,10 +824,12 @@ static void generate_code_for_statement(ASTNode *stmt_node)
     case AST_ASIGNACION_STMT:
     {
 
-        char *var_name = stmt_node->hijo_izq->valor.nombre_id;
+        char *var_name = variable_ir_name(stmt_node->hijo_izq->valor.nombre_id);
         char *expr_result = generate_code_for_expression(stmt_node->hijo_der);
 
+        set_ir_type(var_name, stmt_node->hijo_izq->resolved_type);
         emit_quad(IR_ASSIGN, expr_result, NULL, var_name);
+        free(var_name);
         break;
     }
     case AST_MOSTRAR_STMT:
@@ -471,8 +846,10 @@ static void generate_code_for_statement(ASTNode *stmt_node)
     case AST_LEER_STMT:
     {
 
-        char *read_target = stmt_node->hijo_izq->valor.nombre_id;
+        char *read_target = variable_ir_name(stmt_node->hijo_izq->valor.nombre_id);
+        set_ir_type(read_target, stmt_node->hijo_izq->resolved_type);
         emit_quad(IR_READ, NULL, NULL, read_target);
+        free(read_target);
         break;
     }
     default:
@@ -488,13 +865,29 @@ static void generate_code_for_declaration(ASTNode *decl_node)
         return;
     }
 
-    if (decl_node->hijo_der != NULL)
+    // Como en el análisis semántico, una variable ya es visible en su
+    // inicializador y una constante solo después de él
+    const char *nombre = decl_node->hijo_izq->valor.nombre_id;
+    char *expr_result = NULL;
+    if (decl_node->type == AST_DECLARACION_CONST && decl_node->hijo_der != NULL)
+        expr_result = generate_code_for_expression(decl_node->hijo_der);
+
+    char *var_name = ambito_actual->padre == NULL ? strdup(nombre) : scoped_name(ambito_actual, nombre);
+    if (ambito_actual->padre != NULL)
+        intern_name(declared_scoped_names, var_name);
+
+    if (decl_node->type == AST_DECLARACION_VAR)
     {
+        set_ir_type(var_name, decl_node->declared_type_info);
+        if (decl_node->hijo_der != NULL)
+            expr_result = generate_code_for_expression(decl_node->hijo_der);
+        else if (get_ir_frame_slot(var_name) != 0)
+            expr_result = strdup("0"); // el lugar en el marco lo pudo usar un ámbito hermano
+    }
 
-        char *var_name = decl_node->hijo_izq->valor.nombre_id;
-        char *expr_result = generate_code_for_expression(decl_node->hijo_der);
+    if (expr_result != NULL)
         emit_quad(IR_ASSIGN, expr_result, NULL, var_name);
-    }
+    free(var_name);
 }
 
 static void generate_code_for_if_statement(ASTNode *if_node)
@@ -504,30 +897,30 @@ static void generate_code_for_if_statement(ASTNode *if_node)
         return;
     }
 
-    char *condition_result = generate_code_for_expression(if_node->hijo_izq);
+    ASTNode *else_node = if_node->hijo_der->siguiente_hermano;
 
+    // Sin 'Sino' basta una etiqueta: la condición falsa salta al final del 'Si'
     char *else_label = new_label();
-    char *end_if_label = new_label();
+    char *end_if_label = else_node ? new_label() : NULL;
 
-    emit_quad(IR_IF_FALSE_GOTO, condition_result, NULL, else_label);
+    generate_code_for_condition(if_node->hijo_izq, 0, else_label);
 
     generate_code_for_node(if_node->hijo_der);
 
-    if (if_node->hijo_der->siguiente_hermano)
+    if (else_node)
     {
         emit_quad(IR_GOTO, NULL, NULL, end_if_label);
     }
 
     emit_quad(IR_LABEL, NULL, NULL, else_label);
 
-    if (if_node->hijo_der->siguiente_hermano)
+    if (else_node)
     {
-        generate_code_for_node(if_node->hijo_der->siguiente_hermano);
+        generate_code_for_node(else_node);
 
         emit_quad(IR_LABEL, NULL, NULL, end_if_label);
     }
 
-    free(condition_result);
     free(else_label);
     free(end_if_label);
 }
@@ -546,9 +939,7 @@ static void generate_code_for_while_statement(ASTNode *while_node)
 
     emit_quad(IR_LABEL, NULL, NULL, loop_start_label);
 
-    char *condition_result = generate_code_for_expression(while_node->hijo_izq);
-
-    emit_quad(IR_IF_FALSE_GOTO, condition_result, NULL, loop_end_label);
+    generate_code_for_condition(while_node->hijo_izq, 0, loop_end_label);
 
     generate_code_for_node(while_node->hijo_der);
 
@@ -589,39 +980,60 @@ static void generate_code_for_for_statement(ASTNode *for_node)
     char *loop_increment_label = new_label();
     char *loop_end_label = new_label();
 
+    TablaSimbolos *ambito_anterior = ambito_actual;
+    if (for_node->ambito != NULL)
+        ambito_actual = for_node->ambito;
+
     push_loop_labels(loop_end_label, loop_increment_label);
 
     if (init_node)
         generate_code_for_node(init_node);
 
-    emit_quad(IR_LABEL, NULL, NULL, loop_condition_label);
-
-    char *condition_result = NULL;
-    if (condition_node)
-        condition_result = generate_code_for_expression(condition_node);
-    else
+    // 'Paso' se evalúa una sola vez, antes de la primera vuelta; una variable
+    // se copia para que el cuerpo pueda cambiarla sin alterar el paso
+    char *step_operand = NULL;
+    if (increment_node && increment_node->type == AST_PASO_STMT)
     {
-        condition_result = new_temp();
-        emit_quad(IR_ASSIGN, "1", NULL, condition_result);
+        ASTNode *step_node = increment_node->hijo_der;
+        step_operand = generate_code_for_expression(step_node);
+        if (step_node->type == AST_IDENTIFICADOR && !es_literal(step_operand))
+        {
+            char *copy = new_temp();
+            set_ir_type(copy, step_node->resolved_type);
+            emit_quad(IR_ASSIGN, step_operand, NULL, copy);
+            step_operand = copy;
+        }
     }
 
-    emit_quad(IR_IF_FALSE_GOTO, condition_result, NULL, loop_end_label);
+    emit_quad(IR_LABEL, NULL, NULL, loop_condition_label);
+
+    // Sin condición el ciclo solo termina con 'Romper'
+    if (condition_node)
+        generate_code_for_condition(condition_node, 0, loop_end_label);
 
     generate_code_for_node(body_node);
 
     emit_quad(IR_LABEL, NULL, NULL, loop_increment_label);
 
-    if (increment_node)
+    if (step_operand)
+    {
+        // i = i + k en un solo cuádruplo: la forma de variable de inducción que reconocen los ciclos
+        SourcePosition saved_position = enter_source_position(increment_node);
+        char *var_name = variable_ir_name(increment_node->hijo_izq->valor.nombre_id);
+        set_ir_type(var_name, increment_node->hijo_izq->resolved_type);
+        emit_quad(IR_ADD, var_name, step_operand, var_name);
+        free(var_name);
+        leave_source_position(saved_position);
+    }
+    else if (increment_node)
         generate_code_for_node(increment_node);
 
     emit_quad(IR_GOTO, NULL, NULL, loop_condition_label);
 
     emit_quad(IR_LABEL, NULL, NULL, loop_end_label);
 
-    if (condition_result)
-        free(condition_result);
-
     pop_loop_labels();
+    ambito_actual = ambito_anterior;
 }
 
 Quadruple *get_ir_code()
@@ -634,6 +1046,71 @@ int get_ir_code_size()
     return ir_current_size;
 }
 
+const char *ir_op_name(IROperation op)
+{
+    switch (op)
+    {
+    case IR_ADD:
+        return "ADD";
+    case IR_SUB:
+        return "SUB";
+    case IR_MUL:
+        return "MUL";
+    case IR_DIV:
+        return "DIV";
+    case IR_MOD:
+        return "MOD";
+    case IR_NEG:
+        return "NEG";
+    case IR_LT:
+        return "LT";
+    case IR_GT:
+        return "GT";
+    case IR_LE:
+        return "LE";
+    case IR_GE:
+        return "GE";
+    case IR_EQ:
+        return "EQ";
+    case IR_NE:
+        return "NE";
+    case IR_AND:
+        return "AND";
+    case IR_OR:
+        return "OR";
+    case IR_NOT:
+        return "NOT";
+    case IR_SHL:
+        return "SHL";
+    case IR_SHR:
+        return "SHR";
+    case IR_BAND:
+        return "BAND";
+    case IR_UDIV:
+        return "UDIV";
+    case IR_UMOD:
+        return "UMOD";
+    case IR_ASSIGN:
+        return "ASSIGN";
+    case IR_LABEL:
+        return "LABEL";
+    case IR_GOTO:
+        return "GOTO";
+    case IR_IF_FALSE_GOTO:
+        return "IF_FALSE_GOTO";
+    case IR_IF_TRUE_GOTO:
+        return "IF_TRUE_GOTO";
+    case IR_PRINT:
+        return "PRINT";
+    case IR_READ:
+        return "READ";
+    case IR_HALT:
+        return "HALT";
+    default:
+        return "UNKNOWN_OP";
+    }
+}
+
 void imprimir_codigo_intermedio()
 {
     printf("\n--- Código Intermedio (Cuádruplos) ---\n");
@@ -642,78 +1119,7 @@ void imprimir_codigo_intermedio()
         Quadruple q = ir_code[i];
         printf("%d: (", i);
 
-        switch (q.op)
-        {
-        case IR_ADD:
-            printf("ADD");
-            break;
-        case IR_SUB:
-            printf("SUB");
-            break;
-        case IR_MUL:
-            printf("MUL");
-            break;
-        case IR_DIV:
-            printf("DIV");
-            break;
-        case IR_MOD:
-            printf("MOD");
-            break;
-        case IR_NEG:
-            printf("NEG");
-            break;
-        case IR_LT:
-            printf("LT");
-            break;
-        case IR_GT:
-            printf("GT");
-            break;
-        case IR_LE:
-            printf("LE");
-            break;
-        case IR_GE:
-            printf("GE");
-            break;
-        case IR_EQ:
-            printf("EQ");
-            break;
-        case IR_NE:
-            printf("NE");
-            break;
-        case IR_AND:
-            printf("AND");
-            break;
-        case IR_OR:
-            printf("OR");
-            break;
-        case IR_NOT:
-            printf("NOT");
-            break;
-        case IR_ASSIGN:
-            printf("ASSIGN");
-            break;
-        case IR_LABEL:
-            printf("LABEL");
-            break;
-        case IR_GOTO:
-            printf("GOTO");
-            break;
-        case IR_IF_FALSE_GOTO:
-            printf("IF_FALSE_GOTO");
-            break;
-        case IR_PRINT:
-            printf("PRINT");
-            break;
-        case IR_READ:
-            printf("READ");
-            break;
-        case IR_HALT:
-            printf("HALT");
-            break;
-        default:
-            printf("UNKNOWN_OP");
-            break;
-        }
+        printf("%s", ir_op_name(q.op));
         printf(", ");
 
         printf("%s, ", q.arg1 ? q.arg1 : "NULL");
@@ -752,19 +1158,6 @@ static int es_flotante(const char *s)
     return punto == 1;
 }
 
-static int usar_temp(const char *temp, int desde)
-{
-    for (int i = desde; i < ir_current_size; i++)
-    {
-        if ((ir_code[i].arg1 && strcmp(ir_code[i].arg1, temp) == 0) ||
-            (ir_code[i].arg2 && strcmp(ir_code[i].arg2, temp) == 0))
-        {
-            return 1;
-        }
-    }
-    return 0;
-}
-
 int es_literal(const char *s)
 {
     if (!s)
@@ -776,115 +1169,103 @@ int es_literal(const char *s)
 }
 void optimize_ir_code()
 {
+    run_optimization_passes();
+}
+
+void compact_ir_code()
+{
+    int nueva_pos = 0;
     for (int i = 0; i < ir_current_size; i++)
     {
-        Quadruple *q = &ir_code[i];
-
-        if (q->arg1 && q->arg2 && q->result &&
-            es_literal(q->arg1) && es_literal(q->arg2))
+        if (ir_code[i].op != IR_REMOVED)
         {
-            double a = atof(q->arg1);
-            double b = atof(q->arg2);
-            double r;
-            int valido = 1;
+            if (i != nueva_pos)
+                ir_code[nueva_pos] = ir_code[i];
+            nueva_pos++;
+        }
+    }
+    ir_current_size = nueva_pos;
+}
 
-            switch (q->op)
-            {
-            case IR_ADD:
-                r = a + b;
-                break;
-            case IR_SUB:
-                r = a - b;
-                break;
-            case IR_MUL:
-                r = a * b;
-                break;
-            case IR_DIV:
-                if (b != 0)
-                    r = a / b;
-                else
-                    valido = 0;
-                break;
-            case IR_MOD:
-                if ((int)b != 0)
-                    r = (int)a % (int)b;
-                else
-                    valido = 0;
-                break;
-            default:
-                valido = 0;
-                break;
-            }
-
-            if (valido)
-            {
-                char buffer[64];
-                if (r == (int)r)
-                    sprintf(buffer, "%d", (int)r);
-                else
-                    sprintf(buffer, "%f", r);
-
-                q->op = IR_ASSIGN;
-                free(q->arg1);
-                free(q->arg2);
-                q->arg1 = strdup(buffer);
-                q->arg2 = NULL;
-            }
-        }
-
-        if (q->op == IR_ASSIGN && q->arg1 && q->result && q->result[0] == 't')
+void add_pending_quad(PendingQuads *pending, int position, int order, IROperation op, const char *arg1,
+                      const char *arg2, const char *result, const Quadruple *origin)
+{
+    if (pending->count == pending->capacity)
+    {
+        pending->capacity = pending->capacity == 0 ? 16 : pending->capacity * 2;
+        pending->quads = realloc(pending->quads, pending->capacity * sizeof(PendingQuad));
+        if (pending->quads == NULL)
         {
-            const char *src = q->arg1;
-            const char *dest = q->result;
+            fprintf(stderr, "Error: No se pudo asignar memoria para el código intermedio.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    PendingQuad *p = &pending->quads[pending->count];
+    p->position = position;
+    p->order = order;
+    p->sequence = pending->count++;
+    p->quad.op = op;
+    p->quad.arg1 = xstrdup(arg1);
+    p->quad.arg2 = xstrdup(arg2);
+    p->quad.result = xstrdup(result);
+    p->quad.renglon = origin != NULL ? origin->renglon : 0;
+    p->quad.columna = origin != NULL ? origin->columna : 0;
+}
 
-            for (int j = i + 1; j < ir_current_size; j++)
-            {
-                Quadruple *q2 = &ir_code[j];
+static int compare_pending_quads(const void *a, const void *b)
+{
+    const PendingQuad *x = a;
+    const PendingQuad *y = b;
+    if (x->position != y->position)
+        return x->position < y->position ? -1 : 1;
+    if (x->order != y->order)
+        return x->order < y->order ? -1 : 1;
+    return x->sequence < y->sequence ? -1 : x->sequence > y->sequence ? 1 : 0;
+}
 
-                if (q2->arg1 && strcmp(q2->arg1, dest) == 0)
-                {
-                    free(q2->arg1);
-                    q2->arg1 = strdup(src);
-                }
-                if (q2->arg2 && strcmp(q2->arg2, dest) == 0)
-                {
-                    free(q2->arg2);
-                    q2->arg2 = strdup(src);
-                }
+void splice_pending_quads(PendingQuads *pending)
+{
+    qsort(pending->quads, pending->count, sizeof(PendingQuad), compare_pending_quads);
 
-                if (q2->result && strcmp(q2->result, dest) == 0)
-                    break;
-            }
-        }
+    // Un arreglo nuevo con el IR y los pendientes intercalados en su lugar
+    int capacity = ir_current_size + pending->count + 1;
+    Quadruple *merged = malloc(capacity * sizeof(Quadruple));
+    if (merged == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el código intermedio.\n");
+        exit(EXIT_FAILURE);
     }
-
-    for (int i = 0; i < ir_current_size; i++)
+    int size = 0;
+    int k = 0;
+    for (int i = 0; i <= ir_current_size; i++)
     {
-        Quadruple *q = &ir_code[i];
-        if (q->result && q->result[0] == 't')
-        {
-            if (!usar_temp(q->result, i + 1))
-            {
-                free(q->arg1);
-                free(q->arg2);
-                free(q->result);
-                q->arg1 = q->arg2 = q->result = NULL;
-                q->op = -1;
-            }
-        }
+        while (k < pending->count && pending->quads[k].position <= i)
+            merged[size++] = pending->quads[k++].quad;
+        if (i < ir_current_size && ir_code[i].op != IR_REMOVED)
+            merged[size++] = ir_code[i];
     }
 
-    int nueva_pos = 0;
-    for (int i = 0; i < ir_current_size; i++)
+    free(ir_code);
+    ir_code = merged;
+    ir_current_size = size;
+    ir_capacity = capacity;
+
+    free(pending->quads);
+    pending->quads = NULL;
+    pending->count = pending->capacity = 0;
+}
+
+void free_pending_quads(PendingQuads *pending)
+{
+    for (int k = 0; k < pending->count; k++)
     {
-        if (ir_code[i].op != -1)
-        {
-            if (i != nueva_pos)
-                ir_code[nueva_pos] = ir_code[i];
-            nueva_pos++;
-        }
+        free(pending->quads[k].quad.arg1);
+        free(pending->quads[k].quad.arg2);
+        free(pending->quads[k].quad.result);
     }
-    ir_current_size = nueva_pos;
+    free(pending->quads);
+    pending->quads = NULL;
+    pending->count = pending->capacity = 0;
 }
 
 int is_number(const char *s)
@@ -1066,19 +1447,774 @@ const char *strip_quotes(const char *s)
     }
     return s;
 }
+/*
+ * Modo tamaño (-Os). Solo se emite la variante de la plataforma para la que se
+ * compila, con los registros de argumentos de su convención de llamada.
+ */
+static int asm_size_mode = 0;
+
+#ifdef _WIN32
+#define ASM_ARG_FORMAT "rcx"
+#define ASM_ARG_VALUE "rdx"
+#else
+#define ASM_ARG_FORMAT "rdi"
+#define ASM_ARG_VALUE "rsi"
+#endif
+
+// Operando (nombre o literal) cuyo valor está en rax en este punto; solo se consulta en modo tamaño
+static const char *rax_holds = NULL;
+
+// Registros de las variables de main (ver regalloc.h); NULL en -O0, donde todas viven en memoria
+static RegisterAssignment *var_registers = NULL;
+
+void set_asm_size_mode(int enabled)
+{
+    asm_size_mode = enabled;
+}
+
+static int asm_int_literal(const char *operand, long long *value)
+{
+    if (!is_number(operand) || strchr(operand, '.') != NULL)
+        return 0;
+    *value = strtoll(operand, NULL, 10);
+    return 1;
+}
+
+static const char *var_register(const char *var)
+{
+    return assigned_register(var_registers, var);
+}
+
+/*
+ * Lugar en memoria de una variable: su lugar en el marco de main si es de un
+ * bloque, si no el de .bss; con "qword" delante si la instrucción no tiene
+ * otro operando que dé el tamaño. Alterna entre varios búferes para que una
+ * instrucción pueda usar más de una variable.
+ */
+static const char *format_home(const char *var, int sized)
+{
+    static char buffers[4][320];
+    static int next = 0;
+    char *buffer = buffers[next];
+    next = (next + 1) % 4;
+    int offset = get_ir_frame_slot(var);
+    if (offset != 0)
+        snprintf(buffer, sizeof(buffers[0]), "%s[rbp - %d]", sized ? "qword " : "", offset);
+    else
+        snprintf(buffer, sizeof(buffers[0]), "%s[rel %s]", sized ? "qword " : "", var);
+    return buffer;
+}
+
+static const char *var_home(const char *var)
+{
+    return format_home(var, 0);
+}
+
+/* Texto de una variable como operando: su registro o su lugar en memoria. */
+static const char *format_location(const char *var, int sized)
+{
+    const char *reg = var_register(var);
+    return reg != NULL ? reg : format_home(var, sized);
+}
+
+static const char *var_location(const char *var)
+{
+    return format_location(var, 0);
+}
+
+static const char *var_location_qword(const char *var)
+{
+    return format_location(var, 1);
+}
+
+static int rax_holds_operand(const char *operand)
+{
+    return asm_size_mode && rax_holds != NULL && operand != NULL && strcmp(rax_holds, operand) == 0;
+}
+
+/* Después de escribir var sin pasar por rax, rax ya no tiene su valor. */
+static void forget_rax_if(const char *var)
+{
+    if (rax_holds_operand(var))
+        rax_holds = NULL;
+}
+
+/*
+ * Carga un literal entero con la codificación más corta: xor para el cero y
+ * mov de 32 bits (que limpia la mitad alta) para los positivos que caben.
+ */
+static void load_int_literal_short(FILE *f, const char *reg, long long value)
+{
+    // rax -> eax, rsi -> esi, ...
+    char reg32[8];
+    snprintf(reg32, sizeof(reg32), "e%s", reg + 1);
+    if (value == 0)
+        fprintf(f, "    xor %s, %s\n", reg32, reg32);
+    else if (value > 0 && value <= (long long)UINT32_MAX)
+        fprintf(f, "    mov %s, %lld\n", reg32, value);
+    else
+        fprintf(f, "    mov %s, %lld\n", reg, value);
+}
+
+static void load_operand(FILE *f, const char *reg, const char *operand)
+{
+    if (asm_size_mode)
+    {
+        int to_rax = strcmp(reg, "rax") == 0;
+        long long value;
+        if (to_rax && rax_holds_operand(operand))
+            return;
+        if (!to_rax && rax_holds_operand(operand))
+            fprintf(f, "    mov %s, rax\n", reg);
+        else if (asm_int_literal(operand, &value))
+            load_int_literal_short(f, reg, value);
+        else if (is_number(operand))
+            fprintf(f, "    mov %s, %s\n", reg, operand);
+        else
+            fprintf(f, "    mov %s, %s\n", reg, var_location(operand));
+        if (to_rax)
+            rax_holds = operand;
+        return;
+    }
+
+    if (is_number(operand))
+        fprintf(f, "    mov %s, %s\n", reg, operand);
+    else
+        fprintf(f, "    mov %s, %s\n", reg, var_location(operand));
+}
+
+static void store_rax(FILE *f, const char *var)
+{
+    fprintf(f, "    mov %s, rax\n", var_location(var));
+    rax_holds = var;
+}
+
+/* Guarda un registro distinto de rax en una variable. */
+static void store_register(FILE *f, const char *reg, const char *var)
+{
+    fprintf(f, "    mov %s, %s\n", var_location(var), reg);
+    forget_rax_if(var);
+}
+
+/*
+ * Emite "op reg, operando". Las instrucciones de x86-64 solo aceptan inmediatos
+ * de 32 bits con signo; los literales más grandes pasan por rbx.
+ */
+static void emit_reg_operation(FILE *f, const char *op, const char *reg, const char *operand)
+{
+    if (!is_number(operand))
+    {
+        fprintf(f, "    %s %s, %s\n", op, reg, var_location(operand));
+        return;
+    }
+
+    long long value = strtoll(operand, NULL, 10);
+    if (strchr(operand, '.') == NULL && value >= INT32_MIN && value <= INT32_MAX)
+    {
+        fprintf(f, "    %s %s, %s\n", op, reg, operand);
+    }
+    else
+    {
+        fprintf(f, "    mov rbx, %s\n", operand);
+        fprintf(f, "    %s %s, rbx\n", op, reg);
+    }
+}
+
+static void emit_rax_operation(FILE *f, const char *op, const char *operand)
+{
+    emit_reg_operation(f, op, "rax", operand);
+}
+
+/* Compara rax con un operando; contra el literal 0 en modo tamaño basta test. */
+static void emit_rax_compare(FILE *f, const char *operand)
+{
+    if (asm_size_mode && operand != NULL && strcmp(operand, "0") == 0)
+        fprintf(f, "    test rax, rax\n");
+    else
+        emit_rax_operation(f, "cmp", operand);
+}
+
+/*
+ * Deja en las banderas la comparación de a con b. Si a tiene registro y rax no
+ * lo tiene ya, se compara en su registro sin cargarlo.
+ */
+static void emit_compare(FILE *f, const char *a, const char *b)
+{
+    const char *reg = var_register(a);
+    if (reg == NULL || rax_holds_operand(a))
+    {
+        load_operand(f, "rax", a);
+        emit_rax_compare(f, b);
+    }
+    else if (asm_size_mode && strcmp(b, "0") == 0)
+    {
+        fprintf(f, "    test %s, %s\n", reg, reg);
+    }
+    else
+    {
+        emit_reg_operation(f, "cmp", reg, b);
+    }
+}
+
+/* Literal entero que cabe como inmediato de 32 bits de una instrucción sobre memoria. */
+static int in_place_immediate(const char *operand)
+{
+    long long value;
+    return asm_int_literal(operand, &value) && value >= INT32_MIN && value <= INT32_MAX;
+}
+
+/* Segundo operando de una operación que escribe directamente en un registro. */
+static int in_place_operand(const char *operand)
+{
+    return in_place_immediate(operand) || !es_literal(operand);
+}
+
+/*
+ * Deja en las banderas la comparación del operando con cero (modo tamaño):
+ * test si rax ya lo tiene, y si no, cmp contra la memoria sin cargarlo.
+ */
+static void emit_zero_test(FILE *f, const char *operand)
+{
+    if (rax_holds_operand(operand) || is_number(operand))
+    {
+        load_operand(f, "rax", operand);
+        fprintf(f, "    test rax, rax\n");
+    }
+    else if (var_register(operand) != NULL)
+    {
+        fprintf(f, "    test %s, %s\n", var_register(operand), var_register(operand));
+    }
+    else
+    {
+        fprintf(f, "    cmp %s, 0\n", format_home(operand, 1));
+    }
+}
+
+static const char *comparison_condition(IROperation op, int negate)
+{
+    switch (op)
+    {
+    case IR_LT: return negate ? "ge" : "l";
+    case IR_GT: return negate ? "le" : "g";
+    case IR_LE: return negate ? "g" : "le";
+    case IR_GE: return negate ? "l" : "ge";
+    case IR_EQ: return negate ? "ne" : "e";
+    default: return negate ? "e" : "ne";
+    }
+}
+
+/*
+ * Condición de salto para "var op 0" tomada de las banderas que deja el
+ * add/sub (o inc/dec) que acaba de calcular var: ZF y SF describen el
+ * resultado, así que sirven para ==, !=, < 0 y >= 0. NULL si la comparación
+ * necesita otra cosa.
+ */
+static const char *result_flags_condition(const Quadruple *cmp, const char *var, int negate)
+{
+    IROperation op = cmp->op;
+    if (strcmp(cmp->arg1, var) == 0 && strcmp(cmp->arg2, "0") == 0)
+        ;
+    else if (strcmp(cmp->arg2, var) == 0 && strcmp(cmp->arg1, "0") == 0)
+        op = op == IR_GT ? IR_LT : op == IR_LE ? IR_GE : op == IR_LT || op == IR_GE ? IR_REMOVED : op;
+    else
+        return NULL;
+
+    switch (op)
+    {
+    case IR_EQ: return negate ? "ne" : "e";
+    case IR_NE: return negate ? "e" : "ne";
+    case IR_LT: return negate ? "ns" : "s";
+    case IR_GE: return negate ? "s" : "ns";
+    default: return NULL;
+    }
+}
+
+enum
+{
+    FMT_INT = 1 << 0,
+    FMT_FLOAT = 1 << 1,
+    FMT_STR = 1 << 2,
+    FMT_READ_INT = 1 << 3,
+    FMT_READ_FLOAT = 1 << 4,
+    FMT_READ_STR = 1 << 5
+};
+
+/*
+ * Formato de printf/scanf que referencia el cuádruplo, con la misma elección
+ * que hacen los casos IR_PRINT e IR_READ de generate_asm.
+ */
+static int format_used_by(const Quadruple *q)
+{
+    if (q->op == IR_PRINT)
+    {
+        if (is_string_literal(q->arg1))
+            return FMT_STR;
+        if (is_number(q->arg1))
+            return FMT_INT;
+        enum TipoDato tipo = get_ir_type(q->arg1);
+        return tipo == STRING ? FMT_STR : tipo == FLOAT ? FMT_FLOAT : FMT_INT;
+    }
+    if (q->op == IR_READ)
+    {
+        enum TipoDato tipo = get_ir_type(q->result);
+        return tipo == STRING ? FMT_READ_STR : tipo == FLOAT ? FMT_READ_FLOAT : FMT_READ_INT;
+    }
+    return 0;
+}
+
+/*
+ * En modo tamaño cada impresión o lectura deja el valor (o la dirección) en el
+ * registro del segundo argumento y llama a una rutina compartida que carga el
+ * formato y salta a printf/scanf; ver emit_io_helpers.
+ */
+static void emit_print_call(FILE *f, const Quadruple *q, int index)
+{
+    int format = format_used_by(q);
+    if (is_string_literal(q->arg1))
+        fprintf(f, "    lea %s, [rel str_%d]\n", ASM_ARG_VALUE, index);
+    else if (format == FMT_STR)
+        fprintf(f, "    lea %s, %s\n", ASM_ARG_VALUE, var_home(q->arg1));
+    else if (format == FMT_FLOAT)
+        fprintf(f, "    movsd xmm0, %s\n", format_home(q->arg1, 1));
+    else
+        load_operand(f, ASM_ARG_VALUE, q->arg1);
+
+    fprintf(f, "    call %s\n", format == FMT_STR ? "mx_print_str" : format == FMT_FLOAT ? "mx_print_float" : "mx_print_int");
+    rax_holds = NULL;
+}
+
+/*
+ * Las variables vivas a través de una llamada a printf o scanf que están en
+ * registros que la llamada puede modificar se guardan en su lugar en memoria
+ * antes y se recargan después. scanf escribe en memoria, así que una variable
+ * leída que tiene registro también se recarga.
+ */
+static void spill_call_registers(FILE *f, int index)
+{
+    if (var_registers == NULL)
+        return;
+    const char **spills = &var_registers->call_spills[index * REGALLOC_CALLER_SAVED];
+    for (int k = 0; k < REGALLOC_CALLER_SAVED; k++)
+    {
+        if (spills[k] != NULL)
+            fprintf(f, "    mov %s, %s\n", var_home(spills[k]), var_register(spills[k]));
+    }
+}
+
+static void reload_call_registers(FILE *f, const Quadruple *q, int index)
+{
+    if (var_registers == NULL)
+        return;
+    const char **spills = &var_registers->call_spills[index * REGALLOC_CALLER_SAVED];
+    for (int k = 0; k < REGALLOC_CALLER_SAVED; k++)
+    {
+        if (spills[k] != NULL && !(q->op == IR_READ && strcmp(spills[k], q->result) == 0))
+            fprintf(f, "    mov %s, %s\n", var_register(spills[k]), var_home(spills[k]));
+    }
+    if (q->op == IR_READ && var_register(q->result) != NULL)
+        fprintf(f, "    mov %s, %s\n", var_register(q->result), var_home(q->result));
+}
+
+static void emit_read_call(FILE *f, const Quadruple *q)
+{
+    int format = format_used_by(q);
+    fprintf(f, "    lea %s, %s\n", ASM_ARG_VALUE, var_home(q->result));
+    fprintf(f, "    call %s\n",
+            format == FMT_READ_STR ? "mx_read_str" : format == FMT_READ_FLOAT ? "mx_read_float" : "mx_read_int");
+    rax_holds = NULL;
+}
+
+/*
+ * Rutinas compartidas del modo tamaño, solo para los formatos usados. Se
+ * llega con call desde main, así que el jmp a printf/scanf hereda la pila
+ * alineada y la dirección de retorno: la función de C vuelve directamente al
+ * punto de la llamada.
+ */
+static void emit_io_helpers(FILE *f, int formats)
+{
+    static const struct
+    {
+        int format;
+        const char *name;
+        const char *fmt_label;
+        const char *target;
+    } helpers[] = {
+        {FMT_INT, "mx_print_int", "fmt_int", "printf"},
+        {FMT_FLOAT, "mx_print_float", "fmt_float", "printf"},
+        {FMT_STR, "mx_print_str", "fmt_str", "printf"},
+        {FMT_READ_INT, "mx_read_int", "fmt_read_int", "scanf"},
+        {FMT_READ_FLOAT, "mx_read_float", "fmt_read_float", "scanf"},
+        {FMT_READ_STR, "mx_read_str", "fmt_read_str", "scanf"},
+    };
+
+    for (size_t h = 0; h < sizeof(helpers) / sizeof(helpers[0]); h++)
+    {
+        if (!(formats & helpers[h].format))
+            continue;
+        fprintf(f, "%s:\n", helpers[h].name);
+        fprintf(f, "    lea %s, [rel %s]\n", ASM_ARG_FORMAT, helpers[h].fmt_label);
+#ifdef _WIN32
+        fprintf(f, "    xor eax, eax\n");
+#else
+        // La convención de System V pide en al cuántos registros xmm lleva printf
+        if (helpers[h].format == FMT_FLOAT)
+            fprintf(f, "    mov eax, 1\n");
+        else
+            fprintf(f, "    xor eax, eax\n");
+#endif
+        fprintf(f, "    jmp %s\n", helpers[h].target);
+    }
+}
+
+/*
+ * Marca las comparaciones cuyo resultado solo lo lee el salto condicional que
+ * las sigue: el salto cierra el bloque y el resultado es local a bloques (ver
+ * find_global_names), así que está muerto después. Esas se emiten como
+ * cmp + jcc, sin setcc. Devuelve un arreglo con 1 en la posición de cada
+ * comparación fusionada y deja en *fused_names los nombres que solo aparecen
+ * en comparaciones fusionadas y por eso no necesitan espacio en .bss.
+ */
+static char *find_fused_branches(NameTable **fused_names)
+{
+    char *fused = calloc(ir_current_size + 1, 1);
+    if (fused == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para generar el ensamblador.\n");
+        exit(EXIT_FAILURE);
+    }
+    *fused_names = create_name_table(16);
+    if (ir_current_size == 0)
+        return fused;
+
+    ControlFlowGraph *cfg = build_cfg(ir_code, ir_current_size);
+    int *global_index = malloc((cfg->vars->count + 1) * sizeof(int));
+    int *occurrences = calloc(cfg->vars->count + 1, sizeof(int));
+    if (global_index == NULL || occurrences == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para generar el ensamblador.\n");
+        exit(EXIT_FAILURE);
+    }
+    find_global_names(cfg, global_index);
+
+    for (int i = 0; i < ir_current_size; i++)
+    {
+        int ids[3] = {cfg->use1[i], cfg->use2[i], cfg->def[i]};
+        for (int k = 0; k < 3; k++)
+        {
+            if (ids[k] != -1)
+                occurrences[ids[k]]++;
+        }
+    }
+
+    for (int i = 0; i + 1 < ir_current_size; i++)
+    {
+        Quadruple *q = &ir_code[i];
+        Quadruple *next = &ir_code[i + 1];
+        int d = cfg->def[i];
+        if (!is_comparison(q->op) || d == -1 || global_index[d] != -1)
+            continue;
+        if ((next->op != IR_IF_FALSE_GOTO && next->op != IR_IF_TRUE_GOTO) || cfg->use1[i + 1] != d)
+            continue;
+        fused[i] = 1;
+        occurrences[d] -= 2;
+    }
+
+    for (int v = 0; v < cfg->vars->count; v++)
+    {
+        if (occurrences[v] == 0)
+            intern_name(*fused_names, cfg->vars->names[v]);
+    }
+
+    free(global_index);
+    free(occurrences);
+    free_cfg(cfg);
+    return fused;
+}
+
+/*
+ * Cadenas Si / Encambio sobre una misma variable entera. Una cadena es una
+ * sucesión de pruebas "x == c" (fusionadas con su salto) en la que cada una,
+ * si falla, salta a una etiqueta que solo ella usa y que va seguida de la
+ * siguiente prueba. Como el cuádruplo anterior a esa etiqueta es un GOTO o un
+ * HALT, a las pruebas intermedias solo se llega desde la anterior, así que la
+ * cadena entera se puede cambiar por un despacho: una tabla de saltos si los
+ * valores son densos y una búsqueda binaria si no. El IR no tiene saltos
+ * indirectos, por eso esta bajada se hace aquí y no en el optimizador.
+ */
+#define SWITCH_MIN_CASES 4    // con menos casos la cadena de cmp + je es igual de buena
+#define SWITCH_MAX_TABLE 1024 // entradas como máximo en una tabla de saltos
+#define SWITCH_MAX_SPREAD 3   // entradas de la tabla por caso como máximo
+#define SWITCH_LINEAR_CASES 3 // tramos de la búsqueda que se comparan uno por uno
+
+typedef struct
+{
+    long long value;
+    const char *literal; // el valor tal como aparece en el IR
+    int order;           // posición de la prueba en la cadena
+    const char *label;   // etiqueta del cuerpo del caso
+} SwitchCase;
+
+typedef struct
+{
+    const char *var;
+    SwitchCase *cases;         // ordenados por valor y sin repetidos
+    int num_cases;
+    const char *default_label; // a donde saltaba la última prueba
+} SwitchChain;
+
+typedef struct
+{
+    SwitchChain *chains;
+    int num_chains;
+    int *chain_at;        // cadena cuyo despacho va en cada cuádruplo, o -1
+    char **case_label_at; // etiqueta del caso que sustituye a cada prueba de una cadena
+} SwitchLowering;
+
+/*
+ * Reconoce en i una prueba "x == c" que salta a *miss_label cuando no se
+ * cumple: EQ seguido de IF_FALSE_GOTO o NE seguido de IF_TRUE_GOTO, con x una
+ * variable entera y c un literal entero en cualquiera de los dos lados.
+ */
+static int switch_test(const char *fused, int i, SwitchCase *test, const char **var, const char **miss_label)
+{
+    if (i < 0 || i + 1 >= ir_current_size || !fused[i])
+        return 0;
+    Quadruple *q = &ir_code[i];
+    Quadruple *branch = &ir_code[i + 1];
+    if (!(q->op == IR_EQ && branch->op == IR_IF_FALSE_GOTO) && !(q->op == IR_NE && branch->op == IR_IF_TRUE_GOTO))
+        return 0;
+
+    const char *x = q->arg1;
+    const char *c = q->arg2;
+    if (es_literal(x))
+    {
+        x = q->arg2;
+        c = q->arg1;
+    }
+    if (es_literal(x) || get_ir_type(x) != INT || !asm_int_literal(c, &test->value))
+        return 0;
+    test->literal = c;
+    *var = x;
+    *miss_label = branch->result;
+    return 1;
+}
+
+static int compare_switch_cases(const void *a, const void *b)
+{
+    const SwitchCase *x = a;
+    const SwitchCase *y = b;
+    if (x->value != y->value)
+        return x->value < y->value ? -1 : 1;
+    return x->order - y->order;
+}
+
+static void find_switch_chains(const char *fused, SwitchLowering *sw)
+{
+    int size = ir_current_size;
+    sw->chains = NULL;
+    sw->num_chains = 0;
+    sw->chain_at = xcalloc((size + 1) * sizeof(int));
+    sw->case_label_at = xcalloc((size + 1) * sizeof(char *));
+    for (int i = 0; i < size; i++)
+        sw->chain_at[i] = -1;
+    if (size == 0 || get_optimization_level() == OPT_O0)
+        return;
+
+    NameTable *labels = create_name_table(16);
+    for (int i = 0; i < size; i++)
+    {
+        if (ir_code[i].op == IR_LABEL || is_jump(ir_code[i].op))
+            intern_name(labels, ir_code[i].result);
+    }
+    int *label_pos = xcalloc((labels->count + 1) * sizeof(int));
+    int *label_refs = xcalloc((labels->count + 1) * sizeof(int));
+    for (int l = 0; l < labels->count; l++)
+        label_pos[l] = -1;
+    for (int i = 0; i < size; i++)
+    {
+        if (ir_code[i].op == IR_LABEL)
+            label_pos[lookup_name(labels, ir_code[i].result)] = i;
+        else if (is_jump(ir_code[i].op))
+            label_refs[lookup_name(labels, ir_code[i].result)]++;
+    }
+
+    int *tests = xcalloc(size * sizeof(int));
+    SwitchCase *cases = xcalloc(size * sizeof(SwitchCase));
+    for (int i = 0; i < size; i++)
+    {
+        const char *var;
+        const char *miss;
+        if (sw->case_label_at[i] != NULL || !switch_test(fused, i, &cases[0], &var, &miss))
+            continue;
+
+        int count = 0;
+        cases[count].order = count;
+        tests[count++] = i;
+        for (;;)
+        {
+            int l = lookup_name(labels, miss);
+            int p = label_pos[l];
+            const char *next_var;
+            const char *next_miss;
+            if (p <= tests[count - 1] + 1 || label_refs[l] != 1 ||
+                (ir_code[p - 1].op != IR_GOTO && ir_code[p - 1].op != IR_HALT))
+                break;
+            if (!switch_test(fused, p + 1, &cases[count], &next_var, &next_miss) || strcmp(next_var, var) != 0)
+                break;
+            cases[count].order = count;
+            tests[count++] = p + 1;
+            miss = next_miss;
+        }
+
+        // Un valor repetido solo lo puede tomar la primera prueba que lo compara
+        qsort(cases, count, sizeof(SwitchCase), compare_switch_cases);
+        int unique = 0;
+        for (int k = 0; k < count; k++)
+        {
+            if (unique == 0 || cases[k].value != cases[unique - 1].value)
+                cases[unique++] = cases[k];
+        }
+        if (unique < SWITCH_MIN_CASES)
+            continue;
+
+        for (int k = 0; k < count; k++)
+            sw->case_label_at[tests[k]] = new_label();
+        for (int k = 0; k < unique; k++)
+            cases[k].label = sw->case_label_at[tests[cases[k].order]];
+
+        sw->chains = realloc(sw->chains, (sw->num_chains + 1) * sizeof(SwitchChain));
+        if (sw->chains == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo asignar memoria para generar el ensamblador.\n");
+            exit(EXIT_FAILURE);
+        }
+        SwitchChain *chain = &sw->chains[sw->num_chains];
+        chain->var = var;
+        chain->cases = xcalloc(unique * sizeof(SwitchCase));
+        memcpy(chain->cases, cases, unique * sizeof(SwitchCase));
+        chain->num_cases = unique;
+        chain->default_label = miss;
+        sw->chain_at[i] = sw->num_chains++;
+    }
+
+    free(tests);
+    free(cases);
+    free(label_pos);
+    free(label_refs);
+    destroy_name_table(labels);
+}
+
+static void free_switch_lowering(SwitchLowering *sw)
+{
+    for (int c = 0; c < sw->num_chains; c++)
+        free(sw->chains[c].cases);
+    for (int i = 0; i < ir_current_size; i++)
+        free(sw->case_label_at[i]);
+    free(sw->chains);
+    free(sw->chain_at);
+    free(sw->case_label_at);
+}
+
+/*
+ * Búsqueda binaria sobre cases[lo, hi) con el valor en rax: en cada nivel un
+ * cmp resuelve el caso del medio (je) y elige la mitad (jl); los tramos
+ * cortos se comparan uno por uno.
+ */
+static void emit_switch_search(FILE *f, const SwitchChain *chain, int lo, int hi)
+{
+    if (hi - lo <= SWITCH_LINEAR_CASES)
+    {
+        for (int k = lo; k < hi; k++)
+        {
+            emit_rax_compare(f, chain->cases[k].literal);
+            fprintf(f, "    je %s\n", chain->cases[k].label);
+        }
+        fprintf(f, "    jmp %s\n", chain->default_label);
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    char *lower = new_label();
+    emit_rax_compare(f, chain->cases[mid].literal);
+    fprintf(f, "    je %s\n", chain->cases[mid].label);
+    fprintf(f, "    jl %s\n", lower);
+    emit_switch_search(f, chain, mid + 1, hi);
+    fprintf(f, "%s:\n", lower);
+    emit_switch_search(f, chain, lo, mid);
+    free(lower);
+}
+
+/*
+ * Despacho de una cadena: con valores densos, tabla de desplazamientos de 32
+ * bits relativos a la tabla (no necesita reubicaciones), cuyos huecos van al
+ * caso por omisión; si no, búsqueda binaria.
+ */
+static void emit_switch_dispatch(FILE *f, const SwitchChain *chain)
+{
+    const SwitchCase *first = &chain->cases[0];
+    unsigned long long span = (unsigned long long)chain->cases[chain->num_cases - 1].value - (unsigned long long)first->value;
+
+    load_operand(f, "rax", chain->var);
+    if (span < SWITCH_MAX_TABLE && span < (unsigned long long)SWITCH_MAX_SPREAD * chain->num_cases)
+    {
+        char *table = new_label();
+        if (first->value != 0)
+            emit_rax_operation(f, "sub", first->literal);
+        fprintf(f, "    cmp rax, %llu\n", span);
+        fprintf(f, "    ja %s\n", chain->default_label);
+        fprintf(f, "    lea rbx, [rel %s]\n", table);
+        fprintf(f, "    movsxd rax, dword [rbx + rax*4]\n");
+        fprintf(f, "    add rax, rbx\n");
+        fprintf(f, "    jmp rax\n");
+        fprintf(f, "    align 4\n");
+        fprintf(f, "%s:\n", table);
+        int k = 0;
+        for (unsigned long long slot = 0; slot <= span; slot++)
+        {
+            const char *target = chain->default_label;
+            if ((unsigned long long)chain->cases[k].value - (unsigned long long)first->value == slot)
+                target = chain->cases[k++].label;
+            fprintf(f, "    dd %s - %s\n", target, table);
+        }
+        free(table);
+    }
+    else
+    {
+        emit_switch_search(f, chain, 0, chain->num_cases);
+    }
+    rax_holds = NULL;
+}
+
 void generate_asm(FILE *f)
 {
-    char declared_vars[MAX_BUFFER][64];
-    int declared_vars_count = 0;
+    // Sin límite fijo: con miles de variables un arreglo se desbordaría
+    NameTable *declared_vars = create_name_table(ir_current_size);
+
+    NameTable *fused_names;
+    char *fused = find_fused_branches(&fused_names);
+    SwitchLowering switches;
+    find_switch_chains(fused, &switches);
+    if (get_optimization_level() != OPT_O0)
+        var_registers = allocate_registers(ir_code, ir_current_size, fused_names);
+
+    // Sección .data con los formatos que de verdad se usan
+    int formats = 0;
+    for (int i = 0; i < ir_current_size; i++)
+        formats |= format_used_by(&ir_code[i]);
 
-    // Sección .data con formatos
     fprintf(f, "section .data\n");
-    fprintf(f, "fmt_int db \"%%ld\", 0\n");
-    fprintf(f, "fmt_float db \"%%lf\", 10, 0\n");
-    fprintf(f, "fmt_str db \"%%s\", 0\n");
-    fprintf(f, "fmt_read_int db \"%%ld\", 0\n");
-    fprintf(f, "fmt_read_float db \"%%lf\", 0\n");
-    fprintf(f, "fmt_read_str db \"%%255s\", 0\n");
+    if (formats & FMT_INT)
+        fprintf(f, "fmt_int db \"%%ld\", 0\n");
+    if (formats & FMT_FLOAT)
+        fprintf(f, "fmt_float db \"%%lf\", 10, 0\n");
+    if (formats & FMT_STR)
+        fprintf(f, "fmt_str db \"%%s\", 0\n");
+    if (formats & FMT_READ_INT)
+        fprintf(f, "fmt_read_int db \"%%ld\", 0\n");
+    if (formats & FMT_READ_FLOAT)
+        fprintf(f, "fmt_read_float db \"%%lf\", 0\n");
+    if (formats & FMT_READ_STR)
+        fprintf(f, "fmt_read_str db \"%%255s\", 0\n");
 
     // Literales string para impresión
     for (int i = 0; i < ir_current_size; i++)
@@ -1092,7 +2228,8 @@ void generate_asm(FILE *f)
         }
     }
 
-    // Variables en .bss
+    // Variables en .bss; las de bloque tienen su lugar en el marco de main
+    int frame_size = settle_frame_slots(ir_code, ir_current_size);
     fprintf(f, "section .bss\n");
     for (int i = 0; i < ir_current_size; i++)
     {
@@ -1101,13 +2238,15 @@ void generate_asm(FILE *f)
         for (int j = 0; j < 3; j++)
         {
             const char *var = args[j];
-            if (var && is_valid_varname(var) && !var_declared(declared_vars, declared_vars_count, var))
+            if (var && is_valid_varname(var) && lookup_name(fused_names, var) == -1 &&
+                lookup_name(declared_vars, var) == -1)
             {
                 if (!(var[0] == 'L' && isdigit((unsigned char)var[1])))
                 {
-                    strcpy(declared_vars[declared_vars_count++], var);
-                    EntradaSimbolo *entry = buscar_simbolo(ambito_actual, var);
-                    if (entry != NULL && entry->tipo == STRING)
+                    intern_name(declared_vars, var);
+                    if (get_ir_frame_slot(var) != 0)
+                        continue;
+                    if (get_ir_type(var) == STRING)
                         fprintf(f, "    %s resb 256\n", var);
                     else
                         fprintf(f, "    %s resq 1\n", var);
@@ -1125,6 +2264,28 @@ void generate_asm(FILE *f)
     fprintf(f, "main:\n");
     fprintf(f, "    push rbp\n");
     fprintf(f, "    mov rbp, rsp\n");
+    // Múltiplo de 16 para que rsp siga alineado en las llamadas a printf y scanf
+    frame_size = (frame_size + 15) & ~15;
+    if (frame_size > 0)
+        fprintf(f, "    sub rsp, %d\n", frame_size);
+    rax_holds = NULL;
+
+    int num_saved = var_registers != NULL ? var_registers->num_saved : 0;
+    if (var_registers != NULL)
+    {
+        // r12-r15 se preservan para quien llamó a main; la pila queda alineada a 16 para printf y scanf
+        for (int r = 0; r < num_saved; r++)
+            fprintf(f, "    push %s\n", var_registers->saved[r]);
+        if (num_saved % 2 != 0)
+            fprintf(f, "    sub rsp, 8\n");
+
+        // Las variables que se leen antes de escribirse empiezan con su valor en memoria
+        for (int id = 0; id < var_registers->names->count; id++)
+        {
+            if (var_registers->load_at_entry[id])
+                fprintf(f, "    mov %s, %s\n", var_registers->reg[id], var_home(var_registers->names->names[id]));
+        }
+    }
 
     for (int i = 0; i < ir_current_size; i++)
     {
@@ -1132,18 +2293,52 @@ void generate_asm(FILE *f)
 
         if (q->op == IR_LABEL)
         {
+            // Se puede llegar desde un salto: no se sabe qué tiene rax
             fprintf(f, "%s:\n", q->result);
+            rax_holds = NULL;
+            continue;
+        }
+
+        if (switches.case_label_at[i] != NULL)
+        {
+            // La prueba la resolvió el despacho de la cadena: aquí empieza el cuerpo de su caso
+            if (switches.chain_at[i] != -1)
+                emit_switch_dispatch(f, &switches.chains[switches.chain_at[i]]);
+            fprintf(f, "%s:\n", switches.case_label_at[i]);
+            rax_holds = NULL;
+            i++;
             continue;
         }
 
         switch (q->op)
         {
         case IR_ASSIGN:
-            if (is_number(q->arg1))
-                fprintf(f, "    mov rax, %s\n    mov [rel %s], rax\n", q->arg1, q->result);
+        {
+            long long value;
+            if (!rax_holds_operand(q->arg1) && (var_register(q->result) != NULL || var_register(q->arg1) != NULL))
+            {
+                // Con un registro de por medio la copia es un solo mov
+                fprintf(f, "    mov %s, %s\n", var_location(q->result), is_number(q->arg1) ? q->arg1 : var_location(q->arg1));
+                forget_rax_if(q->result);
+            }
+            else if (asm_size_mode && !rax_holds_operand(q->arg1) && asm_int_literal(q->arg1, &value) && value != 0 &&
+                value >= INT32_MIN && value <= INT32_MAX)
+            {
+                // Un solo mov con inmediato ocupa menos que cargarlo en rax y guardarlo
+                fprintf(f, "    mov %s, %lld\n", format_home(q->result, 1), value);
+                forget_rax_if(q->result);
+            }
+            else if (asm_size_mode)
+            {
+                load_operand(f, "rax", q->arg1);
+                store_rax(f, q->result);
+            }
+            else if (is_number(q->arg1))
+                fprintf(f, "    mov rax, %s\n    mov %s, rax\n", q->arg1, var_home(q->result));
             else
-                fprintf(f, "    mov rax, [rel %s]\n    mov [rel %s], rax\n", q->arg1, q->result);
+                fprintf(f, "    mov rax, %s\n    mov %s, rax\n", var_home(q->arg1), var_home(q->result));
             break;
+        }
 
         case IR_ADD:
         case IR_SUB:
@@ -1152,6 +2347,7 @@ void generate_asm(FILE *f)
         case IR_MOD:
         {
             const char *op;
+            int in_memory = 0; // el resultado se calculó en su lugar, sin pasar por rax
             if (q->op == IR_ADD) op = "add";
             else if (q->op == IR_SUB) op = "sub";
             else if (q->op == IR_MUL) op = "imul";
@@ -1160,48 +2356,85 @@ void generate_asm(FILE *f)
 
             if (q->op == IR_DIV || q->op == IR_MOD)
             {
-                if (es_literal(q->arg1))
-                    fprintf(f, "    mov rax, %s\n", q->arg1);
-                else
-                    fprintf(f, "    mov rax, [rel %s]\n", q->arg1);
+                load_operand(f, "rax", q->arg1);
                 fprintf(f, "    cqo\n");
-
-                if (es_literal(q->arg2))
-                    fprintf(f, "    mov rbx, %s\n", q->arg2);
-                else
-                    fprintf(f, "    mov rbx, [rel %s]\n", q->arg2);
+                load_operand(f, "rbx", q->arg2);
 
                 fprintf(f, "    idiv rbx\n");
+                rax_holds = NULL;
 
+                // Sin destino la división solo se conserva por su posible falla
+                if (q->result == NULL)
+                    break;
                 if (q->op == IR_DIV)
-                    fprintf(f, "    mov [rel %s], rax\n", q->result);
+                    store_rax(f, q->result);
                 else
-                    fprintf(f, "    mov [rel %s], rdx\n", q->result);
+                    store_register(f, "rdx", q->result);
             }
-            else
+            else if ((asm_size_mode || var_register(q->result) != NULL) && (q->op == IR_ADD || q->op == IR_SUB) &&
+                     !es_literal(q->arg1) && strcmp(q->arg1, q->result) == 0 && !rax_holds_operand(q->result) &&
+                     (var_register(q->result) != NULL ? in_place_operand(q->arg2) : in_place_immediate(q->arg2)))
             {
-                if (es_literal(q->arg1))
-                    fprintf(f, "    mov rax, %s\n", q->arg1);
-                else
-                    fprintf(f, "    mov rax, [rel %s]\n", q->arg1);
-
-                if (es_literal(q->arg2))
-                    fprintf(f, "    %s rax, %s\n", op, q->arg2);
+                // x = x ± c directamente en su registro o en memoria, sin pasar por rax
+                long long value;
+                if (asm_size_mode && asm_int_literal(q->arg2, &value) && (value == 1 || value == -1))
+                    fprintf(f, "    %s %s\n", (value == 1) == (q->op == IR_ADD) ? "inc" : "dec", var_location_qword(q->result));
+                else if (is_number(q->arg2))
+                    fprintf(f, "    %s %s, %s\n", op, var_location_qword(q->result), q->arg2);
                 else
-                    fprintf(f, "    %s rax, [rel %s]\n", op, q->arg2);
+                    fprintf(f, "    %s %s, %s\n", op, var_location(q->result), var_location(q->arg2));
+                in_memory = 1;
+            }
+            else
+            {
+                load_operand(f, "rax", q->arg1);
+                emit_rax_operation(f, op, q->arg2);
+                store_rax(f, q->result);
+            }
 
-                fprintf(f, "    mov [rel %s], rax\n", q->result);
+            // Avance del ciclo seguido de su prueba (i = i + k; i < n): el valor
+            // sigue en rax, y contra cero el salto usa las banderas del add/sub
+            if (q->op != IR_DIV && q->op != IR_MOD && i + 2 < ir_current_size && fused[i + 1] &&
+                switches.case_label_at[i + 1] == NULL)
+            {
+                Quadruple *test = &ir_code[i + 1];
+                Quadruple *branch = &ir_code[i + 2];
+                int negate = branch->op == IR_IF_FALSE_GOTO;
+                const char *cond = q->op != IR_MUL ? result_flags_condition(test, q->result, negate) : NULL;
+                if (cond == NULL && !in_memory && strcmp(test->arg1, q->result) == 0)
+                {
+                    emit_rax_compare(f, test->arg2);
+                    cond = comparison_condition(test->op, negate);
+                }
+                if (cond != NULL)
+                {
+                    fprintf(f, "    j%s %s\n", cond, branch->result);
+                    i += 2;
+                }
             }
             break;
         }
 
-        case IR_NEG:
-            if (es_literal(q->arg1))
-                fprintf(f, "    mov rax, %s\n", q->arg1);
+        case IR_UDIV:
+        case IR_UMOD:
+            // El análisis de rangos garantiza operandos en [0, 2^32): basta el div de 32 bits
+            load_operand(f, "rax", q->arg1);
+            fprintf(f, "    xor edx, edx\n");
+            load_operand(f, "rbx", q->arg2);
+            fprintf(f, "    div ebx\n");
+            rax_holds = NULL;
+            if (q->result == NULL)
+                break;
+            if (q->op == IR_UDIV)
+                store_rax(f, q->result);
             else
-                fprintf(f, "    mov rax, [rel %s]\n", q->arg1);
+                store_register(f, "rdx", q->result);
+            break;
+
+        case IR_NEG:
+            load_operand(f, "rax", q->arg1);
             fprintf(f, "    neg rax\n");
-            fprintf(f, "    mov [rel %s], rax\n", q->result);
+            store_rax(f, q->result);
             break;
 
         case IR_LT:
@@ -1211,57 +2444,58 @@ void generate_asm(FILE *f)
         case IR_EQ:
         case IR_NE:
         {
-            const char *cond;
-            switch (q->op)
-            {
-            case IR_LT: cond = "l"; break;
-            case IR_GT: cond = "g"; break;
-            case IR_LE: cond = "le"; break;
-            case IR_GE: cond = "ge"; break;
-            case IR_EQ: cond = "e"; break;
-            case IR_NE: cond = "ne"; break;
-            default: cond = "e"; break;
-            }
+            const char *cond = comparison_condition(q->op, 0);
 
-            if (is_number(q->arg2))
-            {
-                fprintf(f, "    mov rax, [rel %s]\n", q->arg1);
-                fprintf(f, "    cmp rax, %s\n", q->arg2);
-            }
-            else
+            emit_compare(f, q->arg1, q->arg2);
+
+            if (fused[i])
             {
-                fprintf(f, "    mov rax, [rel %s]\n", q->arg1);
-                fprintf(f, "    cmp rax, [rel %s]\n", q->arg2);
+                // El salto siguiente usa las banderas del cmp directamente
+                Quadruple *branch = &ir_code[++i];
+                fprintf(f, "    j%s %s\n", comparison_condition(q->op, branch->op == IR_IF_FALSE_GOTO), branch->result);
+                break;
             }
+
             fprintf(f, "    set%s al\n", cond);
             fprintf(f, "    movzx rax, al\n");
-            fprintf(f, "    mov [rel %s], rax\n", q->result);
+            store_rax(f, q->result);
             break;
         }
 
         case IR_AND:
-            fprintf(f, "    mov rax, [rel %s]\n", q->arg1);
-            fprintf(f, "    and rax, [rel %s]\n", q->arg2);
-            fprintf(f, "    mov [rel %s], rax\n", q->result);
+        case IR_OR:
+        case IR_BAND:
+            load_operand(f, "rax", q->arg1);
+            emit_rax_operation(f, q->op == IR_OR ? "or" : "and", q->arg2);
+            store_rax(f, q->result);
             break;
 
-        case IR_OR:
-            fprintf(f, "    mov rax, [rel %s]\n", q->arg1);
-            fprintf(f, "    or rax, [rel %s]\n", q->arg2);
-            fprintf(f, "    mov [rel %s], rax\n", q->result);
+        case IR_SHL:
+        case IR_SHR:
+            // El optimizador solo genera corrimientos por un literal
+            load_operand(f, "rax", q->arg1);
+            fprintf(f, "    %s rax, %s\n", q->op == IR_SHL ? "shl" : "sar", q->arg2);
+            store_rax(f, q->result);
             break;
 
         case IR_NOT:
-            fprintf(f, "    mov rax, [rel %s]\n", q->arg1);
-            fprintf(f, "    cmp rax, 0\n");
+            load_operand(f, "rax", q->arg1);
+            fprintf(f, asm_size_mode ? "    test rax, rax\n" : "    cmp rax, 0\n");
             fprintf(f, "    sete al\n");
             fprintf(f, "    movzx rax, al\n");
-            fprintf(f, "    mov [rel %s], rax\n", q->result);
+            store_rax(f, q->result);
             break;
 
         case IR_PRINT:
         {
-            EntradaSimbolo *entry = buscar_simbolo(ambito_actual, q->arg1);
+            spill_call_registers(f, i);
+            if (asm_size_mode)
+            {
+                emit_print_call(f, q, i);
+                reload_call_registers(f, q, i);
+                break;
+            }
+            enum TipoDato tipo = get_ir_type(q->arg1);
 
             fprintf(f,
                 "    %%ifdef WINDOWS\n"
@@ -1284,34 +2518,34 @@ void generate_asm(FILE *f)
                     "        call printf\n",
                     q->arg1);
             }
-            else if (entry != NULL)
+            else
             {
-                if (entry->tipo == STRING)
+                if (tipo == STRING)
                 {
                     fprintf(f,
                         "lea rcx, [rel fmt_str]\n"
-                        "        lea rdx, [rel %s]\n"
+                        "        lea rdx, %s\n"
                         "        xor eax, eax\n"
                         "        call printf\n",
-                        q->arg1);
+                        var_home(q->arg1));
                 }
-                else if (entry->tipo == FLOAT)
+                else if (tipo == FLOAT)
                 {
                     fprintf(f,
                         "lea rcx, [rel fmt_float]\n"
-                        "        movsd xmm0, qword [rel %s]\n"
+                        "        movsd xmm0, %s\n"
                         "        xor eax, eax\n"
                         "        call printf\n",
-                        q->arg1);
+                        format_home(q->arg1, 1));
                 }
                 else
                 {
                     fprintf(f,
                         "lea rcx, [rel fmt_int]\n"
-                        "        mov rdx, [rel %s]\n"
+                        "        mov rdx, %s\n"
                         "        xor eax, eax\n"
                         "        call printf\n",
-                        q->arg1);
+                        var_location(q->arg1));
                 }
             }
             fprintf(f, "    %%else\n        ");
@@ -1333,110 +2567,113 @@ void generate_asm(FILE *f)
                     "        call printf\n",
                     q->arg1);
             }
-            else if (entry != NULL)
+            else
             {
-                if (entry->tipo == STRING)
+                if (tipo == STRING)
                 {
                     fprintf(f,
-                        "lea rdi, [rel %s]\n"
+                        "lea rdi, %s\n"
                         "        lea rsi, [rel fmt_str]\n"
                         "        xor eax, eax\n"
                         "        call printf\n",
-                        q->arg1);
+                        var_home(q->arg1));
                 }
-                else if (entry->tipo == FLOAT)
+                else if (tipo == FLOAT)
                 {
                     fprintf(f,
-                        "movsd xmm0, qword [rel %s]\n"
+                        "movsd xmm0, %s\n"
                         "        lea rdi, [rel fmt_float]\n"
                         "        mov eax, 1\n"
                         "        call printf\n",
-                        q->arg1);
+                        format_home(q->arg1, 1));
                 }
                 else
                 {
                     fprintf(f,
-                        "mov rsi, [rel %s]\n"
+                        "mov rsi, %s\n"
                         "        lea rdi, [rel fmt_int]\n"
                         "        xor eax, eax\n"
                         "        call printf\n",
-                        q->arg1);
+                        var_location(q->arg1));
                 }
             }
             fprintf(f, "    %%endif\n");
+            reload_call_registers(f, q, i);
             break;
         }
 
         case IR_READ:
         {
-            EntradaSimbolo *entry = buscar_simbolo(ambito_actual, q->result);
+            spill_call_registers(f, i);
+            if (asm_size_mode)
+            {
+                emit_read_call(f, q);
+                reload_call_registers(f, q, i);
+                break;
+            }
+            enum TipoDato tipo = get_ir_type(q->result);
 
             fprintf(f,
                 "    %%ifdef WINDOWS\n"
                 "        ");
-            if (entry != NULL)
+            if (tipo == STRING)
             {
-                if (entry->tipo == STRING)
-                {
-                    fprintf(f,
-                        "lea rcx, [rel fmt_read_str]\n"
-                        "        lea rdx, [rel %s]\n"
-                        "        xor eax, eax\n"
-                        "        call scanf\n",
-                        q->result);
-                }
-                else if (entry->tipo == FLOAT)
-                {
-                    fprintf(f,
-                        "lea rcx, [rel fmt_read_float]\n"
-                        "        lea rdx, [rel %s]\n"
-                        "        xor eax, eax\n"
-                        "        call scanf\n",
-                        q->result);
-                }
-                else
-                {
-                    fprintf(f,
-                        "lea rcx, [rel fmt_read_int]\n"
-                        "        lea rdx, [rel %s]\n"
-                        "        xor eax, eax\n"
-                        "        call scanf\n",
-                        q->result);
-                }
+                fprintf(f,
+                    "lea rcx, [rel fmt_read_str]\n"
+                    "        lea rdx, %s\n"
+                    "        xor eax, eax\n"
+                    "        call scanf\n",
+                    var_home(q->result));
+            }
+            else if (tipo == FLOAT)
+            {
+                fprintf(f,
+                    "lea rcx, [rel fmt_read_float]\n"
+                    "        lea rdx, %s\n"
+                    "        xor eax, eax\n"
+                    "        call scanf\n",
+                    var_home(q->result));
+            }
+            else
+            {
+                fprintf(f,
+                    "lea rcx, [rel fmt_read_int]\n"
+                    "        lea rdx, %s\n"
+                    "        xor eax, eax\n"
+                    "        call scanf\n",
+                    var_home(q->result));
             }
             fprintf(f,
                 "    %%else\n        ");
-            if (entry != NULL)
+            if (tipo == STRING)
             {
-                if (entry->tipo == STRING)
-                {
-                    fprintf(f,
-                        "lea rdi, [rel fmt_read_str]\n"
-                        "        lea rsi, [rel %s]\n"
-                        "        xor eax, eax\n"
-                        "        call scanf\n",
-                        q->result);
-                }
-                else if (entry->tipo == FLOAT)
-                {
-                    fprintf(f,
-                        "lea rdi, [rel fmt_read_float]\n"
-                        "        lea rsi, [rel %s]\n"
-                        "        xor eax, eax\n"
-                        "        call scanf\n",
-                        q->result);
-                }
-                else
-                {
-                    fprintf(f,
-                        "lea rdi, [rel fmt_read_int]\n"
-                        "        lea rsi, [rel %s]\n"
-                        "        xor eax, eax\n"
-                        "        call scanf\n",
-                        q->result);
-                }
+                fprintf(f,
+                    "lea rdi, [rel fmt_read_str]\n"
+                    "        lea rsi, %s\n"
+                    "        xor eax, eax\n"
+                    "        call scanf\n",
+                    var_home(q->result));
+            }
+            else if (tipo == FLOAT)
+            {
+                fprintf(f,
+                    "lea rdi, [rel fmt_read_float]\n"
+                    "        lea rsi, %s\n"
+                    "        xor eax, eax\n"
+                    "        call scanf\n",
+                    var_home(q->result));
+            }
+            else
+            {
+                fprintf(f,
+                    "lea rdi, [rel fmt_read_int]\n"
+                    "        lea rsi, %s\n"
+                    "        xor eax, eax\n"
+                    "        call scanf\n",
+                    var_home(q->result));
             }
             fprintf(f, "    %%endif\n");
+            reload_call_registers(f, q, i);
             break;
         }
 
@@ -1445,7 +2682,12 @@ void generate_asm(FILE *f)
             break;
 
         case IR_IF_FALSE_GOTO:
-            if (is_number(q->arg1))
+            if (asm_size_mode)
+            {
+                emit_zero_test(f, q->arg1);
+                fprintf(f, "    je %s\n", q->result);
+            }
+            else if (is_number(q->arg1))
             {
                 fprintf(f,
                     "    mov rax, %s\n"
@@ -1456,15 +2698,29 @@ void generate_asm(FILE *f)
             else
             {
                 fprintf(f,
-                    "    mov rax, [rel %s]\n"
+                    "    mov rax, %s\n"
                     "    cmp rax, 0\n"
                     "    je %s\n",
-                    q->arg1, q->result);
+                    var_location(q->arg1), q->result);
             }
             break;
 
+        case IR_IF_TRUE_GOTO:
+            if (asm_size_mode)
+            {
+                emit_zero_test(f, q->arg1);
+            }
+            else
+            {
+                load_operand(f, "rax", q->arg1);
+                fprintf(f, "    cmp rax, 0\n");
+            }
+            fprintf(f, "    jne %s\n", q->result);
+            break;
+
         case IR_HALT:
-            fprintf(f, "    mov eax, 0\n");
+            fprintf(f, asm_size_mode ? "    xor eax, eax\n" : "    mov eax, 0\n");
+            rax_holds = NULL;
             break;
 
         default:
@@ -1473,15 +2729,42 @@ void generate_asm(FILE *f)
         }
     }
 
+    if (num_saved % 2 != 0)
+        fprintf(f, "    add rsp, 8\n");
+    for (int r = num_saved - 1; r >= 0; r--)
+        fprintf(f, "    pop %s\n", var_registers->saved[r]);
+    if (frame_size > 0)
+        fprintf(f, "    add rsp, %d\n", frame_size);
     fprintf(f, "    pop rbp\n");
 
-    fprintf(f, "%%ifdef WINDOWS\n");
-    fprintf(f, "    extern ExitProcess\n");
-    fprintf(f, "    mov ecx, 0\n");
-    fprintf(f, "    call ExitProcess\n");
-    fprintf(f, "%%else\n");
-    fprintf(f, "    ret\n");
-    fprintf(f, "%%endif\n");
+    if (asm_size_mode)
+    {
+#ifdef _WIN32
+        fprintf(f, "    extern ExitProcess\n");
+        fprintf(f, "    xor ecx, ecx\n");
+        fprintf(f, "    call ExitProcess\n");
+#else
+        fprintf(f, "    ret\n");
+#endif
+        emit_io_helpers(f, formats);
+    }
+    else
+    {
+        fprintf(f, "%%ifdef WINDOWS\n");
+        fprintf(f, "    extern ExitProcess\n");
+        fprintf(f, "    mov ecx, 0\n");
+        fprintf(f, "    call ExitProcess\n");
+        fprintf(f, "%%else\n");
+        fprintf(f, "    ret\n");
+        fprintf(f, "%%endif\n");
+    }
 
     fprintf(f, "section .note.GNU-stack noalloc noexec nowrite progbits\n");
+
+    free_register_assignment(var_registers);
+    var_registers = NULL;
+    free_switch_lowering(&switches);
+    free(fused);
+    destroy_name_table(fused_names);
+    destroy_name_table(declared_vars);
 }
@@ -0,0 +1,1897 @@
+#include "elfobj.h"
+#include "cfg.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Ensamblador integrado y escritor de objetos ELF64.
+ *
+ * Lee el texto de generate_asm() línea por línea, como lo haría NASM, y lo
+ * traduce a código de máquina sin lanzar otro proceso. El código de .text se
+ * guarda como una lista de elementos (instrucciones ya codificadas, saltos,
+ * etiquetas y alineaciones) porque el tamaño de un salto depende de la
+ * distancia a su destino: todos empiezan cortos y los que no alcanzan se
+ * alargan hasta que ninguno cambia. Después se resuelven las referencias
+ * dentro de .text y el resto queda como reubicaciones R_X86_64_PC32 (datos) o
+ * R_X86_64_PLT32 (llamadas a funciones externas), igual que con NASM.
+ *
+ * Las formas de instrucción elegidas son las cortas que elige NASM con su
+ * optimización por omisión (inmediatos de 8 bits, "mov r32, imm32" para
+ * constantes de 64 bits positivas que caben, formas del acumulador), así que
+ * el reporte de tamaño de -Os da lo mismo con uno u otro ensamblador.
+ */
+
+#define MAX_OPERANDS 3
+#define MAX_CONDITIONAL_NESTING 16
+#define MAX_INSTRUCTION_LENGTH 16
+
+enum
+{
+    SEC_TEXT,
+    SEC_DATA,
+    SEC_BSS,
+    NUM_SECTIONS,
+    SEC_NOTE = NUM_SECTIONS, // .note.GNU-stack: solo marca la pila como no ejecutable
+    SEC_UNDEFINED = -1
+};
+
+typedef struct
+{
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+typedef enum
+{
+    ITEM_CODE,
+    ITEM_JUMP,
+    ITEM_ALIGN,
+    ITEM_LABEL
+} ItemKind;
+
+typedef enum
+{
+    FIX_NONE,
+    FIX_REL32,    // [rel símbolo]: desplazamiento desde el final de la instrucción
+    FIX_BRANCH32, // call/jmp a un símbolo
+    FIX_DIFF32    // dd a - b
+} FixupKind;
+
+typedef struct
+{
+    ItemKind kind;
+    unsigned char bytes[MAX_INSTRUCTION_LENGTH];
+    int length;
+    FixupKind fixup;
+    int fix_pos;      // inicio del campo de 32 bits dentro de bytes
+    int symbol;       // destino del salto o de la referencia
+    int symbol2;      // FIX_DIFF32: el que se resta
+    long long addend; // [rel símbolo + n]
+    int cond;         // ITEM_JUMP: condición de 0 a 15, o -1 para jmp
+    int is_long;      // ITEM_JUMP: el destino no está a distancia de rel8
+    int align;        // ITEM_ALIGN
+    size_t offset;    // posición en .text, fijada al distribuir
+    int line;
+} TextItem;
+
+typedef struct
+{
+    int section;   // SEC_*, o SEC_UNDEFINED
+    size_t offset; // .data y .bss
+    int item;      // .text: su elemento ITEM_LABEL
+    int is_global;
+    int is_extern;
+    int elf_index;
+} AsmSymbol;
+
+typedef struct
+{
+    uint64_t offset;
+    uint32_t type;
+    uint32_t symbol; // índice en .symtab
+    int64_t addend;
+} Relocation;
+
+typedef struct
+{
+    NameTable *names;
+    AsmSymbol *symbols;
+    int symbols_capacity;
+
+    TextItem *items;
+    int num_items;
+    int items_capacity;
+
+    ByteBuffer text;
+    ByteBuffer data;
+    size_t bss_size;
+
+    Relocation *relocs;
+    int num_relocs;
+    int relocs_capacity;
+
+    int section;
+    int default_rel;
+    unsigned char conditional[MAX_CONDITIONAL_NESTING]; // 1 si la rama abierta se ensambla
+    int conditional_depth;
+    int line;
+    int failed;
+} Assembler;
+
+typedef enum
+{
+    OPND_REG,
+    OPND_XMM,
+    OPND_IMM,
+    OPND_MEM,
+    OPND_SYMBOL
+} OperandKind;
+
+typedef struct
+{
+    OperandKind kind;
+    int reg;        // número de registro (0-15)
+    int size;       // bytes del registro, o tamaño explícito de la memoria (0 si no se dio)
+    long long imm;
+    int base;       // memoria: -1 si no hay
+    int index;      // memoria: -1 si no hay
+    int scale;
+    long long disp;
+    int symbol;     // [rel símbolo] o destino de un salto; -1 si no hay
+} Operand;
+
+/* ELF64 */
+#define ELF_SHT_PROGBITS 1
+#define ELF_SHT_SYMTAB 2
+#define ELF_SHT_STRTAB 3
+#define ELF_SHT_RELA 4
+#define ELF_SHT_NOBITS 8
+#define ELF_SHF_WRITE 0x1
+#define ELF_SHF_ALLOC 0x2
+#define ELF_SHF_EXECINSTR 0x4
+#define ELF_SHF_INFO_LINK 0x40
+#define ELF_STB_LOCAL 0
+#define ELF_STB_GLOBAL 1
+#define ELF_STT_NOTYPE 0
+#define ELF_STT_SECTION 3
+#define ELF_R_X86_64_PC32 2
+#define ELF_R_X86_64_PLT32 4
+
+static void *elfobj_grow(void *p, int *capacity, int needed, size_t element_size)
+{
+    if (needed <= *capacity)
+        return p;
+    int new_capacity = *capacity == 0 ? 64 : *capacity;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+    p = realloc(p, (size_t)new_capacity * element_size);
+    if (p == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el ensamblador integrado.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset((char *)p + (size_t)*capacity * element_size, 0, (size_t)(new_capacity - *capacity) * element_size);
+    *capacity = new_capacity;
+    return p;
+}
+
+static void buffer_write(ByteBuffer *b, const void *bytes, size_t count)
+{
+    if (b->size + count > b->capacity)
+    {
+        size_t capacity = b->capacity == 0 ? 256 : b->capacity;
+        while (capacity < b->size + count)
+            capacity *= 2;
+        b->data = realloc(b->data, capacity);
+        if (b->data == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo asignar memoria para el ensamblador integrado.\n");
+            exit(EXIT_FAILURE);
+        }
+        b->capacity = capacity;
+    }
+    if (bytes != NULL)
+        memcpy(b->data + b->size, bytes, count);
+    else
+        memset(b->data + b->size, 0, count);
+    b->size += count;
+}
+
+static void buffer_put(ByteBuffer *b, uint64_t value, int size)
+{
+    unsigned char bytes[8];
+    for (int k = 0; k < size; k++)
+        bytes[k] = (unsigned char)(value >> (8 * k));
+    buffer_write(b, bytes, size);
+}
+
+static void buffer_align(ByteBuffer *b, size_t align)
+{
+    while (b->size % align != 0)
+        buffer_write(b, NULL, 1);
+}
+
+static void asm_error(Assembler *as, const char *formato, ...) __attribute__((format(printf, 2, 3)));
+
+static void asm_error(Assembler *as, const char *formato, ...)
+{
+    if (as->failed)
+        return;
+    as->failed = 1;
+    va_list args;
+    va_start(args, formato);
+    fprintf(stderr, "Error: ensamblador integrado, línea %d: ", as->line);
+    vfprintf(stderr, formato, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+static int symbol_id(Assembler *as, const char *name)
+{
+    int id = intern_name(as->names, name);
+    if (id >= as->symbols_capacity)
+    {
+        int old = as->symbols_capacity;
+        as->symbols = elfobj_grow(as->symbols, &as->symbols_capacity, id + 1, sizeof(AsmSymbol));
+        for (int s = old; s < as->symbols_capacity; s++)
+            as->symbols[s].section = SEC_UNDEFINED;
+    }
+    return id;
+}
+
+static TextItem *new_item(Assembler *as, ItemKind kind)
+{
+    as->items = elfobj_grow(as->items, &as->items_capacity, as->num_items + 1, sizeof(TextItem));
+    TextItem *it = &as->items[as->num_items++];
+    memset(it, 0, sizeof(TextItem));
+    it->kind = kind;
+    it->symbol = it->symbol2 = -1;
+    it->cond = -1;
+    it->line = as->line;
+    return it;
+}
+
+static void define_label(Assembler *as, const char *name)
+{
+    int id = symbol_id(as, name);
+    AsmSymbol *sym = &as->symbols[id];
+    if (sym->section != SEC_UNDEFINED || sym->is_extern)
+    {
+        asm_error(as, "el símbolo '%s' ya está definido.", name);
+        return;
+    }
+    switch (as->section)
+    {
+    case SEC_TEXT:
+        sym->item = as->num_items;
+        new_item(as, ITEM_LABEL);
+        break;
+    case SEC_DATA:
+        sym->offset = as->data.size;
+        break;
+    case SEC_BSS:
+        sym->offset = as->bss_size;
+        break;
+    default:
+        asm_error(as, "etiqueta '%s' fuera de .text, .data o .bss.", name);
+        return;
+    }
+    sym->section = as->section;
+}
+
+/* ---------------------------------------------------------------------------
+ * Operandos
+ * ------------------------------------------------------------------------- */
+
+static char *trim(char *s)
+{
+    while (isspace((unsigned char)*s))
+        s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+    return s;
+}
+
+static int is_identifier_start(int c)
+{
+    return isalpha(c) || c == '_' || c == '.';
+}
+
+static int is_identifier(const char *s)
+{
+    if (!is_identifier_start((unsigned char)*s))
+        return 0;
+    for (s++; *s; s++)
+    {
+        if (!isalnum((unsigned char)*s) && *s != '_' && *s != '.')
+            return 0;
+    }
+    return 1;
+}
+
+/* Decimal o hexadecimal (0x...), con signo opcional; debe ocupar toda la cadena. */
+static int parse_number(const char *s, long long *value)
+{
+    s = s + strspn(s, " \t");
+    int negative = 0;
+    if (*s == '-' || *s == '+')
+    {
+        negative = *s == '-';
+        s++;
+        s += strspn(s, " \t");
+    }
+    int base = 10;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    {
+        base = 16;
+        s += 2;
+    }
+    if (!isxdigit((unsigned char)*s) || (base == 10 && !isdigit((unsigned char)*s)))
+        return 0;
+    char *end;
+    unsigned long long magnitude = strtoull(s, &end, base);
+    end += strspn(end, " \t");
+    if (*end != '\0')
+        return 0;
+    *value = negative ? (long long)(0 - magnitude) : (long long)magnitude;
+    return 1;
+}
+
+static int parse_register(const char *s, int *number, int *size)
+{
+    static const char *const legacy64[8] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi"};
+    static const char *const legacy32[8] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+    static const char *const legacy8[4] = {"al", "cl", "dl", "bl"};
+
+    for (int r = 0; r < 8; r++)
+    {
+        if (strcmp(s, legacy64[r]) == 0 || strcmp(s, legacy32[r]) == 0)
+        {
+            *number = r;
+            *size = s[0] == 'r' ? 8 : 4;
+            return 1;
+        }
+    }
+    for (int r = 0; r < 4; r++)
+    {
+        if (strcmp(s, legacy8[r]) == 0)
+        {
+            *number = r;
+            *size = 1;
+            return 1;
+        }
+    }
+
+    // r8-r15 con sufijo opcional d (32 bits) o b (8 bits)
+    if (s[0] == 'r' && isdigit((unsigned char)s[1]))
+    {
+        char *end;
+        long r = strtol(s + 1, &end, 10);
+        if (r < 8 || r > 15)
+            return 0;
+        *number = (int)r;
+        if (*end == '\0')
+            *size = 8;
+        else if (strcmp(end, "d") == 0)
+            *size = 4;
+        else if (strcmp(end, "b") == 0)
+            *size = 1;
+        else
+            return 0;
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_xmm(const char *s, int *number)
+{
+    if (strncmp(s, "xmm", 3) != 0 || !isdigit((unsigned char)s[3]))
+        return 0;
+    char *end;
+    long r = strtol(s + 3, &end, 10);
+    if (*end != '\0' || r > 15)
+        return 0;
+    *number = (int)r;
+    return 1;
+}
+
+/* Contenido de [...]: "rel símbolo [± n]", o base + índice*escala ± desplazamiento. */
+static int parse_memory(Assembler *as, char *inside, Operand *op)
+{
+    op->kind = OPND_MEM;
+    op->base = op->index = op->symbol = -1;
+    op->scale = 1;
+    op->disp = 0;
+
+    char *s = trim(inside);
+    int rip = as->default_rel;
+    if (strncmp(s, "rel", 3) == 0 && isspace((unsigned char)s[3]))
+    {
+        rip = 1;
+        s = trim(s + 3);
+    }
+
+    int sign = 1;
+    while (*s)
+    {
+        // Término hasta el siguiente + o - (los de un número negativo van en el signo)
+        size_t length = strcspn(s, "+-");
+        char saved = s[length];
+        s[length] = '\0';
+        char *term = trim(s);
+        char *star = strchr(term, '*');
+        int number, size;
+        long long value;
+
+        if (star != NULL)
+        {
+            *star = '\0';
+            long long scale;
+            if (!parse_register(trim(term), &number, &size) || size != 8 || sign < 0 ||
+                !parse_number(star + 1, &scale) || (scale != 1 && scale != 2 && scale != 4 && scale != 8) ||
+                op->index != -1 || number == 4)
+                return 0;
+            op->index = number;
+            op->scale = (int)scale;
+        }
+        else if (parse_register(term, &number, &size))
+        {
+            if (size != 8 || sign < 0)
+                return 0;
+            if (op->base == -1)
+                op->base = number;
+            else if (op->index == -1 && number != 4)
+                op->index = number;
+            else
+                return 0;
+        }
+        else if (parse_number(term, &value))
+            op->disp += sign * value;
+        else if (is_identifier(term) && op->symbol == -1 && sign > 0)
+            op->symbol = symbol_id(as, term);
+        else
+            return 0;
+
+        s[length] = saved;
+        s += length;
+        if (*s == '\0')
+            break;
+        sign = *s == '-' ? -1 : 1;
+        s++;
+    }
+
+    if (op->symbol != -1)
+        return rip && op->base == -1 && op->index == -1;
+    return !rip && op->base != -1;
+}
+
+static int parse_operand(Assembler *as, char *text, Operand *op)
+{
+    memset(op, 0, sizeof(Operand));
+    op->base = op->index = op->symbol = -1;
+    char *s = trim(text);
+
+    static const struct
+    {
+        const char *name;
+        int size;
+    } sizes[] = {{"byte", 1}, {"word", 2}, {"dword", 4}, {"qword", 8}};
+    int explicit_size = 0;
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++)
+    {
+        size_t length = strlen(sizes[k].name);
+        if (strncmp(s, sizes[k].name, length) == 0 && (isspace((unsigned char)s[length]) || s[length] == '['))
+        {
+            explicit_size = sizes[k].size;
+            s = trim(s + length);
+            break;
+        }
+    }
+
+    if (*s == '[')
+    {
+        char *close = strrchr(s, ']');
+        if (close == NULL || trim(close + 1)[0] != '\0')
+            return 0;
+        *close = '\0';
+        if (!parse_memory(as, s + 1, op))
+            return 0;
+        op->size = explicit_size;
+        return 1;
+    }
+    if (explicit_size != 0)
+        return 0;
+
+    if (parse_register(s, &op->reg, &op->size))
+    {
+        op->kind = OPND_REG;
+        return 1;
+    }
+    if (parse_xmm(s, &op->reg))
+    {
+        op->kind = OPND_XMM;
+        op->size = 16;
+        return 1;
+    }
+    if (parse_number(s, &op->imm))
+    {
+        op->kind = OPND_IMM;
+        return 1;
+    }
+    if (is_identifier(s))
+    {
+        op->kind = OPND_SYMBOL;
+        op->symbol = symbol_id(as, s);
+        return 1;
+    }
+    return 0;
+}
+
+/* Separa por comas que no estén entre corchetes ni entre comillas. */
+static int split_operands(char *s, char **fields, int max_fields)
+{
+    int count = 0;
+    int depth = 0;
+    char quote = 0;
+    s = trim(s);
+    if (*s == '\0')
+        return 0;
+    fields[count++] = s;
+    for (char *p = s; *p; p++)
+    {
+        if (quote)
+        {
+            if (*p == quote)
+                quote = 0;
+        }
+        else if (*p == '"' || *p == '\'' || *p == '`')
+            quote = *p;
+        else if (*p == '[')
+            depth++;
+        else if (*p == ']')
+            depth--;
+        else if (*p == ',' && depth == 0)
+        {
+            if (count == max_fields)
+                return -1;
+            *p = '\0';
+            fields[count++] = p + 1;
+        }
+    }
+    for (int k = 0; k < count; k++)
+        fields[k] = trim(fields[k]);
+    return count;
+}
+
+/* ---------------------------------------------------------------------------
+ * Codificación
+ * ------------------------------------------------------------------------- */
+
+static int fits_int8(long long v)
+{
+    return v >= -128 && v <= 127;
+}
+
+static int fits_int32(long long v)
+{
+    return v >= INT32_MIN && v <= INT32_MAX;
+}
+
+static void put_byte(TextItem *it, int b)
+{
+    it->bytes[it->length++] = (unsigned char)b;
+}
+
+static void put_value(TextItem *it, long long v, int size)
+{
+    for (int k = 0; k < size; k++)
+        put_byte(it, (int)((unsigned long long)v >> (8 * k)) & 0xff);
+}
+
+/*
+ * Prefijo obligatorio, REX, código de operación y ModRM (con SIB y
+ * desplazamiento si hacen falta) de una instrucción con operando r/m.
+ */
+static void encode_modrm(Assembler *as, TextItem *it, int prefix, int rex_w, const unsigned char *opcode,
+                         int opcode_length, int reg_field, const Operand *rm)
+{
+    int rex = rex_w ? 8 : 0;
+    if (reg_field & 8)
+        rex |= 4;
+    if (rm->kind == OPND_MEM)
+    {
+        if (rm->index != -1 && (rm->index & 8))
+            rex |= 2;
+        if (rm->base != -1 && (rm->base & 8))
+            rex |= 1;
+    }
+    else if (rm->reg & 8)
+        rex |= 1;
+
+    if (prefix)
+        put_byte(it, prefix);
+    if (rex)
+        put_byte(it, 0x40 | rex);
+    for (int k = 0; k < opcode_length; k++)
+        put_byte(it, opcode[k]);
+
+    int reg = (reg_field & 7) << 3;
+    if (rm->kind != OPND_MEM)
+    {
+        put_byte(it, 0xC0 | reg | (rm->reg & 7));
+        return;
+    }
+
+    if (rm->symbol != -1)
+    {
+        // RIP + disp32; el desplazamiento se completa al conocer la distribución
+        put_byte(it, 0x05 | reg);
+        it->fixup = FIX_REL32;
+        it->fix_pos = it->length;
+        it->symbol = rm->symbol;
+        it->addend = rm->disp;
+        put_value(it, 0, 4);
+        return;
+    }
+
+    int mod;
+    if (rm->disp == 0 && (rm->base & 7) != 5) // rbp y r13 siempre llevan desplazamiento
+        mod = 0;
+    else if (fits_int8(rm->disp))
+        mod = 1;
+    else if (fits_int32(rm->disp))
+        mod = 2;
+    else
+    {
+        asm_error(as, "desplazamiento de memoria fuera de rango.");
+        return;
+    }
+
+    if (rm->index != -1 || (rm->base & 7) == 4) // rsp y r12 como base necesitan SIB
+    {
+        static const int scale_bits[9] = {0, 0, 1, 0, 2, 0, 0, 0, 3};
+        int index = rm->index != -1 ? rm->index : 4;
+        put_byte(it, (mod << 6) | reg | 4);
+        put_byte(it, (scale_bits[rm->scale] << 6) | ((index & 7) << 3) | (rm->base & 7));
+    }
+    else
+        put_byte(it, (mod << 6) | reg | (rm->base & 7));
+
+    if (mod == 1)
+        put_value(it, rm->disp, 1);
+    else if (mod == 2)
+        put_value(it, rm->disp, 4);
+}
+
+static void encode_rm(Assembler *as, TextItem *it, int size, const unsigned char *opcode, int opcode_length,
+                      int reg_field, const Operand *rm)
+{
+    encode_modrm(as, it, 0, size == 8, opcode, opcode_length, reg_field, rm);
+}
+
+static void encode_rm1(Assembler *as, TextItem *it, int size, int opcode, int reg_field, const Operand *rm)
+{
+    unsigned char op = (unsigned char)opcode;
+    encode_rm(as, it, size, &op, 1, reg_field, rm);
+}
+
+static int is_rm(const Operand *op)
+{
+    return op->kind == OPND_REG || op->kind == OPND_MEM;
+}
+
+/* Tamaño de una instrucción de dos operandos: el de un registro o el explícito de la memoria. */
+static int operand_size(Assembler *as, const Operand *a, const Operand *b)
+{
+    int size = 0;
+    if (a->kind == OPND_REG)
+        size = a->size;
+    else if (b != NULL && b->kind == OPND_REG)
+        size = b->size;
+    else if (a->kind == OPND_MEM)
+        size = a->size;
+
+    if (a->kind == OPND_REG && b != NULL && b->kind == OPND_REG && a->size != b->size)
+        size = 0;
+    if (a->kind == OPND_MEM && a->size != 0 && a->size != size)
+        size = 0;
+    if (size != 1 && size != 4 && size != 8)
+    {
+        asm_error(as, "tamaño de operando no especificado o no soportado.");
+        return 0;
+    }
+    return size;
+}
+
+static int check_immediate(Assembler *as, long long value, int size)
+{
+    int ok = size == 1 ? value >= -128 && value <= 255
+             : size == 4 ? value >= INT32_MIN && value <= (long long)UINT32_MAX
+                         : fits_int32(value);
+    if (!ok)
+        asm_error(as, "inmediato %lld fuera de rango.", value);
+    return ok;
+}
+
+/* add, or, adc, sbb, and, sub, xor y cmp: grupo /n del 80-83 y formas 00-3D */
+static void encode_alu(Assembler *as, TextItem *it, int n, int count, Operand *ops)
+{
+    if (count != 2 || !is_rm(&ops[0]))
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+    Operand *dst = &ops[0];
+    Operand *src = &ops[1];
+    int size = operand_size(as, dst, src->kind == OPND_REG ? src : NULL);
+    if (size == 0)
+        return;
+    int byte = size == 1;
+
+    if (src->kind == OPND_REG)
+        encode_rm1(as, it, size, 8 * n + (byte ? 0 : 1), src->reg, dst);
+    else if (src->kind == OPND_MEM && dst->kind == OPND_REG)
+        encode_rm1(as, it, size, 8 * n + (byte ? 2 : 3), dst->reg, src);
+    else if (src->kind == OPND_IMM)
+    {
+        if (!check_immediate(as, src->imm, size))
+            return;
+        if (byte)
+        {
+            encode_rm1(as, it, size, 0x80, n, dst);
+            put_value(it, src->imm, 1);
+        }
+        else if (fits_int8(src->imm))
+        {
+            encode_rm1(as, it, size, 0x83, n, dst);
+            put_value(it, src->imm, 1);
+        }
+        else if (dst->kind == OPND_REG && dst->reg == 0)
+        {
+            if (size == 8)
+                put_byte(it, 0x48);
+            put_byte(it, 8 * n + 5);
+            put_value(it, src->imm, 4);
+        }
+        else
+        {
+            encode_rm1(as, it, size, 0x81, n, dst);
+            put_value(it, src->imm, 4);
+        }
+    }
+    else
+        asm_error(as, "operandos inválidos.");
+}
+
+static void encode_mov(Assembler *as, TextItem *it, int count, Operand *ops)
+{
+    if (count != 2 || !is_rm(&ops[0]))
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+    Operand *dst = &ops[0];
+    Operand *src = &ops[1];
+    int size = operand_size(as, dst, src->kind == OPND_REG ? src : NULL);
+    if (size == 0)
+        return;
+    int byte = size == 1;
+
+    if (src->kind == OPND_REG)
+        encode_rm1(as, it, size, byte ? 0x88 : 0x89, src->reg, dst);
+    else if (src->kind == OPND_MEM && dst->kind == OPND_REG)
+        encode_rm1(as, it, size, byte ? 0x8A : 0x8B, dst->reg, src);
+    else if (src->kind == OPND_IMM && dst->kind == OPND_REG)
+    {
+        long long v = src->imm;
+        if (dst->reg & 8)
+            put_byte(it, size == 8 && !(v >= 0 && v <= (long long)UINT32_MAX) && !fits_int32(v) ? 0x49 : 0x41);
+        else if (size == 8 && !(v >= 0 && v <= (long long)UINT32_MAX) && !fits_int32(v))
+            put_byte(it, 0x48);
+
+        if (byte)
+        {
+            if (!check_immediate(as, v, 1))
+                return;
+            put_byte(it, 0xB0 + (dst->reg & 7));
+            put_value(it, v, 1);
+        }
+        else if (size == 4 || (v >= 0 && v <= (long long)UINT32_MAX))
+        {
+            // Escribir la mitad baja pone en cero la alta: mov r32, imm32 basta
+            if (!check_immediate(as, v, 4))
+                return;
+            put_byte(it, 0xB8 + (dst->reg & 7));
+            put_value(it, v, 4);
+        }
+        else if (fits_int32(v))
+        {
+            it->length = 0;
+            encode_rm1(as, it, 8, 0xC7, 0, dst);
+            put_value(it, v, 4);
+        }
+        else
+        {
+            put_byte(it, 0xB8 + (dst->reg & 7));
+            put_value(it, v, 8);
+        }
+    }
+    else if (src->kind == OPND_IMM)
+    {
+        if (!check_immediate(as, src->imm, size))
+            return;
+        encode_rm1(as, it, size, byte ? 0xC6 : 0xC7, 0, dst);
+        put_value(it, src->imm, byte ? 1 : 4);
+    }
+    else
+        asm_error(as, "operandos inválidos.");
+}
+
+/* not, neg, mul, imul, div e idiv de un operando (F6/F7) y inc/dec (FE/FF) */
+static void encode_unary(Assembler *as, TextItem *it, int opcode, int n, int count, Operand *ops)
+{
+    if (count != 1 || !is_rm(&ops[0]))
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+    int size = operand_size(as, &ops[0], NULL);
+    if (size != 0)
+        encode_rm1(as, it, size, size == 1 ? opcode - 1 : opcode, n, &ops[0]);
+}
+
+static void encode_imul(Assembler *as, TextItem *it, int count, Operand *ops)
+{
+    if (count == 1)
+    {
+        encode_unary(as, it, 0xF7, 5, count, ops);
+        return;
+    }
+    if (ops[0].kind != OPND_REG || ops[0].size == 1)
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+    // imul r, imm es imul r, r, imm
+    Operand *src = count == 2 && ops[1].kind == OPND_IMM ? &ops[0] : &ops[1];
+    Operand *imm = count == 3 ? &ops[2] : ops[1].kind == OPND_IMM ? &ops[1] : NULL;
+    int size = ops[0].size;
+    if (!is_rm(src) || (src->kind == OPND_REG && src->size != size) || (imm != NULL && imm->kind != OPND_IMM))
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+
+    if (imm == NULL)
+    {
+        static const unsigned char opcode[2] = {0x0F, 0xAF};
+        encode_rm(as, it, size, opcode, 2, ops[0].reg, src);
+    }
+    else if (!check_immediate(as, imm->imm, size == 8 ? 8 : 4))
+        return;
+    else if (fits_int8(imm->imm))
+    {
+        encode_rm1(as, it, size, 0x6B, ops[0].reg, src);
+        put_value(it, imm->imm, 1);
+    }
+    else
+    {
+        encode_rm1(as, it, size, 0x69, ops[0].reg, src);
+        put_value(it, imm->imm, 4);
+    }
+}
+
+/* rol, ror, rcl, rcr, shl/sal, shr y sar: grupo /n del C1/D1/D3 */
+static void encode_shift(Assembler *as, TextItem *it, int n, int count, Operand *ops)
+{
+    if (count != 2 || !is_rm(&ops[0]))
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+    int size = operand_size(as, &ops[0], NULL);
+    if (size == 0)
+        return;
+    int byte = size == 1;
+    if (ops[1].kind == OPND_REG && ops[1].size == 1 && ops[1].reg == 1) // cl
+        encode_rm1(as, it, size, byte ? 0xD2 : 0xD3, n, &ops[0]);
+    else if (ops[1].kind == OPND_IMM && ops[1].imm == 1)
+        encode_rm1(as, it, size, byte ? 0xD0 : 0xD1, n, &ops[0]);
+    else if (ops[1].kind == OPND_IMM && ops[1].imm >= 0 && ops[1].imm <= 255)
+    {
+        encode_rm1(as, it, size, byte ? 0xC0 : 0xC1, n, &ops[0]);
+        put_value(it, ops[1].imm, 1);
+    }
+    else
+        asm_error(as, "operandos inválidos.");
+}
+
+static void encode_test(Assembler *as, TextItem *it, int count, Operand *ops)
+{
+    if (count != 2 || !is_rm(&ops[0]))
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+    int size = operand_size(as, &ops[0], ops[1].kind == OPND_REG ? &ops[1] : NULL);
+    if (size == 0)
+        return;
+    int byte = size == 1;
+    if (ops[1].kind == OPND_REG)
+        encode_rm1(as, it, size, byte ? 0x84 : 0x85, ops[1].reg, &ops[0]);
+    else if (ops[1].kind == OPND_IMM && check_immediate(as, ops[1].imm, size))
+    {
+        encode_rm1(as, it, size, byte ? 0xF6 : 0xF7, 0, &ops[0]);
+        put_value(it, ops[1].imm, byte ? 1 : 4);
+    }
+    else
+        asm_error(as, "operandos inválidos.");
+}
+
+static int parse_condition(const char *s)
+{
+    static const struct
+    {
+        const char *name;
+        int code;
+    } conditions[] = {
+        {"o", 0},   {"no", 1},  {"b", 2},  {"c", 2},   {"nae", 2}, {"ae", 3},  {"nb", 3},  {"nc", 3},
+        {"e", 4},   {"z", 4},   {"ne", 5}, {"nz", 5},  {"be", 6},  {"na", 6},  {"a", 7},   {"nbe", 7},
+        {"s", 8},   {"ns", 9},  {"p", 10}, {"pe", 10}, {"np", 11}, {"po", 11}, {"l", 12},  {"nge", 12},
+        {"ge", 13}, {"nl", 13}, {"le", 14}, {"ng", 14}, {"g", 15}, {"nle", 15},
+    };
+    for (size_t k = 0; k < sizeof(conditions) / sizeof(conditions[0]); k++)
+    {
+        if (strcmp(s, conditions[k].name) == 0)
+            return conditions[k].code;
+    }
+    return -1;
+}
+
+/* jmp, jcc y call: a un símbolo, o indirectos por registro o memoria (FF /4, FF /2) */
+static void encode_branch(Assembler *as, TextItem *it, int cond, int is_call, int count, Operand *ops)
+{
+    if (count != 1)
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+    if (ops[0].kind == OPND_SYMBOL)
+    {
+        if (is_call)
+        {
+            put_byte(it, 0xE8);
+            it->fixup = FIX_BRANCH32;
+            it->fix_pos = it->length;
+            it->symbol = ops[0].symbol;
+            put_value(it, 0, 4);
+            return;
+        }
+        it->kind = ITEM_JUMP;
+        it->cond = cond;
+        it->symbol = ops[0].symbol;
+        return;
+    }
+    if (cond != -1 || !is_rm(&ops[0]) || (ops[0].kind == OPND_REG && ops[0].size != 8))
+    {
+        asm_error(as, "operandos inválidos.");
+        return;
+    }
+    encode_rm1(as, it, 0, 0xFF, is_call ? 2 : 4, &ops[0]);
+}
+
+static void encode_instruction(Assembler *as, const char *mnemonic, int count, Operand *ops)
+{
+    static const char *const alu[8] = {"add", "or", "adc", "sbb", "and", "sub", "xor", "cmp"};
+    static const struct
+    {
+        const char *name;
+        int n;
+    } shifts[] = {{"rol", 0}, {"ror", 1}, {"rcl", 2}, {"rcr", 3}, {"shl", 4}, {"sal", 4}, {"shr", 5}, {"sar", 7}};
+    static const struct
+    {
+        const char *name;
+        int opcode;
+        int n;
+    } unary[] = {{"not", 0xF7, 2}, {"neg", 0xF7, 3}, {"mul", 0xF7, 4}, {"div", 0xF7, 6},
+                 {"idiv", 0xF7, 7}, {"inc", 0xFF, 0}, {"dec", 0xFF, 1}};
+    static const struct
+    {
+        const char *name;
+        unsigned char bytes[2];
+        int length;
+    } fixed[] = {{"ret", {0xC3}, 1}, {"cqo", {0x48, 0x99}, 2}, {"cdq", {0x99}, 1}, {"nop", {0x90}, 1},
+                 {"leave", {0xC9}, 1}};
+
+    if (as->section != SEC_TEXT)
+    {
+        asm_error(as, "instrucción '%s' fuera de .text.", mnemonic);
+        return;
+    }
+    TextItem *it = new_item(as, ITEM_CODE);
+
+    for (int k = 0; k < 8; k++)
+    {
+        if (strcmp(mnemonic, alu[k]) == 0)
+        {
+            encode_alu(as, it, k, count, ops);
+            return;
+        }
+    }
+    for (size_t k = 0; k < sizeof(shifts) / sizeof(shifts[0]); k++)
+    {
+        if (strcmp(mnemonic, shifts[k].name) == 0)
+        {
+            encode_shift(as, it, shifts[k].n, count, ops);
+            return;
+        }
+    }
+    for (size_t k = 0; k < sizeof(unary) / sizeof(unary[0]); k++)
+    {
+        if (strcmp(mnemonic, unary[k].name) == 0)
+        {
+            encode_unary(as, it, unary[k].opcode, unary[k].n, count, ops);
+            return;
+        }
+    }
+    for (size_t k = 0; k < sizeof(fixed) / sizeof(fixed[0]); k++)
+    {
+        if (strcmp(mnemonic, fixed[k].name) == 0)
+        {
+            if (count != 0)
+                asm_error(as, "'%s' no lleva operandos.", mnemonic);
+            for (int b = 0; b < fixed[k].length; b++)
+                put_byte(it, fixed[k].bytes[b]);
+            return;
+        }
+    }
+
+    if (strcmp(mnemonic, "mov") == 0)
+        encode_mov(as, it, count, ops);
+    else if (strcmp(mnemonic, "imul") == 0)
+        encode_imul(as, it, count, ops);
+    else if (strcmp(mnemonic, "test") == 0)
+        encode_test(as, it, count, ops);
+    else if (strcmp(mnemonic, "lea") == 0)
+    {
+        if (count != 2 || ops[0].kind != OPND_REG || ops[0].size == 1 || ops[1].kind != OPND_MEM)
+            asm_error(as, "operandos inválidos.");
+        else
+            encode_rm1(as, it, ops[0].size, 0x8D, ops[0].reg, &ops[1]);
+    }
+    else if (strcmp(mnemonic, "movzx") == 0)
+    {
+        int source_size = ops[1].size;
+        if (count != 2 || ops[0].kind != OPND_REG || ops[0].size == 1 || !is_rm(&ops[1]) ||
+            (source_size != 1 && source_size != 2))
+            asm_error(as, "operandos inválidos.");
+        else
+        {
+            const unsigned char opcode[2] = {0x0F, source_size == 1 ? 0xB6 : 0xB7};
+            encode_rm(as, it, ops[0].size, opcode, 2, ops[0].reg, &ops[1]);
+        }
+    }
+    else if (strcmp(mnemonic, "movsxd") == 0)
+    {
+        if (count != 2 || ops[0].kind != OPND_REG || ops[0].size != 8 || !is_rm(&ops[1]) || ops[1].size != 4)
+            asm_error(as, "operandos inválidos.");
+        else
+            encode_rm1(as, it, 8, 0x63, ops[0].reg, &ops[1]);
+    }
+    else if (strcmp(mnemonic, "movsd") == 0)
+    {
+        // movsd xmm, xmm/m64 (F2 0F 10) y movsd m64, xmm (F2 0F 11)
+        int load = ops[0].kind == OPND_XMM;
+        Operand *xmm = load ? &ops[0] : &ops[1];
+        Operand *rm = load ? &ops[1] : &ops[0];
+        if (count != 2 || xmm->kind != OPND_XMM || (rm->kind != OPND_MEM && rm->kind != OPND_XMM) ||
+            (rm->kind == OPND_MEM && rm->size != 0 && rm->size != 8))
+            asm_error(as, "operandos inválidos.");
+        else
+        {
+            const unsigned char opcode[2] = {0x0F, load ? 0x10 : 0x11};
+            encode_modrm(as, it, 0xF2, 0, opcode, 2, xmm->reg, rm);
+        }
+    }
+    else if (strcmp(mnemonic, "push") == 0 || strcmp(mnemonic, "pop") == 0)
+    {
+        if (count != 1 || ops[0].kind != OPND_REG || ops[0].size != 8)
+            asm_error(as, "operandos inválidos.");
+        else
+        {
+            if (ops[0].reg & 8)
+                put_byte(it, 0x41);
+            put_byte(it, (mnemonic[1] == 'u' ? 0x50 : 0x58) + (ops[0].reg & 7));
+        }
+    }
+    else if (strncmp(mnemonic, "set", 3) == 0 && parse_condition(mnemonic + 3) != -1)
+    {
+        if (count != 1 || !is_rm(&ops[0]) || (ops[0].kind == OPND_REG && ops[0].size != 1) ||
+            (ops[0].kind == OPND_MEM && ops[0].size > 1))
+            asm_error(as, "operandos inválidos.");
+        else
+        {
+            const unsigned char opcode[2] = {0x0F, 0x90 + parse_condition(mnemonic + 3)};
+            encode_rm(as, it, 1, opcode, 2, 0, &ops[0]);
+        }
+    }
+    else if (strcmp(mnemonic, "jmp") == 0)
+        encode_branch(as, it, -1, 0, count, ops);
+    else if (strcmp(mnemonic, "call") == 0)
+        encode_branch(as, it, -1, 1, count, ops);
+    else if (mnemonic[0] == 'j' && parse_condition(mnemonic + 1) != -1)
+        encode_branch(as, it, parse_condition(mnemonic + 1), 0, count, ops);
+    else
+        asm_error(as, "instrucción no soportada: %s", mnemonic);
+}
+
+/* ---------------------------------------------------------------------------
+ * Directivas y datos
+ * ------------------------------------------------------------------------- */
+
+/* Cadena de db entre comillas: "..." y '...' tal cual; `...` con escapes de C. */
+static int parse_string(const char *s, ByteBuffer *out)
+{
+    char quote = s[0];
+    size_t length = strlen(s);
+    if (length < 2 || s[length - 1] != quote)
+        return 0;
+    for (size_t k = 1; k + 1 < length; k++)
+    {
+        unsigned char c = (unsigned char)s[k];
+        if (c == (unsigned char)quote)
+            return 0;
+        if (quote == '`' && c == '\\' && k + 2 < length)
+        {
+            static const char from[] = "ntr0\\'\"`";
+            static const char to[] = "\n\t\r\0\\'\"`";
+            const char *found = strchr(from, s[++k]);
+            if (found == NULL || *found == '\0')
+                return 0;
+            c = (unsigned char)to[found - from];
+        }
+        buffer_write(out, &c, 1);
+    }
+    return 1;
+}
+
+static void define_data(Assembler *as, const char *directive, char *args)
+{
+    int size = directive[1] == 'b' ? 1 : directive[1] == 'w' ? 2 : directive[1] == 'd' ? 4 : 8;
+    char *fields[4096];
+    int count = split_operands(args, fields, 4096);
+    if (count <= 0)
+    {
+        asm_error(as, count < 0 ? "'%s' con demasiados valores." : "'%s' sin valores.", directive);
+        return;
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        char *field = fields[k];
+        long long value;
+
+        if (as->section == SEC_TEXT)
+        {
+            // En .text solo las entradas de las tablas de saltos: dd etiqueta - etiqueta
+            char *minus = strchr(field, '-');
+            if (size != 4 || minus == NULL)
+            {
+                asm_error(as, "datos no soportados en .text.");
+                return;
+            }
+            *minus = '\0';
+            char *a = trim(field);
+            char *b = trim(minus + 1);
+            if (!is_identifier(a) || !is_identifier(b))
+            {
+                asm_error(as, "expresión no soportada en dd.");
+                return;
+            }
+            TextItem *it = new_item(as, ITEM_CODE);
+            it->fixup = FIX_DIFF32;
+            it->symbol = symbol_id(as, a);
+            it->symbol2 = symbol_id(as, b);
+            put_value(it, 0, 4);
+            continue;
+        }
+        if (as->section != SEC_DATA)
+        {
+            asm_error(as, "'%s' fuera de .data.", directive);
+            return;
+        }
+        if (size == 1 && (field[0] == '"' || field[0] == '\'' || field[0] == '`'))
+        {
+            if (!parse_string(field, &as->data))
+            {
+                asm_error(as, "cadena mal formada.");
+                return;
+            }
+        }
+        else if (parse_number(field, &value))
+            buffer_put(&as->data, (uint64_t)value, size);
+        else
+        {
+            asm_error(as, "valor no soportado en '%s': %s", directive, field);
+            return;
+        }
+    }
+}
+
+static void reserve_space(Assembler *as, const char *directive, char *args)
+{
+    int size = directive[3] == 'b' ? 1 : directive[3] == 'w' ? 2 : directive[3] == 'd' ? 4 : 8;
+    long long count;
+    if (!parse_number(args, &count) || count < 0)
+    {
+        asm_error(as, "cantidad inválida en '%s'.", directive);
+        return;
+    }
+    if (as->section == SEC_BSS)
+        as->bss_size += (size_t)(count * size);
+    else if (as->section == SEC_DATA)
+        buffer_write(&as->data, NULL, (size_t)(count * size));
+    else
+        asm_error(as, "'%s' fuera de .data o .bss.", directive);
+}
+
+static void align_section(Assembler *as, char *args)
+{
+    long long align;
+    if (!parse_number(args, &align) || align <= 0 || (align & (align - 1)) != 0 || align > 4096)
+    {
+        asm_error(as, "alineación inválida.");
+        return;
+    }
+    if (as->section == SEC_TEXT)
+        new_item(as, ITEM_ALIGN)->align = (int)align;
+    else if (as->section == SEC_DATA)
+        buffer_align(&as->data, (size_t)align);
+    else if (as->section == SEC_BSS)
+        as->bss_size = (as->bss_size + (size_t)align - 1) & ~((size_t)align - 1);
+}
+
+static void select_section(Assembler *as, char *args)
+{
+    char *name = strtok(args, " \t");
+    if (name == NULL)
+        asm_error(as, "falta el nombre de la sección.");
+    else if (strcmp(name, ".text") == 0)
+        as->section = SEC_TEXT;
+    else if (strcmp(name, ".data") == 0)
+        as->section = SEC_DATA;
+    else if (strcmp(name, ".bss") == 0)
+        as->section = SEC_BSS;
+    else if (strcmp(name, ".note.GNU-stack") == 0)
+        as->section = SEC_NOTE;
+    else
+        asm_error(as, "sección no soportada: %s", name);
+}
+
+static int is_data_directive(const char *word)
+{
+    static const char *const directives[] = {"db", "dw", "dd", "dq", "resb", "resw", "resd", "resq"};
+    for (size_t k = 0; k < sizeof(directives) / sizeof(directives[0]); k++)
+    {
+        if (strcmp(word, directives[k]) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static int conditional_active(const Assembler *as)
+{
+    for (int d = 0; d < as->conditional_depth; d++)
+    {
+        if (!as->conditional[d])
+            return 0;
+    }
+    return 1;
+}
+
+/* %ifdef, %ifndef, %else y %endif. Ningún símbolo del preprocesador está definido. */
+static void preprocess(Assembler *as, char *line)
+{
+    char *directive = strtok(line, " \t");
+    if (strcmp(directive, "%ifdef") == 0 || strcmp(directive, "%ifndef") == 0)
+    {
+        if (as->conditional_depth == MAX_CONDITIONAL_NESTING)
+        {
+            asm_error(as, "demasiados %%ifdef anidados.");
+            return;
+        }
+        as->conditional[as->conditional_depth++] = strcmp(directive, "%ifndef") == 0;
+    }
+    else if (strcmp(directive, "%else") == 0 && as->conditional_depth > 0)
+        as->conditional[as->conditional_depth - 1] = !as->conditional[as->conditional_depth - 1];
+    else if (strcmp(directive, "%endif") == 0 && as->conditional_depth > 0)
+        as->conditional_depth--;
+    else
+        asm_error(as, "directiva del preprocesador no soportada: %s", directive);
+}
+
+/* Quita el comentario (';' fuera de comillas). */
+static void strip_comment(char *line)
+{
+    char quote = 0;
+    for (char *p = line; *p; p++)
+    {
+        if (quote)
+        {
+            if (*p == quote)
+                quote = 0;
+        }
+        else if (*p == '"' || *p == '\'' || *p == '`')
+            quote = *p;
+        else if (*p == ';')
+        {
+            *p = '\0';
+            return;
+        }
+    }
+}
+
+/* Corta la primera palabra de *cursor y avanza el cursor a lo que sigue. */
+static char *next_word(char **cursor)
+{
+    char *s = *cursor + strspn(*cursor, " \t");
+    char *end = s + strcspn(s, " \t");
+    if (*end != '\0')
+        *end++ = '\0';
+    *cursor = end;
+    return s;
+}
+
+static void assemble_line(Assembler *as, char *line)
+{
+    strip_comment(line);
+    char *s = trim(line);
+    if (*s == '\0')
+        return;
+    if (*s == '%')
+    {
+        preprocess(as, s);
+        return;
+    }
+    if (!conditional_active(as))
+        return;
+
+    // Etiqueta "nombre:" y tal vez una instrucción en la misma línea
+    size_t word_length = strcspn(s, " \t:");
+    if (s[word_length] == ':' && word_length > 0)
+    {
+        s[word_length] = '\0';
+        if (!is_identifier(s))
+        {
+            asm_error(as, "etiqueta inválida: %s", s);
+            return;
+        }
+        define_label(as, s);
+        s = trim(s + word_length + 1);
+        if (*s == '\0')
+            return;
+    }
+
+    char *cursor = s;
+    char *word = next_word(&cursor);
+
+    // "nombre db ..." o "nombre resq n" definen la etiqueta sin dos puntos
+    char *after = cursor + strspn(cursor, " \t");
+    size_t second_length = strcspn(after, " \t");
+    char second[8] = "";
+    if (second_length < sizeof(second))
+    {
+        memcpy(second, after, second_length);
+        second[second_length] = '\0';
+    }
+    if (!is_data_directive(word) && is_data_directive(second) && is_identifier(word))
+    {
+        define_label(as, word);
+        word = next_word(&cursor);
+    }
+
+    if (strcmp(word, "section") == 0 || strcmp(word, "segment") == 0)
+        select_section(as, cursor);
+    else if (strcmp(word, "global") == 0 || strcmp(word, "extern") == 0)
+    {
+        char *name = trim(cursor);
+        if (!is_identifier(name))
+        {
+            asm_error(as, "nombre inválido en '%s'.", word);
+            return;
+        }
+        int id = symbol_id(as, name); // puede mover as->symbols
+        AsmSymbol *sym = &as->symbols[id];
+        if (word[0] == 'g')
+            sym->is_global = 1;
+        else
+            sym->is_extern = 1;
+    }
+    else if (strcmp(word, "default") == 0)
+        as->default_rel = strcmp(trim(cursor), "rel") == 0;
+    else if (strcmp(word, "bits") == 0)
+    {
+        if (strcmp(trim(cursor), "64") != 0)
+            asm_error(as, "solo se soporta bits 64.");
+    }
+    else if (strcmp(word, "align") == 0)
+        align_section(as, cursor);
+    else if (strncmp(word, "res", 3) == 0 && is_data_directive(word))
+        reserve_space(as, word, cursor);
+    else if (is_data_directive(word))
+        define_data(as, word, cursor);
+    else
+    {
+        char *fields[MAX_OPERANDS];
+        Operand ops[MAX_OPERANDS];
+        int count = split_operands(cursor, fields, MAX_OPERANDS);
+        if (count < 0)
+        {
+            asm_error(as, "demasiados operandos.");
+            return;
+        }
+        for (int k = 0; k < count; k++)
+        {
+            if (!parse_operand(as, fields[k], &ops[k]))
+            {
+                asm_error(as, "operando no soportado: %s", fields[k]);
+                return;
+            }
+        }
+        for (char *p = word; *p; p++)
+            *p = (char)tolower((unsigned char)*p);
+        encode_instruction(as, word, count, ops);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Distribución de .text y resolución de referencias
+ * ------------------------------------------------------------------------- */
+
+static int is_text_symbol(const Assembler *as, int symbol)
+{
+    return as->symbols[symbol].section == SEC_TEXT;
+}
+
+static size_t symbol_offset(const Assembler *as, int symbol)
+{
+    const AsmSymbol *sym = &as->symbols[symbol];
+    return sym->section == SEC_TEXT ? as->items[sym->item].offset : sym->offset;
+}
+
+static size_t item_size(const TextItem *it, size_t offset)
+{
+    switch (it->kind)
+    {
+    case ITEM_CODE:
+        return (size_t)it->length;
+    case ITEM_JUMP:
+        return it->is_long ? (it->cond == -1 ? 5 : 6) : 2;
+    case ITEM_ALIGN:
+        return (it->align - offset % (size_t)it->align) % (size_t)it->align;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Fija la posición de cada elemento. Los saltos empiezan en su forma corta y
+ * solo crecen, así que basta repetir hasta que ninguno cambie.
+ */
+static void layout_text(Assembler *as)
+{
+    for (int k = 0; k < as->num_items; k++)
+    {
+        TextItem *it = &as->items[k];
+        if (it->kind == ITEM_JUMP && !is_text_symbol(as, it->symbol))
+            it->is_long = 1;
+    }
+
+    size_t offset;
+    int changed;
+    do
+    {
+        offset = 0;
+        for (int k = 0; k < as->num_items; k++)
+        {
+            as->items[k].offset = offset;
+            offset += item_size(&as->items[k], offset);
+        }
+
+        changed = 0;
+        for (int k = 0; k < as->num_items; k++)
+        {
+            TextItem *it = &as->items[k];
+            if (it->kind != ITEM_JUMP || it->is_long)
+                continue;
+            long long distance = (long long)symbol_offset(as, it->symbol) - (long long)(it->offset + 2);
+            if (!fits_int8(distance))
+            {
+                it->is_long = 1;
+                changed = 1;
+            }
+        }
+    } while (changed);
+}
+
+static void add_relocation(Assembler *as, uint64_t offset, uint32_t type, int symbol, int64_t addend)
+{
+    as->relocs = elfobj_grow(as->relocs, &as->relocs_capacity, as->num_relocs + 1, sizeof(Relocation));
+    Relocation *r = &as->relocs[as->num_relocs++];
+    r->offset = offset;
+    r->type = type;
+    // Las referencias a .data y .bss van contra el símbolo de su sección
+    const AsmSymbol *sym = &as->symbols[symbol];
+    r->symbol = sym->section == SEC_DATA || sym->section == SEC_BSS ? (uint32_t)(1 + sym->section)
+                                                                      : (uint32_t)sym->elf_index;
+    r->addend = addend + (sym->section == SEC_DATA || sym->section == SEC_BSS ? (int64_t)sym->offset : 0);
+}
+
+static void patch32(unsigned char *p, long long value)
+{
+    for (int k = 0; k < 4; k++)
+        p[k] = (unsigned char)((unsigned long long)value >> (8 * k));
+}
+
+/* Copia cada elemento a .text, resuelve lo que es local y anota lo demás como reubicación. */
+static void emit_text(Assembler *as)
+{
+    for (int k = 0; k < as->num_items && !as->failed; k++)
+    {
+        TextItem *it = &as->items[k];
+        as->line = it->line;
+        size_t start = as->text.size;
+
+        if (it->kind == ITEM_ALIGN)
+        {
+            size_t pad = item_size(it, it->offset);
+            for (size_t b = 0; b < pad; b++)
+                buffer_put(&as->text, 0x90, 1);
+            continue;
+        }
+        if (it->kind == ITEM_JUMP)
+        {
+            // El destino puede ser externo (jmp printf): siempre largo y por la PLT
+            long long target = is_text_symbol(as, it->symbol) ? (long long)symbol_offset(as, it->symbol) : 0;
+            long long end = (long long)(it->offset + item_size(it, it->offset));
+            if (!it->is_long)
+            {
+                buffer_put(&as->text, it->cond == -1 ? 0xEB : 0x70 + it->cond, 1);
+                buffer_put(&as->text, (uint64_t)(target - end), 1);
+                continue;
+            }
+            if (it->cond == -1)
+                buffer_put(&as->text, 0xE9, 1);
+            else
+            {
+                buffer_put(&as->text, 0x0F, 1);
+                buffer_put(&as->text, 0x80 + it->cond, 1);
+            }
+            if (is_text_symbol(as, it->symbol))
+                buffer_put(&as->text, (uint64_t)(target - end), 4);
+            else
+            {
+                add_relocation(as, as->text.size, ELF_R_X86_64_PLT32, it->symbol, -4);
+                buffer_put(&as->text, 0, 4);
+            }
+            continue;
+        }
+        if (it->kind != ITEM_CODE)
+            continue;
+
+        buffer_write(&as->text, it->bytes, (size_t)it->length);
+        if (it->fixup == FIX_NONE)
+            continue;
+
+        unsigned char *field = as->text.data + start + it->fix_pos;
+        uint64_t field_offset = start + (size_t)it->fix_pos;
+        long long end = (long long)(start + (size_t)it->length);
+        int tail = it->length - it->fix_pos; // bytes del campo más el inmediato que lo sigue
+        const AsmSymbol *sym = &as->symbols[it->symbol];
+
+        switch (it->fixup)
+        {
+        case FIX_REL32:
+            if (sym->section == SEC_TEXT)
+                patch32(field, (long long)symbol_offset(as, it->symbol) + it->addend - end);
+            else
+                add_relocation(as, field_offset, ELF_R_X86_64_PC32, it->symbol, it->addend - tail);
+            break;
+        case FIX_BRANCH32:
+            if (sym->section == SEC_TEXT)
+                patch32(field, (long long)symbol_offset(as, it->symbol) - end);
+            else if (sym->is_extern)
+                add_relocation(as, field_offset, ELF_R_X86_64_PLT32, it->symbol, -tail);
+            else
+                asm_error(as, "llamada a un símbolo que no está en .text.");
+            break;
+        case FIX_DIFF32:
+            if (sym->section != SEC_TEXT || as->symbols[it->symbol2].section != SEC_TEXT)
+                asm_error(as, "dd solo admite diferencias entre etiquetas de .text.");
+            else
+                patch32(field, (long long)symbol_offset(as, it->symbol) - (long long)symbol_offset(as, it->symbol2));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Objeto ELF64
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Numera los símbolos como los necesita .symtab: el nulo, los de sección, las
+ * etiquetas locales y al final los globales y externos. Devuelve el índice del
+ * primer global (sh_info de .symtab).
+ */
+static int number_symbols(Assembler *as)
+{
+    int next = 1 + NUM_SECTIONS;
+    int count = as->names->count;
+    for (int s = 0; s < count; s++)
+    {
+        AsmSymbol *sym = &as->symbols[s];
+        if (sym->section != SEC_UNDEFINED && !sym->is_global)
+            sym->elf_index = next++;
+    }
+    int first_global = next;
+    for (int s = 0; s < count; s++)
+    {
+        AsmSymbol *sym = &as->symbols[s];
+        if (sym->is_global || sym->is_extern)
+            sym->elf_index = next++;
+    }
+    return first_global;
+}
+
+static int check_symbols(Assembler *as)
+{
+    int count = as->names->count;
+    for (int s = 0; s < count; s++)
+    {
+        const AsmSymbol *sym = &as->symbols[s];
+        if (sym->section == SEC_UNDEFINED && !sym->is_extern)
+        {
+            asm_error(as, "símbolo no definido: %s", as->names->names[s]);
+            return 0;
+        }
+        if (sym->section != SEC_UNDEFINED && sym->is_extern)
+        {
+            asm_error(as, "el símbolo externo '%s' también está definido.", as->names->names[s]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void put_symbol(ByteBuffer *out, uint32_t name, int bind, int type, uint16_t section, uint64_t value)
+{
+    buffer_put(out, name, 4);
+    buffer_put(out, (uint64_t)((bind << 4) | type), 1);
+    buffer_put(out, 0, 1); // st_other: visibilidad por omisión
+    buffer_put(out, section, 2);
+    buffer_put(out, value, 8);
+    buffer_put(out, 0, 8); // st_size
+}
+
+static void put_section_header(ByteBuffer *out, uint32_t name, uint32_t type, uint64_t flags, uint64_t offset,
+                               uint64_t size, uint32_t link, uint32_t info, uint64_t align, uint64_t entsize)
+{
+    buffer_put(out, name, 4);
+    buffer_put(out, type, 4);
+    buffer_put(out, flags, 8);
+    buffer_put(out, 0, 8); // sh_addr
+    buffer_put(out, offset, 8);
+    buffer_put(out, size, 8);
+    buffer_put(out, link, 4);
+    buffer_put(out, info, 4);
+    buffer_put(out, align, 8);
+    buffer_put(out, entsize, 8);
+}
+
+static uint32_t add_string(ByteBuffer *table, const char *s)
+{
+    uint32_t offset = (uint32_t)table->size;
+    buffer_write(table, s, strlen(s) + 1);
+    return offset;
+}
+
+/*
+ * Secciones del objeto: 1 .text, 2 .data, 3 .bss, 4 .note.GNU-stack,
+ * 5 .rela.text, 6 .symtab, 7 .strtab y 8 .shstrtab.
+ */
+static void build_object(Assembler *as, int first_global, ByteBuffer *out)
+{
+    enum
+    {
+        SH_NULL,
+        SH_TEXT,
+        SH_DATA,
+        SH_BSS,
+        SH_NOTE,
+        SH_RELA,
+        SH_SYMTAB,
+        SH_STRTAB,
+        SH_SHSTRTAB,
+        SH_COUNT
+    };
+    static const char *const section_names[SH_COUNT] = {
+        "", ".text", ".data", ".bss", ".note.GNU-stack", ".rela.text", ".symtab", ".strtab", ".shstrtab"};
+
+    ByteBuffer shstrtab = {0};
+    uint32_t section_name[SH_COUNT];
+    for (int k = 0; k < SH_COUNT; k++)
+        section_name[k] = add_string(&shstrtab, section_names[k]);
+
+    // .symtab en el orden de number_symbols()
+    ByteBuffer strtab = {0};
+    ByteBuffer symtab = {0};
+    add_string(&strtab, "");
+    put_symbol(&symtab, 0, 0, 0, 0, 0);
+    for (int k = 0; k < NUM_SECTIONS; k++)
+        put_symbol(&symtab, 0, ELF_STB_LOCAL, ELF_STT_SECTION, (uint16_t)(SH_TEXT + k), 0);
+    int count = as->names->count;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int s = 0; s < count; s++)
+        {
+            const AsmSymbol *sym = &as->symbols[s];
+            int global = sym->is_global || sym->is_extern;
+            if (global != pass)
+                continue;
+            uint16_t shndx = sym->is_extern ? 0 : (uint16_t)(SH_TEXT + sym->section);
+            put_symbol(&symtab, add_string(&strtab, as->names->names[s]), global ? ELF_STB_GLOBAL : ELF_STB_LOCAL,
+                       ELF_STT_NOTYPE, shndx, sym->is_extern ? 0 : symbol_offset(as, s));
+        }
+    }
+
+    ByteBuffer rela = {0};
+    for (int k = 0; k < as->num_relocs; k++)
+    {
+        const Relocation *r = &as->relocs[k];
+        buffer_put(&rela, r->offset, 8);
+        buffer_put(&rela, ((uint64_t)r->symbol << 32) | r->type, 8);
+        buffer_put(&rela, (uint64_t)r->addend, 8);
+    }
+
+    // Cabecera ELF; el contenido de las secciones va después, alineado
+    const size_t header_size = 64;
+    size_t offsets[SH_COUNT] = {0};
+    size_t sizes[SH_COUNT] = {0};
+    const ByteBuffer *contents[SH_COUNT] = {NULL, &as->text, &as->data, NULL, NULL, &rela, &symtab, &strtab, &shstrtab};
+    static const size_t aligns[SH_COUNT] = {0, 16, 4, 4, 1, 8, 8, 1, 1};
+
+    ByteBuffer body = {0};
+    buffer_write(&body, NULL, header_size);
+    for (int k = 1; k < SH_COUNT; k++)
+    {
+        if (contents[k] == NULL)
+        {
+            offsets[k] = body.size;
+            continue;
+        }
+        buffer_align(&body, aligns[k]);
+        offsets[k] = body.size;
+        sizes[k] = contents[k]->size;
+        buffer_write(&body, contents[k]->data, contents[k]->size);
+    }
+    sizes[SH_BSS] = as->bss_size;
+    buffer_align(&body, 8);
+    size_t section_headers = body.size;
+
+    put_section_header(&body, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    put_section_header(&body, section_name[SH_TEXT], ELF_SHT_PROGBITS, ELF_SHF_ALLOC | ELF_SHF_EXECINSTR,
+                       offsets[SH_TEXT], sizes[SH_TEXT], 0, 0, aligns[SH_TEXT], 0);
+    put_section_header(&body, section_name[SH_DATA], ELF_SHT_PROGBITS, ELF_SHF_WRITE | ELF_SHF_ALLOC,
+                       offsets[SH_DATA], sizes[SH_DATA], 0, 0, aligns[SH_DATA], 0);
+    put_section_header(&body, section_name[SH_BSS], ELF_SHT_NOBITS, ELF_SHF_WRITE | ELF_SHF_ALLOC, offsets[SH_BSS],
+                       sizes[SH_BSS], 0, 0, aligns[SH_BSS], 0);
+    put_section_header(&body, section_name[SH_NOTE], ELF_SHT_PROGBITS, 0, offsets[SH_NOTE], 0, 0, 0, aligns[SH_NOTE],
+                       0);
+    put_section_header(&body, section_name[SH_RELA], ELF_SHT_RELA, ELF_SHF_INFO_LINK, offsets[SH_RELA], sizes[SH_RELA],
+                       SH_SYMTAB, SH_TEXT, aligns[SH_RELA], 24);
+    put_section_header(&body, section_name[SH_SYMTAB], ELF_SHT_SYMTAB, 0, offsets[SH_SYMTAB], sizes[SH_SYMTAB],
+                       SH_STRTAB, (uint32_t)first_global, aligns[SH_SYMTAB], 24);
+    put_section_header(&body, section_name[SH_STRTAB], ELF_SHT_STRTAB, 0, offsets[SH_STRTAB], sizes[SH_STRTAB], 0, 0,
+                       aligns[SH_STRTAB], 0);
+    put_section_header(&body, section_name[SH_SHSTRTAB], ELF_SHT_STRTAB, 0, offsets[SH_SHSTRTAB],
+                       sizes[SH_SHSTRTAB], 0, 0, aligns[SH_SHSTRTAB], 0);
+
+    // e_ident: ELFCLASS64, little endian, versión 1, System V
+    static const unsigned char ident[16] = {0x7F, 'E', 'L', 'F', 2, 1, 1, 0};
+    ByteBuffer header = {0};
+    buffer_write(&header, ident, sizeof(ident));
+    buffer_put(&header, 1, 2);  // e_type: ET_REL
+    buffer_put(&header, 62, 2); // e_machine: EM_X86_64
+    buffer_put(&header, 1, 4);  // e_version
+    buffer_put(&header, 0, 8);  // e_entry
+    buffer_put(&header, 0, 8);  // e_phoff
+    buffer_put(&header, section_headers, 8);
+    buffer_put(&header, 0, 4);  // e_flags
+    buffer_put(&header, header_size, 2);
+    buffer_put(&header, 0, 2);  // e_phentsize
+    buffer_put(&header, 0, 2);  // e_phnum
+    buffer_put(&header, 64, 2); // e_shentsize
+    buffer_put(&header, SH_COUNT, 2);
+    buffer_put(&header, SH_SHSTRTAB, 2);
+    memcpy(body.data, header.data, header_size);
+
+    free(header.data);
+    free(shstrtab.data);
+    free(strtab.data);
+    free(symtab.data);
+    free(rela.data);
+    *out = body;
+}
+
+int write_elf_object(const char *asm_text, size_t length, const char *ruta)
+{
+    Assembler as;
+    memset(&as, 0, sizeof(as));
+    as.names = create_name_table(256);
+    as.section = SEC_UNDEFINED;
+    int first_global = 0;
+
+    // Una línea a la vez, en una copia que el análisis puede cortar
+    size_t line_capacity = 256;
+    char *line = xcalloc(line_capacity);
+    const char *p = asm_text;
+    const char *end = asm_text + length;
+    while (p < end && !as.failed)
+    {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        size_t line_length = newline != NULL ? (size_t)(newline - p) : (size_t)(end - p);
+        if (line_length + 1 > line_capacity)
+        {
+            free(line);
+            line_capacity = line_length + 1;
+            line = xcalloc(line_capacity);
+        }
+        memcpy(line, p, line_length);
+        line[line_length] = '\0';
+        as.line++;
+        assemble_line(&as, line);
+        p += line_length + 1;
+    }
+    free(line);
+
+    if (!as.failed && as.conditional_depth != 0)
+        asm_error(&as, "falta %%endif.");
+    if (!as.failed && check_symbols(&as))
+    {
+        layout_text(&as);
+        first_global = number_symbols(&as);
+        emit_text(&as);
+    }
+
+    if (!as.failed)
+    {
+        ByteBuffer object;
+        build_object(&as, first_global, &object);
+        FILE *f = fopen(ruta, "wb");
+        if (f == NULL || fwrite(object.data, 1, object.size, f) != object.size)
+        {
+            fprintf(stderr, "Error: No se pudo escribir el objeto '%s'.\n", ruta);
+            as.failed = 1;
+        }
+        if (f != NULL && fclose(f) != 0)
+            as.failed = 1;
+        free(object.data);
+    }
+
+    free(as.items);
+    free(as.symbols);
+    free(as.relocs);
+    free(as.text.data);
+    free(as.data.data);
+    destroy_name_table(as.names);
+    return !as.failed;
+}
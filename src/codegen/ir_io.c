@@ -0,0 +1,522 @@
+#include "ir_io.h"
+#include "codegen.h"
+#include "cfg.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Lectura y escritura del código intermedio.
+ *
+ * Ambos formatos guardan los cuádruplos tal como los dejó el front-end junto
+ * con el tipo de cada variable y temporal y el lugar en el marco de main de las
+ * variables de bloque, que es lo único que el optimizador y generate_asm()
+ * consultan fuera del IR. El HALT final no se guarda: lo agrega
+ * finalizar_codigo_intermedio() después de optimizar. Cada cuádruplo conserva
+ * la posición en el fuente de la que salió, para los reportes de -remarks.
+ */
+
+#define IR_FORMAT_VERSION 5
+#define IR_NO_STRING 0xFFFFFFFFu
+
+static const char *type_names[] = {
+    [INT] = "INT",
+    [STRING] = "STRING",
+    [CHAR] = "CHAR",
+    [FLOAT] = "FLOAT",
+    [BOOL] = "BOOL",
+    [TIPO_VOID] = "VOID",
+    [TIPO_ERROR] = "ERROR",
+    [OTRO] = "OTRO",
+};
+
+#define NUM_TYPE_NAMES ((int)(sizeof(type_names) / sizeof(type_names[0])))
+
+static void ir_io_error(const char *ruta, const char *mensaje)
+{
+    fprintf(stderr, "Error: %s: %s\n", ruta, mensaje);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Nombres (no literales) que aparecen en el IR, sin repetir y en orden de
+ * aparición. Son los únicos cuyo tipo hace falta guardar.
+ */
+static NameTable *collect_names(Quadruple *code, int size, int include_literals)
+{
+    NameTable *names = create_name_table(size);
+    for (int i = 0; i < size; i++)
+    {
+        const char *fields[3] = {code[i].arg1, code[i].arg2, code[i].result};
+        for (int k = 0; k < 3; k++)
+        {
+            if (fields[k] != NULL && (include_literals || is_valid_varname(fields[k])))
+                intern_name(names, fields[k]);
+        }
+    }
+    return names;
+}
+
+static int ir_body_size()
+{
+    int size = get_ir_code_size();
+    if (size > 0 && get_ir_code()[size - 1].op == IR_HALT)
+        size--;
+    return size;
+}
+
+/* Registra los nombres leídos para que las pasadas no generen temporales o
+ * etiquetas que choquen con ellos. */
+static void finish_loading()
+{
+    set_ir_source_position(0, 0);
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    for (int i = 0; i < size; i++)
+    {
+        reserve_ir_name(code[i].arg1);
+        reserve_ir_name(code[i].arg2);
+        reserve_ir_name(code[i].result);
+    }
+    if (size > 0 && code[size - 1].op == IR_HALT)
+    {
+        // Un IR escrito a mano puede traer su propio HALT
+        code[size - 1].op = IR_REMOVED;
+        compact_ir_code();
+    }
+}
+
+static int parse_op(const char *name)
+{
+    for (int op = IR_ADD; op <= IR_HALT; op++)
+    {
+        if (strcmp(ir_op_name((IROperation)op), name) == 0)
+            return op;
+    }
+    return -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Formato de texto
+ * ------------------------------------------------------------------------- */
+
+static void write_text_field(FILE *f, const char *s)
+{
+    fputc(' ', f);
+    if (s == NULL)
+    {
+        fputc('-', f);
+        return;
+    }
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++)
+    {
+        // Las cadenas pueden traer saltos de línea y otros caracteres de control
+        if (*p < 0x20 || *p == 0x7f || *p == '%')
+            fprintf(f, "%%%02X", *p);
+        else
+            fputc(*p, f);
+    }
+}
+
+void write_ir_text(FILE *f)
+{
+    Quadruple *code = get_ir_code();
+    int size = ir_body_size();
+
+    fprintf(f, "MXIR %d\n", IR_FORMAT_VERSION);
+    fprintf(f, "# .tipo <nombre> <tipo>; .marco <nombre> <desplazamiento>; OP arg1 arg2 resultado [@renglon:columna] ('-' = vacío)\n");
+
+    NameTable *names = collect_names(code, size, 0);
+    for (int id = 0; id < names->count; id++)
+    {
+        enum TipoDato tipo = get_ir_type(names->names[id]);
+        if (tipo != OTRO)
+            fprintf(f, ".tipo %s %s\n", names->names[id], type_names[tipo]);
+    }
+    for (int id = 0; id < names->count; id++)
+    {
+        int offset = get_ir_frame_slot(names->names[id]);
+        if (offset != 0)
+            fprintf(f, ".marco %s %d\n", names->names[id], offset);
+    }
+    destroy_name_table(names);
+
+    for (int i = 0; i < size; i++)
+    {
+        fputs(ir_op_name(code[i].op), f);
+        write_text_field(f, code[i].arg1);
+        write_text_field(f, code[i].arg2);
+        write_text_field(f, code[i].result);
+        if (code[i].renglon > 0)
+            fprintf(f, " @%d:%d", code[i].renglon, code[i].columna);
+        fputc('\n', f);
+    }
+}
+
+/* Lee una línea completa sin el '\n'. Devuelve NULL al final del archivo. */
+static char *read_line(FILE *f, char **buffer, size_t *capacity)
+{
+    size_t length = 0;
+    int c;
+    while ((c = fgetc(f)) != EOF && c != '\n')
+    {
+        if (length + 1 >= *capacity)
+        {
+            *capacity = *capacity == 0 ? 128 : *capacity * 2;
+            *buffer = realloc(*buffer, *capacity);
+            if (*buffer == NULL)
+            {
+                fprintf(stderr, "Error: No se pudo asignar memoria para leer el código intermedio.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        (*buffer)[length++] = (char)c;
+    }
+    if (c == EOF && length == 0)
+        return NULL;
+    if (*buffer == NULL)
+        *buffer = xcalloc(*capacity = 128);
+
+    if (length > 0 && (*buffer)[length - 1] == '\r')
+        length--;
+    (*buffer)[length] = '\0';
+    return *buffer;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/*
+ * Separa el siguiente campo de la línea y lo decodifica en el mismo lugar.
+ * Un literal de cadena llega hasta la comilla que lo cierra aunque tenga
+ * espacios. Devuelve 0 si no quedan campos y -1 si el campo está mal formado.
+ */
+static int next_field(char **cursor, char **field)
+{
+    char *p = *cursor;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    if (*p == '\0')
+        return 0;
+
+    char *start = p;
+    if (*p == '"')
+    {
+        p = strchr(p + 1, '"');
+        if (p == NULL)
+            return -1;
+        p++;
+    }
+    while (*p != '\0' && *p != ' ' && *p != '\t')
+        p++;
+    if (*p != '\0')
+        *p++ = '\0';
+    *cursor = p;
+
+    char *out = start;
+    for (char *in = start; *in; in++)
+    {
+        if (*in == '%')
+        {
+            int hi = hex_value(in[1]);
+            int lo = hi < 0 ? -1 : hex_value(in[2]);
+            if (lo < 0)
+                return -1;
+            *out++ = (char)(hi * 16 + lo);
+            in += 2;
+        }
+        else
+        {
+            *out++ = *in;
+        }
+    }
+    *out = '\0';
+    *field = start;
+    return 1;
+}
+
+static int parse_type(const char *name)
+{
+    for (int t = 0; t < NUM_TYPE_NAMES; t++)
+    {
+        if (type_names[t] != NULL && strcmp(type_names[t], name) == 0)
+            return t;
+    }
+    return -1;
+}
+
+void read_ir_text(FILE *f, const char *ruta)
+{
+    char *buffer = NULL;
+    size_t capacity = 0;
+    char mensaje[256];
+    int version;
+
+    char *line = read_line(f, &buffer, &capacity);
+    if (line == NULL || sscanf(line, "MXIR %d", &version) != 1)
+        ir_io_error(ruta, "no es un archivo de código intermedio (falta la cabecera MXIR).");
+    if (version != IR_FORMAT_VERSION)
+        ir_io_error(ruta, "versión de código intermedio no soportada.");
+
+    init_ir_generator();
+
+    int line_number = 1;
+    while ((line = read_line(f, &buffer, &capacity)) != NULL)
+    {
+        line_number++;
+        char *cursor = line;
+        char *fields[5];
+        int count = 0;
+        int status;
+        while (count < 5 && (status = next_field(&cursor, &fields[count])) == 1)
+            count++;
+
+        if (count == 0 && status == 0)
+            continue;
+        if (count > 0 && fields[0][0] == '#')
+            continue;
+
+        char *extra;
+        if (status < 0 || (count == 5 && next_field(&cursor, &extra) != 0))
+        {
+            snprintf(mensaje, sizeof(mensaje), "línea %d mal formada.", line_number);
+            ir_io_error(ruta, mensaje);
+        }
+
+        if (strcmp(fields[0], ".tipo") == 0)
+        {
+            int tipo = count == 3 ? parse_type(fields[2]) : -1;
+            if (tipo < 0 || !is_valid_varname(fields[1]))
+            {
+                snprintf(mensaje, sizeof(mensaje), "línea %d: declaración de tipo inválida.", line_number);
+                ir_io_error(ruta, mensaje);
+            }
+            set_ir_type(fields[1], (enum TipoDato)tipo);
+            continue;
+        }
+        if (strcmp(fields[0], ".marco") == 0)
+        {
+            int offset = 0;
+            char end;
+            if (count != 3 || !is_valid_varname(fields[1]) || sscanf(fields[2], "%d%c", &offset, &end) != 1 ||
+                offset <= 0 || offset % 8 != 0)
+            {
+                snprintf(mensaje, sizeof(mensaje), "línea %d: lugar en el marco inválido.", line_number);
+                ir_io_error(ruta, mensaje);
+            }
+            set_ir_frame_slot(fields[1], offset);
+            continue;
+        }
+
+        // Posición opcional en el fuente: @renglon:columna
+        int renglon = 0, columna = 0;
+        char end;
+        if (count == 5 && sscanf(fields[4], "@%d:%d%c", &renglon, &columna, &end) != 2)
+            count = -1;
+
+        int op = parse_op(fields[0]);
+        if (op < 0 || (count != 4 && count != 5))
+        {
+            snprintf(mensaje, sizeof(mensaje), "línea %d: cuádruplo inválido.", line_number);
+            ir_io_error(ruta, mensaje);
+        }
+        for (int k = 1; k < 4; k++)
+        {
+            if (strcmp(fields[k], "-") == 0)
+                fields[k] = NULL;
+        }
+        set_ir_source_position(renglon, columna);
+        emit_quad((IROperation)op, fields[1], fields[2], fields[3]);
+    }
+
+    free(buffer);
+    finish_loading();
+}
+
+/* ---------------------------------------------------------------------------
+ * Formato binario
+ *
+ *   "MXIR" versión(u8)
+ *   n_cadenas(u32) { longitud(u32) bytes }*
+ *   n_tipos(u32)   { cadena(u32) tipo(u8) }*
+ *   n_marco(u32)   { cadena(u32) desplazamiento(u32) }*
+ *   n_cuádruplos(u32) { op(u8) arg1(u32) arg2(u32) resultado(u32) renglon(u32) columna(u32) }*
+ *
+ * Los enteros van en little-endian sin importar la máquina; un campo vacío
+ * se guarda como 0xFFFFFFFF.
+ * ------------------------------------------------------------------------- */
+
+static void write_u32(FILE *f, uint32_t v)
+{
+    unsigned char bytes[4] = {v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, (v >> 24) & 0xff};
+    fwrite(bytes, 1, 4, f);
+}
+
+static uint32_t string_index(const NameTable *strings, const char *s)
+{
+    return s == NULL ? IR_NO_STRING : (uint32_t)lookup_name(strings, s);
+}
+
+void write_ir_binary(FILE *f)
+{
+    Quadruple *code = get_ir_code();
+    int size = ir_body_size();
+
+    fwrite("MXIR", 1, 4, f);
+    fputc(IR_FORMAT_VERSION, f);
+
+    NameTable *strings = collect_names(code, size, 1);
+    write_u32(f, (uint32_t)strings->count);
+    int num_types = 0;
+    for (int id = 0; id < strings->count; id++)
+    {
+        uint32_t length = (uint32_t)strlen(strings->names[id]);
+        write_u32(f, length);
+        fwrite(strings->names[id], 1, length, f);
+        if (is_valid_varname(strings->names[id]) && get_ir_type(strings->names[id]) != OTRO)
+            num_types++;
+    }
+
+    write_u32(f, (uint32_t)num_types);
+    for (int id = 0; id < strings->count; id++)
+    {
+        if (!is_valid_varname(strings->names[id]))
+            continue;
+        enum TipoDato tipo = get_ir_type(strings->names[id]);
+        if (tipo == OTRO)
+            continue;
+        write_u32(f, (uint32_t)id);
+        fputc((int)tipo, f);
+    }
+
+    int num_slots = 0;
+    for (int id = 0; id < strings->count; id++)
+        num_slots += get_ir_frame_slot(strings->names[id]) != 0;
+    write_u32(f, (uint32_t)num_slots);
+    for (int id = 0; id < strings->count; id++)
+    {
+        int offset = get_ir_frame_slot(strings->names[id]);
+        if (offset == 0)
+            continue;
+        write_u32(f, (uint32_t)id);
+        write_u32(f, (uint32_t)offset);
+    }
+
+    write_u32(f, (uint32_t)size);
+    for (int i = 0; i < size; i++)
+    {
+        fputc((int)code[i].op, f);
+        write_u32(f, string_index(strings, code[i].arg1));
+        write_u32(f, string_index(strings, code[i].arg2));
+        write_u32(f, string_index(strings, code[i].result));
+        write_u32(f, (uint32_t)code[i].renglon);
+        write_u32(f, (uint32_t)code[i].columna);
+    }
+
+    destroy_name_table(strings);
+}
+
+static int read_u8(FILE *f, const char *ruta)
+{
+    int c = fgetc(f);
+    if (c == EOF)
+        ir_io_error(ruta, "el código intermedio binario está truncado.");
+    return c;
+}
+
+static uint32_t read_u32(FILE *f, const char *ruta)
+{
+    unsigned char bytes[4];
+    if (fread(bytes, 1, 4, f) != 4)
+        ir_io_error(ruta, "el código intermedio binario está truncado.");
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static const char *string_at(char **strings, uint32_t count, uint32_t index, const char *ruta)
+{
+    if (index == IR_NO_STRING)
+        return NULL;
+    if (index >= count)
+        ir_io_error(ruta, "índice de cadena fuera de rango.");
+    return strings[index];
+}
+
+void read_ir_binary(FILE *f, const char *ruta)
+{
+    char magic[4];
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "MXIR", 4) != 0)
+        ir_io_error(ruta, "no es un archivo de código intermedio binario.");
+    if (read_u8(f, ruta) != IR_FORMAT_VERSION)
+        ir_io_error(ruta, "versión de código intermedio no soportada.");
+
+    uint32_t num_strings = read_u32(f, ruta);
+    // Cada cadena ocupa al menos sus 4 bytes de longitud; evita reservar a ciegas
+    if (num_strings > (uint32_t)INT32_MAX / sizeof(char *))
+        ir_io_error(ruta, "tabla de cadenas demasiado grande.");
+    char **strings = xcalloc((num_strings + 1) * sizeof(char *));
+    for (uint32_t i = 0; i < num_strings; i++)
+    {
+        uint32_t length = read_u32(f, ruta);
+        if (length > (uint32_t)INT32_MAX)
+            ir_io_error(ruta, "cadena demasiado larga.");
+        strings[i] = xcalloc(length + 1);
+        if (fread(strings[i], 1, length, f) != length)
+            ir_io_error(ruta, "el código intermedio binario está truncado.");
+        strings[i][length] = '\0';
+        if (strlen(strings[i]) != length)
+            ir_io_error(ruta, "cadena con un byte nulo.");
+    }
+
+    init_ir_generator();
+
+    uint32_t num_types = read_u32(f, ruta);
+    for (uint32_t i = 0; i < num_types; i++)
+    {
+        const char *name = string_at(strings, num_strings, read_u32(f, ruta), ruta);
+        int tipo = read_u8(f, ruta);
+        if (name == NULL || tipo >= NUM_TYPE_NAMES || type_names[tipo] == NULL)
+            ir_io_error(ruta, "declaración de tipo inválida.");
+        set_ir_type(name, (enum TipoDato)tipo);
+    }
+
+    uint32_t num_slots = read_u32(f, ruta);
+    for (uint32_t i = 0; i < num_slots; i++)
+    {
+        const char *name = string_at(strings, num_strings, read_u32(f, ruta), ruta);
+        uint32_t offset = read_u32(f, ruta);
+        if (name == NULL || !is_valid_varname(name) || offset == 0 || offset > INT32_MAX || offset % 8 != 0)
+            ir_io_error(ruta, "lugar en el marco inválido.");
+        set_ir_frame_slot(name, (int)offset);
+    }
+
+    uint32_t num_quads = read_u32(f, ruta);
+    for (uint32_t i = 0; i < num_quads; i++)
+    {
+        int op = read_u8(f, ruta);
+        if (op > IR_HALT)
+            ir_io_error(ruta, "operación desconocida.");
+        const char *arg1 = string_at(strings, num_strings, read_u32(f, ruta), ruta);
+        const char *arg2 = string_at(strings, num_strings, read_u32(f, ruta), ruta);
+        const char *result = string_at(strings, num_strings, read_u32(f, ruta), ruta);
+        uint32_t renglon = read_u32(f, ruta);
+        uint32_t columna = read_u32(f, ruta);
+        if (renglon > INT32_MAX || columna > INT32_MAX)
+            ir_io_error(ruta, "posición en el fuente fuera de rango.");
+        set_ir_source_position((int)renglon, (int)columna);
+        emit_quad((IROperation)op, arg1, arg2, result);
+    }
+
+    for (uint32_t i = 0; i < num_strings; i++)
+        free(strings[i]);
+    free(strings);
+    finish_loading();
+}
@@ -0,0 +1,348 @@
+#include "regalloc.h"
+#include "bitset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Asignación de registros por barrido lineal.
+ *
+ * El intervalo de una variable va de su primera a su última aparición y
+ * además cubre completos los bloques en cuya entrada o salida está viva, así
+ * que contiene todos los puntos desde los que su valor se puede leer después.
+ * Los intervalos se recorren por su inicio; al llegar a uno se liberan los
+ * registros de los que ya terminaron y, si no queda ninguno libre, se manda a
+ * memoria el intervalo (el nuevo o uno activo) que termina más tarde. Una
+ * variable en memoria lo está durante todo su intervalo, así que el código
+ * nunca tiene que moverla entre registro y memoria a mitad de camino.
+ *
+ * Los intervalos que cruzan una llamada a printf o scanf prefieren r12-r15,
+ * que la llamada respeta; los demás prefieren r8-r11 para no gastar los
+ * primeros. Una variable en r8-r11 viva a través de una llamada se guarda en
+ * su lugar en memoria antes y se recarga después. rax, rbx y rdx quedan libres
+ * para generate_asm, y rcx, rdx, rsi y rdi para los argumentos de las llamadas.
+ */
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    int *global_index; // ver find_global_names
+    BitSet **live_in;
+    int *start;        // primer cuádruplo del intervalo de cada variable, -1 si no aparece
+    int *end;          // último, inclusivo
+} LiveRanges;
+
+typedef struct
+{
+    int var;          // id en cfg->vars
+    int start;
+    int end;          // inclusivo
+    int crosses_call; // hay una llamada estrictamente dentro del intervalo
+} LiveInterval;
+
+static const struct
+{
+    const char *name;
+    int callee_saved;
+} pool[] = {
+    {"r12", 1}, {"r13", 1}, {"r14", 1}, {"r15", 1}, {"r8", 0}, {"r9", 0}, {"r10", 0}, {"r11", 0},
+};
+
+#define NUM_REGISTERS ((int)(sizeof(pool) / sizeof(pool[0])))
+
+static int is_call(IROperation op)
+{
+    return op == IR_PRINT || op == IR_READ;
+}
+
+static void extend_interval(int *start, int *end, int v, int from, int to)
+{
+    if (start[v] == -1 || from < start[v])
+        start[v] = from;
+    if (end[v] == -1 || to > end[v])
+        end[v] = to;
+}
+
+static LiveRanges compute_live_ranges(Quadruple *code, int size)
+{
+    LiveRanges lr;
+    lr.cfg = build_cfg(code, size);
+    ControlFlowGraph *cfg = lr.cfg;
+    int num_vars = cfg->vars->count;
+    lr.global_index = xcalloc((num_vars + 1) * sizeof(int));
+    int num_globals = find_global_names(cfg, lr.global_index);
+    lr.live_in = compute_live_in(cfg, lr.global_index, num_globals);
+    int *global_var = xcalloc((num_globals + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+    {
+        if (lr.global_index[v] != -1)
+            global_var[lr.global_index[v]] = v;
+    }
+
+    lr.start = xcalloc((num_vars + 1) * sizeof(int));
+    lr.end = xcalloc((num_vars + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+        lr.start[v] = lr.end[v] = -1;
+    for (int i = 0; i < size; i++)
+    {
+        int ids[3] = {cfg->def[i], cfg->use1[i], cfg->use2[i]};
+        for (int k = 0; k < 3; k++)
+        {
+            if (ids[k] != -1)
+                extend_interval(lr.start, lr.end, ids[k], i, i);
+        }
+    }
+
+    // Una variable viva en la frontera de un bloque ocupa el bloque completo
+    BitSet *live = bitset_crear(num_globals);
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        bitset_copiar(live, lr.live_in[b]);
+        for (int s = 0; s < cfg->blocks[b].num_succ; s++)
+            bitset_unir(live, lr.live_in[cfg->blocks[b].succ[s]]);
+        for (int g = bitset_siguiente(live, 0); g != -1; g = bitset_siguiente(live, g + 1))
+            extend_interval(lr.start, lr.end, global_var[g], cfg->blocks[b].start, cfg->blocks[b].end - 1);
+    }
+    bitset_destruir(live);
+    free(global_var);
+    return lr;
+}
+
+static void free_live_ranges(LiveRanges *lr)
+{
+    free(lr->start);
+    free(lr->end);
+    free_block_sets(lr->live_in, lr->cfg->num_blocks);
+    free(lr->global_index);
+    free_cfg(lr->cfg);
+}
+
+static int compare_intervals(const void *a, const void *b)
+{
+    const LiveInterval *x = a;
+    const LiveInterval *y = b;
+    if (x->start != y->start)
+        return x->start < y->start ? -1 : 1;
+    return x->var - y->var;
+}
+
+/* Registro libre para el intervalo: primero uno del tipo que prefiere, si no cualquiera. */
+static int free_register(const int *active, const LiveInterval *it)
+{
+    for (int r = 0; r < NUM_REGISTERS; r++)
+    {
+        if (active[r] == -1 && pool[r].callee_saved == it->crosses_call)
+            return r;
+    }
+    for (int r = 0; r < NUM_REGISTERS; r++)
+    {
+        if (active[r] == -1)
+            return r;
+    }
+    return -1;
+}
+
+RegisterAssignment *allocate_registers(Quadruple *code, int size, const NameTable *exclude)
+{
+    RegisterAssignment *ra = xcalloc(sizeof(RegisterAssignment));
+    ra->names = create_name_table(16);
+    ra->saved = xcalloc(NUM_REGISTERS * sizeof(const char *));
+    ra->call_spills = xcalloc((size + 1) * REGALLOC_CALLER_SAVED * sizeof(const char *));
+    if (size == 0)
+    {
+        ra->reg = xcalloc(sizeof(const char *));
+        ra->load_at_entry = xcalloc(1);
+        return ra;
+    }
+
+    LiveRanges lr = compute_live_ranges(code, size);
+    ControlFlowGraph *cfg = lr.cfg;
+    int num_vars = cfg->vars->count;
+    int *start = lr.start;
+    int *end = lr.end;
+
+    int *calls_before = xcalloc((size + 2) * sizeof(int));
+    for (int i = 0; i < size; i++)
+        calls_before[i + 1] = calls_before[i] + is_call(code[i].op);
+    calls_before[size + 1] = calls_before[size];
+
+    LiveInterval *intervals = xcalloc((num_vars + 1) * sizeof(LiveInterval));
+    int num_intervals = 0;
+    for (int v = 0; v < num_vars; v++)
+    {
+        const char *name = cfg->vars->names[v];
+        enum TipoDato tipo = get_ir_type(name);
+        if (start[v] == -1 || (tipo != INT && tipo != BOOL) || (exclude != NULL && lookup_name(exclude, name) != -1))
+            continue;
+        LiveInterval *it = &intervals[num_intervals++];
+        it->var = v;
+        it->start = start[v];
+        it->end = end[v];
+        it->crosses_call = calls_before[end[v]] - calls_before[start[v] + 1] > 0;
+    }
+    qsort(intervals, num_intervals, sizeof(LiveInterval), compare_intervals);
+
+    int active[NUM_REGISTERS];
+    for (int r = 0; r < NUM_REGISTERS; r++)
+        active[r] = -1;
+    int *assigned = xcalloc((num_intervals + 1) * sizeof(int));
+    for (int k = 0; k < num_intervals; k++)
+    {
+        LiveInterval *it = &intervals[k];
+        for (int r = 0; r < NUM_REGISTERS; r++)
+        {
+            if (active[r] != -1 && intervals[active[r]].end < it->start)
+                active[r] = -1;
+        }
+
+        int r = free_register(active, it);
+        if (r == -1)
+        {
+            // Sin registros libres: a memoria el intervalo que termina más tarde
+            int victim = 0;
+            for (int s = 1; s < NUM_REGISTERS; s++)
+            {
+                if (intervals[active[s]].end > intervals[active[victim]].end)
+                    victim = s;
+            }
+            if (intervals[active[victim]].end > it->end)
+            {
+                assigned[active[victim]] = -1;
+                r = victim;
+            }
+        }
+        assigned[k] = r;
+        if (r != -1)
+            active[r] = k;
+    }
+
+    ra->reg = xcalloc((num_intervals + 1) * sizeof(const char *));
+    ra->load_at_entry = xcalloc(num_intervals + 1);
+    int used[NUM_REGISTERS] = {0};
+    for (int k = 0; k < num_intervals; k++)
+    {
+        int r = assigned[k];
+        if (r == -1)
+            continue;
+        LiveInterval *it = &intervals[k];
+        int g = lr.global_index[it->var];
+        int id = intern_name(ra->names, cfg->vars->names[it->var]);
+        ra->reg[id] = pool[r].name;
+        ra->load_at_entry[id] = g != -1 && bitset_contiene(lr.live_in[0], g);
+        used[r] = 1;
+
+        if (pool[r].callee_saved)
+            continue;
+        int slot = 0;
+        for (int s = 0; s < r; s++)
+            slot += !pool[s].callee_saved;
+        for (int i = it->start + 1; i < it->end; i++)
+        {
+            if (is_call(code[i].op))
+                ra->call_spills[i * REGALLOC_CALLER_SAVED + slot] = ra->names->names[id];
+        }
+    }
+    for (int r = 0; r < NUM_REGISTERS; r++)
+    {
+        if (used[r] && pool[r].callee_saved)
+            ra->saved[ra->num_saved++] = pool[r].name;
+    }
+
+    free(assigned);
+    free(intervals);
+    free(calls_before);
+    free_live_ranges(&lr);
+    return ra;
+}
+
+/*
+ * Ocupante de un lugar del marco: las variables que comparten desplazamiento
+ * se colocan en orden de inicio, así que basta recordar dónde termina la última.
+ */
+typedef struct
+{
+    int offset;
+    int end;
+} FrameSlot;
+
+int settle_frame_slots(Quadruple *code, int size)
+{
+    if (size == 0)
+        return 0;
+
+    LiveRanges lr = compute_live_ranges(code, size);
+    int num_vars = lr.cfg->vars->count;
+    LiveInterval *intervals = xcalloc((num_vars + 1) * sizeof(LiveInterval));
+    int num_intervals = 0;
+    int frame_size = 0;
+    for (int v = 0; v < num_vars; v++)
+    {
+        int offset = get_ir_frame_slot(lr.cfg->vars->names[v]);
+        if (offset == 0 || lr.start[v] == -1)
+            continue;
+        LiveInterval *it = &intervals[num_intervals++];
+        it->var = v;
+        it->start = lr.start[v];
+        it->end = lr.end[v];
+        if (offset > frame_size)
+            frame_size = offset;
+    }
+    qsort(intervals, num_intervals, sizeof(LiveInterval), compare_intervals);
+
+    // Un lugar por cada 8 bytes del marco, más los que haya que agregar
+    FrameSlot *slots = xcalloc((frame_size / 8 + num_intervals + 1) * sizeof(FrameSlot));
+    int num_slots = frame_size / 8;
+    for (int k = 0; k < num_slots; k++)
+    {
+        slots[k].offset = 8 * (k + 1);
+        slots[k].end = -1;
+    }
+
+    for (int k = 0; k < num_intervals; k++)
+    {
+        LiveInterval *it = &intervals[k];
+        const char *name = lr.cfg->vars->names[it->var];
+        int slot = get_ir_frame_slot(name) / 8 - 1;
+        if (slots[slot].end >= it->start)
+        {
+            // El optimizador alargó la vida de una variable más allá de su
+            // ámbito y choca con la de un ámbito hermano: busca otro lugar
+            slot = 0;
+            while (slot < num_slots && slots[slot].end >= it->start)
+                slot++;
+            if (slot == num_slots)
+            {
+                slots[num_slots].offset = 8 * (num_slots + 1);
+                slots[num_slots].end = -1;
+                num_slots++;
+            }
+            set_ir_frame_slot(name, slots[slot].offset);
+        }
+        slots[slot].end = it->end;
+    }
+
+    free(slots);
+    free(intervals);
+    free_live_ranges(&lr);
+    return 8 * num_slots;
+}
+
+void free_register_assignment(RegisterAssignment *ra)
+{
+    if (ra == NULL)
+        return;
+    destroy_name_table(ra->names);
+    free(ra->reg);
+    free(ra->load_at_entry);
+    free(ra->saved);
+    free(ra->call_spills);
+    free(ra);
+}
+
+const char *assigned_register(const RegisterAssignment *ra, const char *name)
+{
+    if (ra == NULL || name == NULL)
+        return NULL;
+    int id = lookup_name(ra->names, name);
+    return id == -1 ? NULL : ra->reg[id];
+}
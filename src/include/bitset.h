@@ -0,0 +1,56 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+typedef unsigned long long bitword;
+
+#define BITS_POR_PALABRA (8 * (int)sizeof(bitword))
+
+typedef struct
+{
+    int num_bits;
+    int num_palabras;
+    bitword *palabras;
+} BitSet;
+
+/**
+ * @brief Crea un conjunto de bits vacío con capacidad para num_bits elementos.
+ */
+BitSet *bitset_crear(int num_bits);
+
+void bitset_destruir(BitSet *set);
+
+void bitset_agregar(BitSet *set, int i);
+void bitset_quitar(BitSet *set, int i);
+int bitset_contiene(const BitSet *set, int i);
+
+void bitset_vaciar(BitSet *set);
+void bitset_llenar(BitSet *set);
+void bitset_copiar(BitSet *destino, const BitSet *origen);
+int bitset_iguales(const BitSet *a, const BitSet *b);
+
+/**
+ * @brief destino |= origen.
+ * @return 1 si destino cambió, 0 en otro caso.
+ */
+int bitset_unir(BitSet *destino, const BitSet *origen);
+
+/**
+ * @brief destino &= origen.
+ * @return 1 si destino cambió, 0 en otro caso.
+ */
+int bitset_intersectar(BitSet *destino, const BitSet *origen);
+
+/**
+ * @brief destino &= ~origen.
+ */
+void bitset_restar(BitSet *destino, const BitSet *origen);
+
+/**
+ * @brief Devuelve el primer elemento del conjunto mayor o igual a desde, o -1.
+ *
+ * Permite recorrer un conjunto disperso sin revisar cada bit:
+ * for (int i = bitset_siguiente(s, 0); i != -1; i = bitset_siguiente(s, i + 1))
+ */
+int bitset_siguiente(const BitSet *set, int desde);
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "codegen.h"
+#include "bitset.h"
+
+/**
+ * @brief Tabla de internado de nombres: asigna un id entero y denso a cada nombre.
+ *
+ * Las optimizaciones trabajan con ids en lugar de comparar cadenas con strcmp.
+ */
+typedef struct
+{
+    char **names;
+    int count;
+    int capacity;
+    int *buckets;
+    int *next;
+    int num_buckets;
+} NameTable;
+
+NameTable *create_name_table(int expected_size);
+void destroy_name_table(NameTable *table);
+
+/**
+ * @brief Devuelve el id de un nombre, agregándolo a la tabla si no existía.
+ */
+int intern_name(NameTable *table, const char *name);
+
+/**
+ * @brief Devuelve el id de un nombre o -1 si no está en la tabla.
+ */
+int lookup_name(const NameTable *table, const char *name);
+
+typedef struct
+{
+    int start;     // primer cuádruplo del bloque
+    int end;       // uno después del último cuádruplo del bloque
+    int succ[2];   // sucesores; succ[0] es el de caída (fall-through) si existe
+    int num_succ;
+    int *pred;
+    int num_pred;
+    int cap_pred;
+} BasicBlock;
+
+/**
+ * @brief Grafo de flujo de control sobre el código intermedio.
+ *
+ * Además de los bloques básicos guarda, por cada cuádruplo, el id de la
+ * variable que define y de las que lee, para que los análisis de flujo de
+ * datos no tengan que volver a interpretar las cadenas de los operandos.
+ */
+typedef struct
+{
+    Quadruple *code;
+    int size;
+
+    BasicBlock *blocks;
+    int num_blocks;
+    int *block_of;      // bloque al que pertenece cada cuádruplo
+
+    NameTable *vars;    // variables y temporales que aparecen en el IR
+    int *def;           // id de la variable escrita por cada cuádruplo, -1 si ninguna
+    int *use1;          // id de arg1 si es variable, -1 en otro caso
+    int *use2;          // id de arg2 si es variable, -1 en otro caso
+
+    NameTable *labels;
+    int *label_block;   // bloque que inicia con cada etiqueta (indexado por id de etiqueta)
+} ControlFlowGraph;
+
+/**
+ * @brief Construye el grafo de flujo de control de una secuencia de cuádruplos.
+ *
+ * Los líderes son el primer cuádruplo, cada IR_LABEL y todo cuádruplo que sigue
+ * a un IR_GOTO, un salto condicional o IR_HALT.
+ */
+ControlFlowGraph *build_cfg(Quadruple *code, int size);
+void free_cfg(ControlFlowGraph *cfg);
+
+/**
+ * @brief Calcula el orden postorden inverso de los bloques alcanzables desde la entrada.
+ *
+ * @param order Arreglo de cfg->num_blocks enteros donde se escribe el orden.
+ * @return El número de bloques alcanzables (los primeros elementos de order).
+ */
+int compute_rpo(ControlFlowGraph *cfg, int *order);
+
+/**
+ * @brief Calcula el dominador inmediato de cada bloque (Cooper, Harvey y Kennedy).
+ *
+ * @param order Orden postorden inverso devuelto por compute_rpo.
+ * @param num_reachable Número de bloques alcanzables en order.
+ * @param idom Arreglo de cfg->num_blocks enteros; la entrada es su propio
+ * dominador y los bloques inalcanzables reciben -1.
+ */
+void compute_dominators(ControlFlowGraph *cfg, const int *order, int num_reachable, int *idom);
+
+/**
+ * @brief Indica si el bloque a domina al bloque b según el arreglo de compute_dominators.
+ */
+int block_dominates(const int *idom, int a, int b);
+
+/**
+ * @brief Ciclo natural: el encabezado y los bloques que llegan a alguna de
+ * sus aristas de regreso sin pasar por él.
+ */
+typedef struct
+{
+    int header;      // bloque encabezado; domina a todos los del ciclo
+    char *in_loop;   // 1 en los bloques del ciclo (indexado por bloque)
+    int *blocks;     // los bloques del ciclo, empezando por el encabezado
+    int num_blocks;  // bloques en el ciclo, incluido el encabezado
+    int parent;      // índice del ciclo inmediato que lo contiene, -1 si no hay
+} NaturalLoop;
+
+/**
+ * @brief Encuentra los ciclos naturales alcanzables del CFG.
+ *
+ * Las aristas de regreso que llegan al mismo encabezado forman un solo ciclo.
+ * Los ciclos se devuelven de los internos a los externos, así que el padre de
+ * un ciclo siempre está después de él en el arreglo.
+ *
+ * @param idom Dominadores de compute_dominators.
+ * @param loops Recibe el arreglo de ciclos; se libera con free_natural_loops.
+ * @return El número de ciclos.
+ */
+int find_natural_loops(ControlFlowGraph *cfg, const int *idom, NaturalLoop **loops);
+void free_natural_loops(NaturalLoop *loops, int count);
+
+/**
+ * @brief Indica si se puede insertar código de preencabezado justo antes de la
+ * etiqueta del encabezado: el encabezado empieza con IR_LABEL y ningún bloque
+ * del ciclo cae en él sin saltar.
+ */
+int loop_has_preheader_slot(ControlFlowGraph *cfg, const NaturalLoop *loop);
+
+/**
+ * @brief Redirige a una etiqueta nueva los saltos de fuera del ciclo que
+ * llegaban a la etiqueta del encabezado, para que también ejecuten el código
+ * que se inserte delante de ella.
+ *
+ * @return El nombre de la etiqueta nueva, que el llamador debe insertar
+ * delante del preencabezado y liberar, o NULL si ningún salto se redirigió.
+ */
+char *redirect_loop_entries(ControlFlowGraph *cfg, const NaturalLoop *loop);
+
+/**
+ * @brief Numera las variables que se leen en algún bloque antes de escribirse en él.
+ *
+ * Solo esas variables pueden estar vivas, o llevar información, en la frontera de
+ * un bloque; el resto son locales a un bloque y no necesitan un bit en los
+ * conjuntos de flujo de datos.
+ *
+ * @param global_index Arreglo de cfg->vars->count enteros; recibe el índice denso
+ * de cada variable global o -1 si es local.
+ * @return El número de variables globales.
+ */
+int find_global_names(ControlFlowGraph *cfg, int *global_index);
+
+/**
+ * @brief Calcula las variables globales (ver find_global_names) vivas a la
+ * entrada de cada bloque.
+ *
+ * @return Un conjunto por bloque; se libera con free_block_sets.
+ */
+BitSet **compute_live_in(ControlFlowGraph *cfg, const int *global_index, int num_globals);
+void free_block_sets(BitSet **sets, int num_blocks);
+
+/**
+ * @brief Devuelve el nombre de la variable que escribe el cuádruplo, o NULL.
+ */
+const char *quad_defined_var(const Quadruple *q);
+
+/**
+ * @brief Indica si el cuádruplo solo calcula un valor en su resultado, sin
+ * efectos observables (E/S, saltos o una posible división entre cero).
+ */
+int quad_is_pure(const Quadruple *q);
+
+/**
+ * @brief Indica si dos operandos de estos tipos se almacenan y operan igual.
+ *
+ * Enteros y booleanos comparten representación; un tipo desconocido nunca se
+ * mezcla con nada para no cambiar la forma en que se imprime o se convierte.
+ */
+int same_value_class(enum TipoDato a, enum TipoDato b);
+
+/**
+ * @brief Lee un literal Entero (sin punto decimal) que cabe en 64 bits.
+ *
+ * @param value Recibe el valor; puede ser NULL si solo interesa la prueba.
+ * @return 1 si s es un literal así, 0 si no.
+ */
+int int_literal(const char *s, long long *value);
+
+/**
+ * @brief Exponente k si v = 2^k con k >= 1, o -1 si v no es una potencia de dos así.
+ */
+int power_of_two(long long v);
+
+/**
+ * @brief Indica si la operación es un salto (GOTO, IF_FALSE_GOTO o IF_TRUE_GOTO).
+ */
+int is_jump(IROperation op);
+
+/**
+ * @brief Indica si la operación es una comparación (LT, GT, LE, GE, EQ o NE).
+ */
+int is_comparison(IROperation op);
+
+/**
+ * @brief Devuelve la comparación equivalente con los operandos intercambiados
+ * (a < b es b > a); EQ, NE y las demás operaciones no cambian.
+ */
+IROperation swap_comparison(IROperation op);
+
+/**
+ * @brief Libera los operandos del cuádruplo y lo marca como IR_REMOVED.
+ */
+void remove_quad(Quadruple *q);
+
+/**
+ * @brief Paso de una variable de inducción básica de un tramo de código.
+ *
+ * La variable es básica si es Entero y su única definición en el tramo es
+ * v = v + c, v = c + v o v = v - c con c literal.
+ *
+ * @param def_count Definiciones de cada variable en el tramo.
+ * @param def_at Cuádruplo de la última de ellas.
+ * @return c (o -c para la resta), o 0 si v no es básica.
+ */
+long long basic_iv_step(const ControlFlowGraph *cfg, const int *def_count, const int *def_at, int v);
+
+/**
+ * @brief Indica si un operando es un Entero invariante en un tramo: un literal
+ * o una variable Entero que el tramo no escribe.
+ *
+ * @param def_count Definiciones de cada variable en el tramo.
+ * @param var Índice del operando en cfg->vars, o -1 si no es una variable.
+ */
+int is_invariant_operand(const int *def_count, const char *operand, int var);
+
+/**
+ * @brief Reconoce la prueba de un ciclo contado en el cuádruplo start + 1 (el
+ * que sigue a la etiqueta del encabezado) como iv op bound.
+ *
+ * iv es una variable de inducción básica del tramo [start, end) y bound un
+ * invariante; si la variable está a la derecha, op se voltea para que quede
+ * a la izquierda. Llena def_count y def_at con las definiciones del tramo.
+ *
+ * @return 1 si la prueba tiene esa forma, 0 si no.
+ */
+int match_counted_test(const ControlFlowGraph *cfg, int start, int end, int *def_count, int *def_at, int *iv,
+                       const char **bound, IROperation *op, long long *step);
+
+/**
+ * @brief Valor de v al caer en el encabezado que empieza en start: el operando
+ * del ASSIGN que la define en el bloque anterior, sin que ese operando cambie
+ * antes de llegar al encabezado.
+ *
+ * Solo mira la entrada por caída; el llamador revisa los demás predecesores.
+ *
+ * @return El operando, o NULL si el bloque anterior no cae en el encabezado o
+ * no asigna así a v.
+ */
+const char *loop_entry_value(const ControlFlowGraph *cfg, int start, int v);
+
+#endif
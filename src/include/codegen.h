@@ -22,24 +22,51 @@ typedef enum
     IR_AND,
     IR_OR,
     IR_NOT,
+    IR_SHL,  // corrimiento a la izquierda; solo lo introduce el optimizador
+    IR_SHR,  // corrimiento aritmético a la derecha
+    IR_BAND, // AND de bits
+    IR_UDIV, // división sin signo de 32 bits; operandos en [0, 2^32)
+    IR_UMOD, // módulo sin signo de 32 bits; operandos en [0, 2^32)
     IR_ASSIGN,
     IR_LABEL,
     IR_GOTO,
     IR_IF_FALSE_GOTO,
+    IR_IF_TRUE_GOTO, // salta si arg1 es distinto de cero
 
     IR_PRINT,
     IR_READ,
     IR_HALT
 } IROperation;
 
+// Marca de un cuádruplo eliminado por una optimización; compact_ir_code() lo descarta.
+#define IR_REMOVED ((IROperation)-1)
+
 typedef struct
 {
     IROperation op;
     char *arg1;
     char *arg2;
     char *result;
+    int renglon; // posición en el fuente del nodo que originó el cuádruplo; 0 si no se conoce
+    int columna;
 } Quadruple;
 
+/* Cuádruplo en espera de insertarse delante de una posición del IR */
+typedef struct
+{
+    int position; // cuádruplo (antes de insertar y compactar) delante del cual va
+    int order;    // orden entre los de la misma posición
+    int sequence; // orden de llegada, para desempatar
+    Quadruple quad;
+} PendingQuad;
+
+typedef struct
+{
+    PendingQuad *quads;
+    int count;
+    int capacity;
+} PendingQuads;
+
 void init_ir_generator();
 /**
  * @brief Inicia el proceso de generación de código intermedio.
@@ -53,6 +80,19 @@ void init_ir_generator();
  */
 void generar_codigo_intermedio(ASTNode *root_ast_node, TablaSimbolos *global_sym_table);
 
+/**
+ * @brief Traduce el AST a cuádruplos sin optimizarlos ni cerrar el programa.
+ *
+ * Es la primera mitad de generar_codigo_intermedio(); permite guardar la
+ * salida del front-end (por ejemplo con write_ir_text()) antes de optimizarla.
+ */
+void traducir_ast_a_ir(ASTNode *root_ast_node, TablaSimbolos *global_sym_table);
+
+/**
+ * @brief Optimiza el código intermedio actual y añade el IR_HALT final.
+ */
+void finalizar_codigo_intermedio();
+
 /**
  * @brief Emite un cuádruplo y lo añade a la secuencia de código intermedio.
  *
@@ -65,6 +105,12 @@ void generar_codigo_intermedio(ASTNode *root_ast_node, TablaSimbolos *global_sym
  */
 void emit_quad(IROperation op, const char *arg1, const char *arg2, const char *result);
 
+/**
+ * @brief Fija la posición en el fuente que reciben los siguientes cuádruplos
+ * emitidos con emit_quad(). Una posición 0 significa desconocida.
+ */
+void set_ir_source_position(int renglon, int columna);
+
 /**
  * @brief Genera y devuelve un nuevo nombre temporal único (ej., "t0", "t1").
  *
@@ -85,6 +131,22 @@ char *new_temp();
  */
 char *new_label();
 
+/**
+ * @brief Evita que new_temp() y new_label() repitan un nombre "tN" o "LN" que
+ * ya existe en un IR cargado desde archivo. Ignora cualquier otro nombre.
+ */
+void reserve_ir_name(const char *name);
+
+/**
+ * @brief Reserva memoria en ceros; termina el programa si no hay memoria.
+ */
+void *xcalloc(size_t size);
+
+/**
+ * @brief Copia una cadena (NULL si es NULL); termina el programa si no hay memoria.
+ */
+char *xstrdup(const char *s);
+
 /**
  * @brief Devuelve un puntero al arreglo global de cuádruplos generados.
  * @return Un puntero al inicio del arreglo de Quadruple.
@@ -101,10 +163,87 @@ int get_ir_code_size();
  * @brief Imprime el código intermedio generado a la salida estándar.
  */
 void imprimir_codigo_intermedio();
+
+/**
+ * @brief Devuelve el nombre textual de una operación (ej., "ADD", "IF_FALSE_GOTO").
+ */
+const char *ir_op_name(IROperation op);
 /**
  * @brief Optimiza el CodigoIntermedio de todas sus operaciones.
  */
 void optimize_ir_code();
 
+/**
+ * @brief Descarta del código intermedio los cuádruplos marcados con IR_REMOVED.
+ */
+void compact_ir_code();
+
+/**
+ * @brief Agrega a la lista un cuádruplo que se insertará delante de position.
+ *
+ * Copia las cadenas y toma la posición en el fuente de origin (0 si es NULL).
+ * Los de la misma posición quedan en orden creciente de order y, con el mismo
+ * order, en el orden en que se agregaron.
+ */
+void add_pending_quad(PendingQuads *pending, int position, int order, IROperation op, const char *arg1,
+                      const char *arg2, const char *result, const Quadruple *origin);
+
+/**
+ * @brief Inserta todos los cuádruplos pendientes y quita los IR_REMOVED en un
+ * solo recorrido del IR.
+ *
+ * Las posiciones se refieren al IR tal como está al llamarla, así que las
+ * pasadas pueden acumular inserciones y eliminaciones sin recalcularlas. La
+ * lista queda vacía y sus cadenas pasan al IR.
+ */
+void splice_pending_quads(PendingQuads *pending);
+
+/**
+ * @brief Libera los cuádruplos pendientes que no se insertaron.
+ */
+void free_pending_quads(PendingQuads *pending);
+
+int es_literal(const char *s);
+int is_valid_varname(const char *s);
+
+/**
+ * @brief Registra el tipo de dato de un nombre del IR (variable o temporal).
+ */
+void set_ir_type(const char *name, enum TipoDato tipo);
+
+/**
+ * @brief Devuelve el tipo de dato de un operando del IR.
+ *
+ * Los literales se clasifican por su forma; los nombres sin tipo registrado
+ * devuelven OTRO.
+ */
+enum TipoDato get_ir_type(const char *name);
+
+/**
+ * @brief Registra que una variable vive en el marco de main, a @p offset bytes
+ * por debajo de rbp.
+ *
+ * Las variables declaradas en un bloque se nombran en el IR con el número de su
+ * ámbito ("_3_i"), así que una variable que oculta a otra es un nombre distinto.
+ */
+void set_ir_frame_slot(const char *name, int offset);
+
+/**
+ * @brief Desplazamiento bajo rbp del lugar de una variable en el marco de main,
+ * o 0 si vive en .bss.
+ */
+int get_ir_frame_slot(const char *name);
+
+/**
+ * @brief Elige cómo emite generate_asm() el ensamblador.
+ *
+ * En modo tamaño (-Os) se emite solo la variante de la plataforma para la que
+ * se compila, las llamadas a printf/scanf pasan por rutinas compartidas, se
+ * evita recargar de memoria el valor que ya está en rax y se prefieren
+ * codificaciones cortas. Fuera de él se emite la forma de referencia, con las
+ * variantes de Windows y Linux.
+ */
+void set_asm_size_mode(int enabled);
+
 void generate_asm(FILE *f);
 #endif
\ No newline at end of file
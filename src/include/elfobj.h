@@ -0,0 +1,22 @@
+#ifndef ELFOBJ_H
+#define ELFOBJ_H
+
+#include <stddef.h>
+
+/**
+ * @brief Ensambla en el proceso el texto que produce generate_asm() y escribe
+ * en @p ruta un objeto ELF64 reubicable equivalente al de "nasm -f elf64".
+ *
+ * Solo reconoce el subconjunto de NASM que emite el generador: secciones
+ * .text, .data y .bss, etiquetas, db/dd/resb/resq, align, global/extern,
+ * %ifdef/%else/%endif y las instrucciones enteras que usa. Los saltos a
+ * etiquetas de .text se codifican cortos cuando alcanzan; las referencias a
+ * .data y .bss y las llamadas a printf/scanf quedan como reubicaciones para
+ * el enlazador.
+ *
+ * @return 1 si escribió el objeto; 0 si encontró algo que no sabe ensamblar,
+ * después de explicarlo en stderr, para que quien llama recurra a NASM.
+ */
+int write_elf_object(const char *asm_text, size_t length, const char *ruta);
+
+#endif
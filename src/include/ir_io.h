@@ -0,0 +1,35 @@
+#ifndef IR_IO_H
+#define IR_IO_H
+
+#include <stdio.h>
+
+/**
+ * @brief Escribe el código intermedio actual y los tipos de sus operandos en
+ * formato de texto.
+ *
+ * Cada cuádruplo ocupa una línea "OP arg1 arg2 resultado", con '-' en los campos
+ * vacíos, seguida de "@renglon:columna" si se conoce su posición en el fuente. Los literales de cadena van entre comillas y los caracteres de
+ * control y '%' se codifican como %XX, así que el archivo se puede volver a leer
+ * sin pérdida con read_ir_text().
+ */
+void write_ir_text(FILE *f);
+
+/**
+ * @brief Escribe el código intermedio en formato binario compacto: una tabla de
+ * cadenas sin repetidos seguida de los tipos y de los cuádruplos como índices.
+ */
+void write_ir_binary(FILE *f);
+
+/**
+ * @brief Reemplaza el código intermedio actual por el leído de un archivo de
+ * texto escrito con write_ir_text(). Termina con error si el archivo no es válido.
+ */
+void read_ir_text(FILE *f, const char *ruta);
+
+/**
+ * @brief Reemplaza el código intermedio actual por el leído de un archivo
+ * binario escrito con write_ir_binary(). Termina con error si no es válido.
+ */
+void read_ir_binary(FILE *f, const char *ruta);
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "codegen.h"
+
+typedef enum
+{
+    OPT_O0, // sin optimizaciones
+    OPT_O1, // pasadas baratas, punto fijo corto
+    OPT_O2, // todas las pasadas
+    OPT_OS  // como -O2 pero sin pasadas que aumentan el tamaño del código, y con las que lo reducen
+} OptLevel;
+
+void set_optimization_level(OptLevel level);
+OptLevel get_optimization_level();
+
+/**
+ * @brief Fuerza la activación o desactivación de una pasada por nombre,
+ * independientemente del nivel de optimización.
+ *
+ * @return 1 si la pasada existe, 0 en otro caso.
+ */
+int set_pass_enabled(const char *name, int enabled);
+int is_pass_enabled(const char *name);
+
+/**
+ * @brief Ejecuta las pasadas activas hasta un punto fijo.
+ *
+ * Cuando una pasada cambia el código se vuelven a encolar solo las pasadas que
+ * pueden aprovechar ese cambio. El número de ejecuciones de cada pasada está
+ * acotado según el nivel de optimización.
+ */
+void run_optimization_passes();
+
+/**
+ * @brief Imprime, por pasada, si estuvo activa, cuántas veces se ejecutó y
+ * cuántos cambios hizo en la última compilación.
+ */
+void print_optimization_stats();
+
+/**
+ * @brief Elimina cuádruplos cuyo resultado nunca se observa.
+ *
+ * Usa un análisis de vida fuerte (faint variables) hacia atrás sobre los bloques
+ * básicos: una asignación solo hace vivos a sus operandos si su propio resultado
+ * está vivo. Elimina tanto temporales como asignaciones a variables ordinarias.
+ * Una división o módulo con resultado muerto se conserva por la posible
+ * división entre cero, pero se le quita el destino (result queda en NULL) para
+ * que no se emita el almacenamiento ni se reserve su variable en .bss.
+ *
+ * @return El número de cuádruplos eliminados o almacenamientos quitados.
+ */
+int eliminate_dead_code();
+
+/**
+ * @brief Propagación de copias global guiada por el flujo de control.
+ *
+ * Primero sustituye hacia adelante los pares "op ... -> tN; ASSIGN tN -> x" en
+ * los que tN no se usa en otro lugar. Después calcula las copias disponibles
+ * (análisis hacia adelante de intersección sobre el CFG) y reemplaza cada uso
+ * de x por su fuente cuando la copia x <- y llega por todos los caminos sin que
+ * x ni y se hayan redefinido.
+ *
+ * @return El número de operandos reescritos más los cuádruplos eliminados.
+ */
+int propagate_copies();
+
+/**
+ * @brief Elimina subexpresiones comunes con numeración de valores.
+ *
+ * Numera los valores de cada bloque con una tabla hash y extiende la tabla a
+ * los bloques dominados recorriendo el árbol de dominadores. Un cálculo que ya
+ * está disponible en una variable se reemplaza por una copia de ella; las
+ * asignaciones e IR_READ cambian el valor de su destino e invalidan las
+ * expresiones que lo usaban.
+ *
+ * @return El número de cálculos reemplazados.
+ */
+int eliminate_common_subexpressions();
+
+/**
+ * @brief Simplifica el flujo de control del código intermedio.
+ *
+ * Convierte los saltos condicionales sobre literales en GOTO o los elimina,
+ * encadena los saltos que llegan a otro GOTO, invierte los saltos
+ * condicionales que solo saltan sobre un GOTO, quita los saltos a la
+ * instrucción siguiente, borra los bloques inalcanzables y las etiquetas sin referencias
+ * (uniendo así los bloques en línea recta). Repite hasta un punto fijo.
+ *
+ * @return El número total de cambios.
+ */
+int simplify_control_flow();
+
+/**
+ * @brief Simplificación algebraica del código intermedio, limitada a enteros.
+ *
+ * Pliega operaciones entre literales (enteros con la semántica de 64 bits del
+ * backend; Flotante en doble precisión), aplica identidades (x+0, x*1, x-x,
+ * x*0), reduce productos por potencias de dos a corrimientos y divisiones o
+ * módulos de valores no negativos a corrimientos y máscaras, reasocia cadenas
+ * de constantes ((x+1)+2) y simplifica !!x y las comparaciones de
+ * comparaciones. Ninguna regla se aplica a operandos Flotante salvo el plegado.
+ *
+ * @return El número de reescrituras.
+ */
+int simplify_algebra();
+
+/**
+ * @brief Análisis de rangos de valores sobre las variables Entero y Booleano.
+ *
+ * Propaga intervalos [min, max] hacia adelante por el CFG, acotándolos en cada
+ * arista con la comparación del salto condicional, con ensanchamiento en los
+ * ciclos y un estrechamiento final. Con los rangos pliega comparaciones
+ * decididas, sustituye variables de valor único por literales y convierte
+ * divisiones de valores no negativos en corrimientos, máscaras o divisiones
+ * sin signo de 32 bits (IR_UDIV / IR_UMOD). También calcula las cotas de
+ * iteraciones que devuelve get_loop_trip_bound.
+ *
+ * @return El número de reescrituras.
+ */
+int analyze_value_ranges();
+
+/**
+ * @brief Cota superior de las veces que se ejecuta el encabezado de un ciclo,
+ * según la última ejecución de analyze_value_ranges.
+ *
+ * @param header_label Etiqueta con la que empieza el bloque encabezado.
+ * @return 1 si se conoce una cota (escrita en max_trips), 0 en otro caso.
+ */
+int get_loop_trip_bound(const char *header_label, long long *max_trips);
+
+/**
+ * @brief Rango de una variable Entero o Booleano que el ciclo lee, a la
+ * entrada de su encabezado, según la última ejecución de analyze_value_ranges.
+ *
+ * @return 1 si el rango es finito (escrito en lo y hi), 0 si no se conoce.
+ */
+int get_loop_header_range(const char *header_label, const char *var, long long *lo, long long *hi);
+
+/**
+ * @brief Mueve los cálculos invariantes de cada ciclo natural a su preencabezado.
+ *
+ * Un cuádruplo se mueve si sus operandos no cambian dentro del ciclo, es la
+ * única definición de su resultado en el ciclo y ese resultado no está vivo
+ * al entrar al encabezado. Las divisiones y módulos entre un divisor que
+ * puede ser cero no se mueven. Cada ejecución sube un nivel de anidamiento.
+ *
+ * @return El número de cuádruplos movidos.
+ */
+int hoist_loop_invariants();
+
+/**
+ * @brief Reemplaza los ciclos de acumulación por su forma cerrada.
+ *
+ * En los ciclos internos de un solo bloque cuya prueba compara una variable
+ * de inducción básica con un invariante, y cuyo cuerpo no tiene efectos y
+ * solo escribe esa variable, acumuladores s = s ± e (e invariante, a * i o
+ * i * i) y temporales muertos a la salida, el ciclo se reemplaza por las
+ * sumas cerradas (por ejemplo n * (n + 1) / 2), calculadas módulo 2^64 como
+ * el ciclo. Si los rangos no descartan un desbordamiento de la distancia o
+ * del último incremento, una prueba manda al ciclo original. Se ejecuta una
+ * vez.
+ *
+ * @return El número de ciclos reemplazados.
+ */
+int evaluate_closed_forms();
+
+/**
+ * @brief Fusiona ciclos vecinos que recorren el mismo espacio de iteración:
+ * la misma prueba contra el mismo límite invariante, el mismo paso y el mismo
+ * valor inicial, sin más que cuádruplos sin efectos entre ellos. El ciclo
+ * fusionado ejecuta en cada vuelta los dos cuerpos, así que solo se aplica si
+ * ninguna variable que escribe uno la usa el otro y a lo más uno tiene
+ * efectos.
+ *
+ * @return El número de pares de ciclos fusionados.
+ */
+int fuse_loops();
+
+/**
+ * @brief Reducción de fuerza y eliminación de variables de inducción.
+ *
+ * En cada ciclo natural con preencabezado, los productos i * k, i << c e
+ * i * i de una variable de inducción básica (i = i ± c, su única definición
+ * en el ciclo) se reemplazan por variables nuevas que se actualizan con sumas
+ * junto al incremento de i. Si después i solo sirve para la prueba de salida
+ * y el análisis de rangos descarta desbordamientos, la prueba se reescribe
+ * sobre una de esas variables para que eliminate_dead_code quite i.
+ *
+ * @return El número de productos reemplazados y contadores eliminados.
+ */
+int reduce_induction_variables();
+
+/**
+ * @brief Desdobla los ciclos internos que saltan según una variable que el
+ * ciclo no escribe (loop unswitching).
+ *
+ * La condición se prueba una vez antes del ciclo y cada resultado ejecuta su
+ * propia copia del ciclo, sin el salto. Solo duplica ciclos pequeños y una
+ * condición por ciclo. Se ejecuta una vez.
+ *
+ * @return El número de ciclos desdoblados.
+ */
+int unswitch_loops();
+
+/**
+ * @brief Desenrolla los ciclos internos cuya prueba compara una variable de
+ * inducción básica con un valor invariante.
+ *
+ * Si la cantidad de vueltas se conoce al compilar y el cuerpo repetido cabe en
+ * el presupuesto del nivel, el ciclo se reemplaza por copias del cuerpo. Si
+ * no, se antepone un ciclo que ejecuta varias copias del cuerpo por prueba y
+ * el ciclo original se queda con las vueltas restantes. Se ejecuta una vez.
+ *
+ * @return El número de ciclos desenrollados.
+ */
+int unroll_loops();
+
+/**
+ * @brief Rota los ciclos con la prueba arriba (Mientras, Para) a la forma
+ * do-while: la prueba original queda como guarda de entrada y una copia al
+ * final regresa al cuerpo con un solo salto condicional.
+ *
+ * Se ejecuta una vez, después de unroll_loops.
+ *
+ * @return El número de ciclos rotados.
+ */
+int rotate_loops();
+
+/**
+ * @brief Fija el factor del desenrollado parcial (opción -unroll=N).
+ *
+ * 0 usa el del nivel de optimización y 1 desactiva el desenrollado parcial.
+ */
+void set_unroll_factor(int factor);
+
+/**
+ * @brief Hace que los temporales cuyas vidas no se traslapan compartan variable.
+ *
+ * Los temporales locales a un bloque se colorean por intervalos de vida dentro
+ * del bloque, separando por tipo; los que cruzan bloques conservan su nombre.
+ * Se ejecuta después de las demás pasadas.
+ *
+ * @return El número de temporales renombrados.
+ */
+int assign_temp_slots();
+
+/**
+ * @brief Cross-jumping: une las secuencias finales idénticas de los caminos
+ * que continúan en la misma etiqueta.
+ *
+ * Se conserva una sola copia de la secuencia y los demás caminos saltan a su
+ * inicio. Solo se activa en -Os y se ejecuta después de las demás pasadas.
+ *
+ * @return El número de cuádruplos eliminados.
+ */
+int merge_identical_tails();
+
+#endif
@@ -6,6 +6,8 @@
 #include <string.h>
 #include "types.h"
 
+struct TablaSimbolos;
+
 enum ASTNodeType
 {
 
@@ -25,6 +27,7 @@ enum ASTNodeType
     AST_MIENTRAS_STMT,
     AST_PARA_STMT,
     AST_PARA_PARAMS,
+    AST_PASO_STMT,
 
     AST_CONTINUAR_STMT,
     AST_ROMPER_STMT,
@@ -82,6 +85,9 @@ typedef struct ASTNode
     int renglon;
     int columna;
     char *ir_result_name;
+    int ir_need; // temporales que requiere evaluar la expresión (Sethi–Ullman), -1 si no se ha calculado
+
+    struct TablaSimbolos *ambito; // ámbito creado por el análisis semántico para bloques y 'Para'
 
 } ASTNode;
 
@@ -104,6 +110,7 @@ ASTNode *parseLeerStmt();
 ASTNode *parseSentenciaCondicional();
 ASTNode *parseSentenciaBucleMientras();
 ASTNode *parseSentenciaBuclePara();
+ASTNode *parsePaso(ASTNode *init_stmt);
 ASTNode *parseBloqueSentencias();
 ASTNode *parseSentencia();
 ASTNode *parseExpresion();
@@ -0,0 +1,52 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "codegen.h"
+#include "cfg.h"
+
+#define REGALLOC_CALLER_SAVED 4 // registros que printf y scanf pueden modificar
+
+/**
+ * @brief Asignación de registros de generate_asm.
+ *
+ * Cada variable con registro lo ocupa durante todo su intervalo de vida; las
+ * demás se quedan en su lugar en memoria (.bss o el marco de main). Ese lugar
+ * sigue existiendo para una variable con registro: ahí la deja scanf y ahí se
+ * guarda mientras dura una llamada que destruiría su registro.
+ */
+typedef struct
+{
+    NameTable *names;         // variables con registro
+    const char **reg;         // registro de cada una (indexado por id de names)
+    char *load_at_entry;      // 1 si se lee antes de escribirse: se carga de memoria al entrar
+    const char **saved;       // registros preservados por la convención que hay que guardar en main
+    int num_saved;
+    const char **call_spills; // por cuádruplo, REGALLOC_CALLER_SAVED variables vivas a través de la llamada o NULL
+} RegisterAssignment;
+
+/**
+ * @brief Asigna registros a las variables enteras del código intermedio con
+ * un barrido lineal (Poletto y Sarkar) sobre sus intervalos de vida.
+ *
+ * @param exclude Nombres que nunca se materializan (comparaciones fusionadas
+ * con su salto) y no necesitan registro.
+ */
+RegisterAssignment *allocate_registers(Quadruple *code, int size, const NameTable *exclude);
+void free_register_assignment(RegisterAssignment *ra);
+
+/**
+ * @brief Registro asignado a un nombre, o NULL si vive en memoria o es un literal.
+ */
+const char *assigned_register(const RegisterAssignment *ra, const char *name);
+
+/**
+ * @brief Confirma los lugares en el marco de main de las variables de bloque
+ * (ver get_ir_frame_slot) y devuelve el tamaño del marco.
+ *
+ * El front-end hace compartir lugar a los ámbitos hermanos, pero el optimizador
+ * puede alargar la vida de una variable fuera de su ámbito; la que se cruce
+ * con otra del mismo lugar se cambia a uno libre durante todo su intervalo.
+ */
+int settle_frame_slots(Quadruple *code, int size);
+
+#endif
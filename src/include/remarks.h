@@ -0,0 +1,42 @@
+#ifndef REMARKS_H
+#define REMARKS_H
+
+#include "codegen.h"
+
+typedef enum
+{
+    REMARK_APPLIED, // la optimización se hizo
+    REMARK_MISSED   // la optimización se consideró y se descartó
+} RemarkKind;
+
+/**
+ * @brief Activa los reportes de optimización; se escribirán en la ruta dada
+ * al llamar a close_remarks().
+ */
+void open_remarks(const char *ruta);
+
+/**
+ * @brief Escribe los reportes acumulados y desactiva el registro.
+ *
+ * Cada reporte es una línea JSON independiente (JSON Lines) con los campos
+ * "pass", "kind" ("applied" o "missed"), "line", "column", "op" y "reason".
+ * Un reporte idéntico que se repite en varias ejecuciones de la misma pasada
+ * se escribe una sola vez.
+ */
+void close_remarks();
+
+/**
+ * @brief Indica si se están registrando reportes, para no calcular el texto
+ * de uno que se va a descartar.
+ */
+int remarks_enabled();
+
+/**
+ * @brief Registra un reporte de la pasada sobre el cuádruplo q, con la
+ * posición en el fuente que este conserva. q puede ser NULL si el reporte no
+ * corresponde a un cuádruplo (línea y columna 0).
+ */
+void emit_remark(const char *pass, RemarkKind kind, const Quadruple *q, const char *formato, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#endif
@@ -1,12 +1,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
 #include "file.h"
 #include "types.h"
 #include "parser.h"
 #include "semantic.h"
 #include "symbols.h"
 #include "codegen.h"
+#include "optimizer.h"
+#include "ir_io.h"
+#include "remarks.h"
+#include "elfobj.h"
 extern struct nodo *raiz;
 extern struct nodo *actual;
 
@@ -14,10 +21,316 @@ extern struct ErrorSemantico *cabeza_errores;
 extern int contador_errores_semanticos;
 extern Quadruple *codigo;
 
+#ifndef _WIN32
+/*
+ * Objeto ELF64 leído completo en memoria, con sus cabeceras de sección y
+ * .shstrtab ya validadas. Solo se usa en los reportes de -debug.
+ */
+typedef struct
+{
+    unsigned char *data;
+    size_t size;
+    uint16_t shnum;
+    const unsigned char *sections;
+    const char *names;
+    uint64_t names_size;
+} ElfObject;
+
+static uint64_t elf_read(const unsigned char *p, int size)
+{
+    uint64_t value = 0;
+    for (int k = size - 1; k >= 0; k--)
+        value = (value << 8) | p[k];
+    return value;
+}
+
+static int load_elf_object(const char *ruta, ElfObject *obj)
+{
+    memset(obj, 0, sizeof(*obj));
+    FILE *f = fopen(ruta, "rb");
+    if (f == NULL)
+        return 0;
+    if (fseek(f, 0, SEEK_END) == 0)
+    {
+        long size = ftell(f);
+        if (size >= 64 && fseek(f, 0, SEEK_SET) == 0 && (obj->data = malloc((size_t)size)) != NULL &&
+            fread(obj->data, 1, (size_t)size, f) == (size_t)size)
+            obj->size = (size_t)size;
+    }
+    fclose(f);
+
+    const unsigned char *h = obj->data;
+    if (obj->size == 0 || memcmp(h, "\x7f" "ELF", 4) != 0 || h[4] != 2 /* ELFCLASS64 */)
+    {
+        free(obj->data);
+        return 0;
+    }
+    uint64_t shoff = elf_read(h + 0x28, 8);
+    uint16_t shentsize = (uint16_t)elf_read(h + 0x3A, 2);
+    obj->shnum = (uint16_t)elf_read(h + 0x3C, 2);
+    uint16_t shstrndx = (uint16_t)elf_read(h + 0x3E, 2);
+    if (shentsize != 64 || shstrndx >= obj->shnum || shoff > obj->size || obj->size - shoff < obj->shnum * 64ull)
+    {
+        free(obj->data);
+        return 0;
+    }
+    obj->sections = obj->data + shoff;
+
+    uint64_t names_offset = elf_read(obj->sections + shstrndx * 64 + 0x18, 8);
+    obj->names_size = elf_read(obj->sections + shstrndx * 64 + 0x20, 8);
+    if (names_offset > obj->size || obj->size - names_offset < obj->names_size || obj->names_size == 0 ||
+        obj->data[names_offset + obj->names_size - 1] != '\0')
+    {
+        free(obj->data);
+        return 0;
+    }
+    obj->names = (const char *)obj->data + names_offset;
+    return 1;
+}
+
+/* Cabecera de la sección con ese nombre, o NULL. */
+static const unsigned char *elf_section(const ElfObject *obj, const char *name)
+{
+    for (int s = 0; s < obj->shnum; s++)
+    {
+        uint64_t name_offset = elf_read(obj->sections + s * 64, 4);
+        if (name_offset < obj->names_size && strcmp(obj->names + name_offset, name) == 0)
+            return obj->sections + s * 64;
+    }
+    return NULL;
+}
+
+/* Contenido de una sección con bits en el archivo; NULL si no cabe en él. */
+static const unsigned char *elf_section_data(const ElfObject *obj, const unsigned char *header, uint64_t *size)
+{
+    uint64_t offset = elf_read(header + 0x18, 8);
+    *size = elf_read(header + 0x20, 8);
+    if (elf_read(header + 4, 4) == 8 /* SHT_NOBITS */)
+        return NULL;
+    if (offset > obj->size || obj->size - offset < *size)
+    {
+        *size = 0;
+        return NULL;
+    }
+    return obj->data + offset;
+}
+
+/*
+ * Tamaño de la sección .text de un objeto ELF64, o -1 si no se pudo leer.
+ * Solo se usa para el reporte de tamaño de -Os.
+ */
+static long text_section_size(const char *ruta)
+{
+    ElfObject obj;
+    if (!load_elf_object(ruta, &obj))
+        return -1;
+    const unsigned char *text = elf_section(&obj, ".text");
+    long size = text != NULL ? (long)elf_read(text + 0x20, 8) : -1;
+    free(obj.data);
+    return size;
+}
+
+/*
+ * Nombre del destino de la reubicación @p k de .rela.text: el del símbolo, o el
+ * de la sección si la reubicación va contra un símbolo de sección.
+ */
+static const char *relocation_target(const ElfObject *obj, const unsigned char *rela, uint64_t k)
+{
+    uint64_t rela_size;
+    const unsigned char *entries = elf_section_data(obj, rela, &rela_size);
+    uint32_t link = (uint32_t)elf_read(rela + 0x28, 4);
+    if (entries == NULL || link >= obj->shnum)
+        return "?";
+    const unsigned char *symtab_header = obj->sections + link * 64;
+    uint64_t symtab_size, strtab_size;
+    const unsigned char *symtab = elf_section_data(obj, symtab_header, &symtab_size);
+    uint32_t strtab_index = (uint32_t)elf_read(symtab_header + 0x28, 4);
+    if (symtab == NULL || strtab_index >= obj->shnum)
+        return "?";
+    const char *strtab = (const char *)elf_section_data(obj, obj->sections + strtab_index * 64, &strtab_size);
+
+    uint64_t symbol = elf_read(entries + k * 24 + 12, 4);
+    if ((symbol + 1) * 24 > symtab_size)
+        return "?";
+    const unsigned char *sym = symtab + symbol * 24;
+    if ((sym[4] & 0xf) == 3 /* STT_SECTION */)
+    {
+        uint16_t shndx = (uint16_t)elf_read(sym + 6, 2);
+        uint64_t name = shndx < obj->shnum ? elf_read(obj->sections + shndx * 64, 4) : obj->names_size;
+        return name < obj->names_size ? obj->names + name : "?";
+    }
+    uint64_t name = elf_read(sym, 4);
+    return strtab != NULL && name < strtab_size && memchr(strtab + name, '\0', strtab_size - name) ? strtab + name
+                                                                                                    : "?";
+}
+
+/*
+ * Compara el contenido de .text y .data, el tamaño de .bss y las reubicaciones
+ * de .text de dos objetos. Describe en @p diferencia la primera discrepancia y
+ * devuelve 0, o devuelve 1 si son equivalentes.
+ *
+ * Las reubicaciones se comparan por posición, tipo, destino por nombre y
+ * sumando, porque cada ensamblador numera sus símbolos a su manera. Una
+ * llamada a una función externa cuenta igual como R_X86_64_PC32 o
+ * R_X86_64_PLT32: según la versión, NASM emite una u otra.
+ */
+static int compare_objects(const ElfObject *a, const ElfObject *b, char *diferencia, size_t longitud)
+{
+    static const char *const sections[] = {".text", ".data", ".bss"};
+    for (size_t s = 0; s < sizeof(sections) / sizeof(sections[0]); s++)
+    {
+        const unsigned char *ha = elf_section(a, sections[s]);
+        const unsigned char *hb = elf_section(b, sections[s]);
+        uint64_t size_a = 0, size_b = 0;
+        const unsigned char *da = ha != NULL ? elf_section_data(a, ha, &size_a) : NULL;
+        const unsigned char *db = hb != NULL ? elf_section_data(b, hb, &size_b) : NULL;
+        if (size_a != size_b)
+        {
+            snprintf(diferencia, longitud, "%s mide %llu bytes y con NASM %llu", sections[s],
+                     (unsigned long long)size_a, (unsigned long long)size_b);
+            return 0;
+        }
+        for (uint64_t k = 0; da != NULL && db != NULL && k < size_a; k++)
+        {
+            if (da[k] != db[k])
+            {
+                snprintf(diferencia, longitud, "%s difiere en el byte 0x%llx (%02x, con NASM %02x)", sections[s],
+                         (unsigned long long)k, da[k], db[k]);
+                return 0;
+            }
+        }
+    }
+
+    const unsigned char *ra = elf_section(a, ".rela.text");
+    const unsigned char *rb = elf_section(b, ".rela.text");
+    uint64_t size_a = 0, size_b = 0;
+    const unsigned char *ea = ra != NULL ? elf_section_data(a, ra, &size_a) : NULL;
+    const unsigned char *eb = rb != NULL ? elf_section_data(b, rb, &size_b) : NULL;
+    if (size_a / 24 != size_b / 24)
+    {
+        snprintf(diferencia, longitud, "%llu reubicaciones en .text y con NASM %llu",
+                 (unsigned long long)(size_a / 24), (unsigned long long)(size_b / 24));
+        return 0;
+    }
+    for (uint64_t k = 0; ea != NULL && eb != NULL && k < size_a / 24; k++)
+    {
+        uint64_t offset_a = elf_read(ea + k * 24, 8), offset_b = elf_read(eb + k * 24, 8);
+        uint32_t type_a = (uint32_t)elf_read(ea + k * 24 + 8, 4), type_b = (uint32_t)elf_read(eb + k * 24 + 8, 4);
+        int64_t addend_a = (int64_t)elf_read(ea + k * 24 + 16, 8), addend_b = (int64_t)elf_read(eb + k * 24 + 16, 8);
+        const char *target_a = relocation_target(a, ra, k);
+        const char *target_b = relocation_target(b, rb, k);
+        if (type_a == 4 /* R_X86_64_PLT32 */)
+            type_a = 2; /* R_X86_64_PC32 */
+        if (type_b == 4)
+            type_b = 2;
+        if (offset_a != offset_b || type_a != type_b || addend_a != addend_b || strcmp(target_a, target_b) != 0)
+        {
+            snprintf(diferencia, longitud,
+                     "la reubicación %llu es %s%+lld en 0x%llx (tipo %u) y con NASM %s%+lld en 0x%llx (tipo %u)",
+                     (unsigned long long)k, target_a, (long long)addend_a, (unsigned long long)offset_a, type_a,
+                     target_b, (long long)addend_b, (unsigned long long)offset_b, type_b);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Con -Os y -debug ensambla también la salida sin el modo tamaño y reporta
+ * cuántos bytes de código se ahorraron.
+ */
+static void report_code_size(const char *base_name)
+{
+    char ruta[256];
+    char cmd[768];
+
+    snprintf(ruta, sizeof(ruta), "%s.ref.asm", base_name);
+    FILE *ref = fopen(ruta, "w");
+    if (ref == NULL)
+    {
+        perror(ruta);
+        return;
+    }
+    set_asm_size_mode(0);
+    generate_asm(ref);
+    set_asm_size_mode(1);
+    fclose(ref);
+
+    snprintf(cmd, sizeof(cmd), "nasm -f elf64 %s.ref.asm -o %s.ref.o", base_name, base_name);
+    system(cmd);
+
+    snprintf(ruta, sizeof(ruta), "%s.o", base_name);
+    long optimized = text_section_size(ruta);
+    snprintf(ruta, sizeof(ruta), "%s.ref.o", base_name);
+    long reference = text_section_size(ruta);
+
+    if (optimized < 0 || reference < 0)
+        printf("Tamaño de codigo (-Os): no se pudo leer la seccion .text de los objetos\n");
+    else
+        printf("Tamaño de codigo (-Os): .text %ld bytes, sin modo tamaño %ld bytes (%+ld bytes, %+.1f%%)\n", optimized,
+               reference, optimized - reference, reference > 0 ? 100.0 * (optimized - reference) / reference : 0.0);
+
+    remove(ruta);
+    snprintf(ruta, sizeof(ruta), "%s.ref.asm", base_name);
+    remove(ruta);
+}
+
+static double elapsed_ms(const struct timespec *inicio)
+{
+    struct timespec fin;
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    return (fin.tv_sec - inicio->tv_sec) * 1e3 + (fin.tv_nsec - inicio->tv_nsec) / 1e6;
+}
+
+/*
+ * Con -integrated-as y -debug ensambla el mismo texto con NASM, reporta el
+ * tiempo que ahorró el ensamblador integrado y verifica que los dos objetos
+ * tengan los mismos bytes y las mismas reubicaciones.
+ */
+static void report_assembler_latency(const char *base_name, double integrated_ms)
+{
+    char ruta[256];
+    char cmd[768];
+
+    snprintf(cmd, sizeof(cmd), "nasm -f elf64 %s.asm -o %s.ref.o", base_name, base_name);
+    struct timespec inicio;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    int status = system(cmd);
+    double nasm_ms = elapsed_ms(&inicio);
+
+    ElfObject integrated, reference;
+    snprintf(ruta, sizeof(ruta), "%s.o", base_name);
+    int have_integrated = load_elf_object(ruta, &integrated);
+    snprintf(ruta, sizeof(ruta), "%s.ref.o", base_name);
+    int have_reference = status == 0 && load_elf_object(ruta, &reference);
+
+    if (!have_integrated || !have_reference)
+        printf("Ensamblador integrado: %.2f ms (no se pudo ensamblar con NASM para comparar)\n", integrated_ms);
+    else
+    {
+        char diferencia[256];
+        printf("Ensamblador integrado: %.2f ms, NASM %.2f ms (%.2f ms menos)\n", integrated_ms, nasm_ms,
+               nasm_ms - integrated_ms);
+        if (compare_objects(&integrated, &reference, diferencia, sizeof(diferencia)))
+            printf("Ensamblador integrado: el objeto coincide con el de NASM (secciones y reubicaciones)\n");
+        else
+            printf("Ensamblador integrado: el objeto NO coincide con el de NASM: %s\n", diferencia);
+    }
+    if (have_integrated)
+        free(integrated.data);
+    if (have_reference)
+        free(reference.data);
+    remove(ruta);
+}
+#endif
+
 int main(int argc, const char *argv[])
 {
     int asm_flag = 0;
     int debug_flag = 0;
+    int emit_ir_flag = 0; // 1 texto, 2 binario
+    int remarks_flag = 0;
+    int integrated_as_flag = 0;
 
     // Recorremos el resto de argumentos (si hay)
     for (int i = 3; i < argc; i++)
@@ -30,6 +343,60 @@ int main(int argc, const char *argv[])
         {
             debug_flag = 1;
         }
+        else if (strcmp(argv[i], "-emit-ir") == 0)
+        {
+            emit_ir_flag = 1;
+        }
+        else if (strcmp(argv[i], "-emit-irb") == 0)
+        {
+            emit_ir_flag = 2;
+        }
+        else if (strcmp(argv[i], "-integrated-as") == 0)
+        {
+            integrated_as_flag = 1;
+        }
+        else if (strcmp(argv[i], "-remarks") == 0)
+        {
+            remarks_flag = 1;
+        }
+        else if (strcmp(argv[i], "-O0") == 0)
+        {
+            set_optimization_level(OPT_O0);
+        }
+        else if (strcmp(argv[i], "-O1") == 0)
+        {
+            set_optimization_level(OPT_O1);
+        }
+        else if (strcmp(argv[i], "-O2") == 0)
+        {
+            set_optimization_level(OPT_O2);
+        }
+        else if (strcmp(argv[i], "-Os") == 0)
+        {
+            set_optimization_level(OPT_OS);
+        }
+        else if (strncmp(argv[i], "-unroll=", 8) == 0)
+        {
+            char *end;
+            long factor = strtol(argv[i] + 8, &end, 10);
+            if (end == argv[i] + 8 || *end != '\0' || factor < 1 || factor > 64)
+            {
+                printf("Factor de desenrollado inválido: %s\n", argv[i] + 8);
+                return 1;
+            }
+            set_unroll_factor((int)factor);
+        }
+        else if (strncmp(argv[i], "-fno-", 5) == 0 || strncmp(argv[i], "-f", 2) == 0)
+        {
+            // -f<pasada> / -fno-<pasada> activan o desactivan una pasada sin importar el nivel
+            int enable = strncmp(argv[i], "-fno-", 5) != 0;
+            const char *pass_name = argv[i] + (enable ? 2 : 5);
+            if (!set_pass_enabled(pass_name, enable))
+            {
+                printf("Pasada de optimización desconocida: %s\n", pass_name);
+                return 1;
+            }
+        }
         else
         {
             printf("Opción desconocida: %s\n", argv[i]);
@@ -37,34 +404,92 @@ int main(int argc, const char *argv[])
         }
     }
 
+    // En -Os el ensamblador se emite para ocupar menos bytes
+    set_asm_size_mode(get_optimization_level() == OPT_OS);
+
     if (argc > 1)
     {
 
-        FILE *archivo = leer_archivo(argv[1]);
-        if (!archivo)
-        {
-            char *cadena = strcat("Error en la lectura del archivo ", argv[1]);
-            perror(cadena);
-            exit(EXIT_FAILURE);
-        }
+        // Un archivo .ir/.irb ya es código intermedio: se salta el front-end
+        const char *extension = strrchr(argv[1], '.');
+        int ir_input = 0;
+        if (extension != NULL && strcmp(extension, ".ir") == 0)
+            ir_input = 1;
+        else if (extension != NULL && strcmp(extension, ".irb") == 0)
+            ir_input = 2;
 
-        analizar_archivo(archivo);
-        ASTNode *raiz_ast = parsePrograma();
-        TablaSimbolos *tabla = realizar_analisis_semantico(raiz_ast);
+        ASTNode *raiz_ast = NULL;
+        TablaSimbolos *tabla = NULL;
 
-        if (contador_errores_semanticos > 0)
+        if (ir_input)
         {
-            imprimir_errores_semanticos();
-            fprintf(stderr, "La compilacion aborto debido a errores semanticos.\n");
-            liberar_ast(raiz_ast);
-            return EXIT_FAILURE;
+            FILE *entrada = fopen(argv[1], ir_input == 2 ? "rb" : "r");
+            if (!entrada)
+            {
+                perror(argv[1]);
+                exit(EXIT_FAILURE);
+            }
+            if (ir_input == 2)
+                read_ir_binary(entrada, argv[1]);
+            else
+                read_ir_text(entrada, argv[1]);
+            fclose(entrada);
         }
+        else
+        {
+            FILE *archivo = leer_archivo(argv[1]);
+            if (!archivo)
+            {
+                char *cadena = strcat("Error en la lectura del archivo ", argv[1]);
+                perror(cadena);
+                exit(EXIT_FAILURE);
+            }
 
-        generar_codigo_intermedio(raiz_ast, tabla);
+            analizar_archivo(archivo);
+            raiz_ast = parsePrograma();
+            tabla = realizar_analisis_semantico(raiz_ast);
+
+            if (contador_errores_semanticos > 0)
+            {
+                imprimir_errores_semanticos();
+                fprintf(stderr, "La compilacion aborto debido a errores semanticos.\n");
+                liberar_ast(raiz_ast);
+                return EXIT_FAILURE;
+            }
+
+            traducir_ast_a_ir(raiz_ast, tabla);
+        }
 
         char *base_name = argv[2] == NULL ? "program" : argv[2];
         char filename[256]; 
 
+        if (emit_ir_flag)
+        {
+            // Se guarda la salida del front-end, antes de optimizar
+            snprintf(filename, sizeof(filename), "%s.%s", base_name, emit_ir_flag == 2 ? "irb" : "ir");
+            FILE *salida_ir = fopen(filename, emit_ir_flag == 2 ? "wb" : "w");
+            if (salida_ir == NULL)
+            {
+                perror("No se pudo crear el archivo");
+                return EXIT_FAILURE;
+            }
+            if (emit_ir_flag == 2)
+                write_ir_binary(salida_ir);
+            else
+                write_ir_text(salida_ir);
+            fclose(salida_ir);
+        }
+
+        if (remarks_flag)
+        {
+            // Un reporte JSON por línea con lo que hizo o descartó cada pasada
+            snprintf(filename, sizeof(filename), "%s.remarks", base_name);
+            open_remarks(filename);
+        }
+
+        finalizar_codigo_intermedio();
+        close_remarks();
+
         snprintf(filename, sizeof(filename), "%s.asm", base_name);
         FILE *f = fopen(filename, "w");
 
@@ -73,7 +498,23 @@ int main(int argc, const char *argv[])
             perror("No se pudo crear el archivo");
         }
 
+#ifndef _WIN32
+        // El ensamblador integrado lee el texto desde memoria; el .asm se escribe igual
+        char *asm_text = NULL;
+        size_t asm_length = 0;
+        if (integrated_as_flag)
+        {
+            FILE *memoria = open_memstream(&asm_text, &asm_length);
+            generate_asm(memoria);
+            fclose(memoria);
+            fwrite(asm_text, 1, asm_length, f);
+        }
+        else
+            generate_asm(f);
+#else
+        (void)integrated_as_flag;
         generate_asm(f);
+#endif
 
         fclose(f);
 
@@ -95,15 +536,36 @@ int main(int argc, const char *argv[])
         {
             char cmd[512];
 
+            int assembled = 0;
+            double integrated_ms = 0;
+            if (integrated_as_flag)
+            {
+                // Sin lanzar NASM; si algo no lo sabe ensamblar, se recurre a NASM
+                struct timespec inicio;
+                clock_gettime(CLOCK_MONOTONIC, &inicio);
+                snprintf(filename, sizeof(filename), "%s.o", base_name);
+                assembled = write_elf_object(asm_text, asm_length, filename);
+                integrated_ms = elapsed_ms(&inicio);
+                free(asm_text);
+            }
+
             // NASM para Linux (elf64)
-            snprintf(cmd, sizeof(cmd), "nasm -f elf64 %s.asm -o %s.o", base_name, base_name);
-            system(cmd);
+            if (!assembled)
+            {
+                snprintf(cmd, sizeof(cmd), "nasm -f elf64 %s.asm -o %s.o", base_name, base_name);
+                system(cmd);
+            }
 
             // Link con ld para Linux
             snprintf(cmd, sizeof(cmd), "gcc -no-pie %s.o -o %s", base_name, base_name);
             system(cmd);
 
             printf("Compilacion terminada. Ejecutable: ./%s\n", base_name);
+
+            if (debug_flag && get_optimization_level() == OPT_OS)
+                report_code_size(base_name);
+            if (debug_flag && assembled)
+                report_assembler_latency(base_name, integrated_ms);
         }
 #endif
 
@@ -112,14 +574,21 @@ int main(int argc, const char *argv[])
 
         if (debug_flag)
         {
-            imprimir_lexico(raiz);
-            imprimir_ast(raiz_ast, 0);
-            imprimir_jerarquia_tablas_simbolos(tabla, 0);
+            if (!ir_input)
+            {
+                imprimir_lexico(raiz);
+                imprimir_ast(raiz_ast, 0);
+                imprimir_jerarquia_tablas_simbolos(tabla, 0);
+            }
             imprimir_codigo_intermedio();
+            print_optimization_stats();
         }
-        liberar_ast(raiz_ast);
 
-        destruir_jerarquia_tablas_simbolos(tabla);
+        if (!ir_input)
+        {
+            liberar_ast(raiz_ast);
+            destruir_jerarquia_tablas_simbolos(tabla);
+        }
     }
 
     else
@@ -0,0 +1,571 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Simplificación algebraica guiada por reglas.
+ *
+ * Las reglas solo se aplican cuando el resultado y los operandos son enteros o
+ * booleanos: para Flotante x+0, x-x o x*0 no son identidades (ceros con signo,
+ * NaN, infinitos) y comparar al revés no equivale a negar la comparación. La
+ * única regla que toca flotantes es el plegado de dos literales, que se hace en
+ * doble precisión y conserva el punto decimal en el resultado.
+ *
+ * Las reglas que miran la definición de un operando (reasociación, !!x,
+ * comparación de comparación) solo buscan dentro del bloque básico.
+ */
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    int walk;
+    int *def_stamp;   // marca de las variables definidas en el bloque actual
+    int *def_pos;     // último cuádruplo del bloque que las definió
+} AlgebraState;
+
+static int is_int_class(const char *operand)
+{
+    if (operand == NULL)
+        return 1;
+    if (is_valid_varname(operand))
+    {
+        enum TipoDato t = get_ir_type(operand);
+        return t == INT || t == BOOL;
+    }
+    return int_literal(operand, NULL);
+}
+
+static IROperation negate_compare(IROperation op)
+{
+    switch (op)
+    {
+    case IR_LT: return IR_GE;
+    case IR_GE: return IR_LT;
+    case IR_GT: return IR_LE;
+    case IR_LE: return IR_GT;
+    case IR_EQ: return IR_NE;
+    default: return IR_EQ;
+    }
+}
+
+static void set_operands(Quadruple *q, IROperation op, const char *arg1, const char *arg2)
+{
+    // Los argumentos pueden apuntar a las cadenas actuales del propio cuádruplo
+    char *a1 = arg1 ? xstrdup(arg1) : NULL;
+    char *a2 = arg2 ? xstrdup(arg2) : NULL;
+    free(q->arg1);
+    free(q->arg2);
+    q->op = op;
+    q->arg1 = a1;
+    q->arg2 = a2;
+}
+
+static void set_constant(Quadruple *q, long long value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", value);
+    set_operands(q, IR_ASSIGN, buffer, NULL);
+}
+
+/*
+ * Pliega una operación entre literales enteros con la semántica del backend:
+ * aritmética de 64 bits con desbordamiento circular e idiv truncando hacia cero.
+ */
+static int fold_int(IROperation op, long long a, long long b, long long *r)
+{
+    unsigned long long ua = (unsigned long long)a, ub = (unsigned long long)b;
+    switch (op)
+    {
+    case IR_ADD: *r = (long long)(ua + ub); return 1;
+    case IR_SUB: *r = (long long)(ua - ub); return 1;
+    case IR_MUL: *r = (long long)(ua * ub); return 1;
+    case IR_DIV:
+    case IR_MOD:
+    case IR_UDIV:
+    case IR_UMOD:
+        if (b == 0 || (a == LLONG_MIN && b == -1))
+            return 0;
+        *r = (op == IR_DIV || op == IR_UDIV) ? a / b : a % b;
+        return 1;
+    case IR_NEG: *r = (long long)(0 - ua); return 1;
+    case IR_LT: *r = a < b; return 1;
+    case IR_GT: *r = a > b; return 1;
+    case IR_LE: *r = a <= b; return 1;
+    case IR_GE: *r = a >= b; return 1;
+    case IR_EQ: *r = a == b; return 1;
+    case IR_NE: *r = a != b; return 1;
+    case IR_AND:
+    case IR_BAND: *r = a & b; return 1;
+    case IR_OR: *r = a | b; return 1;
+    case IR_NOT: *r = a == 0; return 1;
+    case IR_SHL: *r = (b >= 0 && b < 64) ? (long long)(ua << b) : 0; return b >= 0 && b < 64;
+    case IR_SHR: *r = (b >= 0 && b < 64) ? a >> b : 0; return b >= 0 && b < 64;
+    default: return 0;
+    }
+}
+
+static int fold_float(Quadruple *q)
+{
+    if (!es_literal(q->arg1) || (q->arg2 && !es_literal(q->arg2)))
+        return 0;
+
+    double a = atof(q->arg1);
+    double b = q->arg2 ? atof(q->arg2) : 0.0;
+    double r;
+    switch (q->op)
+    {
+    case IR_ADD: r = a + b; break;
+    case IR_SUB: r = a - b; break;
+    case IR_MUL: r = a * b; break;
+    case IR_DIV:
+        if (b == 0.0)
+            return 0;
+        r = a / b;
+        break;
+    case IR_NEG: r = -a; break;
+    default: return 0;
+    }
+
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%f", r);
+    set_operands(q, IR_ASSIGN, buffer, NULL);
+    return 1;
+}
+
+/*
+ * Devuelve el cuádruplo del bloque actual que definió operand si sus propios
+ * operandos no se han redefinido desde entonces, o NULL.
+ */
+static Quadruple *local_definition(AlgebraState *st, const char *operand)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    int v = is_valid_varname(operand) ? lookup_name(cfg->vars, operand) : -1;
+    if (v == -1 || st->def_stamp[v] != st->walk)
+        return NULL;
+
+    int j = st->def_pos[v];
+    Quadruple *def = &cfg->code[j];
+    const char *args[2] = {def->arg1, def->arg2};
+    for (int k = 0; k < 2; k++)
+    {
+        int u = is_valid_varname(args[k]) ? lookup_name(cfg->vars, args[k]) : -1;
+        if (u != -1 && st->def_stamp[u] == st->walk && st->def_pos[u] > j)
+            return NULL;
+        if (u != -1 && u == v)
+            return NULL;
+    }
+    return def;
+}
+
+static int is_known_nonnegative(AlgebraState *st, const char *operand)
+{
+    long long v;
+    if (int_literal(operand, &v))
+        return v >= 0;
+
+    Quadruple *def = local_definition(st, operand);
+    if (def == NULL)
+        return 0;
+    if (is_comparison(def->op) || def->op == IR_NOT)
+        return 1;
+    if (def->op == IR_BAND)
+        return (int_literal(def->arg1, &v) && v >= 0) || (int_literal(def->arg2, &v) && v >= 0);
+    return 0;
+}
+
+/*
+ * Expresa def como x + c o x * c con c literal. Las restas de literal se ven
+ * como sumas del opuesto y los corrimientos a la izquierda como productos.
+ */
+static const char *linear_form(Quadruple *def, IROperation family, long long *c)
+{
+    long long v;
+    if (family == IR_ADD)
+    {
+        if (def->op == IR_ADD && int_literal(def->arg2, &v) && !int_literal(def->arg1, NULL))
+        {
+            *c = v;
+            return def->arg1;
+        }
+        if (def->op == IR_ADD && int_literal(def->arg1, &v) && !int_literal(def->arg2, NULL))
+        {
+            *c = v;
+            return def->arg2;
+        }
+        if (def->op == IR_SUB && int_literal(def->arg2, &v) && !int_literal(def->arg1, NULL))
+        {
+            *c = (long long)(0 - (unsigned long long)v);
+            return def->arg1;
+        }
+        return NULL;
+    }
+
+    if (def->op == IR_MUL && int_literal(def->arg2, &v) && !int_literal(def->arg1, NULL))
+    {
+        *c = v;
+        return def->arg1;
+    }
+    if (def->op == IR_MUL && int_literal(def->arg1, &v) && !int_literal(def->arg2, NULL))
+    {
+        *c = v;
+        return def->arg2;
+    }
+    if (def->op == IR_SHL && int_literal(def->arg2, &v) && v >= 0 && v < 63)
+    {
+        *c = 1LL << v;
+        return def->arg1;
+    }
+    return NULL;
+}
+
+/* (x + c1) + c2 -> x + (c1 + c2), (x * c1) * c2 -> x * (c1 * c2) */
+static int reassociate(AlgebraState *st, Quadruple *q)
+{
+    IROperation family;
+    const char *var;
+    long long c;
+
+    if ((q->op == IR_ADD || q->op == IR_MUL) && int_literal(q->arg1, &c) && !int_literal(q->arg2, NULL))
+        var = q->arg2;
+    else if ((q->op == IR_ADD || q->op == IR_SUB || q->op == IR_MUL) && int_literal(q->arg2, &c) && !int_literal(q->arg1, NULL))
+        var = q->arg1;
+    else
+        return 0;
+
+    family = q->op == IR_MUL ? IR_MUL : IR_ADD;
+    if (q->op == IR_SUB)
+        c = (long long)(0 - (unsigned long long)c);
+
+    Quadruple *def = local_definition(st, var);
+    long long inner;
+    const char *base = def ? linear_form(def, family, &inner) : NULL;
+    if (base == NULL || !is_int_class(base))
+        return 0;
+
+    unsigned long long combined = family == IR_ADD
+        ? (unsigned long long)inner + (unsigned long long)c
+        : (unsigned long long)inner * (unsigned long long)c;
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", (long long)combined);
+    set_operands(q, family, base, buffer);
+    return 1;
+}
+
+static int simplify_identities(Quadruple *q)
+{
+    long long a = 0, b = 0;
+    int lit1 = int_literal(q->arg1, &a);
+    int lit2 = int_literal(q->arg2, &b);
+    int same = q->arg1 && q->arg2 && !lit1 && strcmp(q->arg1, q->arg2) == 0;
+
+    switch (q->op)
+    {
+    case IR_ADD:
+        if (lit2 && b == 0)
+        {
+            set_operands(q, IR_ASSIGN, q->arg1, NULL);
+            return 1;
+        }
+        if (lit1 && a == 0)
+        {
+            set_operands(q, IR_ASSIGN, q->arg2, NULL);
+            return 1;
+        }
+        break;
+    case IR_SUB:
+        if (lit2 && b == 0)
+        {
+            set_operands(q, IR_ASSIGN, q->arg1, NULL);
+            return 1;
+        }
+        if (lit1 && a == 0)
+        {
+            set_operands(q, IR_NEG, q->arg2, NULL);
+            return 1;
+        }
+        if (same)
+        {
+            set_constant(q, 0);
+            return 1;
+        }
+        break;
+    case IR_MUL:
+        if ((lit1 && a == 0) || (lit2 && b == 0))
+        {
+            set_constant(q, 0);
+            return 1;
+        }
+        if (lit2 && (b == 1 || b == -1))
+        {
+            set_operands(q, b == 1 ? IR_ASSIGN : IR_NEG, q->arg1, NULL);
+            return 1;
+        }
+        if (lit1 && (a == 1 || a == -1))
+        {
+            set_operands(q, a == 1 ? IR_ASSIGN : IR_NEG, q->arg2, NULL);
+            return 1;
+        }
+        break;
+    case IR_DIV:
+    case IR_UDIV:
+        // Solo divisores literales: quitar una división por una variable podría ocultar una división entre cero
+        if (lit2 && b == 1)
+        {
+            set_operands(q, IR_ASSIGN, q->arg1, NULL);
+            return 1;
+        }
+        break;
+    case IR_MOD:
+    case IR_UMOD:
+        if (lit2 && (b == 1 || b == -1))
+        {
+            set_constant(q, 0);
+            return 1;
+        }
+        break;
+    case IR_AND:
+    case IR_BAND:
+        if ((lit1 && a == 0) || (lit2 && b == 0))
+        {
+            set_constant(q, 0);
+            return 1;
+        }
+        if (same)
+        {
+            set_operands(q, IR_ASSIGN, q->arg1, NULL);
+            return 1;
+        }
+        break;
+    case IR_OR:
+        if (lit2 && b == 0)
+        {
+            set_operands(q, IR_ASSIGN, q->arg1, NULL);
+            return 1;
+        }
+        if (lit1 && a == 0)
+        {
+            set_operands(q, IR_ASSIGN, q->arg2, NULL);
+            return 1;
+        }
+        if (same)
+        {
+            set_operands(q, IR_ASSIGN, q->arg1, NULL);
+            return 1;
+        }
+        break;
+    case IR_SHL:
+    case IR_SHR:
+        if (lit2 && b == 0)
+        {
+            set_operands(q, IR_ASSIGN, q->arg1, NULL);
+            return 1;
+        }
+        break;
+    case IR_EQ:
+    case IR_LE:
+    case IR_GE:
+        if (same)
+        {
+            set_constant(q, 1);
+            return 1;
+        }
+        break;
+    case IR_NE:
+    case IR_LT:
+    case IR_GT:
+        if (same)
+        {
+            set_constant(q, 0);
+            return 1;
+        }
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static int reduce_strength(AlgebraState *st, Quadruple *q)
+{
+    long long c;
+    char buffer[32];
+
+    if (q->op == IR_MUL)
+    {
+        int k;
+        const char *x;
+        if (int_literal(q->arg2, &c) && (k = power_of_two(c)) > 0)
+            x = q->arg1;
+        else if (int_literal(q->arg1, &c) && (k = power_of_two(c)) > 0)
+            x = q->arg2;
+        else
+            return 0;
+        snprintf(buffer, sizeof(buffer), "%d", k);
+        set_operands(q, IR_SHL, x, buffer);
+        return 1;
+    }
+
+    // La división entera redondea hacia cero; el corrimiento aritmético, hacia abajo
+    if ((q->op == IR_DIV || q->op == IR_MOD) && int_literal(q->arg2, &c) && power_of_two(c) > 0 &&
+        is_known_nonnegative(st, q->arg1))
+    {
+        if (q->op == IR_DIV)
+        {
+            snprintf(buffer, sizeof(buffer), "%d", power_of_two(c));
+            set_operands(q, IR_SHR, q->arg1, buffer);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), "%lld", c - 1);
+            set_operands(q, IR_BAND, q->arg1, buffer);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* !!x, !(a < b), (a < b) == 0, (a < b) != 0 ... */
+static int simplify_booleans(AlgebraState *st, Quadruple *q)
+{
+    long long c;
+    const char *inner_name;
+    int negate;
+
+    if (q->op == IR_NOT)
+    {
+        inner_name = q->arg1;
+        negate = 1;
+    }
+    else if ((q->op == IR_EQ || q->op == IR_NE) && int_literal(q->arg2, &c) && (c == 0 || c == 1))
+    {
+        inner_name = q->arg1;
+        negate = (q->op == IR_EQ) == (c == 0);
+    }
+    else
+    {
+        return 0;
+    }
+
+    Quadruple *def = local_definition(st, inner_name);
+    if (def == NULL)
+        return 0;
+
+    if (is_comparison(def->op) && is_int_class(def->arg1) && is_int_class(def->arg2))
+    {
+        if (negate)
+            set_operands(q, negate_compare(def->op), def->arg1, def->arg2);
+        else
+            set_operands(q, IR_ASSIGN, inner_name, NULL);
+        return 1;
+    }
+
+    if (def->op == IR_NOT && q->op == IR_NOT)
+    {
+        // !!x vale x solo si x ya es 0 o 1; en otro caso equivale a x != 0
+        if (get_ir_type(def->arg1) == BOOL)
+            set_operands(q, IR_ASSIGN, def->arg1, NULL);
+        else
+            set_operands(q, IR_NE, def->arg1, "0");
+        return 1;
+    }
+    return 0;
+}
+
+static int simplify_quad(AlgebraState *st, Quadruple *q)
+{
+    if (q->op == IR_ASSIGN || q->arg1 == NULL)
+        return 0;
+
+    if (!is_int_class(q->result) || !is_int_class(q->arg1) || !is_int_class(q->arg2))
+    {
+        // Flotantes: solo se pliegan los literales
+        if (get_ir_type(q->result) == FLOAT)
+            return fold_float(q);
+        return 0;
+    }
+
+    long long a, b, r;
+    int lit1 = int_literal(q->arg1, &a);
+    int lit2 = q->arg2 == NULL ? 1 : int_literal(q->arg2, &b);
+    if (q->arg2 == NULL)
+        b = 0;
+    if (lit1 && lit2 && fold_int(q->op, a, b, &r))
+    {
+        set_constant(q, r);
+        return 1;
+    }
+
+    // Un literal en arg1 de una operación conmutativa pasa a arg2
+    if (lit1 && !int_literal(q->arg2, NULL) &&
+        (q->op == IR_ADD || q->op == IR_MUL || q->op == IR_AND || q->op == IR_OR || q->op == IR_BAND ||
+         q->op == IR_EQ || q->op == IR_NE))
+    {
+        char *tmp = q->arg1;
+        q->arg1 = q->arg2;
+        q->arg2 = tmp;
+        return 1;
+    }
+
+    return reassociate(st, q) || simplify_identities(q) || simplify_booleans(st, q) || reduce_strength(st, q);
+}
+
+int simplify_algebra()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+
+    AlgebraState st;
+    st.cfg = cfg;
+    st.walk = 0;
+    st.def_stamp = malloc((num_vars + 1) * sizeof(int));
+    st.def_pos = malloc((num_vars + 1) * sizeof(int));
+    if (!st.def_stamp || !st.def_pos)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para la simplificación algebraica.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int v = 0; v < num_vars; v++)
+        st.def_stamp[v] = -1;
+
+    int changes = 0;
+    for (int blk = 0; blk < cfg->num_blocks; blk++)
+    {
+        st.walk++;
+        for (int i = cfg->blocks[blk].start; i < cfg->blocks[blk].end; i++)
+        {
+            Quadruple *q = &code[i];
+
+            // Cada regla deja el cuádruplo en una forma más simple, así que esto termina
+            IROperation original_op = q->op;
+            int rounds = 0;
+            while (rounds < 8 && simplify_quad(&st, q))
+                rounds++;
+            changes += rounds;
+            if (rounds > 0)
+                emit_remark("algebra", REMARK_APPLIED, q, "%s se reescribe como %s %s%s%s", ir_op_name(original_op),
+                            ir_op_name(q->op), q->arg1 ? q->arg1 : "", q->arg2 ? ", " : "", q->arg2 ? q->arg2 : "");
+
+            int d = cfg->def[i];
+            if (d != -1)
+            {
+                st.def_stamp[d] = st.walk;
+                st.def_pos[d] = i;
+            }
+        }
+    }
+
+    free(st.def_stamp);
+    free(st.def_pos);
+    free_cfg(cfg);
+    return changes;
+}
@@ -0,0 +1,820 @@
+#include "cfg.h"
+#include "bitset.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int hash_name(const char *name)
+{
+    unsigned int hash = 0;
+    for (int i = 0; name[i] != '\0'; i++)
+    {
+        hash = hash * 31 + (unsigned char)name[i];
+    }
+    return hash;
+}
+
+NameTable *create_name_table(int expected_size)
+{
+    NameTable *table = xcalloc(sizeof(NameTable));
+
+    table->num_buckets = 64;
+    while (table->num_buckets < expected_size * 2)
+        table->num_buckets *= 2;
+
+    table->buckets = xcalloc(table->num_buckets * sizeof(int));
+    for (int i = 0; i < table->num_buckets; i++)
+        table->buckets[i] = -1;
+
+    table->capacity = 64;
+    table->count = 0;
+    table->names = xcalloc(table->capacity * sizeof(char *));
+    table->next = xcalloc(table->capacity * sizeof(int));
+    return table;
+}
+
+void destroy_name_table(NameTable *table)
+{
+    if (table == NULL)
+        return;
+    for (int i = 0; i < table->count; i++)
+        free(table->names[i]);
+    free(table->names);
+    free(table->next);
+    free(table->buckets);
+    free(table);
+}
+
+int lookup_name(const NameTable *table, const char *name)
+{
+    if (name == NULL)
+        return -1;
+
+    unsigned int bucket = hash_name(name) & (table->num_buckets - 1);
+    for (int id = table->buckets[bucket]; id != -1; id = table->next[id])
+    {
+        if (strcmp(table->names[id], name) == 0)
+            return id;
+    }
+    return -1;
+}
+
+static void rehash_name_table(NameTable *table)
+{
+    free(table->buckets);
+    table->num_buckets *= 2;
+    table->buckets = xcalloc(table->num_buckets * sizeof(int));
+    for (int i = 0; i < table->num_buckets; i++)
+        table->buckets[i] = -1;
+
+    for (int id = 0; id < table->count; id++)
+    {
+        unsigned int bucket = hash_name(table->names[id]) & (table->num_buckets - 1);
+        table->next[id] = table->buckets[bucket];
+        table->buckets[bucket] = id;
+    }
+}
+
+int intern_name(NameTable *table, const char *name)
+{
+    int id = lookup_name(table, name);
+    if (id != -1)
+        return id;
+
+    if (table->count >= table->capacity)
+    {
+        table->capacity *= 2;
+        table->names = realloc(table->names, table->capacity * sizeof(char *));
+        table->next = realloc(table->next, table->capacity * sizeof(int));
+        if (table->names == NULL || table->next == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo redimensionar la tabla de nombres.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Se mantiene un factor de carga menor a 1 aunque la estimación inicial falle
+    if (table->count >= table->num_buckets)
+        rehash_name_table(table);
+
+    // La tabla guarda su propia copia: las optimizaciones reescriben los operandos
+    id = table->count++;
+    unsigned int bucket = hash_name(name) & (table->num_buckets - 1);
+    table->names[id] = strdup(name);
+    table->next[id] = table->buckets[bucket];
+    table->buckets[bucket] = id;
+    return id;
+}
+
+const char *quad_defined_var(const Quadruple *q)
+{
+    switch (q->op)
+    {
+    case IR_LABEL:
+    case IR_GOTO:
+    case IR_IF_FALSE_GOTO:
+    case IR_IF_TRUE_GOTO:
+    case IR_PRINT:
+    case IR_HALT:
+        return NULL;
+    default:
+        return is_valid_varname(q->result) ? q->result : NULL;
+    }
+}
+
+int quad_is_pure(const Quadruple *q)
+{
+    switch (q->op)
+    {
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_NEG:
+    case IR_LT:
+    case IR_GT:
+    case IR_LE:
+    case IR_GE:
+    case IR_EQ:
+    case IR_NE:
+    case IR_AND:
+    case IR_OR:
+    case IR_NOT:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
+    case IR_ASSIGN:
+        return 1;
+    case IR_DIV:
+    case IR_MOD:
+    case IR_UDIV:
+    case IR_UMOD:
+        // Solo es seguro descartarla si el divisor es una constante distinta de cero
+        return es_literal(q->arg2) && atof(q->arg2) != 0.0;
+    default:
+        return 0;
+    }
+}
+
+int same_value_class(enum TipoDato a, enum TipoDato b)
+{
+    if ((a == INT || a == BOOL) && (b == INT || b == BOOL))
+        return 1;
+    if (a == OTRO || a == TIPO_ERROR || a == TIPO_VOID)
+        return 0;
+    return a == b;
+}
+
+int int_literal(const char *s, long long *value)
+{
+    if (s == NULL || s[0] == '\0' || !es_literal(s) || strchr(s, '.') != NULL)
+        return 0;
+
+    char *end;
+    errno = 0;
+    long long v = strtoll(s, &end, 10);
+    if (*end != '\0' || errno == ERANGE)
+        return 0;
+    if (value)
+        *value = v;
+    return 1;
+}
+
+int power_of_two(long long v)
+{
+    if (v <= 1 || (v & (v - 1)) != 0)
+        return -1;
+    return __builtin_ctzll((unsigned long long)v);
+}
+
+int is_jump(IROperation op)
+{
+    return op == IR_GOTO || op == IR_IF_FALSE_GOTO || op == IR_IF_TRUE_GOTO;
+}
+
+int is_comparison(IROperation op)
+{
+    return op == IR_LT || op == IR_GT || op == IR_LE || op == IR_GE || op == IR_EQ || op == IR_NE;
+}
+
+IROperation swap_comparison(IROperation op)
+{
+    switch (op)
+    {
+    case IR_LT:
+        return IR_GT;
+    case IR_GT:
+        return IR_LT;
+    case IR_LE:
+        return IR_GE;
+    case IR_GE:
+        return IR_LE;
+    default:
+        return op;
+    }
+}
+
+void remove_quad(Quadruple *q)
+{
+    free(q->arg1);
+    free(q->arg2);
+    free(q->result);
+    q->arg1 = q->arg2 = q->result = NULL;
+    q->op = IR_REMOVED;
+}
+
+long long basic_iv_step(const ControlFlowGraph *cfg, const int *def_count, const int *def_at, int v)
+{
+    if (v == -1 || def_count[v] != 1 || get_ir_type(cfg->vars->names[v]) != INT)
+        return 0;
+
+    int i = def_at[v];
+    const Quadruple *q = &cfg->code[i];
+    long long c;
+    if (q->op == IR_ADD && cfg->use1[i] == v && int_literal(q->arg2, &c))
+        return c;
+    if (q->op == IR_ADD && cfg->use2[i] == v && int_literal(q->arg1, &c))
+        return c;
+    if (q->op == IR_SUB && cfg->use1[i] == v && int_literal(q->arg2, &c) && c != LLONG_MIN)
+        return -c;
+    return 0;
+}
+
+int is_invariant_operand(const int *def_count, const char *operand, int var)
+{
+    if (var == -1)
+        return int_literal(operand, NULL);
+    return def_count[var] == 0 && get_ir_type(operand) == INT;
+}
+
+int match_counted_test(const ControlFlowGraph *cfg, int start, int end, int *def_count, int *def_at, int *iv,
+                       const char **bound, IROperation *op, long long *step)
+{
+    for (int v = 0; v < cfg->vars->count; v++)
+        def_count[v] = 0;
+    for (int i = start; i < end; i++)
+    {
+        int d = cfg->def[i];
+        if (d != -1)
+        {
+            def_count[d]++;
+            def_at[d] = i;
+        }
+    }
+
+    int t = start + 1;
+    const Quadruple *test = &cfg->code[t];
+    *step = basic_iv_step(cfg, def_count, def_at, cfg->use1[t]);
+    if (*step != 0 && is_invariant_operand(def_count, test->arg2, cfg->use2[t]))
+    {
+        *iv = cfg->use1[t];
+        *bound = test->arg2;
+        *op = test->op;
+        return 1;
+    }
+    *step = basic_iv_step(cfg, def_count, def_at, cfg->use2[t]);
+    if (*step != 0 && is_invariant_operand(def_count, test->arg1, cfg->use1[t]))
+    {
+        *iv = cfg->use2[t];
+        *bound = test->arg1;
+        *op = swap_comparison(test->op);
+        return 1;
+    }
+    return 0;
+}
+
+const char *loop_entry_value(const ControlFlowGraph *cfg, int start, int v)
+{
+    if (start == 0 || is_jump(cfg->code[start - 1].op) || cfg->code[start - 1].op == IR_HALT)
+        return NULL;
+    int first = cfg->blocks[cfg->block_of[start - 1]].start;
+    for (int i = start - 1; i >= first; i--)
+    {
+        if (cfg->def[i] != v)
+            continue;
+        if (cfg->code[i].op != IR_ASSIGN)
+            return NULL;
+        int source = cfg->use1[i];
+        for (int k = i + 1; k < start && source != -1; k++)
+        {
+            if (cfg->def[k] == source)
+                return NULL;
+        }
+        return cfg->code[i].arg1;
+    }
+    return NULL;
+}
+
+static void add_edge(ControlFlowGraph *cfg, int from, int to)
+{
+    BasicBlock *src = &cfg->blocks[from];
+    BasicBlock *dst = &cfg->blocks[to];
+
+    for (int i = 0; i < src->num_succ; i++)
+    {
+        if (src->succ[i] == to)
+            return;
+    }
+    src->succ[src->num_succ++] = to;
+
+    if (dst->num_pred >= dst->cap_pred)
+    {
+        dst->cap_pred = dst->cap_pred == 0 ? 2 : dst->cap_pred * 2;
+        dst->pred = realloc(dst->pred, dst->cap_pred * sizeof(int));
+        if (dst->pred == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo redimensionar la lista de predecesores.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    dst->pred[dst->num_pred++] = from;
+}
+
+static int block_of_label(ControlFlowGraph *cfg, const char *label)
+{
+    int id = lookup_name(cfg->labels, label);
+    if (id == -1 || cfg->label_block[id] == -1)
+    {
+        fprintf(stderr, "Error interno: Salto a la etiqueta inexistente '%s'.\n", label ? label : "NULL");
+        exit(EXIT_FAILURE);
+    }
+    return cfg->label_block[id];
+}
+
+ControlFlowGraph *build_cfg(Quadruple *code, int size)
+{
+    ControlFlowGraph *cfg = xcalloc(sizeof(ControlFlowGraph));
+    cfg->code = code;
+    cfg->size = size;
+    cfg->block_of = xcalloc(size * sizeof(int));
+    cfg->def = xcalloc(size * sizeof(int));
+    cfg->use1 = xcalloc(size * sizeof(int));
+    cfg->use2 = xcalloc(size * sizeof(int));
+    cfg->vars = create_name_table(size);
+    cfg->labels = create_name_table(size / 4);
+
+    // Líderes y numeración de bloques
+    int num_blocks = 0;
+    for (int i = 0; i < size; i++)
+    {
+        int leader = (i == 0) || code[i].op == IR_LABEL;
+        if (i > 0)
+        {
+            IROperation prev = code[i - 1].op;
+            if (prev == IR_GOTO || prev == IR_IF_FALSE_GOTO || prev == IR_IF_TRUE_GOTO || prev == IR_HALT)
+                leader = 1;
+        }
+        if (leader)
+            num_blocks++;
+        cfg->block_of[i] = num_blocks - 1;
+    }
+
+    cfg->num_blocks = num_blocks;
+    cfg->blocks = xcalloc(num_blocks * sizeof(BasicBlock));
+    for (int b = 0; b < num_blocks; b++)
+    {
+        cfg->blocks[b].start = size;
+        cfg->blocks[b].end = 0;
+        cfg->blocks[b].num_succ = 0;
+        cfg->blocks[b].pred = NULL;
+        cfg->blocks[b].num_pred = 0;
+        cfg->blocks[b].cap_pred = 0;
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        BasicBlock *bb = &cfg->blocks[cfg->block_of[i]];
+        if (i < bb->start)
+            bb->start = i;
+        bb->end = i + 1;
+
+        Quadruple *q = &code[i];
+        const char *d = quad_defined_var(q);
+        cfg->def[i] = d ? intern_name(cfg->vars, d) : -1;
+        cfg->use1[i] = is_valid_varname(q->arg1) ? intern_name(cfg->vars, q->arg1) : -1;
+        cfg->use2[i] = is_valid_varname(q->arg2) ? intern_name(cfg->vars, q->arg2) : -1;
+
+        if (q->op == IR_LABEL)
+            intern_name(cfg->labels, q->result);
+    }
+
+    cfg->label_block = xcalloc(cfg->labels->count * sizeof(int));
+    for (int i = 0; i < cfg->labels->count; i++)
+        cfg->label_block[i] = -1;
+    for (int i = 0; i < size; i++)
+    {
+        if (code[i].op == IR_LABEL)
+            cfg->label_block[lookup_name(cfg->labels, code[i].result)] = cfg->block_of[i];
+    }
+
+    // Aristas: primero la de caída, después la del salto
+    for (int b = 0; b < num_blocks; b++)
+    {
+        Quadruple *last = &code[cfg->blocks[b].end - 1];
+        switch (last->op)
+        {
+        case IR_GOTO:
+            add_edge(cfg, b, block_of_label(cfg, last->result));
+            break;
+        case IR_IF_FALSE_GOTO:
+        case IR_IF_TRUE_GOTO:
+            if (b + 1 < num_blocks)
+                add_edge(cfg, b, b + 1);
+            add_edge(cfg, b, block_of_label(cfg, last->result));
+            break;
+        case IR_HALT:
+            break;
+        default:
+            if (b + 1 < num_blocks)
+                add_edge(cfg, b, b + 1);
+            break;
+        }
+    }
+
+    return cfg;
+}
+
+int compute_rpo(ControlFlowGraph *cfg, int *order)
+{
+    int n = cfg->num_blocks;
+    if (n == 0)
+        return 0;
+
+    // DFS iterativo; el postorden se llena de atrás hacia adelante
+    int *stack = xcalloc(n * sizeof(int));
+    int *next_succ = xcalloc(n * sizeof(int));
+    char *visited = calloc(n, 1);
+    if (visited == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el recorrido del grafo.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int post = 0;
+    int reachable = 0;
+    int top = 0;
+    stack[top++] = 0;
+    visited[0] = 1;
+    next_succ[0] = 0;
+    reachable++;
+
+    int *postorder = xcalloc(n * sizeof(int));
+    while (top > 0)
+    {
+        int b = stack[top - 1];
+        if (next_succ[b] < cfg->blocks[b].num_succ)
+        {
+            int s = cfg->blocks[b].succ[next_succ[b]++];
+            if (!visited[s])
+            {
+                visited[s] = 1;
+                next_succ[s] = 0;
+                stack[top++] = s;
+                reachable++;
+            }
+        }
+        else
+        {
+            postorder[post++] = b;
+            top--;
+        }
+    }
+
+    for (int i = 0; i < post; i++)
+        order[i] = postorder[post - 1 - i];
+
+    free(postorder);
+    free(stack);
+    free(next_succ);
+    free(visited);
+    return reachable;
+}
+
+static int intersect_dominators(const int *idom, const int *rpo_number, int a, int b)
+{
+    while (a != b)
+    {
+        while (rpo_number[a] > rpo_number[b])
+            a = idom[a];
+        while (rpo_number[b] > rpo_number[a])
+            b = idom[b];
+    }
+    return a;
+}
+
+void compute_dominators(ControlFlowGraph *cfg, const int *order, int num_reachable, int *idom)
+{
+    int n = cfg->num_blocks;
+    int *rpo_number = xcalloc(n * sizeof(int));
+    for (int b = 0; b < n; b++)
+    {
+        idom[b] = -1;
+        rpo_number[b] = -1;
+    }
+    for (int k = 0; k < num_reachable; k++)
+        rpo_number[order[k]] = k;
+
+    if (num_reachable == 0)
+    {
+        free(rpo_number);
+        return;
+    }
+
+    idom[order[0]] = order[0];
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int k = 1; k < num_reachable; k++)
+        {
+            int b = order[k];
+            int new_idom = -1;
+            for (int p = 0; p < cfg->blocks[b].num_pred; p++)
+            {
+                int pred = cfg->blocks[b].pred[p];
+                if (idom[pred] == -1)
+                    continue;
+                new_idom = new_idom == -1 ? pred : intersect_dominators(idom, rpo_number, pred, new_idom);
+            }
+            if (idom[b] != new_idom)
+            {
+                idom[b] = new_idom;
+                changed = 1;
+            }
+        }
+    }
+
+    free(rpo_number);
+}
+
+int block_dominates(const int *idom, int a, int b)
+{
+    for (int x = b; x != -1; x = idom[x] == x ? -1 : idom[x])
+    {
+        if (x == a)
+            return 1;
+    }
+    return 0;
+}
+
+int find_natural_loops(ControlFlowGraph *cfg, const int *idom, NaturalLoop **loops_out)
+{
+    int n = cfg->num_blocks;
+    NaturalLoop *loops = NULL;
+    int count = 0;
+    int capacity = 0;
+    int *stack = xcalloc((n + 1) * sizeof(int));
+    int *members = xcalloc((n + 1) * sizeof(int));
+
+    for (int h = 0; h < n; h++)
+    {
+        if (idom[h] == -1)
+            continue;
+
+        // Latches: predecesores alcanzables dominados por h
+        BasicBlock *hb = &cfg->blocks[h];
+        char *in_loop = NULL;
+        int top = 0;
+        int size = 0;
+        for (int p = 0; p < hb->num_pred; p++)
+        {
+            int pred = hb->pred[p];
+            if (idom[pred] == -1 || !block_dominates(idom, h, pred))
+                continue;
+            if (in_loop == NULL)
+            {
+                in_loop = xcalloc(n);
+                memset(in_loop, 0, n);
+                in_loop[h] = 1;
+                members[0] = h;
+                size = 1;
+            }
+            if (!in_loop[pred])
+            {
+                in_loop[pred] = 1;
+                members[size++] = pred;
+                stack[top++] = pred;
+            }
+        }
+        if (in_loop == NULL)
+            continue;
+
+        // Todo lo que llega a un latch sin pasar por h
+        while (top > 0)
+        {
+            int x = stack[--top];
+            for (int p = 0; p < cfg->blocks[x].num_pred; p++)
+            {
+                int pred = cfg->blocks[x].pred[p];
+                if (!in_loop[pred] && idom[pred] != -1)
+                {
+                    in_loop[pred] = 1;
+                    members[size++] = pred;
+                    stack[top++] = pred;
+                }
+            }
+        }
+
+        if (count == capacity)
+        {
+            capacity = capacity == 0 ? 8 : capacity * 2;
+            loops = realloc(loops, capacity * sizeof(NaturalLoop));
+            if (loops == NULL)
+            {
+                fprintf(stderr, "Error: No se pudo asignar memoria para el grafo de flujo de control.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        loops[count].header = h;
+        loops[count].in_loop = in_loop;
+        loops[count].blocks = xcalloc(size * sizeof(int));
+        memcpy(loops[count].blocks, members, size * sizeof(int));
+        loops[count].num_blocks = size;
+        loops[count].parent = -1;
+        count++;
+    }
+    free(stack);
+    free(members);
+
+    // Primero los internos: un ciclo anidado tiene menos bloques que el que lo contiene
+    for (int a = 1; a < count; a++)
+    {
+        NaturalLoop moved = loops[a];
+        int b = a - 1;
+        while (b >= 0 && loops[b].num_blocks > moved.num_blocks)
+        {
+            loops[b + 1] = loops[b];
+            b--;
+        }
+        loops[b + 1] = moved;
+    }
+    for (int a = 0; a < count; a++)
+    {
+        for (int b = a + 1; b < count; b++)
+        {
+            if (loops[b].in_loop[loops[a].header] && loops[b].header != loops[a].header)
+            {
+                loops[a].parent = b;
+                break;
+            }
+        }
+    }
+
+    *loops_out = loops;
+    return count;
+}
+
+void free_natural_loops(NaturalLoop *loops, int count)
+{
+    for (int l = 0; l < count; l++)
+    {
+        free(loops[l].in_loop);
+        free(loops[l].blocks);
+    }
+    free(loops);
+}
+
+int loop_has_preheader_slot(ControlFlowGraph *cfg, const NaturalLoop *loop)
+{
+    int start = cfg->blocks[loop->header].start;
+    if (cfg->code[start].op != IR_LABEL)
+        return 0;
+    if (start == 0 || cfg->code[start - 1].op == IR_GOTO || cfg->code[start - 1].op == IR_HALT)
+        return 1;
+    return !loop->in_loop[cfg->block_of[start - 1]];
+}
+
+char *redirect_loop_entries(ControlFlowGraph *cfg, const NaturalLoop *loop)
+{
+    const char *header_label = cfg->code[cfg->blocks[loop->header].start].result;
+    char *preheader_label = NULL;
+    for (int i = 0; i < cfg->size; i++)
+    {
+        Quadruple *q = &cfg->code[i];
+        if (q->op != IR_GOTO && q->op != IR_IF_FALSE_GOTO && q->op != IR_IF_TRUE_GOTO)
+            continue;
+        if (loop->in_loop[cfg->block_of[i]] || strcmp(q->result, header_label) != 0)
+            continue;
+        if (preheader_label == NULL)
+            preheader_label = new_label();
+        char *target = xstrdup(preheader_label);
+        free(q->result);
+        q->result = target;
+    }
+    return preheader_label;
+}
+
+int find_global_names(ControlFlowGraph *cfg, int *global_index)
+{
+    int num_vars = cfg->vars->count;
+    int *defined_in = xcalloc(num_vars * sizeof(int));
+
+    for (int v = 0; v < num_vars; v++)
+    {
+        global_index[v] = -1;
+        defined_in[v] = -1;
+    }
+
+    int num_globals = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            int uses[2] = {cfg->use1[i], cfg->use2[i]};
+            for (int k = 0; k < 2; k++)
+            {
+                int u = uses[k];
+                if (u != -1 && defined_in[u] != b && global_index[u] == -1)
+                    global_index[u] = num_globals++;
+            }
+            if (cfg->def[i] != -1)
+                defined_in[cfg->def[i]] = b;
+        }
+    }
+
+    free(defined_in);
+    return num_globals;
+}
+
+BitSet **compute_live_in(ControlFlowGraph *cfg, const int *global_index, int num_globals)
+{
+    int n = cfg->num_blocks;
+    BitSet **live_in = xcalloc(n * sizeof(BitSet *));
+    BitSet **gen = xcalloc(n * sizeof(BitSet *));
+    BitSet **kill = xcalloc(n * sizeof(BitSet *));
+
+    for (int b = 0; b < n; b++)
+    {
+        live_in[b] = bitset_crear(num_globals);
+        gen[b] = bitset_crear(num_globals);
+        kill[b] = bitset_crear(num_globals);
+        for (int i = cfg->blocks[b].end - 1; i >= cfg->blocks[b].start; i--)
+        {
+            int d = cfg->def[i];
+            if (d != -1 && global_index[d] != -1)
+            {
+                bitset_agregar(kill[b], global_index[d]);
+                bitset_quitar(gen[b], global_index[d]);
+            }
+            int uses[2] = {cfg->use1[i], cfg->use2[i]};
+            for (int k = 0; k < 2; k++)
+            {
+                if (uses[k] != -1 && global_index[uses[k]] != -1)
+                    bitset_agregar(gen[b], global_index[uses[k]]);
+            }
+        }
+    }
+
+    BitSet *scratch = bitset_crear(num_globals);
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int b = n - 1; b >= 0; b--)
+        {
+            bitset_vaciar(scratch);
+            for (int s = 0; s < cfg->blocks[b].num_succ; s++)
+                bitset_unir(scratch, live_in[cfg->blocks[b].succ[s]]);
+            bitset_restar(scratch, kill[b]);
+            bitset_unir(scratch, gen[b]);
+            if (!bitset_iguales(scratch, live_in[b]))
+            {
+                bitset_copiar(live_in[b], scratch);
+                changed = 1;
+            }
+        }
+    }
+
+    bitset_destruir(scratch);
+    free_block_sets(gen, n);
+    free_block_sets(kill, n);
+    return live_in;
+}
+
+void free_block_sets(BitSet **sets, int num_blocks)
+{
+    if (sets == NULL)
+        return;
+    for (int b = 0; b < num_blocks; b++)
+        bitset_destruir(sets[b]);
+    free(sets);
+}
+
+void free_cfg(ControlFlowGraph *cfg)
+{
+    if (cfg == NULL)
+        return;
+
+    for (int b = 0; b < cfg->num_blocks; b++)
+        free(cfg->blocks[b].pred);
+    free(cfg->blocks);
+    free(cfg->block_of);
+    free(cfg->def);
+    free(cfg->use1);
+    free(cfg->use2);
+    free(cfg->label_block);
+    destroy_name_table(cfg->vars);
+    destroy_name_table(cfg->labels);
+    free(cfg);
+}
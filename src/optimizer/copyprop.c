@@ -0,0 +1,447 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "bitset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Propagación de copias guiada por el flujo de control.
+ *
+ * Una copia es un cuádruplo "ASSIGN y -> x" donde y es una variable o un
+ * literal numérico. Solo las copias cuyo destino es un nombre global (ver
+ * find_global_names) ocupan un bit en los conjuntos de flujo de datos; las
+ * demás se siguen dentro del bloque durante la reescritura.
+ */
+
+static int is_copy(const Quadruple *q)
+{
+    if (q->op != IR_ASSIGN || q->arg1 == NULL || !is_valid_varname(q->result))
+        return 0;
+    // Solo literales enteros: el backend aún no materializa constantes flotantes
+    if (!is_valid_varname(q->arg1) && !(es_literal(q->arg1) && get_ir_type(q->arg1) == INT))
+        return 0;
+    if (strcmp(q->arg1, q->result) == 0)
+        return 0;
+    return same_value_class(get_ir_type(q->arg1), get_ir_type(q->result));
+}
+
+/*
+ * Convierte "op a, b -> tN; ASSIGN tN -> x" en "op a, b -> x" cuando tN se
+ * define y se usa exactamente una vez. Es el patrón que deja cada asignación
+ * del programa fuente.
+ */
+static int forward_substitute()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+
+    int *uses = calloc(num_vars + 1, sizeof(int));
+    int *defs = calloc(num_vars + 1, sizeof(int));
+    if (!uses || !defs)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para la propagación de copias.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        if (cfg->use1[i] != -1)
+            uses[cfg->use1[i]]++;
+        if (cfg->use2[i] != -1)
+            uses[cfg->use2[i]]++;
+        if (cfg->def[i] != -1)
+            defs[cfg->def[i]]++;
+    }
+
+    int removed = 0;
+    for (int i = 0; i + 1 < size; i++)
+    {
+        Quadruple *q = &code[i];
+        Quadruple *next = &code[i + 1];
+        int t = cfg->def[i];
+
+        if (t == -1 || q->op == IR_READ || next->op != IR_ASSIGN)
+            continue;
+        if (cfg->use1[i + 1] != t || cfg->def[i + 1] == -1)
+            continue;
+        if (uses[t] != 1 || defs[t] != 1)
+            continue;
+        if (!same_value_class(get_ir_type(q->result), get_ir_type(next->result)))
+            continue;
+
+        free(q->result);
+        q->result = next->result;
+        next->result = NULL;
+        remove_quad(next);
+        removed++;
+        i++;
+    }
+
+    free(uses);
+    free(defs);
+    free_cfg(cfg);
+
+    if (removed > 0)
+        compact_ir_code();
+    return removed;
+}
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+
+    int num_copies;
+    int *copy_quad;        // cuádruplo de cada copia global
+    int *copy_dst;         // id de la variable destino
+    int *copy_src;         // id de la variable fuente, -1 si es un literal
+    char **copy_src_name;  // fuente original; el cuádruplo puede reescribirse después
+    int *copy_of_quad;     // copia global definida por cada cuádruplo, -1 si ninguna
+
+    int *kill_start;       // copias que mencionan a cada variable, en formato CSR
+    int *kill_list;
+
+    BitSet **in;
+    BitSet **out;
+    BitSet **gen;
+    BitSet **kill;
+} CopyState;
+
+static void find_copies(CopyState *st, const int *global_index)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    int num_vars = cfg->vars->count;
+
+    st->copy_of_quad = xcalloc(cfg->size * sizeof(int));
+    st->num_copies = 0;
+    for (int i = 0; i < cfg->size; i++)
+    {
+        st->copy_of_quad[i] = -1;
+        if (is_copy(&cfg->code[i]) && global_index[cfg->def[i]] != -1)
+            st->copy_of_quad[i] = st->num_copies++;
+    }
+
+    st->copy_quad = xcalloc(st->num_copies * sizeof(int));
+    st->copy_dst = xcalloc(st->num_copies * sizeof(int));
+    st->copy_src = xcalloc(st->num_copies * sizeof(int));
+    st->copy_src_name = xcalloc(st->num_copies * sizeof(char *));
+    st->kill_start = calloc(num_vars + 1, sizeof(int));
+    if (st->kill_start == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para la propagación de copias.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < cfg->size; i++)
+    {
+        int c = st->copy_of_quad[i];
+        if (c == -1)
+            continue;
+        st->copy_quad[c] = i;
+        st->copy_dst[c] = cfg->def[i];
+        st->copy_src[c] = cfg->use1[i];
+        st->copy_src_name[c] = xstrdup(cfg->code[i].arg1);
+
+        st->kill_start[st->copy_dst[c] + 1]++;
+        if (st->copy_src[c] != -1)
+            st->kill_start[st->copy_src[c] + 1]++;
+    }
+
+    for (int v = 0; v < num_vars; v++)
+        st->kill_start[v + 1] += st->kill_start[v];
+
+    int *fill = xcalloc((num_vars + 1) * sizeof(int));
+    memcpy(fill, st->kill_start, (num_vars + 1) * sizeof(int));
+    st->kill_list = xcalloc(st->kill_start[num_vars] * sizeof(int));
+    for (int c = 0; c < st->num_copies; c++)
+    {
+        st->kill_list[fill[st->copy_dst[c]]++] = c;
+        if (st->copy_src[c] != -1)
+            st->kill_list[fill[st->copy_src[c]]++] = c;
+    }
+    free(fill);
+}
+
+static void compute_local_sets(CopyState *st)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    int num_vars = cfg->vars->count;
+    int *defined_in = xcalloc((num_vars + 1) * sizeof(int));
+    int *defined_later = xcalloc((num_vars + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+        defined_in[v] = defined_later[v] = -1;
+
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        BasicBlock *bb = &cfg->blocks[b];
+        st->gen[b] = bitset_crear(st->num_copies);
+        st->kill[b] = bitset_crear(st->num_copies);
+
+        for (int i = bb->start; i < bb->end; i++)
+        {
+            int d = cfg->def[i];
+            if (d == -1 || defined_in[d] == b)
+                continue;
+            defined_in[d] = b;
+            for (int k = st->kill_start[d]; k < st->kill_start[d + 1]; k++)
+                bitset_agregar(st->kill[b], st->kill_list[k]);
+        }
+
+        // Una copia se genera si ni su destino ni su fuente se redefinen después en el bloque
+        for (int i = bb->end - 1; i >= bb->start; i--)
+        {
+            int c = st->copy_of_quad[i];
+            if (c != -1 && defined_later[st->copy_dst[c]] != b &&
+                (st->copy_src[c] == -1 || defined_later[st->copy_src[c]] != b))
+                bitset_agregar(st->gen[b], c);
+            if (cfg->def[i] != -1)
+                defined_later[cfg->def[i]] = b;
+        }
+    }
+
+    free(defined_in);
+    free(defined_later);
+}
+
+static void compute_in(CopyState *st, const char *reachable, int b, BitSet *in)
+{
+    BasicBlock *bb = &st->cfg->blocks[b];
+
+    // A la entrada del programa no hay copias disponibles, aunque tenga predecesores
+    if (b == 0)
+    {
+        bitset_vaciar(in);
+        return;
+    }
+
+    bitset_llenar(in);
+    for (int p = 0; p < bb->num_pred; p++)
+    {
+        if (reachable[bb->pred[p]])
+            bitset_intersectar(in, st->out[bb->pred[p]]);
+    }
+}
+
+static void solve_available_copies(CopyState *st, const int *order, int num_reachable, const char *reachable)
+{
+    BitSet *scratch = bitset_crear(st->num_copies);
+    int changed = 1;
+
+    // Análisis de intersección: se parte de "todas disponibles" y se itera en RPO
+    while (changed)
+    {
+        changed = 0;
+        for (int k = 0; k < num_reachable; k++)
+        {
+            int b = order[k];
+            compute_in(st, reachable, b, st->in[b]);
+            bitset_copiar(scratch, st->in[b]);
+            bitset_restar(scratch, st->kill[b]);
+            bitset_unir(scratch, st->gen[b]);
+            if (!bitset_iguales(scratch, st->out[b]))
+            {
+                bitset_copiar(st->out[b], scratch);
+                changed = 1;
+            }
+        }
+    }
+
+    bitset_destruir(scratch);
+}
+
+typedef struct
+{
+    int walk;
+    int *def_stamp;     // marca de las variables definidas en el recorrido actual
+    int *def_pos;       // posición de su última definición
+    int *global_stamp;  // marca de las variables con una copia global disponible
+    int *global_copy;
+    int *local_stamp;   // marca de las variables cuya última definición fue una copia
+    int *local_quad;
+    int *local_src;
+} RewriteState;
+
+static const char *find_source(CopyState *st, RewriteState *rw, int var)
+{
+    if (rw->local_stamp[var] == rw->walk)
+    {
+        int j = rw->local_quad[var];
+        int src = rw->local_src[var];
+        if (src == -1 || rw->def_stamp[src] != rw->walk || rw->def_pos[src] < j)
+            return st->cfg->code[j].arg1;
+        return NULL;
+    }
+    if (rw->global_stamp[var] == rw->walk)
+    {
+        int c = rw->global_copy[var];
+        int src = st->copy_src[c];
+        if (src == -1 || rw->def_stamp[src] != rw->walk)
+            return st->copy_src_name[c];
+    }
+    return NULL;
+}
+
+static int rewrite_operand(CopyState *st, RewriteState *rw, int var, char **operand)
+{
+    if (var == -1)
+        return 0;
+    const char *src = find_source(st, rw, var);
+    if (src == NULL)
+        return 0;
+
+    char *replacement = xstrdup(src);
+    free(*operand);
+    *operand = replacement;
+    return 1;
+}
+
+static int rewrite_block(CopyState *st, RewriteState *rw, int b, const BitSet *in)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    BasicBlock *bb = &cfg->blocks[b];
+    int rewritten = 0;
+
+    rw->walk++;
+    for (int c = bitset_siguiente(in, 0); c != -1; c = bitset_siguiente(in, c + 1))
+    {
+        rw->global_stamp[st->copy_dst[c]] = rw->walk;
+        rw->global_copy[st->copy_dst[c]] = c;
+    }
+
+    for (int i = bb->start; i < bb->end; i++)
+    {
+        Quadruple *q = &cfg->code[i];
+        rewritten += rewrite_operand(st, rw, cfg->use1[i], &q->arg1);
+        rewritten += rewrite_operand(st, rw, cfg->use2[i], &q->arg2);
+
+        int d = cfg->def[i];
+        if (d == -1)
+            continue;
+
+        // "ASSIGN x -> x" puede aparecer tras reescribir; no cambia nada
+        if (q->op == IR_ASSIGN && q->arg1 && strcmp(q->arg1, q->result) == 0)
+        {
+            remove_quad(q);
+            rewritten++;
+            continue;
+        }
+
+        rw->def_stamp[d] = rw->walk;
+        rw->def_pos[d] = i;
+        rw->global_stamp[d] = -1;
+        rw->local_stamp[d] = -1;
+        if (is_copy(q))
+        {
+            rw->local_stamp[d] = rw->walk;
+            rw->local_quad[d] = i;
+            rw->local_src[d] = is_valid_varname(q->arg1) ? lookup_name(cfg->vars, q->arg1) : -1;
+        }
+    }
+    return rewritten;
+}
+
+static int propagate_available_copies()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+    int num_blocks = cfg->num_blocks;
+
+    CopyState st;
+    st.cfg = cfg;
+    int *global_index = xcalloc((num_vars + 1) * sizeof(int));
+    find_global_names(cfg, global_index);
+    find_copies(&st, global_index);
+    free(global_index);
+
+    st.in = xcalloc(num_blocks * sizeof(BitSet *));
+    st.out = xcalloc(num_blocks * sizeof(BitSet *));
+    st.gen = xcalloc(num_blocks * sizeof(BitSet *));
+    st.kill = xcalloc(num_blocks * sizeof(BitSet *));
+    for (int b = 0; b < num_blocks; b++)
+    {
+        st.in[b] = bitset_crear(st.num_copies);
+        st.out[b] = bitset_crear(st.num_copies);
+        bitset_llenar(st.out[b]);
+    }
+    compute_local_sets(&st);
+
+    int *order = xcalloc(num_blocks * sizeof(int));
+    char *reachable = calloc(num_blocks, 1);
+    if (reachable == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para la propagación de copias.\n");
+        exit(EXIT_FAILURE);
+    }
+    int num_reachable = compute_rpo(cfg, order);
+    for (int k = 0; k < num_reachable; k++)
+        reachable[order[k]] = 1;
+
+    solve_available_copies(&st, order, num_reachable, reachable);
+
+    RewriteState rw;
+    rw.walk = 0;
+    rw.def_stamp = xcalloc((num_vars + 1) * sizeof(int));
+    rw.def_pos = xcalloc((num_vars + 1) * sizeof(int));
+    rw.global_stamp = xcalloc((num_vars + 1) * sizeof(int));
+    rw.global_copy = xcalloc((num_vars + 1) * sizeof(int));
+    rw.local_stamp = xcalloc((num_vars + 1) * sizeof(int));
+    rw.local_quad = xcalloc((num_vars + 1) * sizeof(int));
+    rw.local_src = xcalloc((num_vars + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+        rw.def_stamp[v] = rw.global_stamp[v] = rw.local_stamp[v] = -1;
+
+    // Los bloques inalcanzables no reciben copias globales
+    BitSet *empty = bitset_crear(st.num_copies);
+    int rewritten = 0;
+    for (int b = 0; b < num_blocks; b++)
+        rewritten += rewrite_block(&st, &rw, b, reachable[b] ? st.in[b] : empty);
+    bitset_destruir(empty);
+
+    free(rw.def_stamp);
+    free(rw.def_pos);
+    free(rw.global_stamp);
+    free(rw.global_copy);
+    free(rw.local_stamp);
+    free(rw.local_quad);
+    free(rw.local_src);
+    free(order);
+    free(reachable);
+    for (int b = 0; b < num_blocks; b++)
+    {
+        bitset_destruir(st.in[b]);
+        bitset_destruir(st.out[b]);
+        bitset_destruir(st.gen[b]);
+        bitset_destruir(st.kill[b]);
+    }
+    free(st.in);
+    free(st.out);
+    free(st.gen);
+    free(st.kill);
+    for (int c = 0; c < st.num_copies; c++)
+        free(st.copy_src_name[c]);
+    free(st.copy_src_name);
+    free(st.copy_quad);
+    free(st.copy_dst);
+    free(st.copy_src);
+    free(st.copy_of_quad);
+    free(st.kill_start);
+    free(st.kill_list);
+    free_cfg(cfg);
+
+    compact_ir_code();
+    return rewritten;
+}
+
+int propagate_copies()
+{
+    if (get_ir_code_size() == 0)
+        return 0;
+
+    int changes = forward_substitute();
+    changes += propagate_available_copies();
+    return changes;
+}
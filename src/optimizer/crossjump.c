@@ -0,0 +1,152 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Cross-jumping (solo en -Os).
+ *
+ * Cuando varios caminos terminan con la misma secuencia de cuádruplos y luego
+ * continúan en la misma etiqueta, basta con una copia de la secuencia: los
+ * demás caminos saltan al inicio de esa copia. La copia que se conserva es la
+ * que llega a la etiqueta sin salto (si existe) o la del primer GOTO.
+ *
+ * Como todas las variables viven en memoria, ejecutar la copia conservada
+ * equivale exactamente a ejecutar la eliminada. Se ejecuta al final porque
+ * una etiqueta a la mitad de un bloque impediría a las demás pasadas tratarlo
+ * como línea recta.
+ */
+
+static int same_string(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return strcmp(a, b) == 0;
+}
+
+/* Cuádruplo que puede formar parte de una secuencia compartida: no cruza fronteras de bloque. */
+static int mergeable(const Quadruple *q)
+{
+    if (q->op == IR_REMOVED)
+        return 0;
+    switch (q->op)
+    {
+    case IR_LABEL:
+    case IR_GOTO:
+    case IR_IF_FALSE_GOTO:
+    case IR_IF_TRUE_GOTO:
+    case IR_HALT:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+static int same_quad(const Quadruple *a, const Quadruple *b)
+{
+    return a->op == b->op && same_string(a->arg1, b->arg1) && same_string(a->arg2, b->arg2) &&
+           same_string(a->result, b->result);
+}
+
+int merge_identical_tails()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    // Posición de cada etiqueta y fin de la secuencia que se conserva para ella
+    NameTable *labels = create_name_table(64);
+    int capacity = 64;
+    int *label_pos = xcalloc(capacity * sizeof(int));
+    for (int i = 0; i < size; i++)
+    {
+        if (code[i].op != IR_LABEL)
+            continue;
+        int id = intern_name(labels, code[i].result);
+        if (id >= capacity)
+        {
+            capacity *= 2;
+            label_pos = realloc(label_pos, capacity * sizeof(int));
+            if (label_pos == NULL)
+            {
+                fprintf(stderr, "Error: No se pudo asignar memoria para unir secuencias repetidas.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        label_pos[id] = i;
+    }
+
+    int *kept_end = xcalloc((labels->count + 1) * sizeof(int));
+    for (int id = 0; id < labels->count; id++)
+    {
+        int l = label_pos[id];
+        kept_end[id] = l > 0 && mergeable(&code[l - 1]) ? l - 1 : -1;
+    }
+
+    PendingQuads pending = {NULL, 0, 0}; // etiquetas nuevas
+    int changes = 0;
+
+    for (int g = 0; g < size; g++)
+    {
+        Quadruple *jump = &code[g];
+        if (jump->op != IR_GOTO)
+            continue;
+        int id = lookup_name(labels, jump->result);
+        if (id == -1)
+            continue;
+        if (kept_end[id] == -1)
+        {
+            // Sin secuencia que caiga en la etiqueta se conserva la del primer GOTO
+            if (g > 0 && mergeable(&code[g - 1]))
+                kept_end[id] = g - 1;
+            continue;
+        }
+
+        int keep = kept_end[id];
+        int length = 0;
+        while (g - 1 - length >= 0 && keep - length >= 0 && mergeable(&code[g - 1 - length]) &&
+               mergeable(&code[keep - length]) && same_quad(&code[g - 1 - length], &code[keep - length]))
+            length++;
+        if (length == 0)
+            continue;
+
+        // Etiqueta al inicio de la copia conservada: una existente o una nueva
+        int start = keep - length + 1;
+        const char *target = NULL;
+        if (start > 0 && code[start - 1].op == IR_LABEL)
+            target = code[start - 1].result;
+        for (int k = 0; k < pending.count && target == NULL; k++)
+        {
+            if (pending.quads[k].position == start)
+                target = pending.quads[k].quad.result;
+        }
+        if (target == NULL)
+        {
+            char *label = new_label();
+            add_pending_quad(&pending, start, 0, IR_LABEL, NULL, NULL, label, &code[start]);
+            free(label);
+            target = pending.quads[pending.count - 1].quad.result;
+        }
+
+        emit_remark("crossjump", REMARK_APPLIED, &code[g - length],
+                    "%d cuádruplo(s) iguales a los que preceden a %s se reemplazan por un salto a %s", length,
+                    jump->result, target);
+        for (int k = 1; k <= length; k++)
+            remove_quad(&code[g - k]);
+        char *new_target = xstrdup(target);
+        free(jump->result);
+        jump->result = new_target;
+        changes += length;
+    }
+
+    if (changes > 0)
+        splice_pending_quads(&pending);
+    free_pending_quads(&pending);
+    free(kept_end);
+    free(label_pos);
+    destroy_name_table(labels);
+    return changes;
+}
@@ -0,0 +1,201 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "bitset.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Eliminación de código muerto basada en vida fuerte de variables.
+ *
+ * Solo los nombres globales (ver find_global_names) ocupan un bit en los
+ * conjuntos de flujo de datos. Los temporales que nacen y mueren dentro de un
+ * bloque, que son la gran mayoría, se siguen con un arreglo de marcas durante
+ * el recorrido del bloque.
+ */
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    int *global_index;   // índice en los BitSet de cada variable, -1 si es local a un bloque
+    int *local_live;     // marca de vida de las variables locales
+    int walk;            // marca del recorrido actual
+} LivenessState;
+
+static int is_live(LivenessState *st, BitSet *live, int var)
+{
+    int g = st->global_index[var];
+    return g != -1 ? bitset_contiene(live, g) : st->local_live[var] == st->walk;
+}
+
+static void set_live(LivenessState *st, BitSet *live, int var)
+{
+    if (var == -1)
+        return;
+    int g = st->global_index[var];
+    if (g != -1)
+        bitset_agregar(live, g);
+    else
+        st->local_live[var] = st->walk;
+}
+
+static void kill(LivenessState *st, BitSet *live, int var)
+{
+    int g = st->global_index[var];
+    if (g != -1)
+        bitset_quitar(live, g);
+    else
+        st->local_live[var] = -1;
+}
+
+/*
+ * Recorre el bloque hacia atrás partiendo de live (vivas a la salida) y deja en
+ * live las variables vivas a la entrada. Si remove es distinto de cero marca
+ * como eliminados los cuádruplos puros cuyo resultado está muerto.
+ */
+static int transfer_block(LivenessState *st, int b, BitSet *live, int remove)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    BasicBlock *bb = &cfg->blocks[b];
+    int removed = 0;
+
+    st->walk++;
+    for (int i = bb->end - 1; i >= bb->start; i--)
+    {
+        Quadruple *q = &cfg->code[i];
+        int d = cfg->def[i];
+
+        if (d != -1)
+        {
+            if (!is_live(st, live, d) && quad_is_pure(q))
+            {
+                if (remove)
+                {
+                    emit_remark("dce", REMARK_APPLIED, q, "se elimina el cálculo de '%s': su valor nunca se usa", q->result);
+                    free(q->arg1);
+                    free(q->arg2);
+                    free(q->result);
+                    q->arg1 = q->arg2 = q->result = NULL;
+                    q->op = IR_REMOVED;
+                    removed++;
+                }
+                continue;
+            }
+            if (!is_live(st, live, d) && (q->op == IR_DIV || q->op == IR_MOD || q->op == IR_UDIV || q->op == IR_UMOD))
+            {
+                // La división puede fallar y debe conservarse, pero nadie lee
+                // su resultado: se quita solo el almacenamiento
+                if (remove)
+                {
+                    emit_remark("dce", REMARK_MISSED, q,
+                                "la división que calcula '%s' no se elimina: el divisor %s puede ser cero; solo se quita el almacenamiento",
+                                q->result, q->arg2);
+                    free(q->result);
+                    q->result = NULL;
+                    removed++;
+                }
+            }
+            kill(st, live, d);
+        }
+
+        set_live(st, live, cfg->use1[i]);
+        set_live(st, live, cfg->use2[i]);
+    }
+    return removed;
+}
+
+static void compute_live_out(ControlFlowGraph *cfg, BitSet **live_in, int b, BitSet *out)
+{
+    bitset_vaciar(out);
+    for (int s = 0; s < cfg->blocks[b].num_succ; s++)
+        bitset_unir(out, live_in[cfg->blocks[b].succ[s]]);
+}
+
+int eliminate_dead_code()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+
+    LivenessState st;
+    st.cfg = cfg;
+    st.walk = 0;
+    st.global_index = malloc((num_vars + 1) * sizeof(int));
+    st.local_live = malloc((num_vars + 1) * sizeof(int));
+    if (!st.global_index || !st.local_live)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el análisis de vida.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int v = 0; v < num_vars; v++)
+        st.local_live[v] = -1;
+    int num_globals = find_global_names(cfg, st.global_index);
+
+    BitSet **live_in = malloc(cfg->num_blocks * sizeof(BitSet *));
+    int *worklist = malloc(cfg->num_blocks * sizeof(int));
+    char *in_worklist = malloc(cfg->num_blocks);
+    if (!live_in || !worklist || !in_worklist)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el análisis de vida.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Se apilan en orden de programa para procesarlos de atrás hacia adelante
+    int top = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        live_in[b] = bitset_crear(num_globals);
+        worklist[top++] = b;
+        in_worklist[b] = 1;
+    }
+
+    BitSet *scratch = bitset_crear(num_globals);
+    while (top > 0)
+    {
+        int b = worklist[--top];
+        in_worklist[b] = 0;
+
+        compute_live_out(cfg, live_in, b, scratch);
+        transfer_block(&st, b, scratch, 0);
+
+        if (!bitset_iguales(scratch, live_in[b]))
+        {
+            bitset_copiar(live_in[b], scratch);
+            for (int p = 0; p < cfg->blocks[b].num_pred; p++)
+            {
+                int pred = cfg->blocks[b].pred[p];
+                if (!in_worklist[pred])
+                {
+                    worklist[top++] = pred;
+                    in_worklist[pred] = 1;
+                }
+            }
+        }
+    }
+
+    int removed = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        compute_live_out(cfg, live_in, b, scratch);
+        removed += transfer_block(&st, b, scratch, 1);
+    }
+
+    bitset_destruir(scratch);
+    for (int b = 0; b < cfg->num_blocks; b++)
+        bitset_destruir(live_in[b]);
+    free(live_in);
+    free(worklist);
+    free(in_worklist);
+    free(st.global_index);
+    free(st.local_live);
+    free_cfg(cfg);
+
+    if (removed > 0)
+        compact_ir_code();
+    return removed;
+}
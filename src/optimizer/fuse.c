@@ -0,0 +1,378 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Fusión de ciclos vecinos.
+ *
+ * Dos ciclos con la forma de Para o Mientras (un encabezado con la prueba de
+ * salida, un cuerpo contiguo y un GOTO de regreso al final) se fusionan si
+ * aparecen uno detrás del otro:
+ *
+ *     HA: prueba a; IF_FALSE_GOTO t, XA; cuerpo A; GOTO HA
+ *     XA: b = y ...
+ *     HB: prueba b; IF_FALSE_GOTO u, XB; cuerpo B; GOTO HB
+ *     XB:
+ *
+ * y recorren el mismo espacio de iteración: la misma comparación contra el
+ * mismo límite invariante, el mismo paso y el mismo valor inicial. Entre
+ * ellos solo puede haber cuádruplos sin efectos (la inicialización de b y lo
+ * que LICM sacó del segundo ciclo), que pasan delante del primero. El
+ * resultado ejecuta en cada vuelta el cuerpo de A y luego el de B:
+ *
+ *     b = y ...
+ *     HA: prueba a; IF_FALSE_GOTO t, XB; cuerpo A; cuerpo B; GOTO HA
+ *     XB:
+ *
+ * Si a y b son la misma variable, el incremento de A se quita y queda el de
+ * B al final de la vuelta. La fusión cambia el orden entre las vueltas de
+ * los dos cuerpos, así que solo se hace si ninguna variable que escribe uno
+ * la lee o escribe el otro, y si a lo más uno de los dos tiene efectos
+ * (Mostrar, Leer o una división que puede fallar). Los cuerpos no pueden
+ * saltar fuera de sí mismos (Romper, o Continuar en Mientras).
+ *
+ * Cada ejecución fusiona pares disjuntos; el punto fijo sigue con el ciclo
+ * fusionado y el que le sigue.
+ */
+
+typedef struct
+{
+    int header;     // primer cuádruplo (LABEL) del encabezado
+    int end;        // uno después del GOTO de regreso
+    int iv;         // variable de inducción
+    IROperation op; // iv op bound
+    const char *bound;
+    long long step;
+    int increment;  // el cuádruplo que avanza iv
+} LoopShape;
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    const int *global_index;
+    const int *label_refs;  // saltos que llegan a cada etiqueta
+    const int *label_ref_at; // el último de esos saltos
+    int *body_refs;         // saltos del cuerpo analizado a cada etiqueta
+    int *def_count;         // definiciones de cada variable en el tramo analizado
+    int *def_at;
+    char *reads_a;          // variables que lee el primer ciclo
+    char *writes_a;         // variables que escribe el primer ciclo
+    char *reads_b;
+    char *writes_b;
+} FuseContext;
+
+/* Un cuádruplo con efectos observables: E/S o una operación que puede fallar. */
+static int has_effect(const Quadruple *q)
+{
+    return q->op != IR_LABEL && !is_jump(q->op) && !quad_is_pure(q);
+}
+
+/*
+ * Reconoce el ciclo que empieza en el cuádruplo start: encabezado de tres
+ * cuádruplos, cuerpo que no salta fuera de sí mismo y GOTO de regreso al
+ * final, con una sola definición de la variable de inducción en el ciclo.
+ */
+static int match_loop(FuseContext *ctx, int start, LoopShape *shape)
+{
+    ControlFlowGraph *cfg = ctx->cfg;
+    Quadruple *code = cfg->code;
+    if (start + 3 >= cfg->size || code[start].op != IR_LABEL)
+        return 0;
+    Quadruple *test = &code[start + 1];
+    Quadruple *branch = &code[start + 2];
+    if (test->op != IR_LT && test->op != IR_LE && test->op != IR_GT && test->op != IR_GE)
+        return 0;
+    if (branch->op != IR_IF_FALSE_GOTO || strcmp(branch->arg1, test->result) != 0)
+        return 0;
+    int t = cfg->def[start + 1];
+    if (t == -1 || ctx->global_index[t] != -1)
+        return 0;
+
+    // El GOTO de regreso es el único salto a la etiqueta del encabezado
+    int header_label = lookup_name(cfg->labels, code[start].result);
+    if (ctx->label_refs[header_label] != 1)
+        return 0;
+    int back_edge = ctx->label_ref_at[header_label];
+    if (back_edge <= start + 2 || code[back_edge].op != IR_GOTO)
+        return 0;
+    int end = back_edge + 1;
+
+    // Los saltos del cuerpo se quedan en el cuerpo y nadie de fuera salta a él
+    int inside = 1;
+    for (int i = start + 3; i < end - 1; i++)
+    {
+        if (!is_jump(code[i].op))
+            continue;
+        int id = lookup_name(cfg->labels, code[i].result);
+        int at = cfg->blocks[cfg->label_block[id]].start;
+        if (at <= start + 2 || at >= end - 1)
+            inside = 0;
+        ctx->body_refs[id]++;
+    }
+    for (int i = start + 3; i < end - 1; i++)
+    {
+        if (code[i].op != IR_LABEL)
+            continue;
+        int id = lookup_name(cfg->labels, code[i].result);
+        if (ctx->body_refs[id] != ctx->label_refs[id])
+            inside = 0;
+    }
+    for (int i = start + 3; i < end - 1; i++)
+    {
+        if (is_jump(code[i].op))
+            ctx->body_refs[lookup_name(cfg->labels, code[i].result)] = 0;
+    }
+    if (!inside)
+        return 0;
+
+    IROperation op;
+    int iv;
+    const char *bound;
+    long long step;
+    if (!match_counted_test(cfg, start, end, ctx->def_count, ctx->def_at, &iv, &bound, &op, &step))
+        return 0;
+
+    shape->header = start;
+    shape->end = end;
+    shape->iv = iv;
+    shape->op = op;
+    shape->bound = bound;
+    shape->step = step;
+    shape->increment = ctx->def_at[iv];
+    return 1;
+}
+
+/*
+ * Marca lo que lee y escribe el ciclo [start, end) y devuelve si tiene
+ * efectos. Un ciclo interno cuenta como efecto: si no terminara, la fusión
+ * adelantaría ese cuelgue a las salidas del otro ciclo.
+ */
+static int collect_accesses(FuseContext *ctx, int start, int end, char *reads, char *writes)
+{
+    ControlFlowGraph *cfg = ctx->cfg;
+    int effects = 0;
+    memset(reads, 0, cfg->vars->count + 1);
+    memset(writes, 0, cfg->vars->count + 1);
+    for (int i = start; i < end; i++)
+    {
+        if (cfg->use1[i] != -1)
+            reads[cfg->use1[i]] = 1;
+        if (cfg->use2[i] != -1)
+            reads[cfg->use2[i]] = 1;
+        if (cfg->def[i] != -1)
+            writes[cfg->def[i]] = 1;
+        effects |= has_effect(&cfg->code[i]);
+        if (i > start && i < end - 1 && is_jump(cfg->code[i].op))
+        {
+            int id = lookup_name(cfg->labels, cfg->code[i].result);
+            if (cfg->blocks[cfg->label_block[id]].start <= i)
+                effects = 1;
+        }
+    }
+    return effects;
+}
+
+/*
+ * Fusiona el ciclo a con el que empieza después de su salida si se puede;
+ * los cuádruplos que pasan delante de a quedan en pending. Devuelve el fin
+ * del segundo ciclo si se fusionaron, -1 si no.
+ */
+static int try_fuse(FuseContext *ctx, const LoopShape *a, PendingQuads *pending)
+{
+    ControlFlowGraph *cfg = ctx->cfg;
+    Quadruple *code = cfg->code;
+    const char *exit_a = code[a->header + 2].result;
+    if (a->end >= cfg->size || code[a->end].op != IR_LABEL || strcmp(code[a->end].result, exit_a) != 0)
+        return -1;
+    if (ctx->label_refs[lookup_name(cfg->labels, exit_a)] != 1)
+        return -1;
+    const char *init = loop_entry_value(cfg, a->header, a->iv);
+    if (init == NULL)
+        return -1;
+
+    // Entre los dos ciclos solo hay cuádruplos sin efectos ni saltos
+    int gap_start = a->end + 1;
+    int gap_end = gap_start;
+    while (gap_end < cfg->size && code[gap_end].op != IR_LABEL)
+    {
+        if (is_jump(code[gap_end].op) || code[gap_end].op == IR_HALT || has_effect(&code[gap_end]))
+            return -1;
+        gap_end++;
+    }
+    LoopShape b;
+    if (!match_loop(ctx, gap_end, &b))
+        return -1;
+    if (b.op != a->op || b.step != a->step || strcmp(b.bound, a->bound) != 0)
+        return -1;
+    // Con una sola variable de inducción, el incremento de B queda como el de las dos
+    if (a->iv == b.iv && (a->increment != a->end - 2 || b.increment != b.end - 2))
+        return -1;
+
+    int effects_a = collect_accesses(ctx, a->header, a->end, ctx->reads_a, ctx->writes_a);
+    int effects_b = collect_accesses(ctx, b.header, b.end, ctx->reads_b, ctx->writes_b);
+    if (effects_a && effects_b)
+    {
+        emit_remark("fuse", REMARK_MISSED, &code[b.header + 1],
+                    "los ciclos de %s y %s no se fusionan: los dos tienen efectos que cambiarían de orden",
+                    code[a->header].result, code[b.header].result);
+        return -1;
+    }
+
+    // El segundo ciclo empieza igual: su variable recibe el mismo valor inicial en el tramo intermedio
+    const char *init_b = NULL;
+    for (int i = gap_start; i < gap_end; i++)
+    {
+        if (cfg->def[i] == b.iv)
+            init_b = code[i].op == IR_ASSIGN ? code[i].arg1 : NULL;
+    }
+    if (init_b == NULL || strcmp(init_b, init) != 0)
+        return -1;
+    int init_var = lookup_name(cfg->vars, init);
+    int bound_var = lookup_name(cfg->vars, a->bound);
+    for (int i = gap_start; i < gap_end; i++)
+    {
+        int d = cfg->def[i];
+        if (d != -1 && d != b.iv && (d == init_var || d == bound_var))
+            return -1;
+    }
+    if ((init_var != -1 && ctx->writes_a[init_var]) || (bound_var != -1 && ctx->writes_b[bound_var]))
+        return -1;
+
+    // Ninguna variable que escribe un ciclo la usa el otro, salvo la de inducción compartida
+    for (int v = 0; v < cfg->vars->count; v++)
+    {
+        if (ctx->global_index[v] == -1 || (v == a->iv && v == b.iv))
+            continue;
+        if ((ctx->writes_a[v] && (ctx->reads_b[v] || ctx->writes_b[v])) || (ctx->writes_b[v] && ctx->reads_a[v]))
+        {
+            emit_remark("fuse", REMARK_MISSED, &code[b.header + 1],
+                        "los ciclos de %s y %s no se fusionan: '%s' pasa de uno al otro", code[a->header].result,
+                        code[b.header].result, cfg->vars->names[v]);
+            return -1;
+        }
+    }
+
+    // El tramo intermedio pasa delante del primer ciclo, así que no puede tocar lo que este usa
+    for (int i = gap_start; i < gap_end; i++)
+    {
+        int d = cfg->def[i];
+        if (d != -1 && (ctx->reads_a[d] || ctx->writes_a[d]) && !(d == a->iv && d == b.iv))
+            return -1;
+        if ((cfg->use1[i] != -1 && ctx->writes_a[cfg->use1[i]]) ||
+            (cfg->use2[i] != -1 && ctx->writes_a[cfg->use2[i]]))
+            return -1;
+    }
+
+    emit_remark("fuse", REMARK_APPLIED, &code[b.header + 1],
+                "el ciclo de %s se fusiona con el de %s: recorren las mismas vueltas", code[b.header].result,
+                code[a->header].result);
+
+    // b = y y los invariantes del segundo ciclo pasan al preencabezado del primero
+    for (int i = gap_start; i < gap_end; i++)
+    {
+        if (a->iv == b.iv && cfg->def[i] == b.iv)
+            remove_quad(&code[i]);
+        else
+        {
+            Quadruple *q = &code[i];
+            add_pending_quad(pending, a->header, 0, q->op, q->arg1, q->arg2, q->result, q);
+            remove_quad(q);
+        }
+    }
+
+    // Una sola prueba, que ahora sale después del segundo cuerpo
+    free(code[a->header + 2].result);
+    code[a->header + 2].result = xstrdup(code[b.header + 2].result);
+    if (a->iv == b.iv)
+        remove_quad(&code[a->increment]);
+    remove_quad(&code[a->end - 1]); // GOTO HA
+    remove_quad(&code[a->end]);     // LABEL XA
+    for (int i = b.header; i < b.header + 3; i++)
+        remove_quad(&code[i]);
+    free(code[b.end - 1].result);
+    code[b.end - 1].result = xstrdup(code[a->header].result);
+    return b.end;
+}
+
+int fuse_loops()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+
+    int *global_index = xcalloc((num_vars + 1) * sizeof(int));
+    find_global_names(cfg, global_index);
+
+    int *label_refs = xcalloc((cfg->labels->count + 1) * sizeof(int));
+    int *label_ref_at = xcalloc((cfg->labels->count + 1) * sizeof(int));
+    for (int i = 0; i < size; i++)
+    {
+        if (is_jump(code[i].op))
+        {
+            int id = lookup_name(cfg->labels, code[i].result);
+            if (id != -1)
+            {
+                label_refs[id]++;
+                label_ref_at[id] = i;
+            }
+        }
+    }
+
+    FuseContext ctx;
+    ctx.cfg = cfg;
+    ctx.global_index = global_index;
+    ctx.label_refs = label_refs;
+    ctx.label_ref_at = label_ref_at;
+    ctx.body_refs = xcalloc((cfg->labels->count + 1) * sizeof(int));
+    ctx.def_count = xcalloc((num_vars + 1) * sizeof(int));
+    ctx.def_at = xcalloc((num_vars + 1) * sizeof(int));
+    ctx.reads_a = xcalloc(num_vars + 1);
+    ctx.writes_a = xcalloc(num_vars + 1);
+    ctx.reads_b = xcalloc(num_vars + 1);
+    ctx.writes_b = xcalloc(num_vars + 1);
+
+    // Pares de ciclos vecinos, de arriba hacia abajo y sin traslaparse
+    PendingQuads pending = {NULL, 0, 0};
+    int fused = 0;
+    int i = 0;
+    while (i < size)
+    {
+        LoopShape a;
+        if (code[i].op != IR_LABEL || !match_loop(&ctx, i, &a))
+        {
+            i++;
+            continue;
+        }
+        int next = try_fuse(&ctx, &a, &pending);
+        if (next == -1)
+        {
+            i++;
+            continue;
+        }
+        fused++;
+        i = next;
+    }
+
+    if (fused > 0)
+        splice_pending_quads(&pending);
+    free_pending_quads(&pending);
+    free(ctx.def_count);
+    free(ctx.def_at);
+    free(ctx.reads_a);
+    free(ctx.writes_a);
+    free(ctx.reads_b);
+    free(ctx.writes_b);
+    free(ctx.body_refs);
+    free(label_refs);
+    free(label_ref_at);
+    free(global_index);
+    free_cfg(cfg);
+    return fused;
+}
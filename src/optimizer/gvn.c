@@ -0,0 +1,426 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Numeración de valores sobre el árbol de dominadores.
+ *
+ * Cada variable lleva el número del valor que contiene en el punto actual del
+ * recorrido. Una expresión se identifica por (operación, valor de arg1, valor
+ * de arg2); si ya se calculó en un bloque dominador y la variable que guardó el
+ * resultado todavía contiene ese valor, el cálculo se reemplaza por una copia.
+ *
+ * El IR no está en forma SSA, así que al entrar a un bloque las variables que
+ * pueden escribirse entre su dominador inmediato y él reciben un valor nuevo.
+ * Con eso las redefiniciones (asignaciones, IR_READ) invalidan por sí solas
+ * todas las expresiones que dependían del valor anterior.
+ */
+
+typedef struct
+{
+    IROperation op;
+    int vn1;
+    int vn2;
+    int vn;       // valor calculado
+    int holder;   // variable que lo guardó
+    int next;
+} Expression;
+
+typedef struct
+{
+    int var;
+    int old_vn;
+} VarUndo;
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    int next_vn;
+    int *var_vn;
+
+    NameTable *constants;
+    int *constant_vn;
+    int constant_capacity;
+
+    Expression *exprs;
+    int num_exprs;
+    int expr_capacity;
+    int *buckets;
+    int num_buckets;
+
+    VarUndo *undo;
+    int num_undo;
+    int undo_capacity;
+} ValueTable;
+
+static int is_commutative(IROperation op)
+{
+    return op == IR_ADD || op == IR_MUL || op == IR_EQ || op == IR_NE || op == IR_AND || op == IR_OR ||
+           op == IR_BAND;
+}
+
+static int is_value_op(IROperation op)
+{
+    switch (op)
+    {
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_NEG:
+    case IR_LT:
+    case IR_GT:
+    case IR_LE:
+    case IR_GE:
+    case IR_EQ:
+    case IR_NE:
+    case IR_AND:
+    case IR_OR:
+    case IR_NOT:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
+    case IR_UDIV:
+    case IR_UMOD:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static unsigned int hash_expression(IROperation op, int vn1, int vn2)
+{
+    return ((unsigned int)op * 31u + (unsigned int)vn1) * 1000003u + (unsigned int)vn2;
+}
+
+static void set_var_vn(ValueTable *vt, int var, int vn)
+{
+    if (vt->num_undo >= vt->undo_capacity)
+    {
+        vt->undo_capacity *= 2;
+        vt->undo = realloc(vt->undo, vt->undo_capacity * sizeof(VarUndo));
+        if (vt->undo == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo redimensionar la pila de la numeración de valores.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    vt->undo[vt->num_undo].var = var;
+    vt->undo[vt->num_undo].old_vn = vt->var_vn[var];
+    vt->num_undo++;
+    vt->var_vn[var] = vn;
+}
+
+static int operand_vn(ValueTable *vt, const char *operand, int var)
+{
+    if (operand == NULL)
+        return -1;
+    if (var != -1)
+        return vt->var_vn[var];
+
+    // Las constantes conservan su número durante toda la pasada
+    int id = intern_name(vt->constants, operand);
+    if (id >= vt->constant_capacity)
+    {
+        int old_capacity = vt->constant_capacity;
+        vt->constant_capacity *= 2;
+        vt->constant_vn = realloc(vt->constant_vn, vt->constant_capacity * sizeof(int));
+        if (vt->constant_vn == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo redimensionar la tabla de constantes.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int c = old_capacity; c < vt->constant_capacity; c++)
+            vt->constant_vn[c] = -1;
+    }
+    if (vt->constant_vn[id] == -1)
+        vt->constant_vn[id] = vt->next_vn++;
+    return vt->constant_vn[id];
+}
+
+static int find_expression(ValueTable *vt, IROperation op, int vn1, int vn2)
+{
+    unsigned int bucket = hash_expression(op, vn1, vn2) & (vt->num_buckets - 1);
+    for (int e = vt->buckets[bucket]; e != -1; e = vt->exprs[e].next)
+    {
+        Expression *ex = &vt->exprs[e];
+        if (ex->op == op && ex->vn1 == vn1 && ex->vn2 == vn2 && vt->var_vn[ex->holder] == ex->vn)
+            return e;
+    }
+    return -1;
+}
+
+static void add_expression(ValueTable *vt, IROperation op, int vn1, int vn2, int vn, int holder)
+{
+    if (vt->num_exprs >= vt->expr_capacity)
+    {
+        vt->expr_capacity *= 2;
+        vt->exprs = realloc(vt->exprs, vt->expr_capacity * sizeof(Expression));
+        if (vt->exprs == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo redimensionar la tabla de expresiones.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    unsigned int bucket = hash_expression(op, vn1, vn2) & (vt->num_buckets - 1);
+    Expression *ex = &vt->exprs[vt->num_exprs];
+    ex->op = op;
+    ex->vn1 = vn1;
+    ex->vn2 = vn2;
+    ex->vn = vn;
+    ex->holder = holder;
+    ex->next = vt->buckets[bucket];
+    vt->buckets[bucket] = vt->num_exprs++;
+}
+
+/*
+ * Deshace los cambios hechos desde que la tabla tenía num_exprs expresiones y
+ * num_undo entradas en la pila. Las expresiones se insertan siempre al frente
+ * de su cubeta, así que se retiran en el orden inverso.
+ */
+static void restore_scope(ValueTable *vt, int num_exprs, int num_undo)
+{
+    while (vt->num_exprs > num_exprs)
+    {
+        Expression *ex = &vt->exprs[--vt->num_exprs];
+        unsigned int bucket = hash_expression(ex->op, ex->vn1, ex->vn2) & (vt->num_buckets - 1);
+        vt->buckets[bucket] = ex->next;
+    }
+    while (vt->num_undo > num_undo)
+    {
+        VarUndo *u = &vt->undo[--vt->num_undo];
+        vt->var_vn[u->var] = u->old_vn;
+    }
+}
+
+/*
+ * Da un valor nuevo a cada variable escrita en algún camino desde el dominador
+ * inmediato de b hasta b (sin volver a pasar por el dominador).
+ */
+static void kill_join_definitions(ValueTable *vt, int b, int dom, int *visited, int *stack)
+{
+    ControlFlowGraph *cfg = vt->cfg;
+    int top = 0;
+
+    for (int p = 0; p < cfg->blocks[b].num_pred; p++)
+    {
+        int pred = cfg->blocks[b].pred[p];
+        if (pred != dom && visited[pred] != b)
+        {
+            visited[pred] = b;
+            stack[top++] = pred;
+        }
+    }
+
+    while (top > 0)
+    {
+        int x = stack[--top];
+        for (int i = cfg->blocks[x].start; i < cfg->blocks[x].end; i++)
+        {
+            int d = cfg->def[i];
+            if (d != -1)
+                set_var_vn(vt, d, vt->next_vn++);
+        }
+        for (int p = 0; p < cfg->blocks[x].num_pred; p++)
+        {
+            int pred = cfg->blocks[x].pred[p];
+            if (pred != dom && visited[pred] != b)
+            {
+                visited[pred] = b;
+                stack[top++] = pred;
+            }
+        }
+    }
+}
+
+static int number_block(ValueTable *vt, int b)
+{
+    ControlFlowGraph *cfg = vt->cfg;
+    int replaced = 0;
+
+    for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+    {
+        Quadruple *q = &cfg->code[i];
+        int d = cfg->def[i];
+        if (d == -1)
+            continue;
+
+        // Una copia entre representaciones distintas no conserva el valor
+        if (q->op == IR_ASSIGN && same_value_class(get_ir_type(q->arg1), get_ir_type(q->result)))
+        {
+            set_var_vn(vt, d, operand_vn(vt, q->arg1, cfg->use1[i]));
+            continue;
+        }
+
+        if (!is_value_op(q->op) || get_ir_type(q->result) == STRING)
+        {
+            set_var_vn(vt, d, vt->next_vn++);
+            continue;
+        }
+
+        int vn1 = operand_vn(vt, q->arg1, cfg->use1[i]);
+        int vn2 = operand_vn(vt, q->arg2, cfg->use2[i]);
+        if (is_commutative(q->op) && vn1 > vn2)
+        {
+            int tmp = vn1;
+            vn1 = vn2;
+            vn2 = tmp;
+        }
+
+        int e = find_expression(vt, q->op, vn1, vn2);
+        if (e != -1 && vt->exprs[e].holder != d)
+        {
+            // El valor ya está en una variable: el cálculo se convierte en una copia
+            emit_remark("cse", REMARK_APPLIED, q, "el valor de '%s' ya está calculado en '%s'", q->result,
+                        cfg->vars->names[vt->exprs[e].holder]);
+            free(q->arg1);
+            free(q->arg2);
+            q->op = IR_ASSIGN;
+            q->arg1 = xstrdup(cfg->vars->names[vt->exprs[e].holder]);
+            q->arg2 = NULL;
+            set_var_vn(vt, d, vt->exprs[e].vn);
+            replaced++;
+            continue;
+        }
+
+        int vn = e != -1 ? vt->exprs[e].vn : vt->next_vn++;
+        set_var_vn(vt, d, vn);
+        if (e == -1)
+            add_expression(vt, q->op, vn1, vn2, vn, d);
+    }
+    return replaced;
+}
+
+int eliminate_common_subexpressions()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+    int num_blocks = cfg->num_blocks;
+
+    int *order = xcalloc(num_blocks * sizeof(int));
+    int *idom = xcalloc(num_blocks * sizeof(int));
+    int num_reachable = compute_rpo(cfg, order);
+    compute_dominators(cfg, order, num_reachable, idom);
+
+    // Hijos de cada bloque en el árbol de dominadores, en formato CSR
+    int *child_start = calloc(num_blocks + 1, sizeof(int));
+    int *children = xcalloc(num_blocks * sizeof(int));
+    if (child_start == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para la numeración de valores.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int b = 0; b < num_blocks; b++)
+    {
+        if (idom[b] != -1 && idom[b] != b)
+            child_start[idom[b] + 1]++;
+    }
+    for (int b = 0; b < num_blocks; b++)
+        child_start[b + 1] += child_start[b];
+    int *fill = xcalloc((num_blocks + 1) * sizeof(int));
+    memcpy(fill, child_start, (num_blocks + 1) * sizeof(int));
+    for (int k = 0; k < num_reachable; k++)
+    {
+        int b = order[k];
+        if (idom[b] != b)
+            children[fill[idom[b]]++] = b;
+    }
+    free(fill);
+
+    ValueTable vt;
+    vt.cfg = cfg;
+    vt.var_vn = xcalloc((num_vars + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+        vt.var_vn[v] = v;
+    vt.next_vn = num_vars;
+    vt.constants = create_name_table(64);
+    vt.constant_capacity = 64;
+    vt.constant_vn = xcalloc(vt.constant_capacity * sizeof(int));
+    for (int c = 0; c < vt.constant_capacity; c++)
+        vt.constant_vn[c] = -1;
+    vt.expr_capacity = 64;
+    vt.num_exprs = 0;
+    vt.exprs = xcalloc(vt.expr_capacity * sizeof(Expression));
+    vt.num_buckets = 64;
+    while (vt.num_buckets < size)
+        vt.num_buckets *= 2;
+    vt.buckets = xcalloc(vt.num_buckets * sizeof(int));
+    for (int i = 0; i < vt.num_buckets; i++)
+        vt.buckets[i] = -1;
+    vt.undo_capacity = 64;
+    vt.num_undo = 0;
+    vt.undo = xcalloc(vt.undo_capacity * sizeof(VarUndo));
+
+    int *visited = xcalloc(num_blocks * sizeof(int));
+    int *kill_stack = xcalloc(num_blocks * sizeof(int));
+    for (int b = 0; b < num_blocks; b++)
+        visited[b] = -1;
+
+    // Recorrido iterativo en preorden del árbol de dominadores
+    int *stack = xcalloc(num_blocks * sizeof(int));
+    int *next_child = xcalloc(num_blocks * sizeof(int));
+    int *saved_exprs = xcalloc(num_blocks * sizeof(int));
+    int *saved_undo = xcalloc(num_blocks * sizeof(int));
+    int replaced = 0;
+    int top = 0;
+
+    if (num_reachable > 0)
+    {
+        int entry = order[0];
+        saved_exprs[entry] = vt.num_exprs;
+        saved_undo[entry] = vt.num_undo;
+        replaced += number_block(&vt, entry);
+        next_child[entry] = child_start[entry];
+        stack[top++] = entry;
+    }
+
+    while (top > 0)
+    {
+        int b = stack[top - 1];
+        if (next_child[b] < child_start[b + 1])
+        {
+            int c = children[next_child[b]++];
+            saved_exprs[c] = vt.num_exprs;
+            saved_undo[c] = vt.num_undo;
+            if (cfg->blocks[c].num_pred > 1 || (cfg->blocks[c].num_pred == 1 && cfg->blocks[c].pred[0] != b))
+                kill_join_definitions(&vt, c, b, visited, kill_stack);
+            replaced += number_block(&vt, c);
+            next_child[c] = child_start[c];
+            stack[top++] = c;
+        }
+        else
+        {
+            restore_scope(&vt, saved_exprs[b], saved_undo[b]);
+            top--;
+        }
+    }
+
+    free(stack);
+    free(next_child);
+    free(saved_exprs);
+    free(saved_undo);
+    free(visited);
+    free(kill_stack);
+    free(vt.undo);
+    free(vt.buckets);
+    free(vt.exprs);
+    free(vt.constant_vn);
+    destroy_name_table(vt.constants);
+    free(vt.var_vn);
+    free(child_start);
+    free(children);
+    free(order);
+    free(idom);
+    free_cfg(cfg);
+    return replaced;
+}
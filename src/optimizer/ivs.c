@@ -0,0 +1,506 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Reducción de fuerza de variables de inducción.
+ *
+ * Una variable de inducción básica de un ciclo es una variable Entero cuya
+ * única definición dentro del ciclo es i = i + c (o i - c) con c literal. Un
+ * producto i * k con k invariante (o i << c) se reemplaza por una variable
+ * nueva s que se inicializa en el preencabezado con s = i * k y se incrementa
+ * en c * k justo después de i = i + c; como esa es la única escritura de i en
+ * el ciclo, s == i * k en todo punto del ciclo. El cuadrado i * i se lleva con
+ * dos recurrencias: s += u y u += 2c², con u = 2c·i + c² en el preencabezado.
+ * La aritmética es la de 64 bits del backend, y las identidades se cumplen
+ * módulo 2^64, así que no hace falta probar que no haya desbordamiento.
+ *
+ * Eliminación del contador: si después de eso i solo se usa en su propio
+ * incremento y en comparaciones contra valores invariantes, y no está viva al
+ * salir del ciclo, las comparaciones se reescriben sobre una s = i * k con k
+ * literal positivo (i <= n pasa a s <= n * k) y eliminate_dead_code borra el
+ * incremento de i. Aquí sí importa el desbordamiento: solo se hace cuando el
+ * análisis de rangos acota i y n lo suficiente para que ningún producto se
+ * salga de 64 bits.
+ */
+
+/* Variable derivada creada en esta ejecución para un ciclo. */
+typedef struct
+{
+    int iv;            // id de la variable de inducción básica
+    int kind;          // DERIVED_MUL, DERIVED_SHL o DERIVED_SQUARE
+    char *factor;      // NULL para DERIVED_SQUARE
+    char *name;
+    long long literal; // factor literal (1 << c para DERIVED_SHL), si has_literal
+    int has_literal;
+} DerivedIV;
+
+enum
+{
+    DERIVED_MUL,
+    DERIVED_SHL,
+    DERIVED_SQUARE
+};
+
+// Orden entre los pendientes de una posición: incrementos, luego la etiqueta y al final el preencabezado
+#define ORDER_UPDATE 0
+#define ORDER_LABEL 1
+#define ORDER_PREHEADER 2
+
+static char *literal_string(long long value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", value);
+    return xstrdup(buffer);
+}
+
+/* Producto con la semántica de 64 bits del backend (módulo 2^64). */
+static long long wrap_mul(long long a, long long b)
+{
+    return (long long)((unsigned long long)a * (unsigned long long)b);
+}
+
+static char *new_int_temp()
+{
+    char *name = new_temp();
+    set_ir_type(name, INT);
+    return name;
+}
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    const NaturalLoop *loop;
+    int *def_count;     // definiciones de cada variable dentro del ciclo
+    int *def_at;
+    long long *step;    // paso de cada variable de inducción básica
+    char *is_basic;
+    const char *reduced; // cuádruplos ya convertidos en copia de una derivada
+    int loop_index;
+    const int *innermost; // ciclo más interno de cada bloque
+} LoopInfo;
+
+/*
+ * Reconoce i = i + c / i = c + i / i = i - c como la única definición de i en
+ * el ciclo.
+ */
+static void find_basic_ivs(LoopInfo *li)
+{
+    ControlFlowGraph *cfg = li->cfg;
+    for (int v = 0; v < cfg->vars->count; v++)
+    {
+        li->step[v] = basic_iv_step(cfg, li->def_count, li->def_at, v);
+        li->is_basic[v] = li->step[v] != 0;
+    }
+}
+
+/* |x| * k cabe en 64 bits con signo para todo x en [lo, hi]. */
+static int range_product_fits(long long lo, long long hi, long long k)
+{
+    long long a, b;
+    return !__builtin_mul_overflow(lo, k, &a) && !__builtin_mul_overflow(hi, k, &b);
+}
+
+/*
+ * Reescribe las comparaciones de la variable básica v sobre la derivada d
+ * (s = v * k, k > 0) para que v solo quede viva en su propio incremento.
+ */
+static int replace_counter_tests(LoopInfo *li, BitSet **live_in, const int *global_index, int v, const DerivedIV *d,
+                                 PendingQuads *pending, int preheader_position)
+{
+    ControlFlowGraph *cfg = li->cfg;
+    const NaturalLoop *loop = li->loop;
+    Quadruple *code = cfg->code;
+    const char *label = code[cfg->blocks[loop->header].start].result;
+    const char *name = cfg->vars->names[v];
+    long long k = d->literal;
+
+    // El incremento no puede estar en un ciclo anidado: a lo más una vez por vuelta
+    if (li->innermost[cfg->block_of[li->def_at[v]]] != li->loop_index)
+        return 0;
+
+    // v no debe leerse al salir del ciclo
+    int g = global_index[v];
+    for (int b = 0; b < cfg->num_blocks && g != -1; b++)
+    {
+        if (!loop->in_loop[b])
+            continue;
+        for (int s = 0; s < cfg->blocks[b].num_succ; s++)
+        {
+            int succ = cfg->blocks[b].succ[s];
+            if (!loop->in_loop[succ] && bitset_contiene(live_in[succ], g))
+                return 0;
+        }
+    }
+
+    // Solo su incremento y comparaciones contra invariantes pueden leer v
+    int tests = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (!loop->in_loop[b])
+            continue;
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            if (cfg->use1[i] != v && cfg->use2[i] != v)
+                continue;
+            if (i == li->def_at[v] || li->reduced[i])
+                continue;
+            Quadruple *q = &code[i];
+            if (!is_comparison(q->op) || cfg->use1[i] == cfg->use2[i])
+                return 0;
+            int other = cfg->use1[i] == v ? cfg->use2[i] : cfg->use1[i];
+            const char *other_name = cfg->use1[i] == v ? q->arg2 : q->arg1;
+            if (!is_invariant_operand(li->def_count, other_name, other))
+                return 0;
+            tests++;
+        }
+    }
+    if (tests == 0)
+        return 0;
+
+    // Los productos no deben desbordarse en ningún valor que tomen v o los límites
+    long long lo, hi;
+    long long c = li->step[v] < 0 ? -li->step[v] : li->step[v];
+    if (!get_loop_header_range(label, name, &lo, &hi) || __builtin_sub_overflow(lo, c, &lo) ||
+        __builtin_add_overflow(hi, c, &hi) || !range_product_fits(lo, hi, k))
+    {
+        emit_remark("ivs", REMARK_MISSED, &code[li->def_at[v]],
+                    "el contador '%s' no se elimina: no se puede probar que '%s' no se desborde", name, d->name);
+        return 0;
+    }
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (!loop->in_loop[b])
+            continue;
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            if ((cfg->use1[i] != v && cfg->use2[i] != v) || i == li->def_at[v] || li->reduced[i])
+                continue;
+            Quadruple *q = &code[i];
+            const char *other_name = cfg->use1[i] == v ? q->arg2 : q->arg1;
+            long long n_lo, n_hi;
+            if (int_literal(other_name, &n_lo))
+                n_hi = n_lo;
+            else if (!get_loop_header_range(label, other_name, &n_lo, &n_hi))
+                return 0;
+            if (!range_product_fits(n_lo, n_hi, k))
+            {
+                emit_remark("ivs", REMARK_MISSED, q, "el contador '%s' no se elimina: '%s' * %lld puede desbordarse", name,
+                            other_name, k);
+                return 0;
+            }
+        }
+    }
+
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (!loop->in_loop[b])
+            continue;
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            if ((cfg->use1[i] != v && cfg->use2[i] != v) || i == li->def_at[v] || li->reduced[i])
+                continue;
+            Quadruple *q = &code[i];
+            char **counter = cfg->use1[i] == v ? &q->arg1 : &q->arg2;
+            char **bound = cfg->use1[i] == v ? &q->arg2 : &q->arg1;
+
+            long long n;
+            char *scaled;
+            if (int_literal(*bound, &n))
+            {
+                scaled = literal_string(n * k);
+            }
+            else
+            {
+                scaled = new_int_temp();
+                char *factor = literal_string(k);
+                add_pending_quad(pending, preheader_position, ORDER_PREHEADER, IR_MUL, *bound, factor, scaled, q);
+                free(factor);
+            }
+            emit_remark("ivs", REMARK_APPLIED, q, "la comparación usa '%s' en lugar del contador '%s'", d->name, name);
+            free(*counter);
+            *counter = xstrdup(d->name);
+            free(*bound);
+            *bound = scaled;
+        }
+    }
+    return 1;
+}
+
+int reduce_induction_variables()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+    int num_blocks = cfg->num_blocks;
+
+    int *order = xcalloc(num_blocks * sizeof(int));
+    int *idom = xcalloc(num_blocks * sizeof(int));
+    int num_reachable = compute_rpo(cfg, order);
+    compute_dominators(cfg, order, num_reachable, idom);
+
+    NaturalLoop *loops;
+    int num_loops = find_natural_loops(cfg, idom, &loops);
+
+    int *global_index = xcalloc((num_vars + 1) * sizeof(int));
+    int num_globals = find_global_names(cfg, global_index);
+    BitSet **live_in = num_loops > 0 ? compute_live_in(cfg, global_index, num_globals) : NULL;
+
+    LoopInfo li;
+    li.cfg = cfg;
+    li.def_count = xcalloc((num_vars + 1) * sizeof(int));
+    li.def_at = xcalloc((num_vars + 1) * sizeof(int));
+    li.step = xcalloc((num_vars + 1) * sizeof(long long));
+    li.is_basic = xcalloc(num_vars + 1);
+    DerivedIV *derived = xcalloc((size + 1) * sizeof(DerivedIV));
+    char *reduced = xcalloc(size + 1);
+    li.reduced = reduced;
+    PendingQuads pending = {NULL, 0, 0};
+
+    // Ciclo más interno de cada bloque: los ciclos vienen de internos a externos
+    int *innermost = xcalloc((num_blocks + 1) * sizeof(int));
+    for (int b = 0; b < num_blocks; b++)
+    {
+        innermost[b] = -1;
+        for (int l = 0; l < num_loops && innermost[b] == -1; l++)
+        {
+            if (loops[l].in_loop[b])
+                innermost[b] = l;
+        }
+    }
+    li.innermost = innermost;
+    int changes = 0;
+
+    for (int l = 0; l < num_loops; l++)
+    {
+        const NaturalLoop *loop = &loops[l];
+        if (!loop_has_preheader_slot(cfg, loop))
+            continue;
+        li.loop = loop;
+        li.loop_index = l;
+        int first_pending = pending.count;
+        int header_start = cfg->blocks[loop->header].start;
+
+        for (int v = 0; v < num_vars; v++)
+            li.def_count[v] = 0;
+        for (int b = 0; b < num_blocks; b++)
+        {
+            if (!loop->in_loop[b])
+                continue;
+            for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+            {
+                int d = cfg->def[i];
+                if (d != -1)
+                {
+                    li.def_count[d]++;
+                    li.def_at[d] = i;
+                }
+            }
+        }
+        find_basic_ivs(&li);
+
+        // Productos de una variable básica por un invariante
+        int num_derived = 0;
+        for (int b = 0; b < num_blocks; b++)
+        {
+            if (!loop->in_loop[b])
+                continue;
+            for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+            {
+                Quadruple *q = &code[i];
+                int u1 = cfg->use1[i], u2 = cfg->use2[i];
+                if (reduced[i] || cfg->def[i] == -1 || get_ir_type(q->result) != INT)
+                    continue;
+
+                int iv = -1, kind = DERIVED_MUL;
+                const char *factor = NULL;
+                long long literal = 0;
+                int has_literal = 0;
+                if (q->op == IR_MUL && u1 != -1 && u1 == u2 && li.is_basic[u1])
+                {
+                    iv = u1;
+                    kind = DERIVED_SQUARE;
+                }
+                else if (q->op == IR_MUL && u1 != -1 && li.is_basic[u1] &&
+                         is_invariant_operand(li.def_count, q->arg2, u2))
+                {
+                    iv = u1;
+                    factor = q->arg2;
+                }
+                else if (q->op == IR_MUL && u2 != -1 && li.is_basic[u2] &&
+                         is_invariant_operand(li.def_count, q->arg1, u1))
+                {
+                    iv = u2;
+                    factor = q->arg1;
+                }
+                else if (q->op == IR_SHL && u1 != -1 && li.is_basic[u1] && int_literal(q->arg2, &literal) && literal >= 0 &&
+                         literal < 63)
+                {
+                    iv = u1;
+                    kind = DERIVED_SHL;
+                    factor = q->arg2;
+                    literal = 1LL << literal;
+                    has_literal = 1;
+                }
+                if (iv == -1)
+                    continue;
+                if (kind == DERIVED_MUL)
+                    has_literal = int_literal(factor, &literal);
+
+                // Un mismo producto en varios lugares comparte la variable nueva
+                DerivedIV *d = NULL;
+                for (int k = 0; k < num_derived && d == NULL; k++)
+                {
+                    if (derived[k].iv == iv && derived[k].kind == kind &&
+                        (kind == DERIVED_SQUARE || strcmp(derived[k].factor, factor) == 0))
+                        d = &derived[k];
+                }
+
+                const char *iv_name = cfg->vars->names[iv];
+                long long c = li.step[iv];
+                int update_position = li.def_at[iv] + 1;
+                const Quadruple *update = &code[li.def_at[iv]];
+                if (d == NULL)
+                {
+                    d = &derived[num_derived++];
+                    d->iv = iv;
+                    d->kind = kind;
+                    d->factor = xstrdup(factor);
+                    d->name = new_int_temp();
+                    d->literal = literal;
+                    d->has_literal = has_literal;
+
+                    if (kind == DERIVED_SQUARE)
+                    {
+                        // s = i*i; u = 2c*i + c*c; en cada vuelta s += u y u += 2c*c
+                        char *delta = new_int_temp();
+                        char *twice_c = literal_string(wrap_mul(2, c));
+                        char *c_squared = literal_string(wrap_mul(c, c));
+                        char *delta_step = literal_string(wrap_mul(2, wrap_mul(c, c)));
+                        add_pending_quad(&pending, header_start, ORDER_PREHEADER, IR_MUL, iv_name, iv_name, d->name, q);
+                        add_pending_quad(&pending, header_start, ORDER_PREHEADER, IR_MUL, iv_name, twice_c, delta, q);
+                        add_pending_quad(&pending, header_start, ORDER_PREHEADER, IR_ADD, delta, c_squared, delta, q);
+                        add_pending_quad(&pending, update_position, ORDER_UPDATE, IR_ADD, d->name, delta, d->name,
+                                         update);
+                        add_pending_quad(&pending, update_position, ORDER_UPDATE, IR_ADD, delta, delta_step, delta,
+                                         update);
+                        free(delta);
+                        free(twice_c);
+                        free(c_squared);
+                        free(delta_step);
+                    }
+                    else
+                    {
+                        char *step;
+                        add_pending_quad(&pending, header_start, ORDER_PREHEADER,
+                                         kind == DERIVED_SHL ? IR_SHL : IR_MUL, iv_name, factor, d->name, q);
+                        if (has_literal)
+                        {
+                            step = literal_string(wrap_mul(c, literal));
+                        }
+                        else if (c == 1)
+                        {
+                            step = xstrdup(factor);
+                        }
+                        else
+                        {
+                            step = new_int_temp();
+                            char *c_string = literal_string(c);
+                            add_pending_quad(&pending, header_start, ORDER_PREHEADER, IR_MUL, factor, c_string, step,
+                                             q);
+                            free(c_string);
+                        }
+                        add_pending_quad(&pending, update_position, ORDER_UPDATE, IR_ADD, d->name, step, d->name,
+                                         update);
+                        free(step);
+                    }
+                }
+
+                if (kind == DERIVED_SQUARE)
+                    emit_remark("ivs", REMARK_APPLIED, q, "'%s * %s' se lleva como una recurrencia de sumas en '%s'",
+                                iv_name, iv_name, d->name);
+                else if (has_literal)
+                    emit_remark("ivs", REMARK_APPLIED, q, "'%s %s %s' se reemplaza por '%s', que suma %lld por vuelta",
+                                iv_name, kind == DERIVED_SHL ? "<<" : "*", factor, d->name, wrap_mul(c, literal));
+                else if (c == 1)
+                    emit_remark("ivs", REMARK_APPLIED, q, "'%s * %s' se reemplaza por '%s', que suma %s por vuelta",
+                                iv_name, factor, d->name, factor);
+                else
+                    emit_remark("ivs", REMARK_APPLIED, q, "'%s * %s' se reemplaza por '%s', que suma %lld * %s por vuelta",
+                                iv_name, factor, d->name, c, factor);
+                free(q->arg1);
+                free(q->arg2);
+                q->op = IR_ASSIGN;
+                q->arg1 = xstrdup(d->name);
+                q->arg2 = NULL;
+                reduced[i] = 1;
+                changes++;
+            }
+        }
+        if (num_derived == 0)
+            continue;
+
+        // Eliminación del contador sobre una derivada con factor literal positivo
+        for (int v = 0; v < num_vars; v++)
+        {
+            if (!li.is_basic[v])
+                continue;
+            for (int k = 0; k < num_derived; k++)
+            {
+                DerivedIV *d = &derived[k];
+                if (d->iv != v || d->kind == DERIVED_SQUARE || !d->has_literal || d->literal <= 0)
+                    continue;
+                if (replace_counter_tests(&li, live_in, global_index, v, d, &pending, header_start))
+                {
+                    changes++;
+                    break;
+                }
+            }
+        }
+
+        // Los saltos de fuera del ciclo al encabezado deben pasar por el preencabezado
+        int uses_preheader = 0;
+        for (int k = first_pending; k < pending.count; k++)
+            uses_preheader |= pending.quads[k].position == header_start;
+        if (uses_preheader)
+        {
+            char *preheader_label = redirect_loop_entries(cfg, loop);
+            if (preheader_label != NULL)
+            {
+                add_pending_quad(&pending, header_start, ORDER_LABEL, IR_LABEL, NULL, NULL, preheader_label,
+                                 &cfg->code[header_start]);
+                free(preheader_label);
+            }
+        }
+        for (int k = 0; k < num_derived; k++)
+        {
+            free(derived[k].factor);
+            free(derived[k].name);
+        }
+    }
+
+    if (pending.count > 0)
+        splice_pending_quads(&pending);
+    free_pending_quads(&pending);
+    free(derived);
+    free(reduced);
+    free(innermost);
+    free(li.def_count);
+    free(li.def_at);
+    free(li.step);
+    free(li.is_basic);
+    free_block_sets(live_in, num_blocks);
+    free(global_index);
+    free_natural_loops(loops, num_loops);
+    free(order);
+    free(idom);
+    free_cfg(cfg);
+    return changes;
+}
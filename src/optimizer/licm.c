@@ -0,0 +1,189 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "bitset.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Movimiento de código invariante fuera de los ciclos (LICM).
+ *
+ * Un cuádruplo de un ciclo natural es invariante si sus operandos son
+ * literales, variables que el ciclo no escribe o resultados de otros
+ * invariantes del mismo ciclo. Se mueve al preencabezado (justo antes de la
+ * etiqueta del encabezado) cuando además:
+ *   - es la única definición de su resultado dentro del ciclo, y
+ *   - su resultado no está vivo a la entrada del encabezado, así que ningún
+ *     camino desde el encabezado observa el valor anterior al ciclo.
+ * Con eso basta para ejecutarlo de forma especulativa, aun si en el ciclo
+ * estaba en una rama o el ciclo no da ninguna vuelta, siempre que no tenga
+ * efectos: una división o módulo entre un divisor que puede ser cero no se
+ * mueve, porque fallaría en casos en los que el programa original no falla.
+ *
+ * Cada ejecución mueve los invariantes al preencabezado del ciclo más
+ * interno que los contiene; el punto fijo los sigue subiendo por los ciclos
+ * externos. Los saltos de fuera del ciclo que llegaban al encabezado se
+ * redirigen al preencabezado para que también ejecuten el código movido.
+ */
+
+int hoist_loop_invariants()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+    int num_blocks = cfg->num_blocks;
+
+    int *order = xcalloc(num_blocks * sizeof(int));
+    int *idom = xcalloc(num_blocks * sizeof(int));
+    int num_reachable = compute_rpo(cfg, order);
+    compute_dominators(cfg, order, num_reachable, idom);
+
+    NaturalLoop *loops;
+    int num_loops = find_natural_loops(cfg, idom, &loops);
+    if (num_loops == 0)
+    {
+        free_natural_loops(loops, num_loops);
+        free(order);
+        free(idom);
+        free_cfg(cfg);
+        return 0;
+    }
+
+    int *global_index = xcalloc((num_vars + 1) * sizeof(int));
+    int num_globals = find_global_names(cfg, global_index);
+    BitSet **live_in = compute_live_in(cfg, global_index, num_globals);
+
+    // Ciclo más interno de cada bloque: los ciclos vienen de internos a externos
+    int *innermost = xcalloc(num_blocks * sizeof(int));
+    for (int b = 0; b < num_blocks; b++)
+    {
+        innermost[b] = -1;
+        for (int l = 0; l < num_loops && innermost[b] == -1; l++)
+        {
+            if (loops[l].in_loop[b])
+                innermost[b] = l;
+        }
+    }
+
+    int *def_count = xcalloc((num_vars + 1) * sizeof(int));
+    int *def_at = xcalloc((num_vars + 1) * sizeof(int));
+    int *invariant = xcalloc(size * sizeof(int)); // ciclo (+1) al que se mueve cada cuádruplo
+    int *hoisted_index = xcalloc(size * sizeof(int));
+    int num_hoisted = 0;
+    PendingQuads pending = {NULL, 0, 0};
+
+    for (int l = 0; l < num_loops; l++)
+    {
+        NaturalLoop *loop = &loops[l];
+        int h = loop->header;
+        if (!loop_has_preheader_slot(cfg, loop))
+            continue;
+
+        for (int v = 0; v < num_vars; v++)
+            def_count[v] = 0;
+        for (int b = 0; b < num_blocks; b++)
+        {
+            if (!loop->in_loop[b])
+                continue;
+            for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+            {
+                int d = cfg->def[i];
+                if (d != -1)
+                {
+                    def_count[d]++;
+                    def_at[d] = i;
+                }
+            }
+        }
+
+        // Se marcan hasta un punto fijo; el orden de marcado respeta las dependencias
+        int first = num_hoisted;
+        int changed = 1;
+        while (changed)
+        {
+            changed = 0;
+            for (int b = 0; b < num_blocks; b++)
+            {
+                if (innermost[b] != l)
+                    continue;
+                for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+                {
+                    Quadruple *q = &code[i];
+                    int d = cfg->def[i];
+                    if (invariant[i] || d == -1 || def_count[d] != 1 || q->op == IR_READ)
+                        continue;
+                    if (global_index[d] != -1 && bitset_contiene(live_in[h], global_index[d]))
+                        continue;
+
+                    // Los invariantes de un ciclo interno solo suben a su preencabezado, que sigue en este
+                    int uses[2] = {cfg->use1[i], cfg->use2[i]};
+                    int operands_invariant = 1;
+                    for (int k = 0; k < 2; k++)
+                    {
+                        int u = uses[k];
+                        if (u != -1 && def_count[u] != 0 && !(def_count[u] == 1 && invariant[def_at[u]] == l + 1))
+                            operands_invariant = 0;
+                    }
+                    if (!operands_invariant)
+                        continue;
+
+                    if (!quad_is_pure(q))
+                    {
+                        emit_remark("licm", REMARK_MISSED, q,
+                                    "'%s' es invariante pero no sale del ciclo: el divisor %s puede ser cero", q->result,
+                                    q->arg2 ? q->arg2 : "");
+                        continue;
+                    }
+
+                    invariant[i] = l + 1;
+                    hoisted_index[num_hoisted++] = i;
+                    changed = 1;
+                }
+            }
+        }
+        if (num_hoisted == first)
+            continue;
+
+        // Los saltos de fuera del ciclo a la etiqueta del encabezado pasan al preencabezado
+        int header_start = cfg->blocks[h].start;
+        const char *header_label = code[header_start].result;
+        char *preheader_label = redirect_loop_entries(cfg, loop);
+
+        for (int k = first; k < num_hoisted; k++)
+        {
+            Quadruple *q = &code[hoisted_index[k]];
+            emit_remark("licm", REMARK_APPLIED, q, "'%s' es invariante: se calcula una vez antes del ciclo de %s", q->result,
+                        header_label);
+            add_pending_quad(&pending, header_start, 0, q->op, q->arg1, q->arg2, q->result, q);
+            remove_quad(q);
+        }
+        if (preheader_label != NULL)
+        {
+            // Con el menor orden queda delante de los cuádruplos movidos
+            add_pending_quad(&pending, header_start, -1, IR_LABEL, NULL, NULL, preheader_label, &code[header_start]);
+            free(preheader_label);
+        }
+    }
+
+    if (num_hoisted > 0)
+        splice_pending_quads(&pending);
+    free_pending_quads(&pending);
+
+    free_block_sets(live_in, num_blocks);
+    free(hoisted_index);
+    free(invariant);
+    free(def_count);
+    free(def_at);
+    free(innermost);
+    free(global_index);
+    free_natural_loops(loops, num_loops);
+    free(order);
+    free(idom);
+    free_cfg(cfg);
+    return num_hoisted;
+}
@@ -0,0 +1,228 @@
+#include "optimizer.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Administrador de pasadas sobre el código intermedio.
+ *
+ * Cada pasada declara qué otras pueden encontrar trabajo nuevo cuando ella
+ * cambia el código. La lista de trabajo se procesa siempre en el orden del
+ * arreglo de pasadas: se ejecuta la primera pendiente y, si reporta cambios,
+ * se marcan como pendientes las que dependen de ella. Termina cuando ninguna
+ * queda pendiente (punto fijo) o cuando se agota el presupuesto del nivel.
+ *
+ * Las pasadas tardías no participan en la lista de trabajo: se ejecutan una
+ * sola vez, en orden, después del punto fijo.
+ */
+
+enum
+{
+    PASS_ALGEBRA,
+    PASS_COPYPROP,
+    PASS_SIMPLIFY_CFG,
+    PASS_CSE,
+    PASS_RANGES,
+    PASS_LICM,
+    PASS_SCEV,
+    PASS_FUSE,
+    PASS_IVS,
+    PASS_UNSWITCH,
+    PASS_UNROLL,
+    PASS_ROTATE,
+    PASS_DCE,
+    PASS_TEMP_SLOTS,
+    PASS_CROSSJUMP,
+    NUM_PASSES
+};
+
+#define PASS_BIT(p) (1u << (p))
+
+typedef struct
+{
+    const char *name;       // nombre usado en -f<nombre> / -fno-<nombre>
+    int (*run)();           // devuelve el número de cambios hechos
+    OptLevel min_level;     // nivel mínimo en el que se activa
+    int grows_code;         // se desactiva en -Os
+    unsigned int reruns;    // pasadas que pueden mejorar tras un cambio de esta
+    int late;               // se ejecuta una vez después del punto fijo
+    int forced;             // 1 activada, -1 desactivada por opción, 0 según el nivel
+    int runs;
+    int changes;
+} OptimizationPass;
+
+static OptimizationPass passes[NUM_PASSES] = {
+    [PASS_ALGEBRA] = {"algebra", simplify_algebra, OPT_O1, 0,
+                      PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_SIMPLIFY_CFG) | PASS_BIT(PASS_CSE) | PASS_BIT(PASS_LICM) |
+                          PASS_BIT(PASS_IVS) | PASS_BIT(PASS_DCE),
+                      0, 0, 0, 0},
+    [PASS_COPYPROP] = {"copyprop", propagate_copies, OPT_O1, 0,
+                       PASS_BIT(PASS_ALGEBRA) | PASS_BIT(PASS_SIMPLIFY_CFG) | PASS_BIT(PASS_CSE) | PASS_BIT(PASS_RANGES) |
+                           PASS_BIT(PASS_LICM) | PASS_BIT(PASS_IVS) | PASS_BIT(PASS_DCE),
+                       0, 0, 0, 0},
+    [PASS_SIMPLIFY_CFG] = {"simplify-cfg", simplify_control_flow, OPT_O1, 0,
+                           PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_CSE) | PASS_BIT(PASS_RANGES) | PASS_BIT(PASS_LICM) |
+                               PASS_BIT(PASS_FUSE) | PASS_BIT(PASS_DCE),
+                           0, 0, 0, 0},
+    [PASS_CSE] = {"cse", eliminate_common_subexpressions, OPT_O2, 0,
+                  PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_LICM) | PASS_BIT(PASS_FUSE) | PASS_BIT(PASS_IVS) |
+                      PASS_BIT(PASS_DCE),
+                  0, 0, 0, 0},
+    [PASS_RANGES] = {"ranges", analyze_value_ranges, OPT_O2, 0,
+                     PASS_BIT(PASS_ALGEBRA) | PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_SIMPLIFY_CFG) | PASS_BIT(PASS_LICM) |
+                         PASS_BIT(PASS_IVS) | PASS_BIT(PASS_DCE),
+                     0, 0, 0, 0},
+    [PASS_LICM] = {"licm", hoist_loop_invariants, OPT_O2, 0,
+                   PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_CSE) | PASS_BIT(PASS_RANGES) | PASS_BIT(PASS_LICM) |
+                       PASS_BIT(PASS_FUSE) | PASS_BIT(PASS_IVS) | PASS_BIT(PASS_DCE),
+                   0, 0, 0, 0},
+    [PASS_SCEV] = {"scev", evaluate_closed_forms, OPT_O2, 1,
+                   PASS_BIT(PASS_ALGEBRA) | PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_SIMPLIFY_CFG) | PASS_BIT(PASS_CSE) |
+                       PASS_BIT(PASS_RANGES) | PASS_BIT(PASS_LICM) | PASS_BIT(PASS_IVS) | PASS_BIT(PASS_DCE),
+                   0, 0, 0, 0},
+    [PASS_FUSE] = {"fuse", fuse_loops, OPT_O2, 0,
+                   PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_SIMPLIFY_CFG) | PASS_BIT(PASS_CSE) | PASS_BIT(PASS_LICM) |
+                       PASS_BIT(PASS_FUSE) | PASS_BIT(PASS_IVS) | PASS_BIT(PASS_DCE),
+                   0, 0, 0, 0},
+    [PASS_IVS] = {"ivs", reduce_induction_variables, OPT_O2, 1,
+                  PASS_BIT(PASS_ALGEBRA) | PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_CSE) | PASS_BIT(PASS_RANGES) |
+                      PASS_BIT(PASS_DCE),
+                  0, 0, 0, 0},
+    [PASS_UNSWITCH] = {"unswitch", unswitch_loops, OPT_O2, 1,
+                       PASS_BIT(PASS_ALGEBRA) | PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_SIMPLIFY_CFG) |
+                           PASS_BIT(PASS_CSE) | PASS_BIT(PASS_LICM) | PASS_BIT(PASS_DCE),
+                       0, 0, 0, 0},
+    [PASS_UNROLL] = {"unroll", unroll_loops, OPT_O1, 1,
+                     PASS_BIT(PASS_ALGEBRA) | PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_SIMPLIFY_CFG) |
+                         PASS_BIT(PASS_CSE) | PASS_BIT(PASS_RANGES) | PASS_BIT(PASS_LICM) | PASS_BIT(PASS_IVS) |
+                         PASS_BIT(PASS_DCE),
+                     0, 0, 0, 0},
+    [PASS_ROTATE] = {"rotate", rotate_loops, OPT_O1, 1,
+                     PASS_BIT(PASS_ALGEBRA) | PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_CSE) | PASS_BIT(PASS_LICM) |
+                         PASS_BIT(PASS_DCE),
+                     0, 0, 0, 0},
+    [PASS_DCE] = {"dce", eliminate_dead_code, OPT_O1, 0,
+                  PASS_BIT(PASS_COPYPROP) | PASS_BIT(PASS_SIMPLIFY_CFG) | PASS_BIT(PASS_LICM) | PASS_BIT(PASS_FUSE) |
+                      PASS_BIT(PASS_IVS),
+                  0, 0, 0, 0},
+    [PASS_TEMP_SLOTS] = {"temp-slots", assign_temp_slots, OPT_O1, 0, 0, 1, 0, 0, 0},
+    [PASS_CROSSJUMP] = {"crossjump", merge_identical_tails, OPT_OS, 0, 0, 1, 0, 0, 0},
+};
+
+static OptLevel current_level = OPT_O2;
+
+void set_optimization_level(OptLevel level)
+{
+    current_level = level;
+}
+
+OptLevel get_optimization_level()
+{
+    return current_level;
+}
+
+int set_pass_enabled(const char *name, int enabled)
+{
+    for (int p = 0; p < NUM_PASSES; p++)
+    {
+        if (strcmp(passes[p].name, name) == 0)
+        {
+            passes[p].forced = enabled ? 1 : -1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int is_pass_enabled(const char *name)
+{
+    for (int p = 0; p < NUM_PASSES; p++)
+    {
+        if (strcmp(passes[p].name, name) != 0)
+            continue;
+        if (passes[p].forced != 0)
+            return passes[p].forced > 0;
+        if (current_level == OPT_O0)
+            return 0;
+        if (current_level == OPT_OS)
+            return !passes[p].grows_code;
+        return current_level >= passes[p].min_level;
+    }
+    return 0;
+}
+
+/*
+ * Cuántas veces puede ejecutarse cada pasada. Los niveles bajos cortan antes
+ * el punto fijo para reducir la latencia de compilación.
+ */
+static int run_budget()
+{
+    switch (current_level)
+    {
+    case OPT_O1:
+        return 2;
+    case OPT_O2:
+    case OPT_OS:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+void run_optimization_passes()
+{
+    unsigned int enabled = 0;
+    for (int p = 0; p < NUM_PASSES; p++)
+    {
+        passes[p].runs = 0;
+        passes[p].changes = 0;
+        if (is_pass_enabled(passes[p].name) && !passes[p].late)
+            enabled |= PASS_BIT(p);
+    }
+
+    int budget = run_budget();
+    if (budget == 0 && enabled != 0)
+        budget = 1;
+
+    unsigned int pending = enabled;
+    while (pending != 0)
+    {
+        int p = __builtin_ctz(pending);
+        pending &= ~PASS_BIT(p);
+
+        if (passes[p].runs >= budget)
+        {
+            emit_remark(passes[p].name, REMARK_MISSED, NULL,
+                        "límite de %d ejecuciones alcanzado: la pasada todavía tenía trabajo pendiente", budget);
+            continue;
+        }
+
+        int changes = passes[p].run();
+        passes[p].runs++;
+        passes[p].changes += changes;
+
+        if (changes > 0)
+            pending |= passes[p].reruns & enabled;
+    }
+
+    for (int p = 0; p < NUM_PASSES; p++)
+    {
+        if (passes[p].late && is_pass_enabled(passes[p].name))
+        {
+            passes[p].changes += passes[p].run();
+            passes[p].runs++;
+        }
+    }
+}
+
+void print_optimization_stats()
+{
+    printf("Pasadas de optimizacion (nivel -O%s):\n",
+           current_level == OPT_OS ? "s" : current_level == OPT_O2 ? "2" : current_level == OPT_O1 ? "1" : "0");
+    for (int p = 0; p < NUM_PASSES; p++)
+    {
+        printf("  %-14s %s  ejecuciones: %d  cambios: %d\n", passes[p].name,
+               is_pass_enabled(passes[p].name) ? "activa  " : "inactiva", passes[p].runs, passes[p].changes);
+    }
+}
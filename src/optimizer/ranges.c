@@ -0,0 +1,1007 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Análisis de rangos de valores enteros.
+ *
+ * Cada variable Entero o Booleano lleva un intervalo [lo, hi] de los valores
+ * que puede tener. El análisis es hacia adelante sobre el CFG: las variables
+ * empiezan en 0 (viven en .bss), los saltos condicionales acotan los operandos
+ * de la comparación que los precede en cada arista, y en los encabezados de
+ * ciclo se ensancha (widening) para terminar. Después de llegar al punto fijo
+ * se hace un paso de estrechamiento (narrowing) que recupera las cotas que
+ * imponen las condiciones de los ciclos.
+ *
+ * Con los rangos finales:
+ *   - las comparaciones cuyo resultado está determinado se vuelven constantes,
+ *   - los usos de variables con un solo valor posible se vuelven literales,
+ *   - las divisiones entre potencias de dos de valores no negativos se vuelven
+ *     corrimientos o máscaras, y las demás divisiones con operandos en
+ *     [0, 2^32) usan la división sin signo de 32 bits (IR_UDIV / IR_UMOD),
+ *   - se publica una cota del número de iteraciones de cada ciclo con una
+ *     variable de inducción de paso constante (get_loop_trip_bound).
+ *
+ * Solo las variables globales (ver find_global_names) vivas a la entrada de
+ * un bloque tienen estado en su frontera: cada bloque guarda la lista de esas
+ * variables y sus rangos, así que el costo de recorrerlo es proporcional a lo
+ * que realmente cruza sus bordes y no a todas las globales del programa. Los
+ * bloques pendientes se procesan en orden postorden inverso con una cola de
+ * prioridad. Si el total de celdas de estado es muy grande el análisis no se
+ * hace, para acotar la memoria.
+ */
+
+#define RANGE_MAX_STATE_CELLS (8 * 1024 * 1024)
+#define WIDEN_AFTER_VISITS 2
+#define NARROWING_STEPS 2
+
+typedef struct
+{
+    long long lo;
+    long long hi;
+} Range;
+
+static const Range RANGE_TOP = {LLONG_MIN, LLONG_MAX};
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    int num_globals;
+    int *global_index;
+    char *tracked;       // variable Entero/Booleano
+    Range *cur;          // estado del recorrido actual, indexado por id de variable
+    int *live_start;     // live_vars[live_start[b] .. live_start[b + 1]) viven a la entrada de b
+    int *live_vars;      // globales rastreadas vivas a la entrada de cada bloque
+    Range *in;           // rango de cada una de ellas, paralelo a live_vars
+    char *reached;
+    int *visits;
+    char *dirty;         // el bloque está en la cola de pendientes
+    int *rpo_pos;        // posición de cada bloque en el orden postorden inverso
+    int *queue;          // montículo de posiciones en el orden postorden inverso
+    int queue_size;
+} RangeState;
+
+/* Cotas de iteraciones publicadas por la última ejecución */
+static NameTable *trip_labels = NULL;
+static long long *trip_bounds = NULL;
+
+/* Rangos a la entrada de cada encabezado, con clave "etiqueta variable" */
+static NameTable *header_range_keys = NULL;
+static Range *header_ranges = NULL;
+
+static int is_empty(Range r)
+{
+    return r.lo > r.hi;
+}
+
+static int is_bounded(Range r)
+{
+    return r.lo != LLONG_MIN && r.hi != LLONG_MAX;
+}
+
+static Range make_range(long long lo, long long hi)
+{
+    Range r = {lo, hi};
+    return r;
+}
+
+static Range hull(Range a, Range b)
+{
+    return make_range(a.lo < b.lo ? a.lo : b.lo, a.hi > b.hi ? a.hi : b.hi);
+}
+
+static long long min_ll(long long a, long long b)
+{
+    return a < b ? a : b;
+}
+
+static long long max_ll(long long a, long long b)
+{
+    return a > b ? a : b;
+}
+
+/* Rango de un operando: literal, variable rastreada o desconocido. */
+static Range operand_range(RangeState *st, const char *operand, int id)
+{
+    long long v;
+    if (int_literal(operand, &v))
+        return make_range(v, v);
+    if (id != -1 && st->tracked[id])
+        return st->cur[id];
+    return RANGE_TOP;
+}
+
+static Range add_ranges(Range a, Range b)
+{
+    long long lo, hi;
+    if (__builtin_add_overflow(a.lo, b.lo, &lo) || __builtin_add_overflow(a.hi, b.hi, &hi))
+        return RANGE_TOP;
+    return make_range(lo, hi);
+}
+
+static Range sub_ranges(Range a, Range b)
+{
+    long long lo, hi;
+    if (__builtin_sub_overflow(a.lo, b.hi, &lo) || __builtin_sub_overflow(a.hi, b.lo, &hi))
+        return RANGE_TOP;
+    return make_range(lo, hi);
+}
+
+static Range mul_ranges(Range a, Range b)
+{
+    long long c[4];
+    if (__builtin_mul_overflow(a.lo, b.lo, &c[0]) || __builtin_mul_overflow(a.lo, b.hi, &c[1]) ||
+        __builtin_mul_overflow(a.hi, b.lo, &c[2]) || __builtin_mul_overflow(a.hi, b.hi, &c[3]))
+        return RANGE_TOP;
+    return make_range(min_ll(min_ll(c[0], c[1]), min_ll(c[2], c[3])), max_ll(max_ll(c[0], c[1]), max_ll(c[2], c[3])));
+}
+
+static Range div_ranges(Range a, Range b)
+{
+    // Con un divisor que puede ser 0 o -1 (LLONG_MIN / -1) no se acota
+    if (b.lo <= 0 && b.hi >= -1)
+        return RANGE_TOP;
+    long long c[4] = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+    return make_range(min_ll(min_ll(c[0], c[1]), min_ll(c[2], c[3])), max_ll(max_ll(c[0], c[1]), max_ll(c[2], c[3])));
+}
+
+static Range mod_ranges(Range a, Range b)
+{
+    if (b.lo <= 0 && b.hi >= 0)
+        return RANGE_TOP;
+    // |a % b| < |b| y el signo es el del dividendo
+    long long m = b.lo > 0 ? b.hi - 1 : (b.lo == LLONG_MIN ? LLONG_MAX : -b.lo - 1);
+    long long lo = a.lo >= 0 ? 0 : max_ll(a.lo, -m);
+    long long hi = a.hi <= 0 ? 0 : min_ll(a.hi, m);
+    return make_range(lo, hi);
+}
+
+/* Resultado de una comparación: 1 si siempre es verdadera, 0 si siempre es falsa, -1 si no se sabe. */
+static int compare_outcome(IROperation op, Range a, Range b)
+{
+    switch (op)
+    {
+    case IR_LT:
+        return a.hi < b.lo ? 1 : a.lo >= b.hi ? 0 : -1;
+    case IR_LE:
+        return a.hi <= b.lo ? 1 : a.lo > b.hi ? 0 : -1;
+    case IR_GT:
+        return a.lo > b.hi ? 1 : a.hi <= b.lo ? 0 : -1;
+    case IR_GE:
+        return a.lo >= b.hi ? 1 : a.hi < b.lo ? 0 : -1;
+    case IR_EQ:
+        if (a.lo == a.hi && b.lo == b.hi && a.lo == b.lo)
+            return 1;
+        return (a.hi < b.lo || b.hi < a.lo) ? 0 : -1;
+    case IR_NE:
+        if (a.lo == a.hi && b.lo == b.hi && a.lo == b.lo)
+            return 0;
+        return (a.hi < b.lo || b.hi < a.lo) ? 1 : -1;
+    default:
+        return -1;
+    }
+}
+
+static Range truth_range(Range r)
+{
+    if (r.lo == 0 && r.hi == 0)
+        return make_range(0, 0);
+    if (r.lo > 0 || r.hi < 0)
+        return make_range(1, 1);
+    return make_range(0, 1);
+}
+
+/* Rango del resultado de un cuádruplo a partir del estado actual. */
+static Range evaluate(RangeState *st, const Quadruple *q, int i)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    Range a = operand_range(st, q->arg1, cfg->use1[i]);
+    Range b = operand_range(st, q->arg2, cfg->use2[i]);
+
+    switch (q->op)
+    {
+    case IR_ASSIGN:
+        return a;
+    case IR_ADD:
+        return add_ranges(a, b);
+    case IR_SUB:
+        return sub_ranges(a, b);
+    case IR_MUL:
+        return mul_ranges(a, b);
+    case IR_DIV:
+    case IR_UDIV:
+        return div_ranges(a, b);
+    case IR_MOD:
+    case IR_UMOD:
+        return mod_ranges(a, b);
+    case IR_NEG:
+        return a.lo == LLONG_MIN ? RANGE_TOP : make_range(-a.hi, -a.lo);
+    case IR_LT:
+    case IR_GT:
+    case IR_LE:
+    case IR_GE:
+    case IR_EQ:
+    case IR_NE:
+    {
+        int outcome = compare_outcome(q->op, a, b);
+        return outcome == -1 ? make_range(0, 1) : make_range(outcome, outcome);
+    }
+    case IR_NOT:
+    {
+        Range t = truth_range(a);
+        return make_range(1 - t.hi, 1 - t.lo);
+    }
+    case IR_AND:
+    case IR_OR:
+        // El backend las calcula bit a bit sobre valores 0/1
+        if (a.lo >= 0 && a.hi <= 1 && b.lo >= 0 && b.hi <= 1)
+        {
+            if (q->op == IR_AND)
+                return make_range(a.lo & b.lo, a.hi & b.hi);
+            return make_range(a.lo | b.lo, a.hi | b.hi);
+        }
+        return RANGE_TOP;
+    case IR_SHR:
+    {
+        long long k;
+        if (!int_literal(q->arg2, &k) || k < 0 || k > 63)
+            return RANGE_TOP;
+        return make_range(a.lo >> k, a.hi >> k);
+    }
+    case IR_SHL:
+    {
+        long long k;
+        if (!int_literal(q->arg2, &k) || k < 0 || k > 62)
+            return RANGE_TOP;
+        return mul_ranges(a, make_range(1LL << k, 1LL << k));
+    }
+    case IR_BAND:
+        if (a.lo >= 0 && b.lo >= 0)
+            return make_range(0, min_ll(a.hi, b.hi));
+        if (a.lo >= 0)
+            return make_range(0, a.hi);
+        if (b.lo >= 0)
+            return make_range(0, b.hi);
+        return RANGE_TOP;
+    default:
+        return RANGE_TOP;
+    }
+}
+
+static void transfer_quad(RangeState *st, int i)
+{
+    int d = st->cfg->def[i];
+    if (d == -1 || !st->tracked[d])
+        return;
+    st->cur[d] = evaluate(st, &st->cfg->code[i], i);
+}
+
+static void load_block_state(RangeState *st, int b)
+{
+    for (int j = st->live_start[b]; j < st->live_start[b + 1]; j++)
+        st->cur[st->live_vars[j]] = st->in[j];
+}
+
+/*
+ * Acota los operandos de la comparación x op y sabiendo que su resultado fue
+ * truth. Devuelve 0 si la combinación es imposible.
+ */
+static int refine_compare(IROperation op, int truth, Range *x, Range *y)
+{
+    if (!truth)
+    {
+        switch (op)
+        {
+        case IR_LT: op = IR_GE; break;
+        case IR_GT: op = IR_LE; break;
+        case IR_LE: op = IR_GT; break;
+        case IR_GE: op = IR_LT; break;
+        case IR_EQ: op = IR_NE; break;
+        default: op = IR_EQ; break;
+        }
+    }
+
+    switch (op)
+    {
+    case IR_LT:
+        if (y->hi == LLONG_MIN || x->lo == LLONG_MAX)
+            return 0;
+        x->hi = min_ll(x->hi, y->hi - 1);
+        y->lo = max_ll(y->lo, x->lo + 1);
+        break;
+    case IR_LE:
+        x->hi = min_ll(x->hi, y->hi);
+        y->lo = max_ll(y->lo, x->lo);
+        break;
+    case IR_GT:
+        return refine_compare(IR_LT, 1, y, x);
+    case IR_GE:
+        return refine_compare(IR_LE, 1, y, x);
+    case IR_EQ:
+        x->lo = y->lo = max_ll(x->lo, y->lo);
+        x->hi = y->hi = min_ll(x->hi, y->hi);
+        break;
+    default:
+        // x != y solo recorta un extremo cuando el otro lado es un valor único
+        if (y->lo == y->hi)
+        {
+            if (x->lo == y->lo && x->lo != LLONG_MAX)
+                x->lo++;
+            else if (x->hi == y->lo && x->hi != LLONG_MIN)
+                x->hi--;
+        }
+        if (x->lo == x->hi)
+        {
+            if (y->lo == x->lo && y->lo != LLONG_MAX)
+                y->lo++;
+            else if (y->hi == x->lo && y->hi != LLONG_MIN)
+                y->hi--;
+        }
+        break;
+    }
+    return !is_empty(*x) && !is_empty(*y);
+}
+
+/*
+ * Estado que llega al sucesor por una arista en la que la condición del salto
+ * final del bloque valió truth. Se escribe sobre st->cur; devuelve 0 si la
+ * arista no puede tomarse.
+ */
+static int refine_edge(RangeState *st, int b, int truth)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    int last = cfg->blocks[b].end - 1;
+    int c = cfg->use1[last];
+    if (c == -1)
+        return 1;
+
+    // La condición misma: 0 en la rama falsa, distinta de 0 en la verdadera
+    if (st->tracked[c] && st->global_index[c] != -1)
+    {
+        Range *r = &st->cur[c];
+        if (!truth)
+        {
+            if (r->lo > 0 || r->hi < 0)
+                return 0;
+            *r = make_range(0, 0);
+        }
+        else
+        {
+            if (r->lo == 0 && r->hi == 0)
+                return 0;
+            if (r->lo == 0)
+                r->lo = 1;
+            else if (r->hi == 0)
+                r->hi = -1;
+        }
+    }
+
+    // La comparación que calculó la condición justo antes del salto
+    if (last == cfg->blocks[b].start || cfg->def[last - 1] != c || !is_comparison(cfg->code[last - 1].op))
+        return 1;
+    Quadruple *cmp = &cfg->code[last - 1];
+    int x = cfg->use1[last - 1];
+    int y = cfg->use2[last - 1];
+    if (x == c || y == c)
+        return 1;
+
+    Range rx = operand_range(st, cmp->arg1, x);
+    Range ry = operand_range(st, cmp->arg2, y);
+    if (!refine_compare(cmp->op, truth, &rx, &ry))
+        return 0;
+    if (x != -1 && st->tracked[x] && st->global_index[x] != -1)
+        st->cur[x] = rx;
+    if (y != -1 && st->tracked[y] && st->global_index[y] != -1 && y != x)
+        st->cur[y] = ry;
+    return 1;
+}
+
+/*
+ * Une el estado actual (salida del bloque por una arista) en la entrada de s.
+ * Con widen, las cotas que siguen creciendo pasan directamente al infinito.
+ * Devuelve 1 si la entrada de s cambió.
+ */
+static int merge_into(RangeState *st, Range *target, char *reached, int s, int widen)
+{
+    int changed = 0;
+    for (int j = st->live_start[s]; j < st->live_start[s + 1]; j++)
+    {
+        Range r = st->cur[st->live_vars[j]];
+        if (!reached[s])
+        {
+            target[j] = r;
+            continue;
+        }
+        Range joined = hull(target[j], r);
+        if (widen)
+        {
+            if (joined.lo < target[j].lo)
+                joined.lo = LLONG_MIN;
+            if (joined.hi > target[j].hi)
+                joined.hi = LLONG_MAX;
+        }
+        if (joined.lo != target[j].lo || joined.hi != target[j].hi)
+        {
+            target[j] = joined;
+            changed = 1;
+        }
+    }
+    if (!reached[s])
+    {
+        reached[s] = 1;
+        changed = 1;
+    }
+    return changed;
+}
+
+/* Agrega el bloque a la cola de pendientes si no estaba. */
+static void push_block(RangeState *st, int b)
+{
+    if (st->dirty[b])
+        return;
+    st->dirty[b] = 1;
+
+    int k = st->queue_size++;
+    int pos = st->rpo_pos[b];
+    while (k > 0 && st->queue[(k - 1) / 2] > pos)
+    {
+        st->queue[k] = st->queue[(k - 1) / 2];
+        k = (k - 1) / 2;
+    }
+    st->queue[k] = pos;
+}
+
+/* Saca la posición pendiente más temprana en el orden postorden inverso. */
+static int pop_position(RangeState *st)
+{
+    int top = st->queue[0];
+    int last = st->queue[--st->queue_size];
+    int k = 0;
+    while (2 * k + 1 < st->queue_size)
+    {
+        int child = 2 * k + 1;
+        if (child + 1 < st->queue_size && st->queue[child + 1] < st->queue[child])
+            child++;
+        if (st->queue[child] >= last)
+            break;
+        st->queue[k] = st->queue[child];
+        k = child;
+    }
+    st->queue[k] = last;
+    return top;
+}
+
+/*
+ * Recorre el bloque desde su estado de entrada y propaga la salida a sus
+ * sucesores, acotada por la condición en cada arista. Los sucesores cuya
+ * entrada cambió quedan pendientes.
+ */
+static void propagate_block(RangeState *st, int b, Range *target, char *target_reached, int widen)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    BasicBlock *bb = &cfg->blocks[b];
+
+    load_block_state(st, b);
+    for (int i = bb->start; i < bb->end; i++)
+        transfer_quad(st, i);
+
+    Quadruple *last = &cfg->code[bb->end - 1];
+    int conditional = last->op == IR_IF_FALSE_GOTO || last->op == IR_IF_TRUE_GOTO;
+    int jump_block = conditional ? cfg->label_block[lookup_name(cfg->labels, last->result)] : -1;
+
+    // Cada arista acota su propia copia de la salida; refine_edge solo toca la
+    // condición y los operandos de la comparación, así que basta guardar esos
+    int restore = conditional && bb->num_succ > 1;
+    int touched[3] = {-1, -1, -1};
+    Range saved[3];
+    if (restore)
+    {
+        int at = bb->end - 1;
+        touched[0] = cfg->use1[at];
+        if (at > bb->start)
+        {
+            touched[1] = cfg->use1[at - 1];
+            touched[2] = cfg->use2[at - 1];
+        }
+        for (int t = 0; t < 3; t++)
+        {
+            if (touched[t] != -1)
+                saved[t] = st->cur[touched[t]];
+        }
+    }
+
+    for (int k = 0; k < bb->num_succ; k++)
+    {
+        int s = bb->succ[k];
+        if (restore)
+        {
+            for (int t = 0; t < 3; t++)
+            {
+                if (touched[t] != -1)
+                    st->cur[touched[t]] = saved[t];
+            }
+        }
+
+        int feasible = 1;
+        if (conditional && !(s == jump_block && s == b + 1))
+        {
+            // La arista del salto se toma cuando la condición vale lo que pide el salto
+            int jump_truth = last->op == IR_IF_TRUE_GOTO;
+            feasible = refine_edge(st, b, s == jump_block ? jump_truth : !jump_truth);
+        }
+        if (!feasible)
+            continue;
+
+        // Solo se ensancha en las aristas de regreso, que cierran los ciclos
+        int visit_widen = widen && st->rpo_pos[s] <= st->rpo_pos[b] && st->visits[s] >= WIDEN_AFTER_VISITS;
+        if (merge_into(st, target, target_reached, s, visit_widen))
+        {
+            st->visits[s]++;
+            push_block(st, s);
+        }
+    }
+}
+
+static void set_entry_state(RangeState *st, Range *target, char *target_reached)
+{
+    // Todas las variables empiezan en 0 en .bss
+    for (int j = st->live_start[0]; j < st->live_start[1]; j++)
+        target[j] = make_range(0, 0);
+    target_reached[0] = 1;
+}
+
+static void solve(RangeState *st, const int *order, int num_reachable)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    set_entry_state(st, st->in, st->reached);
+
+    push_block(st, 0);
+    while (st->queue_size > 0)
+    {
+        int b = order[pop_position(st)];
+        st->dirty[b] = 0;
+        propagate_block(st, b, st->in, st->reached, 1);
+    }
+
+    // Estrechamiento: recalcular cada entrada desde el punto fijo ensanchado
+    size_t cells = (size_t)st->live_start[cfg->num_blocks];
+    Range *next = xcalloc((cells + 1) * sizeof(Range));
+    char *next_reached = xcalloc(cfg->num_blocks + 1);
+    for (int step = 0; step < NARROWING_STEPS; step++)
+    {
+        memset(next_reached, 0, cfg->num_blocks);
+        set_entry_state(st, next, next_reached);
+        // El bloque de entrada también puede tener predecesores
+        for (int k = 0; k < num_reachable; k++)
+        {
+            int b = order[k];
+            if (st->reached[b])
+                propagate_block(st, b, next, next_reached, 0);
+        }
+        // Cada paso recorre todos los bloques alcanzados: la cola no se usa
+        st->queue_size = 0;
+        memset(st->dirty, 0, cfg->num_blocks);
+        memcpy(st->in, next, cells * sizeof(Range));
+        memcpy(st->reached, next_reached, cfg->num_blocks);
+    }
+    free(next);
+    free(next_reached);
+}
+
+static void replace_operand(char **field, long long value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", value);
+    free(*field);
+    *field = xstrdup(buffer);
+}
+
+/* Reescribe un cuádruplo con los rangos del punto donde se ejecuta. */
+static int rewrite_quad(RangeState *st, int i)
+{
+    ControlFlowGraph *cfg = st->cfg;
+    Quadruple *q = &cfg->code[i];
+    int changes = 0;
+
+    // Variables con un único valor posible
+    if (cfg->use1[i] != -1 && st->tracked[cfg->use1[i]] && q->arg1 && !es_literal(q->arg1))
+    {
+        Range r = st->cur[cfg->use1[i]];
+        if (r.lo == r.hi)
+        {
+            replace_operand(&q->arg1, r.lo);
+            changes++;
+        }
+    }
+    if (cfg->use2[i] != -1 && st->tracked[cfg->use2[i]] && q->arg2 && !es_literal(q->arg2))
+    {
+        Range r = st->cur[cfg->use2[i]];
+        if (r.lo == r.hi)
+        {
+            replace_operand(&q->arg2, r.lo);
+            changes++;
+        }
+    }
+
+    int d = cfg->def[i];
+    if (d == -1 || !st->tracked[d])
+        return changes;
+
+    Range a = operand_range(st, q->arg1, cfg->use1[i]);
+    Range b = operand_range(st, q->arg2, cfg->use2[i]);
+
+    if (is_comparison(q->op))
+    {
+        int outcome = compare_outcome(q->op, a, b);
+        if (outcome != -1)
+        {
+            emit_remark("ranges", REMARK_APPLIED, q, "la comparación siempre es %s: %s está en [%lld, %lld] y %s en [%lld, %lld]",
+                        outcome ? "verdadera" : "falsa", q->arg1, a.lo, a.hi, q->arg2, b.lo, b.hi);
+            free(q->arg1);
+            free(q->arg2);
+            q->op = IR_ASSIGN;
+            q->arg1 = strdup(outcome ? "1" : "0");
+            q->arg2 = NULL;
+            changes++;
+        }
+        return changes;
+    }
+
+    if ((q->op == IR_DIV || q->op == IR_MOD) && a.lo >= 0)
+    {
+        long long divisor;
+        int k = int_literal(q->arg2, &divisor) ? power_of_two(divisor) : -1;
+        char buffer[32];
+        if (k > 0)
+        {
+            emit_remark("ranges", REMARK_APPLIED, q, "%s no es negativo ([%lld, %lld]): la división entre %lld se vuelve %s",
+                        q->arg1, a.lo, a.hi, divisor, q->op == IR_DIV ? "un corrimiento" : "una máscara");
+            // Para un dividendo no negativo, x / 2^k = x >> k y x % 2^k = x & (2^k - 1)
+            snprintf(buffer, sizeof(buffer), "%lld", q->op == IR_DIV ? (long long)k : divisor - 1);
+            q->op = q->op == IR_DIV ? IR_SHR : IR_BAND;
+            free(q->arg2);
+            q->arg2 = strdup(buffer);
+            changes++;
+        }
+        else if (a.hi <= (long long)UINT32_MAX && b.lo >= 0 && b.hi <= (long long)UINT32_MAX)
+        {
+            emit_remark("ranges", REMARK_APPLIED, q, "los operandos caben en 32 bits sin signo: se usa div de 32 bits");
+            q->op = q->op == IR_DIV ? IR_UDIV : IR_UMOD;
+            changes++;
+        }
+        else
+        {
+            emit_remark("ranges", REMARK_MISSED, q, "la división no se reduce: los operandos no caben en 32 bits sin signo");
+        }
+    }
+    else if (q->op == IR_DIV || q->op == IR_MOD)
+    {
+        emit_remark("ranges", REMARK_MISSED, q, "la división no se reduce: %s puede ser negativo ([%lld, %lld])", q->arg1,
+                    a.lo, a.hi);
+    }
+    return changes;
+}
+
+/*
+ * Ciclos naturales: por cada arista de regreso p -> h (h domina a p) se busca
+ * una variable cuya única definición dentro del ciclo es v = v + c (c literal
+ * distinto de 0) en un bloque que domina a todas las aristas de regreso. Cada
+ * vuelta la mueve c, y en el encabezado nunca sale de su rango, así que el
+ * encabezado se visita a lo más (hi - lo) / |c| + 1 veces.
+ */
+static void publish_header_range(const char *label, const char *var, Range r, int *capacity)
+{
+    char key[256];
+    if (snprintf(key, sizeof(key), "%s %s", label, var) >= (int)sizeof(key))
+        return;
+    int id = intern_name(header_range_keys, key);
+    if (id >= *capacity)
+    {
+        *capacity = *capacity == 0 ? 64 : *capacity * 2;
+        header_ranges = realloc(header_ranges, *capacity * sizeof(Range));
+        if (header_ranges == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo asignar memoria para el análisis de rangos.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    header_ranges[id] = r;
+}
+
+static void publish_trip_bounds(RangeState *st, const int *idom)
+{
+    ControlFlowGraph *cfg = st->cfg;
+
+    destroy_name_table(trip_labels);
+    free(trip_bounds);
+    trip_labels = create_name_table(16);
+    trip_bounds = NULL;
+    int capacity = 0;
+    header_range_keys = create_name_table(64);
+    int ranges_capacity = 0;
+
+    int num_vars = cfg->vars->count;
+    int *def_count = xcalloc((num_vars + 1) * sizeof(int));
+    int *def_at = xcalloc((num_vars + 1) * sizeof(int));
+    int *header_stamp = xcalloc((num_vars + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+        header_stamp[v] = -1;
+    NaturalLoop *loops;
+    int num_loops = find_natural_loops(cfg, idom, &loops);
+
+    for (int l = 0; l < num_loops; l++)
+    {
+        int h = loops[l].header;
+        const char *in_loop = loops[l].in_loop;
+        BasicBlock *hb = &cfg->blocks[h];
+        if (!st->reached[h] || cfg->code[hb->start].op != IR_LABEL)
+            continue;
+
+        // Rangos a la entrada del encabezado; header_stamp marca cuáles son de este ciclo
+        load_block_state(st, h);
+        for (int j = st->live_start[h]; j < st->live_start[h + 1]; j++)
+            header_stamp[st->live_vars[j]] = l;
+
+        for (int k = 0; k < loops[l].num_blocks; k++)
+        {
+            BasicBlock *bb = &cfg->blocks[loops[l].blocks[k]];
+            for (int i = bb->start; i < bb->end; i++)
+            {
+                if (cfg->def[i] != -1)
+                    def_count[cfg->def[i]] = 0;
+            }
+        }
+
+        long long best = -1;
+        int best_var = -1;
+        for (int k = 0; k < loops[l].num_blocks; k++)
+        {
+            BasicBlock *bb = &cfg->blocks[loops[l].blocks[k]];
+            for (int i = bb->start; i < bb->end; i++)
+            {
+                int d = cfg->def[i];
+                if (d != -1)
+                {
+                    def_count[d]++;
+                    def_at[d] = i;
+                }
+
+                // Rango a la entrada del encabezado de cada variable acotada que el ciclo lee
+                int uses[2] = {cfg->use1[i], cfg->use2[i]};
+                for (int u = 0; u < 2; u++)
+                {
+                    if (uses[u] == -1 || header_stamp[uses[u]] != l)
+                        continue;
+                    Range r = st->cur[uses[u]];
+                    if (is_bounded(r) && !is_empty(r))
+                        publish_header_range(cfg->code[hb->start].result, cfg->vars->names[uses[u]], r,
+                                             &ranges_capacity);
+                }
+            }
+        }
+
+        for (int k = 0; k < loops[l].num_blocks; k++)
+        {
+            BasicBlock *bb = &cfg->blocks[loops[l].blocks[k]];
+            for (int i = bb->start; i < bb->end; i++)
+            {
+                int v = cfg->def[i];
+                if (v == -1 || def_count[v] != 1 || header_stamp[v] != l)
+                    continue;
+                Quadruple *q = &cfg->code[i];
+                long long step;
+                if (q->op != IR_ADD || cfg->use1[i] != v || !int_literal(q->arg2, &step) || step == 0 ||
+                    step == LLONG_MIN)
+                    continue;
+
+                // El incremento debe ejecutarse en toda vuelta
+                int def_block = cfg->block_of[i];
+                int every_latch = 1;
+                for (int p = 0; p < hb->num_pred && every_latch; p++)
+                {
+                    int pred = hb->pred[p];
+                    if (in_loop[pred])
+                        every_latch = block_dominates(idom, def_block, pred);
+                }
+                if (!every_latch)
+                    continue;
+
+                Range r = st->cur[v];
+                if (!is_bounded(r))
+                    continue;
+                unsigned long long span = (unsigned long long)r.hi - (unsigned long long)r.lo;
+                unsigned long long trips = span / (unsigned long long)(step < 0 ? -step : step) + 1;
+                if (trips > (unsigned long long)LLONG_MAX)
+                    continue;
+                if (best == -1 || (long long)trips < best)
+                {
+                    best = (long long)trips;
+                    best_var = v;
+                }
+            }
+        }
+
+        if (best == -1)
+        {
+            emit_remark("ranges", REMARK_MISSED, &cfg->code[hb->start],
+                        "no se acota el número de iteraciones: no hay una variable de inducción con rango finito");
+            continue;
+        }
+        emit_remark("ranges", REMARK_APPLIED, &cfg->code[hb->start], "el ciclo entra a lo más %lld veces a su encabezado ('%s')",
+                    best, cfg->vars->names[best_var]);
+        int id = intern_name(trip_labels, cfg->code[hb->start].result);
+        if (id >= capacity)
+        {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            trip_bounds = realloc(trip_bounds, capacity * sizeof(long long));
+            if (trip_bounds == NULL)
+            {
+                fprintf(stderr, "Error: No se pudo asignar memoria para el análisis de rangos.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        trip_bounds[id] = best;
+    }
+
+    free_natural_loops(loops, num_loops);
+    free(def_count);
+    free(def_at);
+    free(header_stamp);
+}
+
+int get_loop_trip_bound(const char *header_label, long long *max_trips)
+{
+    int id = trip_labels ? lookup_name(trip_labels, header_label) : -1;
+    if (id == -1)
+        return 0;
+    *max_trips = trip_bounds[id];
+    return 1;
+}
+
+int get_loop_header_range(const char *header_label, const char *var, long long *lo, long long *hi)
+{
+    char key[256];
+    if (header_range_keys == NULL || snprintf(key, sizeof(key), "%s %s", header_label, var) >= (int)sizeof(key))
+        return 0;
+    int id = lookup_name(header_range_keys, key);
+    if (id == -1)
+        return 0;
+    *lo = header_ranges[id].lo;
+    *hi = header_ranges[id].hi;
+    return 1;
+}
+
+int analyze_value_ranges()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+
+    destroy_name_table(trip_labels);
+    trip_labels = NULL;
+    destroy_name_table(header_range_keys);
+    header_range_keys = NULL;
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+
+    RangeState st;
+    st.cfg = cfg;
+    st.global_index = xcalloc((num_vars + 1) * sizeof(int));
+    st.num_globals = find_global_names(cfg, st.global_index);
+
+    st.tracked = xcalloc(num_vars + 1);
+    for (int v = 0; v < num_vars; v++)
+    {
+        enum TipoDato tipo = get_ir_type(cfg->vars->names[v]);
+        st.tracked[v] = tipo == INT || tipo == BOOL;
+    }
+
+    // Estado disperso: por bloque, solo las globales rastreadas vivas a su entrada
+    BitSet **live_in = compute_live_in(cfg, st.global_index, st.num_globals);
+    int *global_vars = xcalloc((st.num_globals + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+    {
+        if (st.global_index[v] != -1)
+            global_vars[st.global_index[v]] = v;
+    }
+    st.live_start = xcalloc((cfg->num_blocks + 1) * sizeof(int));
+    size_t cells = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        st.live_start[b] = (int)cells;
+        for (int g = bitset_siguiente(live_in[b], 0); g != -1; g = bitset_siguiente(live_in[b], g + 1))
+        {
+            if (st.tracked[global_vars[g]])
+                cells++;
+        }
+        if (cells > RANGE_MAX_STATE_CELLS)
+            break;
+    }
+    if (cells > RANGE_MAX_STATE_CELLS)
+    {
+        emit_remark("ranges", REMARK_MISSED, NULL,
+                    "no se analizan los rangos: el estado en las fronteras de los bloques pasa de %d celdas",
+                    RANGE_MAX_STATE_CELLS);
+        free_block_sets(live_in, cfg->num_blocks);
+        free(global_vars);
+        free(st.live_start);
+        free(st.tracked);
+        free(st.global_index);
+        free_cfg(cfg);
+        return 0;
+    }
+    st.live_start[cfg->num_blocks] = (int)cells;
+    st.live_vars = xcalloc((cells + 1) * sizeof(int));
+    for (int b = 0, j = 0; b < cfg->num_blocks; b++)
+    {
+        for (int g = bitset_siguiente(live_in[b], 0); g != -1; g = bitset_siguiente(live_in[b], g + 1))
+        {
+            if (st.tracked[global_vars[g]])
+                st.live_vars[j++] = global_vars[g];
+        }
+    }
+    free_block_sets(live_in, cfg->num_blocks);
+    free(global_vars);
+
+    st.cur = xcalloc((num_vars + 1) * sizeof(Range));
+    for (int v = 0; v < num_vars; v++)
+        st.cur[v] = RANGE_TOP;
+    st.in = xcalloc((cells + 1) * sizeof(Range));
+    st.reached = calloc(cfg->num_blocks + 1, 1);
+    st.visits = calloc(cfg->num_blocks + 1, sizeof(int));
+    st.dirty = calloc(cfg->num_blocks + 1, 1);
+    st.queue = xcalloc((cfg->num_blocks + 1) * sizeof(int));
+    st.queue_size = 0;
+    int *order = xcalloc((cfg->num_blocks + 1) * sizeof(int));
+    int *idom = xcalloc((cfg->num_blocks + 1) * sizeof(int));
+    if (st.reached == NULL || st.visits == NULL || st.dirty == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el análisis de rangos.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int num_reachable = compute_rpo(cfg, order);
+    st.rpo_pos = xcalloc((cfg->num_blocks + 1) * sizeof(int));
+    for (int k = 0; k < num_reachable; k++)
+        st.rpo_pos[order[k]] = k;
+    compute_dominators(cfg, order, num_reachable, idom);
+    solve(&st, order, num_reachable);
+    publish_trip_bounds(&st, idom);
+
+    int changes = 0;
+    for (int k = 0; k < num_reachable; k++)
+    {
+        int b = order[k];
+        if (!st.reached[b])
+            continue;
+        load_block_state(&st, b);
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            changes += rewrite_quad(&st, i);
+            transfer_quad(&st, i);
+        }
+    }
+
+    free(order);
+    free(idom);
+    free(st.global_index);
+    free(st.tracked);
+    free(st.live_start);
+    free(st.live_vars);
+    free(st.cur);
+    free(st.in);
+    free(st.queue);
+    free(st.reached);
+    free(st.visits);
+    free(st.dirty);
+    free(st.rpo_pos);
+    free_cfg(cfg);
+    return changes;
+}
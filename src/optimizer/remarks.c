@@ -0,0 +1,105 @@
+#include "remarks.h"
+#include "cfg.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Reportes de optimización (-remarks).
+ *
+ * Los reportes se guardan ya serializados en una tabla de nombres: así una
+ * pasada que vuelve a ejecutarse en el punto fijo y encuentra la misma
+ * oportunidad descartada no la reporta dos veces, y el archivo conserva el
+ * orden en que se produjeron.
+ */
+
+static NameTable *remarks = NULL;
+static char *remarks_path = NULL;
+
+void open_remarks(const char *ruta)
+{
+    destroy_name_table(remarks);
+    free(remarks_path);
+    remarks = create_name_table(64);
+    remarks_path = strdup(ruta);
+    if (remarks_path == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para los reportes de optimización.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int remarks_enabled()
+{
+    return remarks != NULL;
+}
+
+/* Agrega s a buffer como cadena JSON. */
+static int append_json_string(char *buffer, int length, int capacity, const char *s)
+{
+    length += snprintf(buffer + length, length < capacity ? capacity - length : 0, "\"");
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++)
+    {
+        int room = length < capacity ? capacity - length : 0;
+        if (*p == '"' || *p == '\\')
+            length += snprintf(buffer + length, room, "\\%c", *p);
+        else if (*p < 0x20)
+            length += snprintf(buffer + length, room, "\\u%04x", *p);
+        else
+            length += snprintf(buffer + length, room, "%c", *p);
+    }
+    length += snprintf(buffer + length, length < capacity ? capacity - length : 0, "\"");
+    return length;
+}
+
+void emit_remark(const char *pass, RemarkKind kind, const Quadruple *q, const char *formato, ...)
+{
+    if (remarks == NULL)
+        return;
+
+    char reason[512];
+    va_list args;
+    va_start(args, formato);
+    vsnprintf(reason, sizeof(reason), formato, args);
+    va_end(args);
+
+    char record[4096]; // cabe el motivo aunque cada carácter se escape
+    int capacity = (int)sizeof(record);
+    int length = snprintf(record, capacity, "{\"pass\":");
+    length = append_json_string(record, length, capacity, pass);
+    length += snprintf(record + length, length < capacity ? capacity - length : 0,
+                       ",\"kind\":\"%s\",\"line\":%d,\"column\":%d,\"op\":",
+                       kind == REMARK_APPLIED ? "applied" : "missed", q ? q->renglon : 0, q ? q->columna : 0);
+    length = append_json_string(record, length, capacity, q && q->op != IR_REMOVED ? ir_op_name(q->op) : "");
+    length += snprintf(record + length, length < capacity ? capacity - length : 0, ",\"reason\":");
+    length = append_json_string(record, length, capacity, reason);
+    length += snprintf(record + length, length < capacity ? capacity - length : 0, "}");
+    if (length >= capacity)
+        return; // un reporte truncado ya no sería JSON válido
+
+    intern_name(remarks, record);
+}
+
+void close_remarks()
+{
+    if (remarks == NULL)
+        return;
+
+    FILE *f = fopen(remarks_path, "w");
+    if (f == NULL)
+    {
+        perror(remarks_path);
+    }
+    else
+    {
+        for (int id = 0; id < remarks->count; id++)
+            fprintf(f, "%s\n", remarks->names[id]);
+        fclose(f);
+    }
+
+    destroy_name_table(remarks);
+    free(remarks_path);
+    remarks = NULL;
+    remarks_path = NULL;
+}
@@ -0,0 +1,272 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Rotación de ciclos.
+ *
+ * Mientras y Para se traducen con la prueba arriba:
+ *
+ *     H:  prueba; IF_FALSE_GOTO t, X; cuerpo; GOTO H
+ *
+ * así que cada vuelta ejecuta el salto condicional y el GOTO de regreso. La
+ * rotación deja la prueba original como guarda de entrada y pone una copia
+ * al final, donde un solo IF_TRUE_GOTO regresa al cuerpo:
+ *
+ *     H:  prueba; IF_FALSE_GOTO t, X
+ *     B:  cuerpo
+ *     P:  prueba; IF_TRUE_GOTO t, B; GOTO X (si X no sigue)
+ *
+ * Los saltos del cuerpo al encabezado (Continuar en Mientras) pasan a P; el
+ * Continuar de Para ya salta a su etiqueta de incremento, que queda antes de
+ * P. La prueba se evalúa las mismas veces que antes, así que puede copiarse
+ * aunque lea datos o tenga efectos. Solo se rotan los ciclos cuya prueba es
+ * un bloque (sin cortocircuito) de a lo más el presupuesto del nivel.
+ *
+ * Un ciclo que cuenta hacia cero de uno en uno (i > 0 con i = i - 1 como
+ * única escritura de i, o i < 0 con i = i + 1) repite abajo la prueba como
+ * i != 0: al llegar a la copia, la vuelta empezó con i > 0 y a lo más restó
+ * uno, así que las dos pruebas coinciden, y el backend salta con las
+ * banderas del decremento sin comparar (dec/jnz).
+ *
+ * Se ejecuta una vez, después del desenrollado, que reconoce la forma con
+ * la prueba arriba.
+ */
+
+static int is_literal_value(const char *s, const char *value)
+{
+    return s != NULL && strcmp(s, value) == 0;
+}
+
+/*
+ * Variable de la prueba v > 0 (o v < 0) si v es Entero, su única escritura
+ * en el ciclo la acerca a cero en uno, y esa escritura no está en un ciclo
+ * interno, donde podría ejecutarse varias veces por vuelta. NULL si no.
+ */
+static const char *countdown_variable(ControlFlowGraph *cfg, const NaturalLoop *loops, int num_loops, int l,
+                                      const Quadruple *test)
+{
+    const char *var;
+    int direction; // -1: v > 0 y v baja, 1: v < 0 y v sube
+    if (test->op == IR_GT && is_literal_value(test->arg2, "0") && !es_literal(test->arg1))
+        var = test->arg1, direction = -1;
+    else if (test->op == IR_LT && is_literal_value(test->arg1, "0") && !es_literal(test->arg2))
+        var = test->arg2, direction = -1;
+    else if (test->op == IR_LT && is_literal_value(test->arg2, "0") && !es_literal(test->arg1))
+        var = test->arg1, direction = 1;
+    else if (test->op == IR_GT && is_literal_value(test->arg1, "0") && !es_literal(test->arg2))
+        var = test->arg2, direction = 1;
+    else
+        return NULL;
+    if (get_ir_type(var) != INT)
+        return NULL;
+
+    const NaturalLoop *loop = &loops[l];
+    int v = lookup_name(cfg->vars, var);
+    int def_at = -1;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (!loop->in_loop[b])
+            continue;
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            if (cfg->def[i] != v)
+                continue;
+            if (def_at != -1)
+                return NULL;
+            def_at = i;
+        }
+    }
+    if (def_at == -1)
+        return NULL;
+
+    const Quadruple *q = &cfg->code[def_at];
+    const char *one = direction == -1 ? "1" : "-1";
+    const char *minus_one = direction == -1 ? "-1" : "1";
+    int steps = (q->op == IR_SUB && cfg->use1[def_at] == v && is_literal_value(q->arg2, one)) ||
+                (q->op == IR_ADD && cfg->use1[def_at] == v && is_literal_value(q->arg2, minus_one)) ||
+                (q->op == IR_ADD && cfg->use2[def_at] == v && is_literal_value(q->arg1, minus_one));
+    if (!steps)
+        return NULL;
+
+    int b = cfg->block_of[def_at];
+    for (int k = 0; k < num_loops; k++)
+    {
+        if (k != l && loops[k].in_loop[b] && loop->in_loop[loops[k].header])
+            return NULL;
+    }
+    return var;
+}
+
+/* Cuádruplos de prueba que se pueden copiar al final del ciclo según el nivel. */
+static int test_budget()
+{
+    return get_optimization_level() == OPT_O2 ? 16 : 4;
+}
+
+/*
+ * Rota el ciclo si tiene la forma de Mientras/Para; los cuádruplos nuevos
+ * quedan en pending. Devuelve 1 si el ciclo se rota.
+ */
+static int plan_rotation(ControlFlowGraph *cfg, const NaturalLoop *loops, int num_loops, int l, int *label_refs,
+                         PendingQuads *pending)
+{
+    const NaturalLoop *loop = &loops[l];
+    Quadruple *code = cfg->code;
+    BasicBlock *header = &cfg->blocks[loop->header];
+    int hs = header->start;
+    int branch_at = header->end - 1;
+    if (code[hs].op != IR_LABEL || branch_at <= hs + 1 || code[branch_at].op != IR_IF_FALSE_GOTO)
+        return 0;
+    if (branch_at - hs - 1 > test_budget())
+        return 0;
+    int exit_id = lookup_name(cfg->labels, code[branch_at].result);
+    if (exit_id == -1 || loop->in_loop[cfg->label_block[exit_id]])
+        return 0;
+
+    // El ciclo ocupa un tramo contiguo que termina en el GOTO de regreso
+    int end = hs;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (!loop->in_loop[b])
+            continue;
+        if (cfg->blocks[b].start < hs)
+            return 0;
+        if (cfg->blocks[b].end > end)
+            end = cfg->blocks[b].end;
+    }
+    int blocks_in_range = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (cfg->blocks[b].start >= hs && cfg->blocks[b].start < end)
+        {
+            if (!loop->in_loop[b])
+                return 0;
+            blocks_in_range++;
+        }
+    }
+    const char *header_label = code[hs].result;
+    if (blocks_in_range != loop->num_blocks || end - 1 == branch_at)
+        return 0;
+    if (code[end - 1].op != IR_GOTO || strcmp(code[end - 1].result, header_label) != 0)
+        return 0;
+
+    emit_remark("rotate", REMARK_APPLIED, &code[branch_at],
+                "el ciclo de %s se rota: la prueba se repite al final con un solo salto condicional", header_label);
+
+    char *body_label = new_label();
+    char *test_label = new_label();
+
+    // Las demás aristas de regreso (Continuar en Mientras) llegan a la prueba de abajo
+    int back_edges = 1;
+    for (int i = branch_at + 1; i < end - 1; i++)
+    {
+        Quadruple *q = &code[i];
+        if (is_jump(q->op) && strcmp(q->result, header_label) == 0)
+        {
+            free(q->result);
+            q->result = xstrdup(test_label);
+            back_edges++;
+        }
+    }
+    // También el GOTO de salida de un ciclo interno ya rotado, que aún no está en code
+    for (int p = 0; p < pending->count; p++)
+    {
+        Quadruple *q = &pending->quads[p].quad;
+        int position = pending->quads[p].position;
+        if (position > branch_at && position < end - 1 && is_jump(q->op) && strcmp(q->result, header_label) == 0)
+        {
+            free(q->result);
+            q->result = xstrdup(test_label);
+            back_edges++;
+        }
+    }
+
+    add_pending_quad(pending, branch_at + 1, 0, IR_LABEL, NULL, NULL, body_label, &code[branch_at]);
+
+    Quadruple *back = &code[end - 1];
+    add_pending_quad(pending, end - 1, 0, IR_LABEL, NULL, NULL, test_label, back);
+    const char *countdown = branch_at == hs + 2 ? countdown_variable(cfg, loops, num_loops, l, &code[hs + 1]) : NULL;
+    if (countdown != NULL)
+    {
+        emit_remark("rotate", REMARK_APPLIED, &code[hs + 1],
+                    "'%s' cuenta hacia cero: la prueba de abajo es %s != 0", countdown, countdown);
+        add_pending_quad(pending, end - 1, 0, IR_NE, countdown, "0", code[hs + 1].result, &code[hs + 1]);
+    }
+    else
+    {
+        for (int i = hs + 1; i < branch_at; i++)
+            add_pending_quad(pending, end - 1, 0, code[i].op, code[i].arg1, code[i].arg2, code[i].result, &code[i]);
+    }
+    add_pending_quad(pending, end - 1, 0, IR_IF_TRUE_GOTO, code[branch_at].arg1, NULL, body_label, &code[branch_at]);
+    if (end == cfg->size || code[end].op != IR_LABEL || strcmp(code[end].result, code[branch_at].result) != 0)
+    {
+        // Cuenta como referencia para un ciclo externo que salga a la misma etiqueta
+        add_pending_quad(pending, end - 1, 0, IR_GOTO, NULL, NULL, code[branch_at].result, back);
+        label_refs[exit_id]++;
+    }
+    free(back->result);
+    back->result = NULL;
+    back->op = IR_REMOVED;
+
+    // Sin saltos de fuera, la etiqueta del encabezado ya no tiene referencias
+    if (label_refs[lookup_name(cfg->labels, header_label)] == back_edges)
+    {
+        free(code[hs].result);
+        code[hs].result = NULL;
+        code[hs].op = IR_REMOVED;
+    }
+
+    free(body_label);
+    free(test_label);
+    return 1;
+}
+
+int rotate_loops()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_blocks = cfg->num_blocks;
+
+    int *order = xcalloc(num_blocks * sizeof(int));
+    int *idom = xcalloc(num_blocks * sizeof(int));
+    int num_reachable = compute_rpo(cfg, order);
+    compute_dominators(cfg, order, num_reachable, idom);
+
+    NaturalLoop *loops;
+    int num_loops = find_natural_loops(cfg, idom, &loops);
+
+    // Saltos que llegan a cada etiqueta
+    int *label_refs = xcalloc((cfg->labels->count + 1) * sizeof(int));
+    for (int i = 0; i < size; i++)
+    {
+        if (is_jump(code[i].op))
+        {
+            int id = lookup_name(cfg->labels, code[i].result);
+            if (id != -1)
+                label_refs[id]++;
+        }
+    }
+
+    PendingQuads pending = {NULL, 0, 0};
+    int rotated = 0;
+    for (int l = 0; l < num_loops; l++)
+        rotated += plan_rotation(cfg, loops, num_loops, l, label_refs, &pending);
+
+    if (rotated > 0)
+        splice_pending_quads(&pending);
+    free_pending_quads(&pending);
+    free(label_refs);
+    free_natural_loops(loops, num_loops);
+    free(order);
+    free(idom);
+    free_cfg(cfg);
+    return rotated;
+}
@@ -0,0 +1,639 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "bitset.h"
+#include "remarks.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Forma cerrada de los ciclos de acumulación (evolución escalar).
+ *
+ * Se reconocen los ciclos internos con la forma de Para y Mientras (un
+ * encabezado con una comparación entre una variable de inducción básica i y
+ * un invariante, un cuerpo de un solo bloque y un GOTO de regreso) cuyo
+ * cuerpo no tiene efectos y solo escribe:
+ *   - i, una vez por vuelta (i = i ± c);
+ *   - acumuladores s = s ± e, donde e es un invariante, a * i o i * i (con i
+ *     antes o después del incremento) o la suma de esas formas;
+ *   - temporales que no siguen vivos a la salida.
+ * Si x_k es el valor de i en la vuelta k, la suma de N vueltas es
+ *
+ *     N * A + B * (N * x_0 + c * T) + C * (N * x_0² + 2 * x_0 * c * T + c² * Q)
+ *
+ * con T = 0 + 1 + ... + (N - 1) y Q = 0² + 1² + ... + (N - 1)². El ciclo se
+ * reemplaza por ese cálculo delante del encabezado.
+ *
+ * El código intermedio usa aritmética de 64 bits que da la vuelta, así que el
+ * resultado debe coincidir módulo 2^64 con el del ciclo. Las sumas y
+ * productos lo hacen por sí solos; las divisiones entre 2 y 3 no: T se
+ * calcula como (M / 2) * (M + 1) + (M % 2) * (M / 2 + M % 2), con M = N - 1
+ * sin signo, dividiendo solo valores exactos, y la división de T * (2M + 1)
+ * entre 3 se hace multiplicando por el inverso de 3 módulo 2^64. Dos
+ * condiciones sí cambian el comportamiento: que la distancia entre i y el
+ * límite no quepa en un Entero cuando hay que dividirla entre un paso
+ * mayor que 1, y que el incremento que termina el ciclo se desborde (el
+ * ciclo original no termina o da la vuelta). Si el análisis de rangos no las
+ * descarta, se prueban antes del cálculo y, si ocurren, se ejecuta el ciclo
+ * original, que se conserva detrás.
+ *
+ * Se ejecuta una vez, antes de la reducción de fuerza y del desenrollado,
+ * que cambian la forma que aquí se reconoce.
+ */
+
+/* Partes del valor de una variable en la vuelta k: A + B * x + x², con x = x_k o x_k + c. */
+typedef enum
+{
+    TERM_CONSTANT,
+    TERM_LINEAR,
+    TERM_SQUARE,
+    NUM_TERM_KINDS
+} TermKind;
+
+typedef struct
+{
+    int present;
+    int negative;            // se resta
+    int after;               // x = x_k + c (i leída después del incremento)
+    const char *coefficient; // A o B: literal o variable invariante
+} EvolutionTerm;
+
+typedef struct
+{
+    int known;
+    int base; // acumulador cuyo valor de la vuelta anterior se suma, -1 si no hay
+    EvolutionTerm terms[NUM_TERM_KINDS];
+} Evolution;
+
+typedef struct
+{
+    int var;
+    Evolution step; // lo que se le suma en cada vuelta
+    const Quadruple *origin;
+} Accumulator;
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    const int *global_index;
+    BitSet **live_in;
+    int *def_count; // definiciones de cada variable dentro del ciclo
+    int *def_at;
+    Evolution *evolution;
+    Accumulator *accumulators;
+} ScevContext;
+
+/* Temporal nuevo del tipo dado; el llamador lo libera. */
+static char *typed_temp(int type)
+{
+    char *t = new_temp();
+    set_ir_type(t, type);
+    return t;
+}
+
+/* Rango del operando a la entrada del encabezado; sin información, todo el Entero. */
+static void operand_range(const char *header_label, const char *operand, long long *lo, long long *hi)
+{
+    if (int_literal(operand, lo))
+    {
+        *hi = *lo;
+        return;
+    }
+    if (!get_loop_header_range(header_label, operand, lo, hi))
+    {
+        *lo = LLONG_MIN;
+        *hi = LLONG_MAX;
+    }
+}
+
+/*
+ * Evolución del operando leído en el cuádruplo at: un invariante, la variable
+ * de inducción, un temporal calculado antes en la misma vuelta o el valor
+ * anterior de una variable que se escribe después (un posible acumulador).
+ */
+static Evolution operand_evolution(ScevContext *ctx, const char *operand, int var, int at, int iv)
+{
+    Evolution e = {0};
+    e.base = -1;
+    if (is_invariant_operand(ctx->def_count, operand, var))
+    {
+        e.known = 1;
+        e.terms[TERM_CONSTANT] = (EvolutionTerm){1, 0, 0, operand};
+    }
+    else if (var == iv)
+    {
+        e.known = 1;
+        e.terms[TERM_LINEAR] = (EvolutionTerm){1, 0, at > ctx->def_at[iv], "1"};
+    }
+    else if (var != -1 && ctx->def_count[var] == 1 && ctx->def_at[var] < at)
+        e = ctx->evolution[var];
+    else if (var != -1 && ctx->def_count[var] == 1 && get_ir_type(operand) == INT)
+    {
+        e.known = 1;
+        e.base = var;
+    }
+    return e;
+}
+
+/* x con coeficiente 1 y nada más. */
+static int is_plain_iv(const Evolution *e)
+{
+    const EvolutionTerm *linear = &e->terms[TERM_LINEAR];
+    return e->known && e->base == -1 && !e->terms[TERM_CONSTANT].present && !e->terms[TERM_SQUARE].present &&
+           linear->present && !linear->negative && strcmp(linear->coefficient, "1") == 0;
+}
+
+static int is_plain_constant(const Evolution *e)
+{
+    return e->known && e->base == -1 && e->terms[TERM_CONSTANT].present && !e->terms[TERM_CONSTANT].negative &&
+           !e->terms[TERM_LINEAR].present && !e->terms[TERM_SQUARE].present;
+}
+
+/* Evolución del resultado del cuádruplo at, si es una de las formas reconocidas. */
+static Evolution quad_evolution(ScevContext *ctx, int at, int iv)
+{
+    ControlFlowGraph *cfg = ctx->cfg;
+    Quadruple *q = &cfg->code[at];
+    Evolution none = {0};
+    none.base = -1;
+    if (get_ir_type(q->result) != INT)
+        return none;
+
+    Evolution a = operand_evolution(ctx, q->arg1, cfg->use1[at], at, iv);
+    if (q->op == IR_ASSIGN)
+        return a;
+    if (q->op != IR_ADD && q->op != IR_SUB && q->op != IR_MUL && q->op != IR_SHL)
+        return none;
+    Evolution b = operand_evolution(ctx, q->arg2, cfg->use2[at], at, iv);
+    if (!a.known || !b.known)
+        return none;
+
+    if (q->op == IR_ADD || q->op == IR_SUB)
+    {
+        // Un acumulador y una parte de cada clase a lo más; el acumulador no se resta
+        if (b.base != -1 && (a.base != -1 || q->op == IR_SUB))
+            return none;
+        Evolution sum = a;
+        if (b.base != -1)
+            sum.base = b.base;
+        for (int k = 0; k < NUM_TERM_KINDS; k++)
+        {
+            if (!b.terms[k].present)
+                continue;
+            if (a.terms[k].present)
+                return none;
+            sum.terms[k] = b.terms[k];
+            sum.terms[k].negative ^= q->op == IR_SUB;
+        }
+        return sum;
+    }
+
+    if (q->op == IR_SHL)
+    {
+        long long shift;
+        if (!is_plain_iv(&a) || !int_literal(q->arg2, &shift) || shift < 0 || shift > 62)
+            return none;
+        static char factors[63][24];
+        snprintf(factors[shift], sizeof(factors[shift]), "%lld", 1LL << shift);
+        a.terms[TERM_LINEAR].coefficient = factors[shift];
+        return a;
+    }
+
+    // MUL: k * i, i * k o i * i
+    if (is_plain_iv(&a) && is_plain_constant(&b))
+    {
+        a.terms[TERM_LINEAR].coefficient = b.terms[TERM_CONSTANT].coefficient;
+        return a;
+    }
+    if (is_plain_constant(&a) && is_plain_iv(&b))
+    {
+        b.terms[TERM_LINEAR].coefficient = a.terms[TERM_CONSTANT].coefficient;
+        return b;
+    }
+    if (is_plain_iv(&a) && is_plain_iv(&b) && a.terms[TERM_LINEAR].after == b.terms[TERM_LINEAR].after)
+    {
+        Evolution square = none;
+        square.known = 1;
+        square.terms[TERM_SQUARE] = (EvolutionTerm){1, 0, a.terms[TERM_LINEAR].after, "1"};
+        return square;
+    }
+    return none;
+}
+
+static const char *literal_text(long long value, char *text, size_t size)
+{
+    snprintf(text, size, "%lld", value);
+    return text;
+}
+
+/*
+ * Agrega el cálculo de la suma de una parte en las vueltas 0..M y deja el
+ * resultado en un temporal nuevo, que el llamador libera.
+ */
+static char *emit_term_sum(PendingQuads *pending, int position, TermKind kind, const EvolutionTerm *term,
+                           const char *iv_name, long long step, const char *trips, const char *triangle,
+                           const char *squares, const Quadruple *origin)
+{
+    char text[32];
+    char *sum = typed_temp(INT);
+    if (kind == TERM_CONSTANT)
+    {
+        add_pending_quad(pending, position, 0, IR_MUL, trips, term->coefficient, sum, origin);
+        return sum;
+    }
+
+    // x_0 es i antes del ciclo, o i + c si la parte la lee después del incremento
+    char *first = NULL;
+    if (term->after)
+    {
+        first = typed_temp(INT);
+        add_pending_quad(pending, position, 0, IR_ADD, iv_name, literal_text(step, text, sizeof(text)), first, origin);
+    }
+    const char *x0 = first ? first : iv_name;
+
+    if (kind == TERM_LINEAR)
+    {
+        // B * (N * x_0 + c * T)
+        char *head = typed_temp(INT);
+        char *tail = typed_temp(INT);
+        add_pending_quad(pending, position, 0, IR_MUL, trips, x0, head, origin);
+        add_pending_quad(pending, position, 0, IR_MUL, triangle, literal_text(step, text, sizeof(text)), tail, origin);
+        if (strcmp(term->coefficient, "1") != 0)
+        {
+            char *partial = typed_temp(INT);
+            add_pending_quad(pending, position, 0, IR_ADD, head, tail, partial, origin);
+            add_pending_quad(pending, position, 0, IR_MUL, partial, term->coefficient, sum, origin);
+            free(partial);
+        }
+        else
+            add_pending_quad(pending, position, 0, IR_ADD, head, tail, sum, origin);
+        free(head);
+        free(tail);
+    }
+    else
+    {
+        // N * x_0² + 2 * x_0 * c * T + c² * Q
+        char *x0_squared = typed_temp(INT);
+        char *head = typed_temp(INT);
+        char *cross = typed_temp(INT);
+        char *middle = typed_temp(INT);
+        char *tail = typed_temp(INT);
+        char *partial = typed_temp(INT);
+        add_pending_quad(pending, position, 0, IR_MUL, x0, x0, x0_squared, origin);
+        add_pending_quad(pending, position, 0, IR_MUL, trips, x0_squared, head, origin);
+        add_pending_quad(pending, position, 0, IR_MUL, x0, literal_text(2 * step, text, sizeof(text)), cross, origin);
+        add_pending_quad(pending, position, 0, IR_MUL, cross, triangle, middle, origin);
+        add_pending_quad(pending, position, 0, IR_MUL, squares, literal_text(step * step, text, sizeof(text)), tail,
+                         origin);
+        add_pending_quad(pending, position, 0, IR_ADD, head, middle, partial, origin);
+        add_pending_quad(pending, position, 0, IR_ADD, partial, tail, sum, origin);
+        free(x0_squared);
+        free(head);
+        free(cross);
+        free(middle);
+        free(tail);
+        free(partial);
+    }
+    free(first);
+    return sum;
+}
+
+/*
+ * Decide si el ciclo se reemplaza por su forma cerrada y, si es así, deja en
+ * pending el código nuevo. Devuelve 1 si el ciclo cambió.
+ */
+static int plan_closed_form(ScevContext *ctx, const NaturalLoop *loop, PendingQuads *pending)
+{
+    ControlFlowGraph *cfg = ctx->cfg;
+    Quadruple *code = cfg->code;
+    int h = loop->header;
+    int hs = cfg->blocks[h].start;
+
+    // Encabezado: LABEL, comparación y salto de salida
+    if (code[hs].op != IR_LABEL || cfg->blocks[h].end - hs != 3 || loop->num_blocks != 2)
+        return 0;
+    Quadruple *test = &code[hs + 1];
+    Quadruple *branch = &code[hs + 2];
+    if (test->op != IR_LT && test->op != IR_LE && test->op != IR_GT && test->op != IR_GE)
+        return 0;
+    if (branch->op != IR_IF_FALSE_GOTO || strcmp(branch->arg1, test->result) != 0)
+        return 0;
+    int exit_id = lookup_name(cfg->labels, branch->result);
+    if (exit_id == -1 || loop->in_loop[cfg->label_block[exit_id]])
+        return 0;
+    int t = cfg->def[hs + 1];
+    if (t == -1 || ctx->global_index[t] != -1)
+        return 0;
+    if (!loop_has_preheader_slot(cfg, loop))
+        return 0;
+
+    // El cuerpo es un solo bloque, justo después del encabezado, que termina en el GOTO de regreso
+    int body = cfg->block_of[hs + 3 < cfg->size ? hs + 3 : hs];
+    if (hs + 3 >= cfg->size || !loop->in_loop[body] || body == h)
+        return 0;
+    int end = cfg->blocks[body].end;
+    if (code[end - 1].op != IR_GOTO || strcmp(code[end - 1].result, code[hs].result) != 0)
+        return 0;
+    for (int i = hs + 3; i < end - 1; i++)
+    {
+        if (code[i].op == IR_LABEL || is_jump(code[i].op))
+            return 0;
+    }
+
+    for (int v = 0; v < cfg->vars->count; v++)
+        ctx->evolution[v].known = 0;
+
+    // La prueba compara una variable de inducción con un invariante: iv op bound
+    IROperation op;
+    int iv;
+    const char *bound;
+    long long step;
+    if (!match_counted_test(cfg, hs, end, ctx->def_count, ctx->def_at, &iv, &bound, &op, &step))
+        return 0;
+    if ((step > 0) != (op == IR_LT || op == IR_LE))
+        return 0;
+
+    const char *header_label = code[hs].result;
+    const char *iv_name = cfg->vars->names[iv];
+    int exit_block = cfg->label_block[exit_id];
+
+    // Cada escritura del cuerpo es el incremento, un acumulador o un temporal muerto a la salida
+    int num_accumulators = 0;
+    for (int i = hs + 3; i < end - 1; i++)
+    {
+        Quadruple *q = &code[i];
+        int d = cfg->def[i];
+        if (d == -1 || !quad_is_pure(q))
+            return 0;
+        if (d == iv)
+            continue;
+        if (ctx->def_count[d] != 1)
+            return 0;
+
+        // s = s ± e ± ..., con s leída solo ahí
+        Evolution evolution = quad_evolution(ctx, i, iv);
+        if (evolution.known && evolution.base == d)
+        {
+            int reads = 0;
+            for (int k = hs; k < end; k++)
+                reads += (cfg->use1[k] == d) + (cfg->use2[k] == d);
+            if (reads == 1)
+            {
+                Accumulator *acc = &ctx->accumulators[num_accumulators++];
+                acc->var = d;
+                acc->step = evolution;
+                acc->origin = q;
+                continue;
+            }
+        }
+
+        ctx->evolution[d] = evolution;
+        if (ctx->global_index[d] != -1 && bitset_contiene(ctx->live_in[exit_block], ctx->global_index[d]))
+        {
+            if (q->op == IR_MUL && (cfg->use1[i] == d || cfg->use2[i] == d))
+                emit_remark("scev", REMARK_MISSED, q,
+                            "'%s' se acumula con un producto: no tiene forma cerrada y el ciclo de %s se conserva",
+                            q->result, header_label);
+            return 0;
+        }
+    }
+
+    // Los cuadrados usan 2c y c² como literales
+    int needs_triangle = 0, needs_squares = 0;
+    for (int a = 0; a < num_accumulators; a++)
+    {
+        needs_triangle |= ctx->accumulators[a].step.terms[TERM_LINEAR].present ||
+                          ctx->accumulators[a].step.terms[TERM_SQUARE].present;
+        needs_squares |= ctx->accumulators[a].step.terms[TERM_SQUARE].present;
+    }
+    long long step_squared, step_doubled;
+    if (needs_squares &&
+        (__builtin_mul_overflow(step, step, &step_squared) || __builtin_mul_overflow(step, 2LL, &step_doubled)))
+        return 0;
+
+    // Las condiciones que cambiarían el resultado, si los rangos no las descartan
+    long long iv_lo, iv_hi, bound_lo, bound_hi, unused;
+    operand_range(header_label, iv_name, &iv_lo, &iv_hi);
+    operand_range(header_label, bound, &bound_lo, &bound_hi);
+    // Con paso 1 la distancia se usa sin signo y no hace falta que quepa en un Entero
+    int distance_guard = step != 1 && step != -1 &&
+                         (step > 0 ? __builtin_sub_overflow(bound_hi, iv_lo, &unused)
+                                   : __builtin_sub_overflow(iv_hi, bound_lo, &unused));
+    // Con prueba estricta, la última vuelta queda al menos a un paso del límite
+    int strict = op == IR_LT || op == IR_GT;
+    int final_guard = step > 0 ? __builtin_add_overflow(bound_hi - (strict && bound_hi > LLONG_MIN), step, &unused)
+                               : __builtin_add_overflow(bound_lo + (strict && bound_lo < LLONG_MAX), step, &unused);
+
+    emit_remark("scev", REMARK_APPLIED, test, "el ciclo de %s se reemplaza por su forma cerrada (%d acumulador(es))%s",
+                header_label, num_accumulators,
+                distance_guard || final_guard ? "; el ciclo original queda para los casos que se desbordan" : "");
+
+    char *preheader_label = redirect_loop_entries(cfg, loop);
+    if (preheader_label != NULL)
+        add_pending_quad(pending, hs, 0, IR_LABEL, NULL, NULL, preheader_label, test);
+
+    // Sin vueltas el ciclo no cambia nada
+    char text[32];
+    char *enters = typed_temp(BOOL);
+    add_pending_quad(pending, hs, 0, test->op, test->arg1, test->arg2, enters, test);
+    add_pending_quad(pending, hs, 0, IR_IF_FALSE_GOTO, enters, NULL, branch->result, branch);
+
+    // M = (distancia - [prueba estricta]) / |c|: las vueltas menos una
+    char *distance = typed_temp(INT);
+    add_pending_quad(pending, hs, 0, IR_SUB, step > 0 ? bound : iv_name, step > 0 ? iv_name : bound, distance, test);
+    if (distance_guard)
+    {
+        char *overflow = typed_temp(BOOL);
+        add_pending_quad(pending, hs, 0, IR_LT, distance, "0", overflow, test);
+        add_pending_quad(pending, hs, 0, IR_IF_TRUE_GOTO, overflow, NULL, header_label, test);
+        free(overflow);
+    }
+    char *last_trip = distance;
+    if (strict)
+    {
+        last_trip = typed_temp(INT);
+        add_pending_quad(pending, hs, 0, IR_SUB, distance, "1", last_trip, test);
+    }
+    if (step != 1 && step != -1)
+    {
+        char *quotient = typed_temp(INT);
+        add_pending_quad(pending, hs, 0, IR_DIV, last_trip, literal_text(step > 0 ? step : -step, text, sizeof(text)),
+                         quotient, test);
+        if (last_trip != distance)
+            free(last_trip);
+        last_trip = quotient;
+    }
+
+    // Valor de i en la última vuelta y al salir
+    char *offset = typed_temp(INT);
+    char *last_value = typed_temp(INT);
+    char *final_value = typed_temp(INT);
+    add_pending_quad(pending, hs, 0, IR_MUL, last_trip, literal_text(step, text, sizeof(text)), offset, test);
+    add_pending_quad(pending, hs, 0, IR_ADD, iv_name, offset, last_value, test);
+    add_pending_quad(pending, hs, 0, IR_ADD, last_value, literal_text(step, text, sizeof(text)), final_value,
+                     &code[ctx->def_at[iv]]);
+    if (final_guard)
+    {
+        char *overflow = typed_temp(BOOL);
+        add_pending_quad(pending, hs, 0, step > 0 ? IR_LT : IR_GT, final_value, last_value, overflow, test);
+        add_pending_quad(pending, hs, 0, IR_IF_TRUE_GOTO, overflow, NULL, header_label, test);
+        free(overflow);
+    }
+
+    // N, T y Q según lo que pidan los acumuladores
+    char *trips = NULL, *triangle = NULL, *squares = NULL;
+    if (num_accumulators > 0)
+    {
+        trips = typed_temp(INT);
+        add_pending_quad(pending, hs, 0, IR_ADD, last_trip, "1", trips, test);
+    }
+    if (needs_triangle)
+    {
+        // T = (M / 2) * (M + 1) + (M % 2) * (M / 2 + M % 2), con M sin signo
+        char *shifted = typed_temp(INT);
+        char *half = typed_temp(INT);
+        char *odd = typed_temp(INT);
+        char *even_part = typed_temp(INT);
+        char *rounded = typed_temp(INT);
+        char *odd_part = typed_temp(INT);
+        triangle = typed_temp(INT);
+        add_pending_quad(pending, hs, 0, IR_SHR, last_trip, "1", shifted, test);
+        add_pending_quad(pending, hs, 0, IR_BAND, shifted, "9223372036854775807", half, test);
+        add_pending_quad(pending, hs, 0, IR_BAND, last_trip, "1", odd, test);
+        add_pending_quad(pending, hs, 0, IR_MUL, half, trips, even_part, test);
+        add_pending_quad(pending, hs, 0, IR_ADD, half, odd, rounded, test);
+        add_pending_quad(pending, hs, 0, IR_MUL, odd, rounded, odd_part, test);
+        add_pending_quad(pending, hs, 0, IR_ADD, even_part, odd_part, triangle, test);
+        free(shifted);
+        free(half);
+        free(odd);
+        free(even_part);
+        free(rounded);
+        free(odd_part);
+    }
+    if (needs_squares)
+    {
+        // Q = T * (2M + 1) / 3; la división es exacta, así que basta el inverso de 3 módulo 2^64
+        char *twice = typed_temp(INT);
+        char *odd_factor = typed_temp(INT);
+        char *product = typed_temp(INT);
+        squares = typed_temp(INT);
+        add_pending_quad(pending, hs, 0, IR_ADD, last_trip, last_trip, twice, test);
+        add_pending_quad(pending, hs, 0, IR_ADD, twice, "1", odd_factor, test);
+        add_pending_quad(pending, hs, 0, IR_MUL, triangle, odd_factor, product, test);
+        add_pending_quad(pending, hs, 0, IR_MUL, product, "-6148914691236517205", squares, test);
+        free(twice);
+        free(odd_factor);
+        free(product);
+    }
+
+    for (int a = 0; a < num_accumulators; a++)
+    {
+        Accumulator *acc = &ctx->accumulators[a];
+        const char *name = cfg->vars->names[acc->var];
+        for (int k = 0; k < NUM_TERM_KINDS; k++)
+        {
+            const EvolutionTerm *term = &acc->step.terms[k];
+            if (!term->present)
+                continue;
+            char *sum = emit_term_sum(pending, hs, k, term, iv_name, step, trips, triangle, squares, acc->origin);
+            add_pending_quad(pending, hs, 0, term->negative ? IR_SUB : IR_ADD, name, sum, name, acc->origin);
+            free(sum);
+        }
+    }
+    add_pending_quad(pending, hs, 0, IR_ASSIGN, final_value, NULL, iv_name, &code[ctx->def_at[iv]]);
+    add_pending_quad(pending, hs, 0, IR_GOTO, NULL, NULL, branch->result, branch);
+
+    // Sin pruebas de desbordamiento nadie llega al ciclo original
+    if (!distance_guard && !final_guard)
+    {
+        for (int i = hs; i < end; i++)
+            remove_quad(&code[i]);
+    }
+
+    if (last_trip != distance)
+        free(last_trip);
+    free(distance);
+    free(enters);
+    free(offset);
+    free(last_value);
+    free(final_value);
+    free(trips);
+    free(triangle);
+    free(squares);
+    free(preheader_label);
+    return 1;
+}
+
+int evaluate_closed_forms()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+    int num_blocks = cfg->num_blocks;
+
+    int *order = xcalloc(num_blocks * sizeof(int));
+    int *idom = xcalloc(num_blocks * sizeof(int));
+    int num_reachable = compute_rpo(cfg, order);
+    compute_dominators(cfg, order, num_reachable, idom);
+
+    NaturalLoop *loops;
+    int num_loops = find_natural_loops(cfg, idom, &loops);
+    if (num_loops == 0)
+    {
+        free_natural_loops(loops, num_loops);
+        free(order);
+        free(idom);
+        free_cfg(cfg);
+        return 0;
+    }
+
+    int *global_index = xcalloc((num_vars + 1) * sizeof(int));
+    int num_globals = find_global_names(cfg, global_index);
+
+    ScevContext ctx;
+    ctx.cfg = cfg;
+    ctx.global_index = global_index;
+    ctx.live_in = compute_live_in(cfg, global_index, num_globals);
+    ctx.def_count = xcalloc((num_vars + 1) * sizeof(int));
+    ctx.def_at = xcalloc((num_vars + 1) * sizeof(int));
+    ctx.evolution = xcalloc((num_vars + 1) * sizeof(Evolution));
+    ctx.accumulators = xcalloc((num_vars + 1) * sizeof(Accumulator));
+
+    // Solo los ciclos más internos: sus tramos no se traslapan
+    char *has_inner = xcalloc(num_loops + 1);
+    for (int l = 0; l < num_loops; l++)
+    {
+        if (loops[l].parent != -1)
+            has_inner[loops[l].parent] = 1;
+    }
+
+    PendingQuads pending = {NULL, 0, 0};
+    int replaced = 0;
+    for (int l = 0; l < num_loops; l++)
+    {
+        if (!has_inner[l])
+            replaced += plan_closed_form(&ctx, &loops[l], &pending);
+    }
+    if (replaced > 0)
+        splice_pending_quads(&pending);
+    free_pending_quads(&pending);
+
+    free(has_inner);
+    free(ctx.def_count);
+    free(ctx.def_at);
+    free(ctx.evolution);
+    free(ctx.accumulators);
+    free_block_sets(ctx.live_in, num_blocks);
+    free(global_index);
+    free_natural_loops(loops, num_loops);
+    free(order);
+    free(idom);
+    free_cfg(cfg);
+    return replaced;
+}
@@ -0,0 +1,254 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Simplificación del flujo de control sobre el código lineal.
+ *
+ * Cada transformación es local y barata; se repiten hasta que ninguna cambia
+ * nada, porque una suele habilitar a la otra (un salto constante deja un bloque
+ * inalcanzable, que al borrarse deja una etiqueta sin referencias, etc.).
+ */
+
+/*
+ * Salto condicional sobre un literal: si la condición coincide con la del
+ * salto (cero para IF_FALSE_GOTO, distinto de cero para IF_TRUE_GOTO) siempre
+ * se toma y se convierte en GOTO; en otro caso nunca se toma y se elimina.
+ */
+static int fold_constant_branches(Quadruple *code, int size)
+{
+    int changes = 0;
+    for (int i = 0; i < size; i++)
+    {
+        Quadruple *q = &code[i];
+        if ((q->op != IR_IF_FALSE_GOTO && q->op != IR_IF_TRUE_GOTO) || !es_literal(q->arg1))
+            continue;
+
+        if ((atof(q->arg1) == 0.0) == (q->op == IR_IF_FALSE_GOTO))
+        {
+            emit_remark("simplify-cfg", REMARK_APPLIED, q, "la condición vale siempre %s: el salto a %s siempre se toma",
+                        q->arg1, q->result);
+            q->op = IR_GOTO;
+            free(q->arg1);
+            q->arg1 = NULL;
+        }
+        else
+        {
+            emit_remark("simplify-cfg", REMARK_APPLIED, q, "la condición vale siempre %s: el salto a %s nunca se toma",
+                        q->arg1, q->result);
+            remove_quad(q);
+        }
+        changes++;
+    }
+    return changes;
+}
+
+/*
+ * Redirige los saltos cuyo destino es una etiqueta seguida (tras otras
+ * etiquetas) de un GOTO, directamente al destino final de la cadena.
+ */
+static int thread_jumps(Quadruple *code, int size)
+{
+    NameTable *labels = create_name_table(size / 4);
+    int *label_pos = malloc((size + 1) * sizeof(int));
+    if (label_pos == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para simplificar el flujo de control.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < size; i++)
+    {
+        if (code[i].op == IR_LABEL)
+            label_pos[intern_name(labels, code[i].result)] = i;
+    }
+
+    int changes = 0;
+    for (int i = 0; i < size; i++)
+    {
+        Quadruple *q = &code[i];
+        if (!is_jump(q->op))
+            continue;
+
+        const char *target = q->result;
+        // Un ciclo de GOTOs no puede recorrer más saltos que cuádruplos hay
+        for (int hops = 0; hops < size; hops++)
+        {
+            int id = lookup_name(labels, target);
+            if (id == -1)
+                break;
+            int j = label_pos[id];
+            while (j < size && code[j].op == IR_LABEL)
+                j++;
+            if (j >= size || code[j].op != IR_GOTO || strcmp(code[j].result, target) == 0)
+                break;
+            target = code[j].result;
+        }
+
+        if (strcmp(target, q->result) != 0)
+        {
+            char *new_target = xstrdup(target);
+            free(q->result);
+            q->result = new_target;
+            changes++;
+        }
+    }
+
+    free(label_pos);
+    destroy_name_table(labels);
+    return changes;
+}
+
+/*
+ * "IF_FALSE_GOTO c, L1; GOTO L2; L1:" equivale a "IF_TRUE_GOTO c, L2; L1:" (y
+ * al revés). El código de corto circuito produce este patrón en cada '||'.
+ */
+static int invert_branches_over_jumps(Quadruple *code, int size)
+{
+    int changes = 0;
+    for (int i = 0; i + 2 < size; i++)
+    {
+        Quadruple *q = &code[i];
+        if ((q->op != IR_IF_FALSE_GOTO && q->op != IR_IF_TRUE_GOTO) || code[i + 1].op != IR_GOTO)
+            continue;
+
+        int skips_goto = 0;
+        for (int j = i + 2; j < size && code[j].op == IR_LABEL; j++)
+        {
+            if (strcmp(code[j].result, q->result) == 0)
+            {
+                skips_goto = 1;
+                break;
+            }
+        }
+        if (!skips_goto)
+            continue;
+
+        q->op = q->op == IR_IF_FALSE_GOTO ? IR_IF_TRUE_GOTO : IR_IF_FALSE_GOTO;
+        free(q->result);
+        q->result = code[i + 1].result;
+        code[i + 1].result = NULL;
+        remove_quad(&code[i + 1]);
+        changes++;
+    }
+    return changes;
+}
+
+/*
+ * Un salto a una etiqueta que ya es la siguiente instrucción no hace nada. La
+ * condición de un salto condicional es un nombre o literal, así que no hay efectos que
+ * conservar.
+ */
+static int remove_jumps_to_next(Quadruple *code, int size)
+{
+    int changes = 0;
+    for (int i = 0; i < size; i++)
+    {
+        Quadruple *q = &code[i];
+        if (!is_jump(q->op))
+            continue;
+
+        for (int j = i + 1; j < size && code[j].op == IR_LABEL; j++)
+        {
+            if (strcmp(code[j].result, q->result) == 0)
+            {
+                remove_quad(q);
+                changes++;
+                break;
+            }
+        }
+    }
+    return changes;
+}
+
+static int remove_unreachable_blocks(Quadruple *code, int size)
+{
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int *order = malloc((cfg->num_blocks + 1) * sizeof(int));
+    char *reachable = calloc(cfg->num_blocks + 1, 1);
+    if (order == NULL || reachable == NULL)
+    {
+        fprintf(stderr, "Error: No se pudo asignar memoria para simplificar el flujo de control.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int num_reachable = compute_rpo(cfg, order);
+    for (int k = 0; k < num_reachable; k++)
+        reachable[order[k]] = 1;
+
+    int changes = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (reachable[b])
+            continue;
+        emit_remark("simplify-cfg", REMARK_APPLIED, &code[cfg->blocks[b].start], "se elimina código inalcanzable (%d cuádruplo(s))",
+                    cfg->blocks[b].end - cfg->blocks[b].start);
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            remove_quad(&code[i]);
+            changes++;
+        }
+    }
+
+    free(order);
+    free(reachable);
+    free_cfg(cfg);
+    return changes;
+}
+
+/*
+ * Borrar una etiqueta sin referencias une su bloque con el anterior, que ya
+ * caía en él.
+ */
+static int remove_dead_labels(Quadruple *code, int size)
+{
+    NameTable *targets = create_name_table(size / 4);
+    for (int i = 0; i < size; i++)
+    {
+        if (is_jump(code[i].op))
+            intern_name(targets, code[i].result);
+    }
+
+    int changes = 0;
+    for (int i = 0; i < size; i++)
+    {
+        if (code[i].op == IR_LABEL && lookup_name(targets, code[i].result) == -1)
+        {
+            remove_quad(&code[i]);
+            changes++;
+        }
+    }
+
+    destroy_name_table(targets);
+    return changes;
+}
+
+int simplify_control_flow()
+{
+    int total = 0;
+    int changes;
+
+    do
+    {
+        changes = fold_constant_branches(get_ir_code(), get_ir_code_size());
+        changes += thread_jumps(get_ir_code(), get_ir_code_size());
+        changes += invert_branches_over_jumps(get_ir_code(), get_ir_code_size());
+        changes += remove_jumps_to_next(get_ir_code(), get_ir_code_size());
+        compact_ir_code();
+
+        if (get_ir_code_size() > 0)
+        {
+            changes += remove_unreachable_blocks(get_ir_code(), get_ir_code_size());
+            compact_ir_code();
+        }
+
+        changes += remove_dead_labels(get_ir_code(), get_ir_code_size());
+        compact_ir_code();
+
+        total += changes;
+    } while (changes > 0);
+
+    return total;
+}
@@ -0,0 +1,191 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Reutilización del almacenamiento de los temporales.
+ *
+ * Cada temporal "tN" se convierte en una variable de .bss. Los que son locales
+ * a un bloque (ver find_global_names) están muertos en las fronteras, así que
+ * dentro del bloque su vida es un intervalo [primera definición, último uso].
+ * Los intervalos se colorean en orden de inicio tomando el primer espacio libre
+ * del mismo tipo (coloreado óptimo para intervalos), y cada espacio toma el
+ * nombre del primer temporal que lo ocupó. Un temporal local a varios bloques
+ * puede necesitar un espacio nuevo cuando ya hay otro con su nombre; ese
+ * espacio recibe un temporal nuevo para no compartir la variable. Así el
+ * número de variables temporales depende de la profundidad de las expresiones
+ * y no del tamaño del programa.
+ *
+ * Un intervalo puede empezar en el mismo cuádruplo donde termina otro: el
+ * ensamblador lee todos los operandos antes de escribir el resultado.
+ *
+ * Se ejecuta al final, porque después de ella un temporal ya no tiene una sola
+ * definición.
+ */
+
+typedef struct
+{
+    char **names;
+    int *end;       // último cuádruplo donde está ocupado
+    int count;
+    int capacity;
+} SlotPool;
+
+static int is_temp_name(const char *name)
+{
+    if (name[0] != 't' || name[1] == '\0')
+        return 0;
+    for (const char *p = name + 1; *p; p++)
+    {
+        if (!isdigit((unsigned char)*p))
+            return 0;
+    }
+    return 1;
+}
+
+/* Primer espacio del tipo libre en start, o uno nuevo con el nombre del temporal. */
+static int take_slot(SlotPool *pool, const char *name, enum TipoDato tipo, int start, int end)
+{
+    int taken = 0;
+    for (int k = 0; k < pool->count; k++)
+    {
+        if (pool->end[k] <= start)
+        {
+            pool->end[k] = end;
+            return k;
+        }
+        taken |= strcmp(pool->names[k], name) == 0;
+    }
+
+    if (pool->count == pool->capacity)
+    {
+        pool->capacity = pool->capacity == 0 ? 8 : pool->capacity * 2;
+        pool->names = realloc(pool->names, pool->capacity * sizeof(char *));
+        pool->end = realloc(pool->end, pool->capacity * sizeof(int));
+        if (pool->names == NULL || pool->end == NULL)
+        {
+            fprintf(stderr, "Error: No se pudo asignar memoria para asignar los temporales.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (taken)
+    {
+        // El nombre ya es de un espacio ocupado por un bloque anterior
+        pool->names[pool->count] = new_temp();
+        set_ir_type(pool->names[pool->count], tipo);
+    }
+    else
+    {
+        pool->names[pool->count] = strdup(name);
+    }
+    pool->end[pool->count] = end;
+    return pool->count++;
+}
+
+static void rename_operand(char **field, const char *name)
+{
+    if (strcmp(*field, name) == 0)
+        return;
+    free(*field);
+    *field = strdup(name);
+}
+
+int assign_temp_slots()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+
+    int *global_index = xcalloc((num_vars + 1) * sizeof(int));
+    find_global_names(cfg, global_index);
+
+    // Pool de espacios por tipo; -1 si la variable no se colorea
+    int *pool_of = xcalloc((num_vars + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+    {
+        enum TipoDato tipo = get_ir_type(cfg->vars->names[v]);
+        int colorable = global_index[v] == -1 && is_temp_name(cfg->vars->names[v]) && (int)tipo >= 0 && tipo <= OTRO;
+        pool_of[v] = colorable ? (int)tipo : -1;
+    }
+
+    int *seg_block = xcalloc((num_vars + 1) * sizeof(int));
+    int *seg_start = xcalloc((num_vars + 1) * sizeof(int));
+    int *seg_end = xcalloc((num_vars + 1) * sizeof(int));
+    int *slot_of = xcalloc((num_vars + 1) * sizeof(int));
+    int *segments = xcalloc((num_vars + 1) * sizeof(int));
+    for (int v = 0; v < num_vars; v++)
+        seg_block[v] = -1;
+
+    SlotPool pools[OTRO + 1];
+    memset(pools, 0, sizeof(pools));
+
+    int renamed = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        BasicBlock *bb = &cfg->blocks[b];
+
+        // Intervalos de vida dentro del bloque, en orden de inicio
+        int num_segments = 0;
+        for (int i = bb->start; i < bb->end; i++)
+        {
+            int ids[3] = {cfg->use1[i], cfg->use2[i], cfg->def[i]};
+            for (int k = 0; k < 3; k++)
+            {
+                int v = ids[k];
+                if (v == -1 || pool_of[v] == -1)
+                    continue;
+                if (seg_block[v] != b)
+                {
+                    seg_block[v] = b;
+                    seg_start[v] = i;
+                    segments[num_segments++] = v;
+                }
+                seg_end[v] = i;
+            }
+        }
+
+        for (int s = 0; s < num_segments; s++)
+        {
+            int v = segments[s];
+            slot_of[v] = take_slot(&pools[pool_of[v]], cfg->vars->names[v], (enum TipoDato)pool_of[v], seg_start[v],
+                                  seg_end[v]);
+            if (strcmp(pools[pool_of[v]].names[slot_of[v]], cfg->vars->names[v]) != 0)
+                renamed++;
+        }
+
+        for (int i = bb->start; i < bb->end; i++)
+        {
+            Quadruple *q = &code[i];
+            if (cfg->use1[i] != -1 && pool_of[cfg->use1[i]] != -1)
+                rename_operand(&q->arg1, pools[pool_of[cfg->use1[i]]].names[slot_of[cfg->use1[i]]]);
+            if (cfg->use2[i] != -1 && pool_of[cfg->use2[i]] != -1)
+                rename_operand(&q->arg2, pools[pool_of[cfg->use2[i]]].names[slot_of[cfg->use2[i]]]);
+            if (cfg->def[i] != -1 && pool_of[cfg->def[i]] != -1)
+                rename_operand(&q->result, pools[pool_of[cfg->def[i]]].names[slot_of[cfg->def[i]]]);
+        }
+    }
+
+    for (int t = 0; t <= OTRO; t++)
+    {
+        for (int k = 0; k < pools[t].count; k++)
+            free(pools[t].names[k]);
+        free(pools[t].names);
+        free(pools[t].end);
+    }
+    free(global_index);
+    free(pool_of);
+    free(seg_block);
+    free(seg_start);
+    free(seg_end);
+    free(slot_of);
+    free(segments);
+    free_cfg(cfg);
+    return renamed;
+}
@@ -0,0 +1,440 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Desenrollado de ciclos.
+ *
+ * Se desenrollan los ciclos internos con la forma que producen Para y
+ * Mientras después de las demás pasadas: un encabezado con una sola
+ * comparación y su IF_FALSE_GOTO de salida, un cuerpo contiguo y un único
+ * GOTO de regreso al final. La comparación debe enfrentar una variable de
+ * inducción básica (i = i ± c, su única definición en el ciclo, en un bloque
+ * que domina al de regreso) con un valor invariante, así que cada vuelta
+ * avanza i exactamente una vez.
+ *
+ * Si el valor inicial de i y el límite son literales, la cantidad de vueltas
+ * se calcula simulando la prueba; si el cuerpo repetido cabe en el
+ * presupuesto del nivel, el ciclo se reemplaza por las copias del cuerpo.
+ * En otro caso, con un factor F, se agrega antes del ciclo uno que prueba
+ * i <= n - (F - 1) * c y ejecuta F copias del cuerpo por vuelta; el ciclo
+ * original queda como ciclo de restos. Si n - (F - 1) * c puede desbordarse
+ * y el análisis de rangos no lo descarta, una prueba en el preencabezado
+ * manda directo al ciclo original.
+ *
+ * La pasada se ejecuta una sola vez: ninguna otra la vuelve a encolar, así
+ * que ni el ciclo desenrollado ni el de restos se desenrollan de nuevo.
+ */
+
+typedef struct
+{
+    int max_full_quads;    // cuádruplos que puede ocupar un ciclo desenrollado por completo
+    int default_factor;    // factor de desenrollado parcial si no se da -unroll=N
+    int max_partial_quads; // cuádruplos que pueden ocupar las copias del ciclo parcial
+} UnrollBudget;
+
+typedef struct
+{
+    ControlFlowGraph *cfg;
+    const int *idom;
+    const int *global_index;
+    int *def_count; // definiciones de cada variable dentro del ciclo
+    int *def_at;
+    UnrollBudget budget;
+    int factor;
+} UnrollContext;
+
+static int unroll_factor = 0; // 0: el del nivel de optimización
+
+void set_unroll_factor(int factor)
+{
+    unroll_factor = factor;
+}
+
+static UnrollBudget level_budget()
+{
+    switch (get_optimization_level())
+    {
+    case OPT_O2:
+        return (UnrollBudget){128, 4, 128};
+    default:
+        return (UnrollBudget){32, 1, 32};
+    }
+}
+
+static int comparison_holds(IROperation op, long long a, long long b)
+{
+    switch (op)
+    {
+    case IR_LT:
+        return a < b;
+    case IR_LE:
+        return a <= b;
+    case IR_GT:
+        return a > b;
+    case IR_GE:
+        return a >= b;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Valor de v al entrar al ciclo, si el único camino de entrada cae en el
+ * encabezado después de un ASSIGN literal a v en el mismo bloque.
+ */
+static int entry_value(UnrollContext *ctx, const NaturalLoop *loop, int v, long long *value)
+{
+    ControlFlowGraph *cfg = ctx->cfg;
+    BasicBlock *header = &cfg->blocks[loop->header];
+    int start = header->start;
+    if (start == 0 || is_jump(cfg->code[start - 1].op) || cfg->code[start - 1].op == IR_HALT)
+        return 0;
+
+    int entry = cfg->block_of[start - 1];
+    for (int p = 0; p < header->num_pred; p++)
+    {
+        if (!loop->in_loop[header->pred[p]] && header->pred[p] != entry)
+            return 0;
+    }
+    return int_literal(loop_entry_value(cfg, start, v), value);
+}
+
+/* Valor de la variable de inducción durante una vuelta del desenrollado completo. */
+typedef struct
+{
+    int iv;
+    int def_at;       // su incremento
+    long long before; // valor antes del incremento
+    long long after;
+} KnownIV;
+
+/*
+ * Deja pendiente delante de position una copia de los cuádruplos [start, end)
+ * con etiquetas nuevas para las que se definen dentro de ese tramo. Con known,
+ * los usos de la variable de inducción se reemplazan por su valor en esa
+ * vuelta y el incremento por una asignación del literal.
+ */
+static void copy_body(PendingQuads *pending, int position, const ControlFlowGraph *cfg, int start, int end,
+                      const KnownIV *known)
+{
+    const Quadruple *code = cfg->code;
+    char before[32], after[32];
+    if (known != NULL)
+    {
+        snprintf(before, sizeof(before), "%lld", known->before);
+        snprintf(after, sizeof(after), "%lld", known->after);
+    }
+
+    int num_labels = 0;
+    for (int i = start; i < end; i++)
+        num_labels += code[i].op == IR_LABEL;
+
+    const char **old_names = xcalloc((num_labels + 1) * sizeof(char *));
+    char **new_names = xcalloc((num_labels + 1) * sizeof(char *));
+    num_labels = 0;
+    for (int i = start; i < end; i++)
+    {
+        if (code[i].op == IR_LABEL)
+        {
+            old_names[num_labels] = code[i].result;
+            new_names[num_labels] = new_label();
+            num_labels++;
+        }
+    }
+
+    for (int i = start; i < end; i++)
+    {
+        const Quadruple *q = &code[i];
+        const char *result = q->result;
+        if (q->op == IR_LABEL || is_jump(q->op))
+        {
+            for (int k = 0; k < num_labels; k++)
+            {
+                if (strcmp(result, old_names[k]) == 0)
+                    result = new_names[k];
+            }
+        }
+        if (known != NULL && i == known->def_at)
+        {
+            add_pending_quad(pending, position, 0, IR_ASSIGN, after, NULL, result, q);
+            continue;
+        }
+        const char *arg1 = q->arg1;
+        const char *arg2 = q->arg2;
+        if (known != NULL && cfg->use1[i] == known->iv)
+            arg1 = i < known->def_at ? before : after;
+        if (known != NULL && cfg->use2[i] == known->iv)
+            arg2 = i < known->def_at ? before : after;
+        add_pending_quad(pending, position, 0, q->op, arg1, arg2, result, q);
+    }
+
+    for (int k = 0; k < num_labels; k++)
+        free(new_names[k]);
+    free(new_names);
+    free(old_names);
+}
+
+/*
+ * Decide si el ciclo se desenrolla y, si es así, deja en pending el código
+ * nuevo. Devuelve 1 si el ciclo cambió.
+ */
+static int plan_unroll(UnrollContext *ctx, const NaturalLoop *loop, PendingQuads *pending)
+{
+    ControlFlowGraph *cfg = ctx->cfg;
+    Quadruple *code = cfg->code;
+    int h = loop->header;
+    int hs = cfg->blocks[h].start;
+
+    // Encabezado: LABEL, comparación y salto de salida
+    if (code[hs].op != IR_LABEL || cfg->blocks[h].end - hs != 3)
+        return 0;
+    Quadruple *test = &code[hs + 1];
+    Quadruple *branch = &code[hs + 2];
+    if (test->op != IR_LT && test->op != IR_LE && test->op != IR_GT && test->op != IR_GE)
+        return 0;
+    if (branch->op != IR_IF_FALSE_GOTO || strcmp(branch->arg1, test->result) != 0)
+        return 0;
+    int exit_id = lookup_name(cfg->labels, branch->result);
+    if (exit_id == -1 || loop->in_loop[cfg->label_block[exit_id]])
+        return 0;
+    int t = cfg->def[hs + 1];
+    if (t == -1 || ctx->global_index[t] != -1)
+        return 0;
+
+    // Los bloques del ciclo ocupan un tramo contiguo que termina en el GOTO de regreso
+    int end = hs;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (!loop->in_loop[b])
+            continue;
+        if (cfg->blocks[b].start < hs)
+            return 0;
+        if (cfg->blocks[b].end > end)
+            end = cfg->blocks[b].end;
+    }
+    int blocks_in_range = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (cfg->blocks[b].start >= hs && cfg->blocks[b].start < end)
+        {
+            if (!loop->in_loop[b])
+                return 0;
+            blocks_in_range++;
+        }
+    }
+    if (blocks_in_range != loop->num_blocks)
+        return 0;
+    if (code[end - 1].op != IR_GOTO || strcmp(code[end - 1].result, code[hs].result) != 0)
+        return 0;
+    int latch = cfg->block_of[end - 1];
+    int back_edges = 0;
+    for (int p = 0; p < cfg->blocks[h].num_pred; p++)
+        back_edges += loop->in_loop[cfg->blocks[h].pred[p]];
+    if (back_edges != 1)
+        return 0;
+
+    // La prueba compara una variable de inducción con un invariante: iv op bound
+    IROperation op;
+    int iv;
+    const char *bound;
+    long long step;
+    if (!match_counted_test(cfg, hs, end, ctx->def_count, ctx->def_at, &iv, &bound, &op, &step))
+        return 0;
+    if (!block_dominates(ctx->idom, cfg->block_of[ctx->def_at[iv]], latch))
+        return 0;
+    if ((step > 0) != (op == IR_LT || op == IR_LE))
+        return 0;
+
+    const char *header_label = code[hs].result;
+    const char *iv_name = cfg->vars->names[iv];
+    int body_start = hs + 3;
+    int body_end = end - 1;
+    int body_size = body_end - body_start;
+
+    // Desenrollado completo: la cantidad de vueltas se conoce al compilar
+    long long init, bound_value;
+    int bound_is_literal = int_literal(bound, &bound_value);
+    if (bound_is_literal && entry_value(ctx, loop, iv, &init))
+    {
+        long long max_trips = ctx->budget.max_full_quads / (body_size > 0 ? body_size : 1);
+        long long trips = 0;
+        long long value = init;
+        int overflow = 0;
+        while (trips <= max_trips && comparison_holds(op, value, bound_value))
+        {
+            if (__builtin_add_overflow(value, step, &value))
+            {
+                overflow = 1;
+                break;
+            }
+            trips++;
+        }
+        if (!overflow && trips <= max_trips)
+        {
+            emit_remark("unroll", REMARK_APPLIED, test, "el ciclo de %s da %lld vuelta(s): se desenrolla por completo",
+                        header_label, trips);
+            // Con saltos solo hacia adelante, lo que está antes del incremento ve el valor anterior
+            int forward_only = 1;
+            for (int i = body_start; i < body_end; i++)
+            {
+                int id = is_jump(code[i].op) ? lookup_name(cfg->labels, code[i].result) : -1;
+                if (id != -1 && loop->in_loop[cfg->label_block[id]] && cfg->blocks[cfg->label_block[id]].start <= i)
+                    forward_only = 0;
+            }
+            KnownIV known = {iv, ctx->def_at[iv], init, init};
+            for (long long k = 0; k < trips; k++)
+            {
+                known.before = known.after;
+                known.after = known.before + step;
+                copy_body(pending, hs + 1, cfg, body_start, body_end, forward_only ? &known : NULL);
+            }
+            add_pending_quad(pending, hs + 1, 0, IR_GOTO, NULL, NULL, branch->result, branch);
+            for (int i = hs + 1; i < end; i++)
+                remove_quad(&code[i]);
+            return 1;
+        }
+    }
+
+    // Desenrollado parcial con el ciclo original como ciclo de restos
+    int factor = ctx->factor;
+    while (factor >= 2 && (long long)factor * body_size > ctx->budget.max_partial_quads)
+        factor--;
+    if (factor < 2)
+    {
+        if (ctx->factor >= 2)
+            emit_remark("unroll", REMARK_MISSED, test,
+                        "el cuerpo del ciclo de %s (%d cuádruplos) no cabe en el presupuesto de desenrollado",
+                        header_label, body_size);
+        return 0;
+    }
+    if (!loop_has_preheader_slot(cfg, loop))
+        return 0;
+
+    long long distance;
+    if (__builtin_mul_overflow((long long)(factor - 1), step > 0 ? step : -step, &distance))
+        return 0;
+
+    // Límite del ciclo desenrollado: m = bound - distance (bound + distance si i baja)
+    char *limit;
+    int needs_guard = 0;
+    if (bound_is_literal)
+    {
+        long long limit_value;
+        if (step > 0 ? __builtin_sub_overflow(bound_value, distance, &limit_value)
+                     : __builtin_add_overflow(bound_value, distance, &limit_value))
+            return 0;
+        char text[32];
+        snprintf(text, sizeof(text), "%lld", limit_value);
+        limit = xstrdup(text);
+    }
+    else
+    {
+        long long lo, hi, unused;
+        needs_guard = 1;
+        if (get_loop_header_range(header_label, bound, &lo, &hi))
+            needs_guard = step > 0 ? __builtin_sub_overflow(lo, distance, &unused)
+                                   : __builtin_add_overflow(hi, distance, &unused);
+        limit = new_temp();
+        set_ir_type(limit, INT);
+    }
+
+    emit_remark("unroll", REMARK_APPLIED, test,
+                "el ciclo de %s se desenrolla %d veces; las vueltas restantes quedan en el ciclo original", header_label,
+                factor);
+
+    char *preheader_label = redirect_loop_entries(cfg, loop);
+    if (preheader_label != NULL)
+        add_pending_quad(pending, hs, 0, IR_LABEL, NULL, NULL, preheader_label, test);
+    if (!bound_is_literal)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%lld", distance);
+        add_pending_quad(pending, hs, 0, step > 0 ? IR_SUB : IR_ADD, bound, text, limit, test);
+    }
+    if (needs_guard)
+    {
+        // Si el límite se desbordó, todas las vueltas las hace el ciclo original
+        char *fits = new_temp();
+        set_ir_type(fits, BOOL);
+        add_pending_quad(pending, hs, 0, step > 0 ? IR_LT : IR_GT, limit, bound, fits, test);
+        add_pending_quad(pending, hs, 0, IR_IF_FALSE_GOTO, fits, NULL, header_label, test);
+        free(fits);
+    }
+    char *unrolled_label = new_label();
+    add_pending_quad(pending, hs, 0, IR_LABEL, NULL, NULL, unrolled_label, test);
+    add_pending_quad(pending, hs, 0, op, iv_name, limit, test->result, test);
+    add_pending_quad(pending, hs, 0, IR_IF_FALSE_GOTO, test->result, NULL, header_label, branch);
+    for (int k = 0; k < factor; k++)
+        copy_body(pending, hs, cfg, body_start, body_end, NULL);
+    add_pending_quad(pending, hs, 0, IR_GOTO, NULL, NULL, unrolled_label, &code[end - 1]);
+
+    free(unrolled_label);
+    free(preheader_label);
+    free(limit);
+    return 1;
+}
+
+int unroll_loops()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_vars = cfg->vars->count;
+    int num_blocks = cfg->num_blocks;
+
+    int *order = xcalloc(num_blocks * sizeof(int));
+    int *idom = xcalloc(num_blocks * sizeof(int));
+    int num_reachable = compute_rpo(cfg, order);
+    compute_dominators(cfg, order, num_reachable, idom);
+
+    NaturalLoop *loops;
+    int num_loops = find_natural_loops(cfg, idom, &loops);
+
+    int *global_index = xcalloc((num_vars + 1) * sizeof(int));
+    find_global_names(cfg, global_index);
+
+    UnrollContext ctx;
+    ctx.cfg = cfg;
+    ctx.idom = idom;
+    ctx.global_index = global_index;
+    ctx.def_count = xcalloc((num_vars + 1) * sizeof(int));
+    ctx.def_at = xcalloc((num_vars + 1) * sizeof(int));
+    ctx.budget = level_budget();
+    ctx.factor = unroll_factor > 0 ? unroll_factor : ctx.budget.default_factor;
+
+    // Solo los ciclos más internos: sus tramos no se traslapan
+    char *has_inner = xcalloc(num_loops + 1);
+    for (int l = 0; l < num_loops; l++)
+    {
+        if (loops[l].parent != -1)
+            has_inner[loops[l].parent] = 1;
+    }
+
+    PendingQuads pending = {NULL, 0, 0};
+    int unrolled = 0;
+    for (int l = 0; l < num_loops; l++)
+    {
+        if (!has_inner[l])
+            unrolled += plan_unroll(&ctx, &loops[l], &pending);
+    }
+    if (unrolled > 0)
+        splice_pending_quads(&pending);
+    free_pending_quads(&pending);
+
+    free(has_inner);
+    free(ctx.def_count);
+    free(ctx.def_at);
+    free(global_index);
+    free_natural_loops(loops, num_loops);
+    free(order);
+    free(idom);
+    free_cfg(cfg);
+    return unrolled;
+}
@@ -0,0 +1,257 @@
+#include "optimizer.h"
+#include "cfg.h"
+#include "remarks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Desdoblamiento de ciclos (loop unswitching).
+ *
+ * Un salto condicional dentro de un ciclo cuya condición es una variable que
+ * el ciclo no escribe (por ejemplo el resultado de una comparación que LICM
+ * ya sacó al preencabezado) toma la misma decisión en todas las vueltas. Se
+ * prueba una sola vez antes del ciclo y se ejecuta una de dos versiones:
+ *
+ *     IF_FALSE_GOTO c, F
+ *     copia del ciclo con los saltos sobre c resueltos como verdaderos
+ *     GOTO D
+ *     F: ciclo original con los saltos sobre c resueltos como falsos
+ *     D:
+ *
+ * Las etiquetas internas del ciclo (las de Continuar, el incremento de Para,
+ * las ramas de Si) se renombran en la copia; los saltos a etiquetas de fuera
+ * (Romper, las salidas) se conservan, así que ambas versiones salen al mismo
+ * lugar. Solo se desdoblan los ciclos internos que caben en el presupuesto
+ * y una condición por ciclo. Se ejecuta una vez, antes del desenrollado, para
+ * que cada versión se pueda desenrollar por separado.
+ */
+
+#define UNSWITCH_MAX_LOOP_QUADS 64 // cuádruplos del ciclo que se pueden duplicar
+
+// Orden entre los pendientes de una posición: la salida de un ciclo y luego la entrada del siguiente
+#define TAIL_ORDER 0
+#define HEAD_ORDER 1
+
+static int is_branch_on(const ControlFlowGraph *cfg, int i, int cond)
+{
+    IROperation op = cfg->code[i].op;
+    return (op == IR_IF_FALSE_GOTO || op == IR_IF_TRUE_GOTO) && cfg->use1[i] == cond;
+}
+
+/*
+ * Deja pendiente delante de start una copia de los cuádruplos [start, end)
+ * con etiquetas nuevas para las que se definen en el tramo y con los saltos
+ * sobre cond resueltos como verdaderos.
+ */
+static void copy_true_version(PendingQuads *pending, const ControlFlowGraph *cfg, int start, int end, int cond)
+{
+    const Quadruple *code = cfg->code;
+    int num_labels = 0;
+    for (int i = start; i < end; i++)
+        num_labels += code[i].op == IR_LABEL;
+
+    const char **old_names = xcalloc((num_labels + 1) * sizeof(char *));
+    char **new_names = xcalloc((num_labels + 1) * sizeof(char *));
+    num_labels = 0;
+    for (int i = start; i < end; i++)
+    {
+        if (code[i].op == IR_LABEL)
+        {
+            old_names[num_labels] = code[i].result;
+            new_names[num_labels] = new_label();
+            num_labels++;
+        }
+    }
+
+    for (int i = start; i < end; i++)
+    {
+        const Quadruple *q = &code[i];
+        if (is_branch_on(cfg, i, cond) && q->op == IR_IF_FALSE_GOTO)
+            continue;
+
+        const char *result = q->result;
+        if (q->op == IR_LABEL || is_jump(q->op))
+        {
+            for (int k = 0; k < num_labels; k++)
+            {
+                if (strcmp(result, old_names[k]) == 0)
+                    result = new_names[k];
+            }
+        }
+        if (is_branch_on(cfg, i, cond))
+            add_pending_quad(pending, start, HEAD_ORDER, IR_GOTO, NULL, NULL, result, q);
+        else
+            add_pending_quad(pending, start, HEAD_ORDER, q->op, q->arg1, q->arg2, result, q);
+    }
+
+    for (int k = 0; k < num_labels; k++)
+        free(new_names[k]);
+    free(new_names);
+    free(old_names);
+}
+
+/* Resuelve en el ciclo original los saltos sobre cond como falsos. */
+static void fold_false_version(ControlFlowGraph *cfg, int start, int end, int cond)
+{
+    for (int i = start; i < end; i++)
+    {
+        if (!is_branch_on(cfg, i, cond))
+            continue;
+        Quadruple *q = &cfg->code[i];
+        free(q->arg1);
+        q->arg1 = NULL;
+        if (q->op == IR_IF_FALSE_GOTO)
+            q->op = IR_GOTO;
+        else
+        {
+            free(q->result);
+            q->result = NULL;
+            q->op = IR_REMOVED;
+        }
+    }
+}
+
+/*
+ * Busca en el ciclo un salto sobre una variable invariante y, si el ciclo cabe
+ * en el presupuesto, deja en pending el código nuevo. Devuelve 1 si el
+ * ciclo cambió.
+ */
+static int plan_unswitch(ControlFlowGraph *cfg, const NaturalLoop *loop, int *def_count, PendingQuads *pending)
+{
+    Quadruple *code = cfg->code;
+    int h = loop->header;
+    int hs = cfg->blocks[h].start;
+    if (!loop_has_preheader_slot(cfg, loop))
+        return 0;
+
+    // El ciclo ocupa un tramo contiguo
+    int end = hs;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (!loop->in_loop[b])
+            continue;
+        if (cfg->blocks[b].start < hs)
+            return 0;
+        if (cfg->blocks[b].end > end)
+            end = cfg->blocks[b].end;
+    }
+    int blocks_in_range = 0;
+    for (int b = 0; b < cfg->num_blocks; b++)
+    {
+        if (cfg->blocks[b].start >= hs && cfg->blocks[b].start < end)
+        {
+            if (!loop->in_loop[b])
+                return 0;
+            blocks_in_range++;
+        }
+    }
+    if (blocks_in_range != loop->num_blocks || end >= cfg->size)
+        return 0;
+
+    for (int v = 0; v < cfg->vars->count; v++)
+        def_count[v] = 0;
+    for (int i = hs; i < end; i++)
+    {
+        if (cfg->def[i] != -1)
+            def_count[cfg->def[i]]++;
+    }
+
+    int cond = -1;
+    int branch_at = -1;
+    for (int i = hs; i < end && cond == -1; i++)
+    {
+        Quadruple *q = &code[i];
+        if ((q->op == IR_IF_FALSE_GOTO || q->op == IR_IF_TRUE_GOTO) && cfg->use1[i] != -1 &&
+            def_count[cfg->use1[i]] == 0)
+        {
+            cond = cfg->use1[i];
+            branch_at = i;
+        }
+    }
+    if (cond == -1)
+        return 0;
+
+    const char *header_label = code[hs].result;
+    const char *cond_name = cfg->vars->names[cond];
+    if (end - hs > UNSWITCH_MAX_LOOP_QUADS)
+    {
+        emit_remark("unswitch", REMARK_MISSED, &code[branch_at],
+                    "'%s' no cambia en el ciclo de %s, pero el ciclo (%d cuádruplos) excede el presupuesto para duplicarlo",
+                    cond_name, header_label, end - hs);
+        return 0;
+    }
+    emit_remark("unswitch", REMARK_APPLIED, &code[branch_at],
+                "'%s' no cambia en el ciclo de %s: se prueba una vez antes del ciclo y cada resultado tiene su versión",
+                cond_name, header_label);
+
+    char *false_label = new_label();
+    char *done_label = new_label();
+
+    char *preheader_label = redirect_loop_entries(cfg, loop);
+    if (preheader_label != NULL)
+        add_pending_quad(pending, hs, HEAD_ORDER, IR_LABEL, NULL, NULL, preheader_label, &code[hs]);
+    add_pending_quad(pending, hs, HEAD_ORDER, IR_IF_FALSE_GOTO, cond_name, NULL, false_label, &code[branch_at]);
+    copy_true_version(pending, cfg, hs, end, cond);
+    IROperation last = pending->quads[pending->count - 1].quad.op;
+    if (last != IR_GOTO && last != IR_HALT)
+        add_pending_quad(pending, hs, HEAD_ORDER, IR_GOTO, NULL, NULL, done_label, &code[end - 1]);
+    add_pending_quad(pending, hs, HEAD_ORDER, IR_LABEL, NULL, NULL, false_label, &code[hs]);
+
+    // La etiqueta de salida va antes de lo que otro ciclo inserte en la misma posición
+    add_pending_quad(pending, end, TAIL_ORDER, IR_LABEL, NULL, NULL, done_label, &code[end]);
+
+    fold_false_version(cfg, hs, end, cond);
+
+    free(preheader_label);
+    free(false_label);
+    free(done_label);
+    return 1;
+}
+
+int unswitch_loops()
+{
+    Quadruple *code = get_ir_code();
+    int size = get_ir_code_size();
+    if (size == 0)
+        return 0;
+
+    ControlFlowGraph *cfg = build_cfg(code, size);
+    int num_blocks = cfg->num_blocks;
+
+    int *order = xcalloc(num_blocks * sizeof(int));
+    int *idom = xcalloc(num_blocks * sizeof(int));
+    int num_reachable = compute_rpo(cfg, order);
+    compute_dominators(cfg, order, num_reachable, idom);
+
+    NaturalLoop *loops;
+    int num_loops = find_natural_loops(cfg, idom, &loops);
+
+    // Solo los ciclos más internos: sus tramos no se traslapan
+    char *has_inner = xcalloc(num_loops + 1);
+    for (int l = 0; l < num_loops; l++)
+    {
+        if (loops[l].parent != -1)
+            has_inner[loops[l].parent] = 1;
+    }
+
+    int *def_count = xcalloc((cfg->vars->count + 1) * sizeof(int));
+    PendingQuads pending = {NULL, 0, 0};
+    int unswitched = 0;
+    for (int l = 0; l < num_loops; l++)
+    {
+        if (!has_inner[l])
+            unswitched += plan_unswitch(cfg, &loops[l], def_count, &pending);
+    }
+    if (unswitched > 0)
+        splice_pending_quads(&pending);
+    free_pending_quads(&pending);
+
+    free(def_count);
+    free(has_inner);
+    free_natural_loops(loops, num_loops);
+    free(order);
+    free(idom);
+    free_cfg(cfg);
+    return unswitched;
+}
@@ -91,6 +91,8 @@ ASTNode *crearNodoAST(enum ASTNodeType type, int renglon, int columna)
     newNode->tipoconstante = -1;
     newNode->declared_type_info = -1;
     newNode->ir_result_name = NULL;
+    newNode->ir_need = -1;
+    newNode->ambito = NULL;
 
     return newNode;
 }
@@ -525,6 +527,39 @@ ASTNode *parseUpdateStatement()
     return NULL;
 }
 
+/*
+ * 'Paso k' en la actualización de un 'Para': la variable que se inicializa
+ * avanza k en cada vuelta. El nodo tiene la forma de una asignación, con la
+ * variable a la izquierda y el paso a la derecha.
+ */
+ASTNode *parsePaso(ASTNode *init_stmt)
+{
+    struct Token *paso_token = consumirToken();
+
+    if (init_stmt == NULL || init_stmt->hijo_izq == NULL || init_stmt->hijo_izq->type != AST_IDENTIFICADOR)
+    {
+        fprintf(stderr, "Error de sintaxis (R%d, C%d): 'Paso' requiere una inicialización en el 'Para' que indique la variable del ciclo.\n",
+                paso_token->Renglon, paso_token->Columna);
+        exit(EXIT_FAILURE);
+    }
+
+    ASTNode *step_expr = parseExpresion();
+    if (step_expr == NULL)
+    {
+        fprintf(stderr, "Error de sintaxis (R%d, C%d): Se esperaba una expresión después de 'Paso'.\n",
+                paso_token->Renglon, paso_token->Columna);
+        exit(EXIT_FAILURE);
+    }
+
+    ASTNode *id_node = crearNodoAST(AST_IDENTIFICADOR, paso_token->Renglon, paso_token->Columna);
+    id_node->valor.nombre_id = strdup(init_stmt->hijo_izq->valor.nombre_id);
+
+    ASTNode *paso_node = crearNodoAST(AST_PASO_STMT, paso_token->Renglon, paso_token->Columna);
+    paso_node->hijo_izq = id_node;
+    paso_node->hijo_der = step_expr;
+    return paso_node;
+}
+
 ASTNode *parseMostrarStmt()
 {
     struct Token *mostrar_token = consumirToken();
@@ -654,7 +689,7 @@ ASTNode *parseExpresionAND()
 ASTNode *parseExpresionNOT()
 {
     struct Token *current_token = peekToken();
-    if (current_token != NULL && current_token->TipoToken == PalRes && strcmp(current_token->Lexema, "!") == 0)
+    if (current_token != NULL && current_token->TipoToken == OPLOG && strcmp(current_token->Lexema, "!") == 0)
     {
         consumirToken();
         ASTNode *not_expr_node = crearNodoAST(AST_NOT_EXPR, current_token->Renglon, current_token->Columna);
@@ -839,10 +874,12 @@ ASTNode *parseFactor()
 
         node->valor.valor_cadena = strdup(current_token->Lexema);
         break;
+    case OPAR:
     case ESPECIAL:
         if (strcmp(current_token->Lexema, "-") == 0)
         {
-            match(ESPECIAL, "-");
+            // El lexer entrega '-' como operador aritmético
+            consumirToken();
             ASTNode *neg_expr = parseFactor();
             if (neg_expr == NULL)
             {
@@ -939,22 +976,27 @@ ASTNode *parseSentenciaCondicional()
     if_node->hijo_izq = condition_expr;
     if_node->hijo_der = then_block;
 
-    ASTNode *current_else_chain_tail = if_node;
+    // La rama 'Sino' se enlaza como hermana del bloque 'entonces', donde la busca la generación de código
+    ASTNode *current_else_chain_tail = then_block;
 
     struct Token *peek_next_keyword = peekToken();
-    while (peek_next_keyword != NULL && strcmp(peek_next_keyword->Lexema, "Sino") == 0)
+    while (peek_next_keyword != NULL &&
+           (strcmp(peek_next_keyword->Lexema, "Sino") == 0 || strcmp(peek_next_keyword->Lexema, "Encambio") == 0))
     {
+        // 'Encambio (c) { ... }' es la forma corta de 'Sino Si (c) { ... }'
+        int es_encambio = strcmp(peek_next_keyword->Lexema, "Encambio") == 0;
         consumirToken();
 
-        peek_next_keyword = peekToken();
+        if (!es_encambio)
+            peek_next_keyword = peekToken();
 
-        if (peek_next_keyword != NULL && strcmp(peek_next_keyword->Lexema, "Si") == 0)
+        if (es_encambio || (peek_next_keyword != NULL && strcmp(peek_next_keyword->Lexema, "Si") == 0))
         {
-            consumirToken();
+            if (!es_encambio)
+                consumirToken();
 
             ASTNode *else_if_wrapper_node = crearNodoAST(AST_SINO_STMT, peek_next_keyword->Renglon, peek_next_keyword->Columna);
             current_else_chain_tail->siguiente_hermano = else_if_wrapper_node;
-            current_else_chain_tail = else_if_wrapper_node;
 
             ASTNode *nested_if_node = crearNodoAST(AST_SI_STMT, peek_next_keyword->Renglon, peek_next_keyword->Columna);
             else_if_wrapper_node->hijo_izq = nested_if_node;
@@ -982,6 +1024,7 @@ ASTNode *parseSentenciaCondicional()
 
             nested_if_node->hijo_izq = else_if_condition;
             nested_if_node->hijo_der = else_if_block;
+            current_else_chain_tail = else_if_block;
 
             peek_next_keyword = peekToken();
         }
@@ -1090,7 +1133,11 @@ ASTNode *parseSentenciaBuclePara()
 
     ASTNode *increment_stmt = NULL;
     struct Token *peek_inc = peekToken();
-    if (peek_inc != NULL && !(peek_inc->TipoToken == ESPECIAL && strcmp(peek_inc->Lexema, ")") == 0))
+    if (peek_inc != NULL && peek_inc->TipoToken == PalRes && strcmp(peek_inc->Lexema, "Paso") == 0)
+    {
+        increment_stmt = parsePaso(init_stmt);
+    }
+    else if (peek_inc != NULL && !(peek_inc->TipoToken == ESPECIAL && strcmp(peek_inc->Lexema, ")") == 0))
     {
         increment_stmt = parseUpdateStatement();
     }
@@ -1161,6 +1208,7 @@ const char *ASTNodeTypeNames[] = {
     "AST_MIENTRAS_STMT",
     "AST_PARA_STMT",
     "AST_FOR_PARAMS",
+    "AST_PASO_STMT",
     "AST_CONTINUAR_STMT",
     "AST_ROMPER_STMT",
     "AST_OR_EXPR",
@@ -369,6 +369,7 @@ void visit_ast_semantic(ASTNode *node)
     {
         TablaSimbolos *nuevo_ambito = crear_tabla_simbolos(ambito_actual);
         ambito_actual = nuevo_ambito;
+        node->ambito = nuevo_ambito;
 
         ASTNode *current = node->hijo_izq;
         while (current != NULL)
@@ -544,9 +545,9 @@ void visit_ast_semantic(ASTNode *node)
                                      tipoDatoToString(node->hijo_izq->resolved_type));
         }
         visit_ast_semantic(node->hijo_der);
-        if (node->siguiente_hermano != NULL && node->siguiente_hermano->type == AST_SINO_STMT)
+        if (node->hijo_der->siguiente_hermano != NULL && node->hijo_der->siguiente_hermano->type == AST_SINO_STMT)
         {
-            visit_ast_semantic(node->siguiente_hermano);
+            visit_ast_semantic(node->hijo_der->siguiente_hermano);
         }
         break;
     }
@@ -575,6 +576,7 @@ void visit_ast_semantic(ASTNode *node)
     {
         TablaSimbolos *nuevo_ambito_para = crear_tabla_simbolos(ambito_actual);
         ambito_actual = nuevo_ambito_para;
+        node->ambito = nuevo_ambito_para;
 
         ASTNode *for_params_node = node->hijo_izq;
         ASTNode *inicializacion_node = NULL;
@@ -644,10 +646,53 @@ void visit_ast_semantic(ASTNode *node)
         break;
     }
 
+    case AST_PASO_STMT:
+    {
+        // 'Paso k' suma k a la variable del 'Para', que debe ser numérica y asignable
+        visit_ast_semantic(node->hijo_izq);
+        visit_ast_semantic(node->hijo_der);
+
+        enum TipoDato tipo_variable = node->hijo_izq->resolved_type;
+        enum TipoDato tipo_paso = node->hijo_der->resolved_type;
+        EntradaSimbolo *entrada = buscar_simbolo(ambito_actual, node->hijo_izq->valor.nombre_id);
+        node->resolved_type = TIPO_ERROR;
+
+        if (entrada != NULL && entrada->es_constante)
+        {
+            reportar_error_semantico(node->renglon, node->columna,
+                                     "No se puede asignar a la constante '%s'.", node->hijo_izq->valor.nombre_id);
+        }
+        else if (tipo_variable != TIPO_ERROR && tipo_variable != INT && tipo_variable != FLOAT)
+        {
+            reportar_error_semantico(node->renglon, node->columna,
+                                     "'Paso' requiere una variable numerica, se encontro %s.",
+                                     tipoDatoToString(tipo_variable));
+        }
+        else if (tipo_paso != TIPO_ERROR && tipo_paso != INT && (tipo_paso != FLOAT || tipo_variable != FLOAT))
+        {
+            reportar_error_semantico(node->hijo_der->renglon, node->hijo_der->columna,
+                                     "El paso de una variable %s debe ser %s, se encontro %s.",
+                                     tipoDatoToString(tipo_variable), tipo_variable == INT ? "Entero" : "numerico",
+                                     tipoDatoToString(tipo_paso));
+        }
+        else if ((node->hijo_der->type == AST_LITERAL_ENTERO || node->hijo_der->type == AST_LITERAL_FLOTANTE) &&
+                 node->hijo_der->valor.valor_numero == 0)
+        {
+            reportar_error_semantico(node->hijo_der->renglon, node->hijo_der->columna,
+                                     "El paso del bucle 'Para' no puede ser cero.");
+        }
+        else if (tipo_variable != TIPO_ERROR && tipo_paso != TIPO_ERROR)
+        {
+            node->resolved_type = tipo_variable;
+        }
+        break;
+    }
+
     case AST_SUMA_EXPR:
     case AST_RESTA_EXPR:
     case AST_MULT_EXPR:
     case AST_DIV_EXPR:
+    case AST_MOD_EXPR:
     {
         visit_ast_semantic(node->hijo_izq);
         visit_ast_semantic(node->hijo_der);
@@ -0,0 +1,126 @@
+#include "bitset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+BitSet *bitset_crear(int num_bits)
+{
+    BitSet *set = malloc(sizeof(BitSet));
+    if (set == NULL)
+    {
+        perror("Error al asignar memoria para BitSet");
+        exit(EXIT_FAILURE);
+    }
+
+    set->num_bits = num_bits;
+    set->num_palabras = (num_bits + BITS_POR_PALABRA - 1) / BITS_POR_PALABRA;
+    set->palabras = calloc(set->num_palabras > 0 ? set->num_palabras : 1, sizeof(bitword));
+    if (set->palabras == NULL)
+    {
+        perror("Error al asignar memoria para BitSet");
+        exit(EXIT_FAILURE);
+    }
+    return set;
+}
+
+void bitset_destruir(BitSet *set)
+{
+    if (set == NULL)
+        return;
+    free(set->palabras);
+    free(set);
+}
+
+void bitset_agregar(BitSet *set, int i)
+{
+    set->palabras[i / BITS_POR_PALABRA] |= (bitword)1 << (i % BITS_POR_PALABRA);
+}
+
+void bitset_quitar(BitSet *set, int i)
+{
+    set->palabras[i / BITS_POR_PALABRA] &= ~((bitword)1 << (i % BITS_POR_PALABRA));
+}
+
+int bitset_contiene(const BitSet *set, int i)
+{
+    return (set->palabras[i / BITS_POR_PALABRA] >> (i % BITS_POR_PALABRA)) & 1;
+}
+
+void bitset_vaciar(BitSet *set)
+{
+    memset(set->palabras, 0, set->num_palabras * sizeof(bitword));
+}
+
+void bitset_llenar(BitSet *set)
+{
+    memset(set->palabras, 0xff, set->num_palabras * sizeof(bitword));
+
+    // Los bits sobrantes de la última palabra se mantienen en cero
+    int sobrantes = set->num_palabras * BITS_POR_PALABRA - set->num_bits;
+    if (sobrantes > 0)
+        set->palabras[set->num_palabras - 1] >>= sobrantes;
+}
+
+void bitset_copiar(BitSet *destino, const BitSet *origen)
+{
+    memcpy(destino->palabras, origen->palabras, destino->num_palabras * sizeof(bitword));
+}
+
+int bitset_iguales(const BitSet *a, const BitSet *b)
+{
+    return memcmp(a->palabras, b->palabras, a->num_palabras * sizeof(bitword)) == 0;
+}
+
+int bitset_unir(BitSet *destino, const BitSet *origen)
+{
+    int cambio = 0;
+    for (int i = 0; i < destino->num_palabras; i++)
+    {
+        bitword nuevo = destino->palabras[i] | origen->palabras[i];
+        if (nuevo != destino->palabras[i])
+        {
+            destino->palabras[i] = nuevo;
+            cambio = 1;
+        }
+    }
+    return cambio;
+}
+
+int bitset_intersectar(BitSet *destino, const BitSet *origen)
+{
+    int cambio = 0;
+    for (int i = 0; i < destino->num_palabras; i++)
+    {
+        bitword nuevo = destino->palabras[i] & origen->palabras[i];
+        if (nuevo != destino->palabras[i])
+        {
+            destino->palabras[i] = nuevo;
+            cambio = 1;
+        }
+    }
+    return cambio;
+}
+
+void bitset_restar(BitSet *destino, const BitSet *origen)
+{
+    for (int i = 0; i < destino->num_palabras; i++)
+        destino->palabras[i] &= ~origen->palabras[i];
+}
+
+int bitset_siguiente(const BitSet *set, int desde)
+{
+    if (desde < 0)
+        desde = 0;
+    if (desde >= set->num_bits)
+        return -1;
+
+    int palabra = desde / BITS_POR_PALABRA;
+    bitword resto = set->palabras[palabra] & (~(bitword)0 << (desde % BITS_POR_PALABRA));
+    while (resto == 0)
+    {
+        if (++palabra >= set->num_palabras)
+            return -1;
+        resto = set->palabras[palabra];
+    }
+    return palabra * BITS_POR_PALABRA + __builtin_ctzll(resto);
+}